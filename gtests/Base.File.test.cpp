@@ -83,6 +83,67 @@ TEST(BaseTest, FileTest)
 
 }
 
+TEST(BaseTest, MappedFileTest)
+{
+	std::string dataPath = _u8(TEST_DATA_PATH);
+
+	saba::MappedFile file;
+	EXPECT_EQ(false, file.IsOpen());
+	EXPECT_EQ(nullptr, file.GetData());
+	EXPECT_EQ(0, file.GetSize());
+
+	EXPECT_EQ(false, file.Open(dataPath + u8"/not_found.txt"));
+	EXPECT_EQ(false, file.IsOpen());
+
+	EXPECT_EQ(true, file.Open(dataPath + u8"/日本語.txt"));
+	EXPECT_EQ(true, file.IsOpen());
+	EXPECT_EQ(4, file.GetSize());
+
+	// BufferReader のテスト
+	saba::BufferReader reader(file.GetData(), file.GetSize());
+	EXPECT_EQ(4, reader.GetSize());
+	EXPECT_EQ(0, reader.Tell());
+
+	char ch = 0;
+	EXPECT_EQ(true, reader.Read(&ch));
+	EXPECT_EQ('1', ch);
+	EXPECT_EQ(1, reader.Tell());
+
+	EXPECT_EQ(true, reader.CanRead(3));
+	EXPECT_EQ(false, reader.CanRead(4));
+	EXPECT_EQ(false, reader.CanRead(2, 2));
+	EXPECT_EQ(false, reader.CanRead(-1));
+
+	char buf[3] = {};
+	EXPECT_EQ(true, reader.Read(buf, 3));
+	EXPECT_EQ('2', buf[0]);
+	EXPECT_EQ('4', buf[2]);
+	EXPECT_EQ(true, reader.IsEOF());
+	EXPECT_EQ(false, reader.IsBad());
+
+	// 範囲外は読まずに bad になる
+	EXPECT_EQ(false, reader.Read(&ch));
+	EXPECT_EQ(true, reader.IsBad());
+	EXPECT_EQ(4, reader.Tell());
+	reader.ClearBadFlag();
+
+	EXPECT_EQ(false, reader.Seek(1, saba::File::SeekDir::End));
+	EXPECT_EQ(true, reader.IsBad());
+	reader.ClearBadFlag();
+	EXPECT_EQ(true, reader.Seek(-2, saba::File::SeekDir::End));
+	EXPECT_EQ(2, reader.Tell());
+
+	auto view = reader.ReadView(2);
+	ASSERT_NE(nullptr, view);
+	EXPECT_EQ('3', view[0]);
+	EXPECT_EQ(nullptr, reader.ReadView(1));
+
+	file.Close();
+	EXPECT_EQ(false, file.IsOpen());
+	EXPECT_EQ(nullptr, file.GetData());
+	EXPECT_EQ(0, file.GetSize());
+}
+
 TEST(BaseTest, TextFileReader)
 {
 	std::string dataPath = _u8(TEST_DATA_PATH);
@@ -0,0 +1,88 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/JobSystem.h>
+
+#include <atomic>
+#include <vector>
+
+TEST(BaseTest, JobSystemRunWait)
+{
+	saba::JobSystem jobSystem(3);
+	EXPECT_EQ(3, jobSystem.GetWorkerCount());
+	EXPECT_EQ(4, jobSystem.GetConcurrency());
+
+	std::atomic<int> counter(0);
+	saba::JobGroup group;
+	for (int i = 0; i < 100; i++)
+	{
+		jobSystem.Run(&group, [&counter]() { counter++; });
+	}
+	jobSystem.Wait(&group);
+	EXPECT_TRUE(group.IsDone());
+	EXPECT_EQ(100, counter);
+
+	// ジョブの中からジョブを追加する
+	std::atomic<int> nestedCounter(0);
+	saba::JobGroup outerGroup;
+	for (int i = 0; i < 8; i++)
+	{
+		jobSystem.Run(&outerGroup, [&jobSystem, &nestedCounter]() {
+			saba::JobGroup innerGroup;
+			for (int j = 0; j < 8; j++)
+			{
+				jobSystem.Run(&innerGroup, [&nestedCounter]() { nestedCounter++; });
+			}
+			jobSystem.Wait(&innerGroup);
+		});
+	}
+	jobSystem.Wait(&outerGroup);
+	EXPECT_EQ(64, nestedCounter);
+}
+
+TEST(BaseTest, JobSystemParallelFor)
+{
+	saba::JobSystem jobSystem(2);
+
+	std::vector<int> values(1001, 0);
+	jobSystem.ParallelFor(values.size(), 7, [&values](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			values[i]++;
+		}
+	});
+	for (const auto& value : values)
+	{
+		EXPECT_EQ(1, value);
+	}
+
+	// 範囲数が要素数より多い場合
+	std::vector<int> smallValues(3, 0);
+	jobSystem.ParallelFor(smallValues.size(), 16, [&smallValues](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			smallValues[i]++;
+		}
+	});
+	EXPECT_EQ(1, smallValues[0]);
+	EXPECT_EQ(1, smallValues[1]);
+	EXPECT_EQ(1, smallValues[2]);
+
+	jobSystem.ParallelFor(0, 4, [](size_t, size_t) { FAIL(); });
+}
+
+TEST(BaseTest, JobSystemNoWorker)
+{
+	// ワーカーが無くても Wait() を呼んだスレッドで処理される
+	saba::JobSystem jobSystem(0);
+	EXPECT_EQ(0, jobSystem.GetWorkerCount());
+	EXPECT_EQ(1, jobSystem.GetConcurrency());
+
+	int counter = 0;
+	saba::JobGroup group;
+	for (int i = 0; i < 10; i++)
+	{
+		jobSystem.Run(&group, [&counter]() { counter++; });
+	}
+	jobSystem.Wait(&group);
+	EXPECT_EQ(10, counter);
+}
@@ -0,0 +1,75 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/NumberFormat.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace
+{
+	std::string FormatFloatString(float value)
+	{
+		char buffer[saba::FormatFloatBufferSize];
+		char* end = saba::FormatFloat(buffer, value);
+		return std::string(buffer, end);
+	}
+
+	std::string FormatUIntString(uint64_t value)
+	{
+		char buffer[saba::FormatUIntBufferSize];
+		char* end = saba::FormatUInt(buffer, value);
+		return std::string(buffer, end);
+	}
+}
+
+TEST(BaseTest, FormatFloat)
+{
+	EXPECT_EQ(std::string("0"), FormatFloatString(0.0f));
+	EXPECT_EQ(std::string("-0"), FormatFloatString(-0.0f));
+	EXPECT_EQ(std::string("1"), FormatFloatString(1.0f));
+	EXPECT_EQ(std::string("-2.5"), FormatFloatString(-2.5f));
+	EXPECT_EQ(std::string("0.1"), FormatFloatString(0.1f));
+	EXPECT_EQ(std::string("0.3"), FormatFloatString(0.3f));
+	EXPECT_EQ(std::string("123456.7"), FormatFloatString(123456.7f));
+	EXPECT_EQ(std::string("0.00001"), FormatFloatString(0.00001f));
+	EXPECT_EQ(std::string("1e-6"), FormatFloatString(0.000001f));
+	EXPECT_EQ(std::string("100000000"), FormatFloatString(100000000.0f));
+	EXPECT_EQ(std::string("1e9"), FormatFloatString(1000000000.0f));
+	EXPECT_EQ(std::string("16777216"), FormatFloatString(16777216.0f));
+	EXPECT_EQ(std::string("3.4028235e38"), FormatFloatString(std::numeric_limits<float>::max()));
+	EXPECT_EQ(std::string("1.1754944e-38"), FormatFloatString(std::numeric_limits<float>::min()));
+	EXPECT_EQ(std::string("1e-45"), FormatFloatString(std::numeric_limits<float>::denorm_min()));
+	EXPECT_EQ(std::string("inf"), FormatFloatString(std::numeric_limits<float>::infinity()));
+	EXPECT_EQ(std::string("-inf"), FormatFloatString(-std::numeric_limits<float>::infinity()));
+	EXPECT_EQ(std::string("nan"), FormatFloatString(std::numeric_limits<float>::quiet_NaN()));
+
+	// 読み込むと元の値に戻る
+	std::mt19937 rand(1234);
+	for (int i = 0; i < 100000; i++)
+	{
+		uint32_t bits = rand();
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		if (std::isnan(value) || std::isinf(value))
+		{
+			continue;
+		}
+
+		auto str = FormatFloatString(value);
+		EXPECT_GE(saba::FormatFloatBufferSize, str.size());
+		float readValue = strtof(str.c_str(), nullptr);
+		EXPECT_EQ(0, memcmp(&value, &readValue, sizeof(value))) << str;
+	}
+}
+
+TEST(BaseTest, FormatUInt)
+{
+	EXPECT_EQ(std::string("0"), FormatUIntString(0));
+	EXPECT_EQ(std::string("7"), FormatUIntString(7));
+	EXPECT_EQ(std::string("1234567890"), FormatUIntString(1234567890));
+	EXPECT_EQ(std::string("18446744073709551615"), FormatUIntString(std::numeric_limits<uint64_t>::max()));
+}
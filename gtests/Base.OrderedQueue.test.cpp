@@ -0,0 +1,143 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/OrderedQueue.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(BaseTest, OrderedQueueOrder)
+{
+	saba::OrderedQueue<std::unique_ptr<int>> queue(4);
+	queue.Reset(4);
+
+	// 逆順に追加しても番号順に取り出す
+	for (int i = 3; i >= 0; i--)
+	{
+		EXPECT_EQ(true, queue.Push(size_t(i), std::make_unique<int>(i * 10)));
+	}
+	EXPECT_EQ(4, queue.GetPendingCount());
+
+	for (int i = 0; i < 4; i++)
+	{
+		std::unique_ptr<int> item;
+		ASSERT_EQ(true, queue.Pop(&item));
+		ASSERT_NE(nullptr, item);
+		EXPECT_EQ(i * 10, *item);
+	}
+
+	// すべて取り出した後は待たずに失敗する
+	std::unique_ptr<int> item;
+	EXPECT_EQ(false, queue.Pop(&item));
+	EXPECT_EQ(0, queue.GetPendingCount());
+}
+
+TEST(BaseTest, OrderedQueueBackpressure)
+{
+	const size_t capacity = 2;
+	saba::OrderedQueue<int> queue(capacity);
+	queue.Reset(3);
+
+	// 2 番は 0 番を取り出すまで追加できない
+	std::atomic<bool> pushed(false);
+	std::thread pushThread([&queue, &pushed]()
+	{
+		EXPECT_EQ(true, queue.Push(2, 2));
+		pushed = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_EQ(false, pushed);
+
+	EXPECT_EQ(true, queue.Push(1, 1));
+	EXPECT_EQ(true, queue.Push(0, 0));
+	EXPECT_LE(queue.GetPendingCount(), capacity);
+
+	int value = -1;
+	ASSERT_EQ(true, queue.Pop(&value));
+	EXPECT_EQ(0, value);
+	pushThread.join();
+	EXPECT_EQ(true, pushed);
+
+	ASSERT_EQ(true, queue.Pop(&value));
+	EXPECT_EQ(1, value);
+	ASSERT_EQ(true, queue.Pop(&value));
+	EXPECT_EQ(2, value);
+	EXPECT_EQ(false, queue.Pop(&value));
+}
+
+TEST(BaseTest, OrderedQueueMultiThread)
+{
+	const size_t count = 1000;
+	const size_t threadCount = 4;
+	saba::OrderedQueue<size_t> queue(3);
+	queue.Reset(count);
+
+	std::vector<std::thread> threads;
+	for (size_t threadIdx = 0; threadIdx < threadCount; threadIdx++)
+	{
+		threads.emplace_back([&queue, threadIdx, threadCount, count]()
+		{
+			for (size_t i = threadIdx; i < count; i += threadCount)
+			{
+				EXPECT_EQ(true, queue.Push(i, i));
+			}
+		});
+	}
+
+	size_t expected = 0;
+	size_t value = 0;
+	while (queue.Pop(&value))
+	{
+		EXPECT_EQ(expected, value);
+		EXPECT_LE(queue.GetPendingCount(), size_t(3));
+		expected++;
+	}
+	EXPECT_EQ(count, expected);
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+TEST(BaseTest, OrderedQueueCancel)
+{
+	saba::OrderedQueue<int> queue(1);
+	queue.Reset(10);
+
+	// 待っている Push と Pop は Cancel で失敗する
+	std::atomic<int> pushResult(-1);
+	std::thread pushThread([&queue, &pushResult]()
+	{
+		pushResult = queue.Push(5, 5) ? 1 : 0;
+	});
+	std::atomic<int> popResult(-1);
+	std::thread popThread([&queue, &popResult]()
+	{
+		int value;
+		popResult = queue.Pop(&value) ? 1 : 0;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_EQ(-1, pushResult);
+	EXPECT_EQ(-1, popResult);
+
+	queue.Cancel();
+	pushThread.join();
+	popThread.join();
+	EXPECT_EQ(0, pushResult);
+	EXPECT_EQ(0, popResult);
+	EXPECT_EQ(true, queue.IsCanceled());
+
+	// キャンセルした後は追加できない
+	EXPECT_EQ(false, queue.Push(0, 0));
+
+	// Reset すると再び使える
+	queue.Reset(1);
+	EXPECT_EQ(false, queue.IsCanceled());
+	EXPECT_EQ(true, queue.Push(0, 7));
+	int value = 0;
+	EXPECT_EQ(true, queue.Pop(&value));
+	EXPECT_EQ(7, value);
+}
@@ -0,0 +1,67 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/Hash.h>
+#include <Saba/Model/MMD/MMDModelCache.h>
+
+#include <cstdio>
+#include <vector>
+
+TEST(ModelTest, MMDModelCache)
+{
+	const std::string cachePath = "MMDModelCacheTest.sabacache";
+
+	const char source[] = "source data";
+	const uint64_t sourceSize = sizeof(source);
+	const uint64_t sourceHash = saba::CalcHash64(source, sizeof(source));
+	EXPECT_EQ(sourceHash, saba::CalcHash64(source, sizeof(source)));
+	EXPECT_NE(sourceHash, saba::CalcHash64(source, sizeof(source) - 1));
+
+	std::vector<float> values = { 1.0f, 2.0f, 3.0f };
+	std::vector<uint16_t> indices = { 0, 1, 2, 3, 4 };
+	std::vector<uint32_t> empty;
+	{
+		saba::MMDModelCacheWriter writer;
+		writer.AddSection(1, values);
+		writer.AddSection(2, indices);
+		writer.AddSection(3, empty);
+		writer.AddValue(4, uint64_t(1234));
+		EXPECT_EQ(true, writer.Save(cachePath, 1, sourceSize, sourceHash));
+	}
+
+	{
+		saba::MMDModelCacheReader reader;
+		ASSERT_EQ(true, reader.Open(cachePath, 1, sourceSize, sourceHash));
+
+		std::vector<float> readValues;
+		EXPECT_EQ(true, reader.ReadSection(1, &readValues));
+		EXPECT_EQ(values, readValues);
+
+		std::vector<uint16_t> readIndices;
+		EXPECT_EQ(true, reader.ReadSection(2, &readIndices));
+		EXPECT_EQ(indices, readIndices);
+
+		std::vector<uint32_t> readEmpty = { 1 };
+		EXPECT_EQ(true, reader.ReadSection(3, &readEmpty));
+		EXPECT_TRUE(readEmpty.empty());
+
+		uint64_t value = 0;
+		EXPECT_EQ(true, reader.ReadValue(4, &value));
+		EXPECT_EQ(1234, value);
+
+		// 要素のサイズが違う、または存在しないセクションは読めない
+		std::vector<uint16_t> wrongSize;
+		EXPECT_EQ(false, reader.ReadSection(1, &wrongSize));
+		EXPECT_EQ(false, reader.ReadSection(5, &readValues));
+	}
+
+	// フォーマットや元ファイルが変わった場合は開けない
+	{
+		saba::MMDModelCacheReader reader;
+		EXPECT_EQ(false, reader.Open(cachePath, 2, sourceSize, sourceHash));
+		EXPECT_EQ(false, reader.Open(cachePath, 1, sourceSize + 1, sourceHash));
+		EXPECT_EQ(false, reader.Open(cachePath, 1, sourceSize, sourceHash + 1));
+		EXPECT_EQ(false, reader.IsOpen());
+	}
+
+	remove(cachePath.c_str());
+}
@@ -0,0 +1,86 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Model/MMD/MMDModel.h>
+#include <Saba/Model/MMD/MMDNode.h>
+
+#include <memory>
+#include <vector>
+
+TEST(ModelTest, MMDNameIndex)
+{
+	std::vector<std::unique_ptr<saba::MMDNode>> nodes;
+	const char* names[] = { "センター", "上半身", "下半身", "上半身" };
+	for (auto name : names)
+	{
+		nodes.emplace_back(std::make_unique<saba::MMDNode>());
+		nodes.back()->SetName(name);
+	}
+
+	saba::MMDNameIndex nameIndex;
+	const size_t npos = saba::MMDNameIndex::NPos;
+
+	// テーブルを作る前は線形探索する
+	EXPECT_FALSE(nameIndex.IsBuilt());
+	EXPECT_EQ(1, nameIndex.Find(nodes, "上半身"));
+	EXPECT_EQ(npos, nameIndex.Find(nodes, "首"));
+
+	nameIndex.Build(nodes);
+	EXPECT_TRUE(nameIndex.IsBuilt());
+	EXPECT_EQ(0, nameIndex.Find(nodes, "センター"));
+	// 同名の場合は先頭を返す
+	EXPECT_EQ(1, nameIndex.Find(nodes, "上半身"));
+	EXPECT_EQ(2, nameIndex.Find(nodes, "下半身"));
+	EXPECT_EQ(npos, nameIndex.Find(nodes, "首"));
+
+	// 名前が変わった要素は返さない
+	nodes[0]->SetName("全ての親");
+	EXPECT_EQ(npos, nameIndex.Find(nodes, "センター"));
+	// 線形探索はしないので、Build し直すまでは新しい名前でも見つからない
+	EXPECT_EQ(npos, nameIndex.Find(nodes, "全ての親"));
+	nameIndex.Build(nodes);
+	EXPECT_EQ(0, nameIndex.Find(nodes, "全ての親"));
+
+	// 要素が減った場合
+	nodes.resize(2);
+	EXPECT_EQ(npos, nameIndex.Find(nodes, "下半身"));
+	EXPECT_EQ(1, nameIndex.Find(nodes, "上半身"));
+
+	nameIndex.Clear();
+	EXPECT_FALSE(nameIndex.IsBuilt());
+	EXPECT_EQ(1, nameIndex.Find(nodes, "上半身"));
+}
+
+namespace
+{
+	// すべての名前が衝突するハッシュ
+	struct CollideNameHash
+	{
+		uint64_t operator()(const std::string&) const { return 0; }
+	};
+}
+
+TEST(ModelTest, MMDNameIndexCollision)
+{
+	std::vector<std::unique_ptr<saba::MMDNode>> nodes;
+	const char* names[] = { "右腕", "左腕", "右腕" };
+	for (auto name : names)
+	{
+		nodes.emplace_back(std::make_unique<saba::MMDNode>());
+		nodes.back()->SetName(name);
+	}
+
+	saba::MMDNameIndexT<CollideNameHash> nameIndex;
+	const size_t npos = saba::MMDNameIndexT<CollideNameHash>::NPos;
+
+	// ハッシュが同じでも、名前を比べて区別する
+	nameIndex.Build(nodes);
+	EXPECT_EQ(0, nameIndex.Find(nodes, "右腕"));
+	EXPECT_EQ(1, nameIndex.Find(nodes, "左腕"));
+	EXPECT_EQ(npos, nameIndex.Find(nodes, "首"));
+
+	// 名前が変わった要素は返さない
+	nodes[1]->SetName("首");
+	EXPECT_EQ(npos, nameIndex.Find(nodes, "左腕"));
+	nameIndex.Build(nodes);
+	EXPECT_EQ(1, nameIndex.Find(nodes, "首"));
+}
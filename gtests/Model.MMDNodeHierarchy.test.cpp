@@ -0,0 +1,128 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Model/MMD/MMDNode.h>
+#include <Saba/Model/MMD/MMDNodeHierarchy.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	void ExpectMatrixEq(const glm::mat4& expected, const glm::mat4& actual)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+			{
+				EXPECT_FLOAT_EQ(expected[c][r], actual[c][r]);
+			}
+		}
+	}
+
+	/*
+	0 - 1 - 2
+	  |   + 3
+	  + 4
+	5 - 6
+	*/
+	std::vector<std::unique_ptr<saba::MMDNode>> CreateNodes()
+	{
+		std::vector<std::unique_ptr<saba::MMDNode>> nodes;
+		for (int i = 0; i < 7; i++)
+		{
+			nodes.emplace_back(std::make_unique<saba::MMDNode>());
+			nodes[i]->SetIndex(i);
+			nodes[i]->SetTranslate(glm::vec3(float(i), 1.0f, 0.0f));
+			nodes[i]->SetRotate(glm::angleAxis(0.1f * float(i + 1), glm::vec3(0, 1, 0)));
+		}
+		// 子の順番が番号順と異なる場合も確認する
+		nodes[1]->AddChild(nodes[3].get());
+		nodes[1]->AddChild(nodes[2].get());
+		nodes[0]->AddChild(nodes[1].get());
+		nodes[0]->AddChild(nodes[4].get());
+		nodes[5]->AddChild(nodes[6].get());
+		return nodes;
+	}
+
+	std::vector<glm::mat4> CalcGlobalsRecursive()
+	{
+		auto nodes = CreateNodes();
+		for (auto& node : nodes)
+		{
+			node->UpdateLocalTransform();
+		}
+		for (auto& node : nodes)
+		{
+			if (node->GetParent() == nullptr)
+			{
+				node->UpdateGlobalTransform();
+			}
+		}
+		std::vector<glm::mat4> globals;
+		for (auto& node : nodes)
+		{
+			globals.push_back(node->GetGlobalTransform());
+		}
+		return globals;
+	}
+}
+
+TEST(ModelTest, MMDNodeHierarchy)
+{
+	const auto expected = CalcGlobalsRecursive();
+
+	auto nodes = CreateNodes();
+	saba::MMDNodeHierarchy hierarchy;
+	hierarchy.Build(nodes);
+	ASSERT_EQ(7, hierarchy.GetNodeCount());
+
+	// 深さ優先 (子は追加順)
+	const uint32_t expectedOrder[] = { 0, 1, 3, 2, 4, 5, 6 };
+	for (size_t order = 0; order < hierarchy.GetNodeCount(); order++)
+	{
+		EXPECT_EQ(expectedOrder[order], hierarchy.GetNode(order)->GetIndex());
+		EXPECT_EQ(order, hierarchy.GetNode(order)->GetHierarchyOrder());
+		auto parentOrder = hierarchy.GetParentOrder(order);
+		if (parentOrder >= 0)
+		{
+			EXPECT_LT(size_t(parentOrder), order);
+			EXPECT_EQ(hierarchy.GetNode(order)->GetParent(), hierarchy.GetNode(parentOrder));
+		}
+	}
+	EXPECT_EQ(5, hierarchy.GetSubtreeEnd(0));
+	EXPECT_EQ(4, hierarchy.GetSubtreeEnd(1));
+	EXPECT_EQ(7, hierarchy.GetSubtreeEnd(5));
+
+	for (auto& node : nodes)
+	{
+		node->UpdateLocalTransform();
+	}
+	hierarchy.UpdateGlobalTransforms();
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		ExpectMatrixEq(expected[i], nodes[i]->GetGlobalTransform());
+	}
+
+	// 部分木の更新は、その範囲のみ更新する
+	nodes[1]->SetTranslate(glm::vec3(0, 5, 0));
+	nodes[1]->UpdateLocalTransform();
+	nodes[1]->UpdateGlobalTransform();
+	const auto global1 = nodes[0]->GetGlobalTransform() * nodes[1]->GetLocalTransform();
+	ExpectMatrixEq(global1, nodes[1]->GetGlobalTransform());
+	ExpectMatrixEq(global1 * nodes[2]->GetLocalTransform(), nodes[2]->GetGlobalTransform());
+	ExpectMatrixEq(global1 * nodes[3]->GetLocalTransform(), nodes[3]->GetGlobalTransform());
+	ExpectMatrixEq(expected[4], nodes[4]->GetGlobalTransform());
+	ExpectMatrixEq(expected[6], nodes[6]->GetGlobalTransform());
+
+	// 子のみ更新する
+	nodes[5]->SetGlobalTransform(glm::translate(glm::mat4(1), glm::vec3(0, 0, 10)));
+	nodes[5]->UpdateChildTransform();
+	ExpectMatrixEq(nodes[5]->GetGlobalTransform() * nodes[6]->GetLocalTransform(), nodes[6]->GetGlobalTransform());
+
+	// 登録を解除しても行列は保持される
+	const auto global2 = nodes[2]->GetGlobalTransform();
+	hierarchy.Clear();
+	EXPECT_EQ(nullptr, nodes[2]->GetHierarchy());
+	ExpectMatrixEq(global2, nodes[2]->GetGlobalTransform());
+}
@@ -0,0 +1,210 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Model/MMD/MMDSkinning.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct SkinningTestData
+	{
+		std::vector<glm::mat4>	m_transforms;
+		std::vector<glm::vec3>	m_positions;
+		std::vector<glm::vec3>	m_morphPositions;
+		std::vector<glm::vec3>	m_normals;
+
+		std::vector<saba::MMDSkinningWeight1>	m_weight1;
+		std::vector<saba::MMDSkinningWeight2>	m_weight2;
+		std::vector<saba::MMDSkinningWeight4>	m_weight4;
+	};
+
+	SkinningTestData CreateSkinningTestData()
+	{
+		std::mt19937 rand(12345);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> weightDist(0.0f, 1.0f);
+
+		SkinningTestData data;
+		const int BoneCount = 16;
+		for (int i = 0; i < BoneCount; i++)
+		{
+			glm::mat4 m = glm::translate(glm::mat4(1), glm::vec3(dist(rand), dist(rand), dist(rand)));
+			m = glm::rotate(m, dist(rand) * 3.0f, glm::normalize(glm::vec3(dist(rand), dist(rand), 1.0f)));
+			data.m_transforms.push_back(m);
+		}
+
+		// 端数の処理を確認するため、奇数個にする
+		const uint32_t VertexCount = 301;
+		for (uint32_t i = 0; i < VertexCount; i++)
+		{
+			data.m_positions.push_back(glm::vec3(dist(rand), dist(rand), dist(rand)) * 10.0f);
+			data.m_morphPositions.push_back(glm::vec3(dist(rand), dist(rand), dist(rand)) * 0.1f);
+			data.m_normals.push_back(glm::normalize(glm::vec3(dist(rand), dist(rand), dist(rand)) + glm::vec3(0, 0, 2)));
+
+			auto bone = [&rand, BoneCount]() { return uint16_t(rand() % BoneCount); };
+			switch (i % 3)
+			{
+			case 0:
+			{
+				saba::MMDSkinningWeight1 v;
+				v.m_vertex = i;
+				v.m_boneIndex = bone();
+				data.m_weight1.push_back(v);
+				break;
+			}
+			case 1:
+			{
+				saba::MMDSkinningWeight2 v;
+				v.m_vertex = i;
+				v.m_boneIndex[0] = bone();
+				v.m_boneIndex[1] = bone();
+				v.m_boneWeight = saba::QuantizeMMDSkinningWeight(weightDist(rand));
+				data.m_weight2.push_back(v);
+				break;
+			}
+			default:
+			{
+				saba::MMDSkinningWeight4 v;
+				v.m_vertex = i;
+				float weights[4];
+				float total = 0;
+				for (int bi = 0; bi < 4; bi++)
+				{
+					v.m_boneIndex[bi] = bone();
+					weights[bi] = weightDist(rand);
+					total += weights[bi];
+				}
+				for (int bi = 0; bi < 4; bi++)
+				{
+					v.m_boneWeight[bi] = saba::QuantizeMMDSkinningWeight(weights[bi] / total);
+				}
+				data.m_weight4.push_back(v);
+				break;
+			}
+			}
+		}
+		return data;
+	}
+
+	void RunSkinning(const SkinningTestData& data, std::vector<glm::vec3>* positions, std::vector<glm::vec3>* normals, bool useMorph = true)
+	{
+		positions->assign(data.m_positions.size(), glm::vec3(0));
+		normals->assign(data.m_normals.size(), glm::vec3(0));
+
+		saba::MMDSkinningContext ctx;
+		ctx.m_transforms = data.m_transforms.data();
+		ctx.m_positions = data.m_positions.data();
+		ctx.m_morphPositions = useMorph ? data.m_morphPositions.data() : nullptr;
+		ctx.m_normals = data.m_normals.data();
+		ctx.m_updatePositions = positions->data();
+		ctx.m_updateNormals = normals->data();
+		saba::MMDSkinning(ctx, data.m_weight1.data(), data.m_weight1.size());
+		saba::MMDSkinning(ctx, data.m_weight2.data(), data.m_weight2.size());
+		saba::MMDSkinning(ctx, data.m_weight4.data(), data.m_weight4.size());
+	}
+}
+
+TEST(ModelTest, MMDSkinningWeight)
+{
+	EXPECT_EQ(0, saba::QuantizeMMDSkinningWeight(0.0f));
+	EXPECT_EQ(0xFFFF, saba::QuantizeMMDSkinningWeight(1.0f));
+	EXPECT_EQ(0, saba::QuantizeMMDSkinningWeight(-0.5f));
+	EXPECT_EQ(0xFFFF, saba::QuantizeMMDSkinningWeight(1.5f));
+	EXPECT_EQ(0.0f, saba::DequantizeMMDSkinningWeight(0));
+	EXPECT_EQ(1.0f, saba::DequantizeMMDSkinningWeight(0xFFFF));
+	for (int i = 0; i <= 100; i++)
+	{
+		const float weight = float(i) / 100.0f;
+		const auto q = saba::QuantizeMMDSkinningWeight(weight);
+		EXPECT_NEAR(weight, saba::DequantizeMMDSkinningWeight(q), 1.0f / 65535.0f);
+	}
+}
+
+TEST(ModelTest, MMDSkinning)
+{
+	const auto defaultISA = saba::GetMMDSkinningISA();
+	EXPECT_TRUE(saba::IsMMDSkinningISASupported(defaultISA));
+	EXPECT_TRUE(saba::IsMMDSkinningISASupported(saba::MMDSkinningISA::Scalar));
+
+	const auto data = CreateSkinningTestData();
+
+	std::vector<glm::vec3> refPositions;
+	std::vector<glm::vec3> refNormals;
+	EXPECT_TRUE(saba::SetMMDSkinningISA(saba::MMDSkinningISA::Scalar));
+	RunSkinning(data, &refPositions, &refNormals);
+
+	const saba::MMDSkinningISA isaList[] = {
+		saba::MMDSkinningISA::SSE2,
+		saba::MMDSkinningISA::AVX2,
+		saba::MMDSkinningISA::NEON,
+	};
+	for (auto isa : isaList)
+	{
+		if (!saba::IsMMDSkinningISASupported(isa))
+		{
+			EXPECT_FALSE(saba::SetMMDSkinningISA(isa));
+			continue;
+		}
+		EXPECT_TRUE(saba::SetMMDSkinningISA(isa));
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		RunSkinning(data, &positions, &normals);
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			SCOPED_TRACE(saba::GetMMDSkinningISAName(isa));
+			EXPECT_NEAR(refPositions[i].x, positions[i].x, 1.0e-4f);
+			EXPECT_NEAR(refPositions[i].y, positions[i].y, 1.0e-4f);
+			EXPECT_NEAR(refPositions[i].z, positions[i].z, 1.0e-4f);
+			EXPECT_NEAR(refNormals[i].x, normals[i].x, 1.0e-5f);
+			EXPECT_NEAR(refNormals[i].y, normals[i].y, 1.0e-5f);
+			EXPECT_NEAR(refNormals[i].z, normals[i].z, 1.0e-5f);
+		}
+	}
+
+	saba::SetMMDSkinningISA(defaultISA);
+}
+
+TEST(ModelTest, MMDSkinningWithoutMorph)
+{
+	const auto defaultISA = saba::GetMMDSkinningISA();
+
+	// モーフが 0 の場合と、モーフを渡さない場合が一致すること
+	auto data = CreateSkinningTestData();
+	for (auto& morphPos : data.m_morphPositions)
+	{
+		morphPos = glm::vec3(0);
+	}
+
+	const saba::MMDSkinningISA isaList[] = {
+		saba::MMDSkinningISA::Scalar,
+		saba::MMDSkinningISA::SSE2,
+		saba::MMDSkinningISA::AVX2,
+		saba::MMDSkinningISA::NEON,
+	};
+	for (auto isa : isaList)
+	{
+		if (!saba::SetMMDSkinningISA(isa))
+		{
+			continue;
+		}
+
+		std::vector<glm::vec3> refPositions;
+		std::vector<glm::vec3> refNormals;
+		RunSkinning(data, &refPositions, &refNormals);
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		RunSkinning(data, &positions, &normals, false);
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			SCOPED_TRACE(saba::GetMMDSkinningISAName(isa));
+			EXPECT_EQ(refPositions[i], positions[i]);
+			EXPECT_EQ(refNormals[i], normals[i]);
+		}
+	}
+
+	saba::SetMMDSkinningISA(defaultISA);
+}
@@ -0,0 +1,271 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/File.h>
+#include <Saba/Model/MMD/MMDIkSolver.h>
+#include <Saba/Model/MMD/MMDModel.h>
+#include <Saba/Model/MMD/MMDMorph.h>
+#include <Saba/Model/MMD/MMDNode.h>
+#include <Saba/Model/MMD/VMDAnimation.h>
+#include <Saba/Model/MMD/VMDBakedAnimation.h>
+#include <Saba/Model/MMD/VMDFile.h>
+
+#include <glm/gtc/quaternion.hpp>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// ノードとモーフだけを持つモデル (頂点と物理演算は持たない)
+	class TestMMDModel : public saba::MMDModel
+	{
+	public:
+		TestMMDModel()
+		{
+			for (const char* name : { "root", "arm", "hand" })
+			{
+				m_nodeMan.AddNode()->SetName(name);
+			}
+			m_nodeMan.GetNode(0)->AddChild(m_nodeMan.GetNode(1));
+			m_nodeMan.GetNode(1)->AddChild(m_nodeMan.GetNode(2));
+			m_nodeMan.BuildNameIndex();
+
+			m_morphMan.AddMorph()->SetName("smile");
+			m_morphMan.BuildNameIndex();
+		}
+
+		saba::MMDNodeManager* GetNodeManager() override { return &m_nodeMan; }
+		saba::MMDIKManager* GetIKManager() override { return &m_ikMan; }
+		saba::MMDMorphManager* GetMorphManager() override { return &m_morphMan; }
+		saba::MMDPhysicsManager* GetPhysicsManager() override { return nullptr; }
+
+		size_t GetVertexCount() const override { return 0; }
+		const glm::vec3* GetPositions() const override { return nullptr; }
+		const glm::vec3* GetNormals() const override { return nullptr; }
+		const glm::vec2* GetUVs() const override { return nullptr; }
+		const glm::vec3* GetUpdatePositions() const override { return nullptr; }
+		const glm::vec3* GetUpdateNormals() const override { return nullptr; }
+		const glm::vec2* GetUpdateUVs() const override { return nullptr; }
+
+		size_t GetIndexElementSize() const override { return 0; }
+		size_t GetIndexCount() const override { return 0; }
+		const void* GetIndices() const override { return nullptr; }
+
+		size_t GetMaterialCount() const override { return 0; }
+		const saba::MMDMaterial* GetMaterials() const override { return nullptr; }
+
+		size_t GetSubMeshCount() const override { return 0; }
+		const saba::MMDSubMesh* GetSubMeshes() const override { return nullptr; }
+
+		saba::MMDPhysics* GetMMDPhysics() override { return nullptr; }
+
+		void InitializeAnimation() override
+		{
+			ClearBaseAnimation();
+			for (auto& node : *m_nodeMan.GetNodes())
+			{
+				node->SetAnimationTranslate(glm::vec3(0));
+				node->SetAnimationRotate(glm::quat(1, 0, 0, 0));
+			}
+			for (auto& morph : *m_morphMan.GetMorphs())
+			{
+				morph->SetWeight(0);
+			}
+		}
+
+		void BeginAnimation() override
+		{
+			for (auto& node : *m_nodeMan.GetNodes())
+			{
+				node->BeginUpdateTransform();
+			}
+		}
+
+		void EndAnimation() override
+		{
+			for (auto& node : *m_nodeMan.GetNodes())
+			{
+				node->EndUpdateTransform();
+			}
+		}
+
+		void UpdateMorphAnimation() override {}
+		void UpdateNodeAnimation(bool afterPhysicsAnim) override
+		{
+			if (afterPhysicsAnim)
+			{
+				return;
+			}
+			for (auto& node : *m_nodeMan.GetNodes())
+			{
+				node->UpdateLocalTransform();
+			}
+			m_nodeMan.GetNode(0)->UpdateGlobalTransform();
+		}
+		void ResetPhysics() override {}
+		void UpdatePhysicsAnimation(float elapsed) override {}
+		void BeginPhysicsAnimation(float elapsed) override {}
+		void EndPhysicsAnimation() override {}
+		void Update() override {}
+		void SetParallelUpdateHint(uint32_t parallelCount) override {}
+
+	private:
+		MMDNodeManagerT<saba::MMDNode>			m_nodeMan;
+		MMDIKManagerT<saba::MMDIkSolver>		m_ikMan;
+		MMDMorphManagerT<saba::MMDMorph>		m_morphMan;
+	};
+
+	void AddMotion(saba::VMDFile* vmd, const char* name, uint32_t frame, const glm::vec3& t, const glm::quat& q)
+	{
+		saba::VMDMotion motion;
+		motion.m_boneName.Set(name);
+		motion.m_frame = frame;
+		motion.m_translate = t;
+		motion.m_quaternion = q;
+		// 線形補間
+		for (size_t i = 0; i < motion.m_interpolation.size(); i++)
+		{
+			motion.m_interpolation[i] = (i % 16) < 8 ? 20 : 107;
+		}
+		vmd->m_motions.push_back(motion);
+	}
+
+	void AddMorph(saba::VMDFile* vmd, const char* name, uint32_t frame, float weight)
+	{
+		saba::VMDMorph morph;
+		morph.m_blendShapeName.Set(name);
+		morph.m_frame = frame;
+		morph.m_weight = weight;
+		vmd->m_morphs.push_back(morph);
+	}
+
+	struct Pose
+	{
+		std::vector<glm::vec3>	m_translates;
+		std::vector<glm::quat>	m_rotates;
+		float					m_weight;
+	};
+
+	Pose GetPose(saba::MMDModel* model)
+	{
+		Pose pose;
+		auto nodeMan = model->GetNodeManager();
+		for (size_t i = 0; i < nodeMan->GetNodeCount(); i++)
+		{
+			pose.m_translates.push_back(nodeMan->GetMMDNode(i)->GetAnimationTranslate());
+			pose.m_rotates.push_back(nodeMan->GetMMDNode(i)->GetAnimationRotate());
+		}
+		pose.m_weight = model->GetMorphManager()->GetMorph(size_t(0))->GetWeight();
+		return pose;
+	}
+
+	void ExpectPoseNear(const Pose& expected, const Pose& actual)
+	{
+		ASSERT_EQ(expected.m_translates.size(), actual.m_translates.size());
+		for (size_t i = 0; i < expected.m_translates.size(); i++)
+		{
+			EXPECT_NEAR(expected.m_translates[i].x, actual.m_translates[i].x, 1e-5f);
+			EXPECT_NEAR(expected.m_translates[i].y, actual.m_translates[i].y, 1e-5f);
+			EXPECT_NEAR(expected.m_translates[i].z, actual.m_translates[i].z, 1e-5f);
+			// 回転は int16 に量子化して保存している
+			EXPECT_NEAR(1.0f, std::abs(glm::dot(expected.m_rotates[i], actual.m_rotates[i])), 1e-4f);
+		}
+		EXPECT_NEAR(expected.m_weight, actual.m_weight, 1e-5f);
+	}
+}
+
+TEST(ModelTest, VMDBakedAnimation)
+{
+	const std::string bakePath = "VMDBakedAnimationTest.bin";
+
+	auto model = std::make_shared<TestMMDModel>();
+
+	saba::VMDFile vmd;
+	const glm::vec3 axis = glm::normalize(glm::vec3(1, 2, 3));
+	AddMotion(&vmd, "root", 0, glm::vec3(0, 0, 0), glm::quat(1, 0, 0, 0));
+	AddMotion(&vmd, "root", 20, glm::vec3(1, 2, 3), glm::angleAxis(1.0f, axis));
+	AddMotion(&vmd, "arm", 0, glm::vec3(0), glm::angleAxis(-0.5f, glm::vec3(0, 0, 1)));
+	AddMotion(&vmd, "arm", 10, glm::vec3(0), glm::angleAxis(0.5f, glm::vec3(0, 0, 1)));
+	AddMorph(&vmd, "smile", 0, 0.0f);
+	AddMorph(&vmd, "smile", 20, 1.0f);
+
+	saba::VMDAnimation vmdAnim;
+	ASSERT_EQ(true, vmdAnim.Create(model));
+	ASSERT_EQ(true, vmdAnim.Add(vmd));
+
+	// VMDAnimation で評価した結果
+	const float times[] = { 0.0f, 3.0f, 10.0f, 17.0f, 20.0f };
+	std::vector<Pose> expected;
+	for (float t : times)
+	{
+		model->InitializeAnimation();
+		vmdAnim.Evaluate(t);
+		expected.push_back(GetPose(model.get()));
+	}
+
+	{
+		saba::VMDBakedAnimation bakedAnim;
+		ASSERT_EQ(true, bakedAnim.Create(model));
+		ASSERT_EQ(true, bakedAnim.Bake(&vmdAnim));
+		EXPECT_EQ(21, bakedAnim.GetFrameCount());
+		EXPECT_EQ(true, bakedAnim.Save(bakePath));
+	}
+
+	// フレームは 16 バイト単位
+	{
+		saba::File file;
+		std::vector<uint8_t> data;
+		ASSERT_EQ(true, file.Open(bakePath));
+		ASSERT_EQ(true, file.ReadAll(&data));
+		ASSERT_LE(size_t(40), data.size());
+		uint32_t frameCount = 0;
+		uint32_t frameSize = 0;
+		memcpy(&frameCount, data.data() + 16, sizeof(uint32_t));
+		memcpy(&frameSize, data.data() + 36, sizeof(uint32_t));
+		EXPECT_EQ(21, frameCount);
+		EXPECT_EQ(0, frameSize % 16);
+		EXPECT_EQ(0, (data.size() - size_t(frameSize) * frameCount) % 16);
+	}
+
+	// ファイル全体を読み込む場合と、マップして参照する場合
+	for (int stream = 0; stream < 2; stream++)
+	{
+		saba::VMDBakedAnimation bakedAnim;
+		ASSERT_EQ(true, bakedAnim.Create(model));
+		if (stream == 0)
+		{
+			ASSERT_EQ(true, bakedAnim.Load(bakePath));
+		}
+		else
+		{
+			ASSERT_EQ(true, bakedAnim.OpenStream(bakePath));
+		}
+		EXPECT_EQ(21, bakedAnim.GetFrameCount());
+		EXPECT_EQ(false, bakedAnim.IsIKBaked());
+
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			model->InitializeAnimation();
+			bakedAnim.Evaluate(times[i]);
+			ExpectPoseNear(expected[i], GetPose(model.get()));
+		}
+
+		// 最後のフレームより後は最後のフレームのまま
+		model->InitializeAnimation();
+		bakedAnim.Evaluate(20.5f);
+		ExpectPoseNear(expected.back(), GetPose(model.get()));
+	}
+
+	// 構造の違うモデルでは読み込めない
+	{
+		auto otherModel = std::make_shared<TestMMDModel>();
+		otherModel->GetNodeManager()->GetMMDNode(size_t(2))->SetName("finger");
+		saba::VMDBakedAnimation bakedAnim;
+		ASSERT_EQ(true, bakedAnim.Create(otherModel));
+		EXPECT_EQ(false, bakedAnim.Load(bakePath));
+	}
+
+	remove(bakePath.c_str());
+}
@@ -0,0 +1,85 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Model/MMD/VMDAnimation.h>
+
+namespace
+{
+	saba::VMDBezier CreateBezier(int x0, int y0, int x1, int y1)
+	{
+		saba::VMDBezier bezier;
+		bezier.m_cp1 = glm::vec2(float(x0) / 127.0f, float(y0) / 127.0f);
+		bezier.m_cp2 = glm::vec2(float(x1) / 127.0f, float(y1) / 127.0f);
+		return bezier;
+	}
+
+	double EvalBezier(double t, double p1, double p2)
+	{
+		const double it = 1.0 - t;
+		return 3.0 * t * it * it * p1 + 3.0 * t * t * it * p2 + t * t * t;
+	}
+
+	// double の二分法で十分な精度まで求める
+	float EvalYFromXReference(const saba::VMDBezier& bezier, float x)
+	{
+		double start = 0.0;
+		double stop = 1.0;
+		for (int i = 0; i < 60; i++)
+		{
+			double t = (start + stop) * 0.5;
+			if (EvalBezier(t, bezier.m_cp1.x, bezier.m_cp2.x) < x)
+			{
+				start = t;
+			}
+			else
+			{
+				stop = t;
+			}
+		}
+		return float(EvalBezier((start + stop) * 0.5, bezier.m_cp1.y, bezier.m_cp2.y));
+	}
+}
+
+TEST(ModelTest, VMDBezierTable)
+{
+	const int controlPoints[][4] = {
+		{ 20, 20, 107, 107 },
+		{ 0, 127, 0, 127 },
+		{ 127, 0, 127, 0 },
+		{ 0, 0, 127, 127 },
+		{ 127, 127, 0, 0 },
+		{ 64, 0, 64, 127 },
+		{ 10, 90, 30, 120 },
+		{ 100, 5, 120, 40 },
+		{ 37, 81, 93, 12 },
+	};
+	for (const auto& cp : controlPoints)
+	{
+		auto bezier = CreateBezier(cp[0], cp[1], cp[2], cp[3]);
+		bezier.Bake();
+		ASSERT_NE(nullptr, bezier.m_table);
+
+		for (int i = 0; i <= 1000; i++)
+		{
+			float x = float(i) / 1000.0f;
+			EXPECT_NEAR(EvalYFromXReference(bezier, x), bezier.EvalYFromX(x), 5.0e-4f);
+		}
+	}
+
+	// 同じ制御点の曲線はテーブルを共有する
+	auto bezier0 = CreateBezier(10, 90, 30, 120);
+	auto bezier1 = CreateBezier(10, 90, 30, 120);
+	bezier0.Bake();
+	bezier1.Bake();
+	EXPECT_EQ(bezier0.m_table, bezier1.m_table);
+
+	// 直線は x をそのまま返す
+	auto linear = CreateBezier(20, 20, 107, 107);
+	linear.Bake();
+	EXPECT_EQ(0.3f, linear.EvalYFromX(0.3f));
+
+	// 範囲外の制御点はテーブルを使わない
+	auto outOfRange = CreateBezier(-10, 20, 107, 140);
+	outOfRange.Bake();
+	EXPECT_EQ(nullptr, outOfRange.m_table);
+	EXPECT_EQ(outOfRange.EvalY(outOfRange.FindBezierX(0.4f)), outOfRange.EvalYFromX(0.4f));
+}
@@ -3,8 +3,26 @@
 // Distributed under the MIT License (http://opensource.org/licenses/MIT)
 //
 
+/*
+mmd2obj
+
+Output formats (-format)
+  obj  : <output>.obj and <output>.mtl (default)
+  ply  : Binary PLY file. (<output>.ply)
+  gltf : glTF 2.0. (<output>.gltf and <output>.bin)
+         Positions, normals, UVs and uint32 indices are stored in one binary buffer,
+         with one primitive per sub mesh.
+
+Text is formatted with saba::FormatFloat (locale independent, shortest round-trip).
+Large sections are split into chunks, formatted in parallel (-jobs) and written in order.
+*/
+
 #include <Saba/Base/UnicodeUtil.h>
 #include <Saba/Base/Path.h>
+#include <Saba/Base/File.h>
+#include <Saba/Base/JobSystem.h>
+#include <Saba/Base/NumberFormat.h>
+#include <Saba/Base/Singleton.h>
 #include <Saba/Model/MMD/MMDModel.h>
 #include <Saba/Model/MMD/PMDModel.h>
 #include <Saba/Model/MMD/PMXModel.h>
@@ -12,15 +30,501 @@
 #include <Saba/Model/MMD/VMDAnimation.h>
 #include <Saba/Model/MMD/VPDFile.h>
 
+#include <nlohmann/json.hpp>
+
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <memory>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	enum class OutputFormat
+	{
+		OBJ,
+		PLY,
+		GLTF,
+	};
+
+	class TextBuffer
+	{
+	public:
+		void Clear() { m_buffer.clear(); }
+		size_t GetSize() const { return m_buffer.size(); }
+
+		void Append(char c) { m_buffer.push_back(c); }
+		void Append(const char* str) { m_buffer.append(str); }
+		void Append(const std::string& str) { m_buffer.append(str); }
+
+		void AppendFloat(float value)
+		{
+			char buf[saba::FormatFloatBufferSize];
+			m_buffer.append(buf, saba::FormatFloat(buf, value));
+		}
+
+		void AppendUInt(uint64_t value)
+		{
+			char buf[saba::FormatUIntBufferSize];
+			m_buffer.append(buf, saba::FormatUInt(buf, value));
+		}
+
+		bool Write(saba::File& file) const
+		{
+			return m_buffer.empty() || file.Write(m_buffer.data(), m_buffer.size());
+		}
+
+	private:
+		std::string	m_buffer;
+	};
+
+	// Number of lines formatted by one job.
+	const size_t LinesPerChunk = 16 * 1024;
+
+	/*
+	Format lines [0, count) and write them to the file.
+	The lines are split into chunks, and with jobCount > 1 the chunks are formatted in parallel.
+	Only a few chunks per job are kept in memory, and they are written in order.
+	formatFunc : void (TextBuffer* buffer, size_t begin, size_t end)
+	*/
+	template <typename FormatFunc>
+	bool WriteLines(saba::File& file, size_t count, size_t jobCount, FormatFunc formatFunc)
+	{
+		const size_t chunkCount = (count + LinesPerChunk - 1) / LinesPerChunk;
+		const size_t batchSize = std::max(size_t(1), jobCount) * 4;
+		std::vector<TextBuffer> chunks(std::min(chunkCount, batchSize));
+		for (size_t batchBegin = 0; batchBegin < chunkCount; batchBegin += batchSize)
+		{
+			const size_t batchCount = std::min(batchSize, chunkCount - batchBegin);
+			auto formatChunks = [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const size_t lineBegin = (batchBegin + i) * LinesPerChunk;
+					const size_t lineEnd = std::min(lineBegin + LinesPerChunk, count);
+					chunks[i].Clear();
+					formatFunc(&chunks[i], lineBegin, lineEnd);
+				}
+			};
+			if (jobCount > 1)
+			{
+				saba::Singleton<saba::JobSystem>::Get()->ParallelFor(batchCount, jobCount, formatChunks);
+			}
+			else
+			{
+				formatChunks(0, batchCount);
+			}
+
+			for (size_t i = 0; i < batchCount; i++)
+			{
+				if (!chunks[i].Write(file))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	std::vector<uint32_t> GetIndices(const saba::MMDModel* model)
+	{
+		std::vector<uint32_t> indices(model->GetIndexCount());
+		const size_t elemSize = model->GetIndexElementSize();
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			if (elemSize == 1)
+			{
+				indices[i] = ((const uint8_t*)model->GetIndices())[i];
+			}
+			else if (elemSize == 2)
+			{
+				indices[i] = ((const uint16_t*)model->GetIndices())[i];
+			}
+			else
+			{
+				indices[i] = ((const uint32_t*)model->GetIndices())[i];
+			}
+		}
+		return indices;
+	}
+
+	bool CreateOutputFile(saba::File* file, const std::string& path)
+	{
+		if (!file->Create(path))
+		{
+			std::cout << "Failed to open file : " << path << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	bool WriteOBJ(const std::string& output, const saba::MMDModel* model, const std::vector<uint32_t>& indices, size_t jobCount)
+	{
+		saba::File objFile;
+		if (!CreateOutputFile(&objFile, output + ".obj"))
+		{
+			return false;
+		}
+
+		TextBuffer text;
+		text.Append("# mmd2obj\n");
+		text.Append("mtllib " + saba::PathUtil::GetFilename(output) + ".mtl\n");
+		if (!text.Write(objFile))
+		{
+			return false;
+		}
+
+		// Write positions.
+		size_t vtxCount = model->GetVertexCount();
+		const glm::vec3* positions = model->GetUpdatePositions();
+		bool ret = WriteLines(objFile, vtxCount, jobCount, [positions](TextBuffer* buf, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				buf->Append("v ");
+				buf->AppendFloat(positions[i].x);
+				buf->Append(' ');
+				buf->AppendFloat(positions[i].y);
+				buf->Append(' ');
+				buf->AppendFloat(positions[i].z);
+				buf->Append('\n');
+			}
+		});
+
+		// Write normals.
+		const glm::vec3* normals = model->GetUpdateNormals();
+		ret = ret && WriteLines(objFile, vtxCount, jobCount, [normals](TextBuffer* buf, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				buf->Append("vn ");
+				buf->AppendFloat(normals[i].x);
+				buf->Append(' ');
+				buf->AppendFloat(normals[i].y);
+				buf->Append(' ');
+				buf->AppendFloat(normals[i].z);
+				buf->Append('\n');
+			}
+		});
+
+		// Write UVs.
+		const glm::vec2* uvs = model->GetUpdateUVs();
+		ret = ret && WriteLines(objFile, vtxCount, jobCount, [uvs](TextBuffer* buf, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				buf->Append("vt ");
+				buf->AppendFloat(uvs[i].x);
+				buf->Append(' ');
+				buf->AppendFloat(uvs[i].y);
+				buf->Append('\n');
+			}
+		});
+
+		// Write faces.
+		size_t subMeshCount = model->GetSubMeshCount();
+		const saba::MMDSubMesh* subMeshes = model->GetSubMeshes();
+		for (size_t i = 0; i < subMeshCount && ret; i++)
+		{
+			text.Clear();
+			text.Append("\nusemtl ");
+			text.AppendUInt(uint64_t(subMeshes[i].m_materialID));
+			text.Append('\n');
+			ret = text.Write(objFile);
+
+			const uint32_t* subMeshIndices = indices.data() + subMeshes[i].m_beginIndex;
+			size_t faceCount = size_t(subMeshes[i].m_vertexCount) / 3;
+			ret = ret && WriteLines(objFile, faceCount, jobCount, [subMeshIndices](TextBuffer* buf, size_t begin, size_t end)
+			{
+				for (size_t face = begin; face < end; face++)
+				{
+					buf->Append('f');
+					for (size_t j = 0; j < 3; j++)
+					{
+						const uint64_t vi = uint64_t(subMeshIndices[face * 3 + j]) + 1;
+						buf->Append(' ');
+						buf->AppendUInt(vi);
+						buf->Append('/');
+						buf->AppendUInt(vi);
+						buf->Append('/');
+						buf->AppendUInt(vi);
+					}
+					buf->Append('\n');
+				}
+			});
+		}
+		if (!ret)
+		{
+			std::cout << "Failed to write OBJ file.\n";
+			return false;
+		}
+		objFile.Close();
+
+		// Write materials.
+		saba::File mtlFile;
+		if (!CreateOutputFile(&mtlFile, output + ".mtl"))
+		{
+			return false;
+		}
+
+		auto appendColor = [&text](const char* name, const glm::vec3& color)
+		{
+			text.Append(name);
+			for (int i = 0; i < 3; i++)
+			{
+				text.Append(' ');
+				text.AppendFloat(color[i]);
+			}
+			text.Append('\n');
+		};
+
+		text.Clear();
+		text.Append("# mmd2obj\n");
+		size_t materialCount = model->GetMaterialCount();
+		const saba::MMDMaterial* materials = model->GetMaterials();
+		for (size_t i = 0; i < materialCount; i++)
+		{
+			const auto& m = materials[i];
+			text.Append("newmtl ");
+			text.AppendUInt(i);
+			text.Append('\n');
+
+			appendColor("Ka", m.m_ambient);
+			appendColor("Kd", m.m_diffuse);
+			appendColor("Ks", m.m_specular);
+			text.Append("d ");
+			text.AppendFloat(m.m_alpha);
+			text.Append('\n');
+			text.Append("map_Kd " + saba::PathUtil::GetFilename(m.m_texture) + "\n");
+			text.Append('\n');
+		}
+		if (!text.Write(mtlFile))
+		{
+			std::cout << "Failed to write MTL file.\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	bool WritePLY(const std::string& output, const saba::MMDModel* model, const std::vector<uint32_t>& indices)
+	{
+		const size_t vtxCount = model->GetVertexCount();
+		const size_t faceCount = indices.size() / 3;
+
+		std::string header;
+		header += "ply\n";
+		header += "format binary_little_endian 1.0\n";
+		header += "comment mmd2obj\n";
+		header += "element vertex " + std::to_string(vtxCount) + "\n";
+		header += "property float x\nproperty float y\nproperty float z\n";
+		header += "property float nx\nproperty float ny\nproperty float nz\n";
+		header += "property float s\nproperty float t\n";
+		header += "element face " + std::to_string(faceCount) + "\n";
+		header += "property list uchar uint vertex_indices\n";
+		header += "end_header\n";
+
+		std::vector<uint8_t> buffer(header.size() + vtxCount * sizeof(float) * 8 + faceCount * (1 + sizeof(uint32_t) * 3));
+		uint8_t* out = buffer.data();
+		memcpy(out, header.data(), header.size());
+		out += header.size();
+
+		const glm::vec3* positions = model->GetUpdatePositions();
+		const glm::vec3* normals = model->GetUpdateNormals();
+		const glm::vec2* uvs = model->GetUpdateUVs();
+		for (size_t i = 0; i < vtxCount; i++)
+		{
+			const float v[8] = {
+				positions[i].x, positions[i].y, positions[i].z,
+				normals[i].x, normals[i].y, normals[i].z,
+				uvs[i].x, uvs[i].y,
+			};
+			memcpy(out, v, sizeof(v));
+			out += sizeof(v);
+		}
+		for (size_t i = 0; i < faceCount; i++)
+		{
+			*out = 3;
+			out++;
+			memcpy(out, &indices[i * 3], sizeof(uint32_t) * 3);
+			out += sizeof(uint32_t) * 3;
+		}
+
+		saba::File plyFile;
+		if (!CreateOutputFile(&plyFile, output + ".ply"))
+		{
+			return false;
+		}
+		if (!plyFile.Write(buffer.data(), buffer.size()))
+		{
+			std::cout << "Failed to write PLY file.\n";
+			return false;
+		}
+		return true;
+	}
+
+	bool WriteGLTF(const std::string& output, const saba::MMDModel* model, const std::vector<uint32_t>& indices)
+	{
+		using json = nlohmann::json;
+
+		// glTF constants.
+		const int ArrayBuffer = 34962;
+		const int ElementArrayBuffer = 34963;
+		const int ComponentFloat = 5126;
+		const int ComponentUInt = 5125;
+
+		const size_t vtxCount = model->GetVertexCount();
+		const glm::vec3* positions = model->GetUpdatePositions();
+		const glm::vec3* normals = model->GetUpdateNormals();
+		const glm::vec2* uvs = model->GetUpdateUVs();
+
+		// Binary buffer : positions, normals, UVs, indices. (All elements are 4 byte aligned.)
+		const size_t positionOffset = 0;
+		const size_t normalOffset = positionOffset + vtxCount * sizeof(glm::vec3);
+		const size_t uvOffset = normalOffset + vtxCount * sizeof(glm::vec3);
+		const size_t indexOffset = uvOffset + vtxCount * sizeof(glm::vec2);
+		const size_t bufferSize = indexOffset + indices.size() * sizeof(uint32_t);
+
+		std::vector<uint8_t> buffer(bufferSize);
+		memcpy(buffer.data() + positionOffset, positions, vtxCount * sizeof(glm::vec3));
+		memcpy(buffer.data() + normalOffset, normals, vtxCount * sizeof(glm::vec3));
+		memcpy(buffer.data() + uvOffset, uvs, vtxCount * sizeof(glm::vec2));
+		if (!indices.empty())
+		{
+			memcpy(buffer.data() + indexOffset, indices.data(), indices.size() * sizeof(uint32_t));
+		}
+
+		// POSITION requires min and max.
+		glm::vec3 minPos(0.0f);
+		glm::vec3 maxPos(0.0f);
+		if (vtxCount != 0)
+		{
+			minPos = maxPos = positions[0];
+			for (size_t i = 1; i < vtxCount; i++)
+			{
+				minPos = glm::min(minPos, positions[i]);
+				maxPos = glm::max(maxPos, positions[i]);
+			}
+		}
+
+		const std::string binName = saba::PathUtil::GetFilename(output) + ".bin";
+		json gltf;
+		gltf["asset"] = { { "version", "2.0" }, { "generator", "mmd2obj" } };
+		gltf["buffers"] = json::array({ { { "uri", binName }, { "byteLength", bufferSize } } });
+		gltf["bufferViews"] = json::array({
+			{ { "buffer", 0 }, { "byteOffset", positionOffset }, { "byteLength", normalOffset - positionOffset }, { "target", ArrayBuffer } },
+			{ { "buffer", 0 }, { "byteOffset", normalOffset }, { "byteLength", uvOffset - normalOffset }, { "target", ArrayBuffer } },
+			{ { "buffer", 0 }, { "byteOffset", uvOffset }, { "byteLength", indexOffset - uvOffset }, { "target", ArrayBuffer } },
+			{ { "buffer", 0 }, { "byteOffset", indexOffset }, { "byteLength", bufferSize - indexOffset }, { "target", ElementArrayBuffer } },
+		});
+
+		json accessors = json::array({
+			{
+				{ "bufferView", 0 }, { "componentType", ComponentFloat }, { "count", vtxCount }, { "type", "VEC3" },
+				{ "min", { minPos.x, minPos.y, minPos.z } }, { "max", { maxPos.x, maxPos.y, maxPos.z } },
+			},
+			{ { "bufferView", 1 }, { "componentType", ComponentFloat }, { "count", vtxCount }, { "type", "VEC3" } },
+			{ { "bufferView", 2 }, { "componentType", ComponentFloat }, { "count", vtxCount }, { "type", "VEC2" } },
+		});
+		json primitives = json::array();
+		size_t subMeshCount = model->GetSubMeshCount();
+		const saba::MMDSubMesh* subMeshes = model->GetSubMeshes();
+		for (size_t i = 0; i < subMeshCount; i++)
+		{
+			const auto& subMesh = subMeshes[i];
+			if (subMesh.m_vertexCount == 0)
+			{
+				continue;
+			}
+			accessors.push_back({
+				{ "bufferView", 3 },
+				{ "byteOffset", size_t(subMesh.m_beginIndex) * sizeof(uint32_t) },
+				{ "componentType", ComponentUInt },
+				{ "count", subMesh.m_vertexCount },
+				{ "type", "SCALAR" },
+			});
+			primitives.push_back({
+				{ "attributes", { { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } } },
+				{ "indices", accessors.size() - 1 },
+				{ "material", subMesh.m_materialID },
+			});
+		}
+		gltf["accessors"] = accessors;
+		gltf["meshes"] = json::array({ { { "primitives", primitives } } });
+		gltf["nodes"] = json::array({ { { "mesh", 0 } } });
+		gltf["scenes"] = json::array({ { { "nodes", { 0 } } } });
+		gltf["scene"] = 0;
+
+		json materials = json::array();
+		json images = json::array();
+		json textures = json::array();
+		size_t materialCount = model->GetMaterialCount();
+		const saba::MMDMaterial* mmdMaterials = model->GetMaterials();
+		for (size_t i = 0; i < materialCount; i++)
+		{
+			const auto& m = mmdMaterials[i];
+			json pbr = {
+				{ "baseColorFactor", { m.m_diffuse.r, m.m_diffuse.g, m.m_diffuse.b, m.m_alpha } },
+				{ "metallicFactor", 0.0f },
+				{ "roughnessFactor", 1.0f },
+			};
+			if (!m.m_texture.empty())
+			{
+				images.push_back({ { "uri", saba::PathUtil::GetFilename(m.m_texture) } });
+				textures.push_back({ { "source", images.size() - 1 } });
+				pbr["baseColorTexture"] = { { "index", textures.size() - 1 } };
+			}
+			json material = {
+				{ "pbrMetallicRoughness", pbr },
+				{ "doubleSided", m.m_bothFace },
+			};
+			if (m.m_alpha < 1.0f)
+			{
+				material["alphaMode"] = "BLEND";
+			}
+			materials.push_back(material);
+		}
+		gltf["materials"] = materials;
+		if (!images.empty())
+		{
+			gltf["images"] = images;
+			gltf["textures"] = textures;
+		}
+
+		saba::File binFile;
+		if (!CreateOutputFile(&binFile, output + ".bin"))
+		{
+			return false;
+		}
+		if (!buffer.empty() && !binFile.Write(buffer.data(), buffer.size()))
+		{
+			std::cout << "Failed to write glTF buffer.\n";
+			return false;
+		}
+
+		saba::File gltfFile;
+		if (!CreateOutputFile(&gltfFile, output + ".gltf"))
+		{
+			return false;
+		}
+		const std::string gltfText = gltf.dump(1, '\t');
+		if (!gltfFile.Write(gltfText.data(), gltfText.size()))
+		{
+			std::cout << "Failed to write glTF file.\n";
+			return false;
+		}
+		return true;
+	}
+}
 
 void Usage()
 {
 	std::cout << "mmd2obj <pmd/pmx file> [-vmd <vmd file>] [-t <animation time (sec)>] [-vpd <vpd file>]\n";
+	std::cout << "        [-o <output name>] [-format obj|ply|gltf] [-jobs <format job count>]\n";
+	std::cout << "  -o      : Output file name without extension. (default: output)\n";
+	std::cout << "  -format : Output format. (default: obj)\n";
+	std::cout << "  -jobs   : Number of jobs formatting OBJ text. 0 uses all threads, 1 disables. (default: 0)\n";
 }
 
 bool MMD2Obj(const std::vector<std::string>& args)
@@ -36,6 +540,9 @@ bool MMD2Obj(const std::vector<std::string>& args)
 	std::vector<std::string> vmdPaths;
 	std::string vpdPath;
 	double	animTime = 0.0;
+	std::string outputPath = "output";
+	OutputFormat format = OutputFormat::OBJ;
+	size_t jobCount = 0;
 
 	for (size_t i = 2; i < args.size(); i++)
 	{
@@ -78,6 +585,53 @@ bool MMD2Obj(const std::vector<std::string>& args)
 				return false;
 			}
 		}
+		else if (args[i] == "-o")
+		{
+			i++;
+			if (i < args.size())
+			{
+				outputPath = args[i];
+			}
+			else
+			{
+				Usage();
+				return false;
+			}
+		}
+		else if (args[i] == "-format")
+		{
+			i++;
+			if (i < args.size() && args[i] == "obj")
+			{
+				format = OutputFormat::OBJ;
+			}
+			else if (i < args.size() && args[i] == "ply")
+			{
+				format = OutputFormat::PLY;
+			}
+			else if (i < args.size() && args[i] == "gltf")
+			{
+				format = OutputFormat::GLTF;
+			}
+			else
+			{
+				Usage();
+				return false;
+			}
+		}
+		else if (args[i] == "-jobs")
+		{
+			i++;
+			if (i < args.size())
+			{
+				jobCount = size_t(std::stoi(args[i]));
+			}
+			else
+			{
+				Usage();
+				return false;
+			}
+		}
 		else
 		{
 			Usage();
@@ -181,7 +735,7 @@ bool MMD2Obj(const std::vector<std::string>& args)
 		}
 		else
 		{
-			mmdModel->UpdateAllAnimation(nullptr, 0, 1.0f / 60.0f);
+			mmdModel->UpdateAllAnimation((saba::VMDAnimation*)nullptr, 0, 1.0f / 60.0f);
 		}
 		mmdModel->EndAnimation();
 
@@ -189,115 +743,32 @@ bool MMD2Obj(const std::vector<std::string>& args)
 		mmdModel->Update();
 	}
 
-	// Output OBJ file.
-	std::ofstream objFile;
-	objFile.open("output.obj");
-	if (!objFile.is_open())
+	// Copy vertex indices.
+	if (mmdModel->GetIndexElementSize() != 1 &&
+		mmdModel->GetIndexElementSize() != 2 &&
+		mmdModel->GetIndexElementSize() != 4)
 	{
-		std::cout << "Failed to open OBJ file.\n";
 		return false;
 	}
-	objFile << "# mmmd2obj\n";
-	objFile << "mtllib output.mtl\n";
+	std::vector<uint32_t> indices = GetIndices(mmdModel.get());
 
-	// Write positions.
-	size_t vtxCount = mmdModel->GetVertexCount();
-	const glm::vec3* positions = mmdModel->GetUpdatePositions();
-	for (size_t i = 0; i < vtxCount; i++)
+	// Output model.
+	if (format == OutputFormat::PLY)
 	{
-		objFile << "v " << positions[i].x << " " << positions[i].y << " " << positions[i].z << "\n";
+		return WritePLY(outputPath, mmdModel.get(), indices);
 	}
-	const glm::vec3* normals = mmdModel->GetUpdateNormals();
-	for (size_t i = 0; i < vtxCount; i++)
+	else if (format == OutputFormat::GLTF)
 	{
-		objFile << "vn " << normals[i].x << " " << normals[i].y << " " << normals[i].z << "\n";
-	}
-	const glm::vec2* uvs = mmdModel->GetUpdateUVs();
-	for (size_t i = 0; i < vtxCount; i++)
-	{
-		objFile << "vt " << uvs[i].x << " " << uvs[i].y << "\n";
-	}
-
-	// Copy vertex indices.
-	std::vector<size_t> indices(mmdModel->GetIndexCount());
-	if (mmdModel->GetIndexElementSize() == 1)
-	{
-		uint8_t* mmdIndices = (uint8_t*)mmdModel->GetIndices();
-		for (size_t i = 0; i < indices.size(); i++)
-		{
-			indices[i] = mmdIndices[i];
-		}
-	}
-	else if (mmdModel->GetIndexElementSize() == 2)
-	{
-		uint16_t* mmdIndices = (uint16_t*)mmdModel->GetIndices();
-		for (size_t i = 0; i < indices.size(); i++)
-		{
-			indices[i] = mmdIndices[i];
-		}
-	}
-	else if (mmdModel->GetIndexElementSize() == 4)
-	{
-		uint32_t* mmdIndices = (uint32_t*)mmdModel->GetIndices();
-		for (size_t i = 0; i < indices.size(); i++)
-		{
-			indices[i] = mmdIndices[i];
-		}
+		return WriteGLTF(outputPath, mmdModel.get(), indices);
 	}
 	else
 	{
-		return false;
-	}
-
-	// Write faces.
-	size_t subMeshCount = mmdModel->GetSubMeshCount();
-	const saba::MMDSubMesh* subMeshes = mmdModel->GetSubMeshes();
-	for (size_t i = 0; i < subMeshCount; i++)
-	{
-		objFile << "\n";
-		objFile << "usemtl " << subMeshes[i].m_materialID << "\n";
-
-		for (size_t j = 0; j < subMeshes[i].m_vertexCount; j += 3)
+		if (jobCount == 0)
 		{
-			auto vtxIdx = subMeshes[i].m_beginIndex + j;
-			auto vi0 = indices[vtxIdx + 0] + 1;
-			auto vi1 = indices[vtxIdx + 1] + 1;
-			auto vi2 = indices[vtxIdx + 2] + 1;
-			objFile << "f "
-				<< vi0 << "/" << vi0 << "/" << vi0 << " "
-				<< vi1 << "/" << vi1 << "/" << vi1 << " "
-				<< vi2 << "/" << vi2 << "/" << vi2 << "\n";
+			jobCount = saba::Singleton<saba::JobSystem>::Get()->GetConcurrency();
 		}
+		return WriteOBJ(outputPath, mmdModel.get(), indices, jobCount);
 	}
-	objFile.close();
-
-	// Write materials.
-	std::ofstream mtlFile;
-	mtlFile.open("output.mtl");
-	if (!mtlFile.is_open())
-	{
-		std::cout << "Failed to open MTL file.\n";
-		return false;
-	}
-
-	objFile << "# mmmd2obj\n";
-	size_t materialCount = mmdModel->GetMaterialCount();
-	const saba::MMDMaterial* materials = mmdModel->GetMaterials();
-	for (size_t i = 0; i < materialCount; i++)
-	{
-		const auto& m = materials[i];
-		mtlFile << "newmtl " << i << "\n";
-
-		mtlFile << "Ka " << m.m_ambient.r << " " << m.m_ambient.g << " " << m.m_ambient.b << "\n";
-		mtlFile << "Kd " << m.m_diffuse.r << " " << m.m_diffuse.g << " " << m.m_diffuse.b << "\n";
-		mtlFile << "Ks " << m.m_specular.r << " " << m.m_specular.g << " " << m.m_specular.b << "\n";
-		mtlFile << "d " << m.m_alpha << "\n";
-		mtlFile << "map_Kd " << saba::PathUtil::GetFilename(m.m_texture) << "\n";
-		mtlFile << "\n";
-	}
-	mtlFile.close();
-
-	return true;
 }
 
 #if _WIN32
@@ -325,7 +796,9 @@ int main(int argc, char** argv)
 	}
 #endif
 
-	if (!MMD2Obj(args))
+	bool ret = MMD2Obj(args);
+	saba::SingletonFinalizer::Finalize();
+	if (!ret)
 	{
 		std::cout << "Failed to convert model data.\n";
 		return 1;
@@ -0,0 +1,848 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+/*
+mmdbake
+
+Evaluate every frame of VMD animations with a PMD/PMX model, without a window or GL,
+and write the skinned vertices.
+
+Output formats
+  bake : One binary file (little endian).
+         BakeFileHeader
+         uint32_t  indices[indexCount]
+         BakeSubMesh subMeshes[subMeshCount]
+         glm::vec2 uvs[vertexCount]           (initial UVs)
+         frames[frameCount]
+           glm::vec3 positions[vertexCount]
+           glm::vec3 normals[vertexCount]
+           glm::vec2 uvs[vertexCount]         (only if BakeFlags_UV)
+  ply  : Binary PLY file per frame. (<output>_00000.ply, ...)
+  obj  : OBJ file per frame. (<output>_00000.obj, ...)
+
+Frames are evaluated on one model in order when physics is enabled.
+With -nophysics, frames do not depend on each other, and are evaluated in parallel
+on multiple model instances.
+Evaluated frames are passed to a writer thread through a bounded queue.
+*/
+
+#include <Saba/Base/UnicodeUtil.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Base/File.h>
+#include <Saba/Base/Time.h>
+#include <Saba/Base/NumberFormat.h>
+#include <Saba/Base/OrderedQueue.h>
+#include <Saba/Model/MMD/MMDModel.h>
+#include <Saba/Model/MMD/PMDModel.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDFile.h>
+#include <Saba/Model/MMD/VMDAnimation.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	enum BakeFlags : uint32_t
+	{
+		BakeFlags_UV = 0x01,	// Per-frame UVs are written.
+	};
+
+	struct BakeFileHeader
+	{
+		char		m_magic[8];		// "SABABAKE"
+		uint32_t	m_version;
+		uint32_t	m_flags;		// BakeFlags
+		uint32_t	m_vertexCount;
+		uint32_t	m_indexCount;
+		uint32_t	m_subMeshCount;
+		uint32_t	m_frameCount;
+		float		m_fps;
+		uint32_t	m_reserved;
+	};
+
+	struct BakeSubMesh
+	{
+		uint32_t	m_beginIndex;
+		uint32_t	m_indexCount;
+		uint32_t	m_materialID;
+	};
+
+	const uint32_t BakeFileVersion = 1;
+
+	enum class OutputFormat
+	{
+		Bake,
+		PLY,
+		OBJ,
+	};
+
+	struct BakeConfig
+	{
+		std::string					m_modelPath;
+		std::vector<std::string>	m_vmdPaths;
+		std::string					m_outputPath = "output";
+		OutputFormat				m_format = OutputFormat::Bake;
+		float						m_fps = 30.0f;
+		int32_t						m_beginFrame = 0;
+		int32_t						m_endFrame = -1;	// -1 : Last key frame.
+		bool						m_enablePhysics = true;
+		bool						m_writeUV = false;
+		size_t						m_jobCount = 0;		// 0 : Hardware concurrency.
+		size_t						m_queueSize = 8;
+	};
+
+	struct FrameData
+	{
+		size_t					m_frameIndex;
+		std::vector<glm::vec3>	m_positions;
+		std::vector<glm::vec3>	m_normals;
+		std::vector<glm::vec2>	m_uvs;
+	};
+	using FrameDataPtr = std::unique_ptr<FrameData>;
+
+	/*
+	Queue between evaluating threads and the writer thread.
+	Frames are popped in order and the number of pending frames is bounded (saba::OrderedQueue).
+	Popped frame buffers are recycled through Acquire/Release.
+	*/
+	class FrameQueue
+	{
+	public:
+		explicit FrameQueue(size_t capacity)
+			: m_queue(capacity)
+		{
+		}
+
+		void Reset(size_t frameCount) { m_queue.Reset(frameCount); }
+
+		FrameDataPtr Acquire()
+		{
+			std::unique_lock<std::mutex> lock(m_freeMutex);
+			if (m_freeFrames.empty())
+			{
+				return std::make_unique<FrameData>();
+			}
+			auto frame = std::move(m_freeFrames.back());
+			m_freeFrames.pop_back();
+			return frame;
+		}
+
+		void Release(FrameDataPtr frame)
+		{
+			std::unique_lock<std::mutex> lock(m_freeMutex);
+			m_freeFrames.emplace_back(std::move(frame));
+		}
+
+		bool Push(FrameDataPtr frame)
+		{
+			const size_t frameIndex = frame->m_frameIndex;
+			return m_queue.Push(frameIndex, std::move(frame));
+		}
+
+		// Returns nullptr when all frames are popped or canceled.
+		FrameDataPtr Pop()
+		{
+			FrameDataPtr frame;
+			if (!m_queue.Pop(&frame))
+			{
+				return nullptr;
+			}
+			return frame;
+		}
+
+		void Cancel() { m_queue.Cancel(); }
+
+	private:
+		saba::OrderedQueue<FrameDataPtr>	m_queue;
+		std::mutex							m_freeMutex;
+		std::vector<FrameDataPtr>			m_freeFrames;
+	};
+
+	class FrameWriter
+	{
+	public:
+		virtual ~FrameWriter() {}
+
+		virtual bool Begin(const saba::MMDModel* model, size_t frameCount) = 0;
+		virtual bool Write(const FrameData& frame) = 0;
+		virtual bool End() = 0;
+	};
+
+	std::vector<uint32_t> GetIndices(const saba::MMDModel* model)
+	{
+		std::vector<uint32_t> indices(model->GetIndexCount());
+		const size_t elemSize = model->GetIndexElementSize();
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			if (elemSize == 1)
+			{
+				indices[i] = ((const uint8_t*)model->GetIndices())[i];
+			}
+			else if (elemSize == 2)
+			{
+				indices[i] = ((const uint16_t*)model->GetIndices())[i];
+			}
+			else
+			{
+				indices[i] = ((const uint32_t*)model->GetIndices())[i];
+			}
+		}
+		return indices;
+	}
+
+	std::string MakeFramePath(const std::string& output, size_t frameIndex, const char* ext)
+	{
+		char numStr[32];
+		snprintf(numStr, sizeof(numStr), "_%05u.", unsigned(frameIndex));
+		return output + numStr + ext;
+	}
+
+	class BakeFrameWriter : public FrameWriter
+	{
+	public:
+		BakeFrameWriter(const std::string& path, float fps, bool writeUV)
+			: m_path(path)
+			, m_fps(fps)
+			, m_writeUV(writeUV)
+		{
+		}
+
+		bool Begin(const saba::MMDModel* model, size_t frameCount) override
+		{
+			if (!m_file.Create(m_path))
+			{
+				std::cout << "Failed to create file : " << m_path << "\n";
+				return false;
+			}
+
+			auto indices = GetIndices(model);
+			std::vector<BakeSubMesh> subMeshes(model->GetSubMeshCount());
+			for (size_t i = 0; i < subMeshes.size(); i++)
+			{
+				const auto& subMesh = model->GetSubMeshes()[i];
+				subMeshes[i].m_beginIndex = uint32_t(subMesh.m_beginIndex);
+				subMeshes[i].m_indexCount = uint32_t(subMesh.m_vertexCount);
+				subMeshes[i].m_materialID = uint32_t(subMesh.m_materialID);
+			}
+
+			BakeFileHeader header;
+			memcpy(header.m_magic, "SABABAKE", 8);
+			header.m_version = BakeFileVersion;
+			header.m_flags = m_writeUV ? uint32_t(BakeFlags_UV) : 0;
+			header.m_vertexCount = uint32_t(model->GetVertexCount());
+			header.m_indexCount = uint32_t(indices.size());
+			header.m_subMeshCount = uint32_t(subMeshes.size());
+			header.m_frameCount = uint32_t(frameCount);
+			header.m_fps = m_fps;
+			header.m_reserved = 0;
+
+			bool ret = m_file.Write(&header);
+			ret = ret && WriteArray(indices.data(), indices.size());
+			ret = ret && WriteArray(subMeshes.data(), subMeshes.size());
+			ret = ret && WriteArray(model->GetUVs(), model->GetVertexCount());
+			return ret;
+		}
+
+		bool Write(const FrameData& frame) override
+		{
+			bool ret = WriteArray(frame.m_positions.data(), frame.m_positions.size());
+			ret = ret && WriteArray(frame.m_normals.data(), frame.m_normals.size());
+			if (m_writeUV)
+			{
+				ret = ret && WriteArray(frame.m_uvs.data(), frame.m_uvs.size());
+			}
+			return ret;
+		}
+
+		bool End() override
+		{
+			m_file.Close();
+			return true;
+		}
+
+	private:
+		template <typename T>
+		bool WriteArray(const T* data, size_t count)
+		{
+			return count == 0 || m_file.Write(data, count);
+		}
+
+	private:
+		std::string		m_path;
+		float			m_fps;
+		bool			m_writeUV;
+		saba::File		m_file;
+	};
+
+	class PLYFrameWriter : public FrameWriter
+	{
+	public:
+		explicit PLYFrameWriter(const std::string& output)
+			: m_output(output)
+		{
+		}
+
+		bool Begin(const saba::MMDModel* model, size_t) override
+		{
+			m_indices = GetIndices(model);
+			return true;
+		}
+
+		bool Write(const FrameData& frame) override
+		{
+			const size_t vtxCount = frame.m_positions.size();
+			const size_t faceCount = m_indices.size() / 3;
+
+			std::string header;
+			header += "ply\n";
+			header += "format binary_little_endian 1.0\n";
+			header += "comment mmdbake\n";
+			header += "element vertex " + std::to_string(vtxCount) + "\n";
+			header += "property float x\nproperty float y\nproperty float z\n";
+			header += "property float nx\nproperty float ny\nproperty float nz\n";
+			header += "property float s\nproperty float t\n";
+			header += "element face " + std::to_string(faceCount) + "\n";
+			header += "property list uchar uint vertex_indices\n";
+			header += "end_header\n";
+
+			m_buffer.resize(header.size() + vtxCount * sizeof(float) * 8 + faceCount * (1 + sizeof(uint32_t) * 3));
+			uint8_t* out = m_buffer.data();
+			memcpy(out, header.data(), header.size());
+			out += header.size();
+			for (size_t i = 0; i < vtxCount; i++)
+			{
+				const float v[8] = {
+					frame.m_positions[i].x, frame.m_positions[i].y, frame.m_positions[i].z,
+					frame.m_normals[i].x, frame.m_normals[i].y, frame.m_normals[i].z,
+					frame.m_uvs[i].x, frame.m_uvs[i].y,
+				};
+				memcpy(out, v, sizeof(v));
+				out += sizeof(v);
+			}
+			for (size_t i = 0; i < faceCount; i++)
+			{
+				*out = 3;
+				out++;
+				memcpy(out, &m_indices[i * 3], sizeof(uint32_t) * 3);
+				out += sizeof(uint32_t) * 3;
+			}
+
+			saba::File file;
+			auto path = MakeFramePath(m_output, frame.m_frameIndex, "ply");
+			if (!file.Create(path))
+			{
+				std::cout << "Failed to create file : " << path << "\n";
+				return false;
+			}
+			return file.Write(m_buffer.data(), m_buffer.size());
+		}
+
+		bool End() override
+		{
+			return true;
+		}
+
+	private:
+		std::string				m_output;
+		std::vector<uint32_t>	m_indices;
+		std::vector<uint8_t>	m_buffer;
+	};
+
+	class OBJFrameWriter : public FrameWriter
+	{
+	public:
+		explicit OBJFrameWriter(const std::string& output)
+			: m_output(output)
+		{
+		}
+
+		bool Begin(const saba::MMDModel* model, size_t) override
+		{
+			// Faces are the same in every frame.
+			auto indices = GetIndices(model);
+			char buf[128];
+			for (size_t i = 0; i < model->GetSubMeshCount(); i++)
+			{
+				const auto& subMesh = model->GetSubMeshes()[i];
+				snprintf(buf, sizeof(buf), "\nusemtl %d\n", subMesh.m_materialID);
+				m_faces += buf;
+				for (int j = 0; j < subMesh.m_vertexCount; j += 3)
+				{
+					auto vi0 = indices[subMesh.m_beginIndex + j + 0] + 1;
+					auto vi1 = indices[subMesh.m_beginIndex + j + 1] + 1;
+					auto vi2 = indices[subMesh.m_beginIndex + j + 2] + 1;
+					snprintf(buf, sizeof(buf), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", vi0, vi0, vi0, vi1, vi1, vi1, vi2, vi2, vi2);
+					m_faces += buf;
+				}
+			}
+			return true;
+		}
+
+		bool Write(const FrameData& frame) override
+		{
+			m_buffer.clear();
+			m_buffer += "# mmdbake\n";
+			for (const auto& p : frame.m_positions)
+			{
+				AppendVector("v", &p.x, 3);
+			}
+			for (const auto& n : frame.m_normals)
+			{
+				AppendVector("vn", &n.x, 3);
+			}
+			for (const auto& uv : frame.m_uvs)
+			{
+				AppendVector("vt", &uv.x, 2);
+			}
+			m_buffer += m_faces;
+
+			saba::File file;
+			auto path = MakeFramePath(m_output, frame.m_frameIndex, "obj");
+			if (!file.Create(path))
+			{
+				std::cout << "Failed to create file : " << path << "\n";
+				return false;
+			}
+			return file.Write(m_buffer.data(), m_buffer.size());
+		}
+
+		bool End() override
+		{
+			return true;
+		}
+
+	private:
+		// Shortest round-trip and locale independent.
+		void AppendVector(const char* name, const float* values, int count)
+		{
+			char buf[saba::FormatFloatBufferSize];
+			m_buffer += name;
+			for (int i = 0; i < count; i++)
+			{
+				m_buffer += ' ';
+				m_buffer.append(buf, saba::FormatFloat(buf, values[i]));
+			}
+			m_buffer += '\n';
+		}
+
+	private:
+		std::string	m_output;
+		std::string	m_faces;
+		std::string	m_buffer;
+	};
+
+	std::shared_ptr<saba::MMDModel> LoadModel(const std::string& modelPath)
+	{
+		std::string mmdDataPath = "";
+		std::string ext = saba::PathUtil::GetExt(modelPath);
+		if (ext == "pmd")
+		{
+			auto pmdModel = std::make_shared<saba::PMDModel>();
+			if (!pmdModel->Load(modelPath, mmdDataPath))
+			{
+				std::cout << "Failed to load PMDModel.\n";
+				return nullptr;
+			}
+			return pmdModel;
+		}
+		else if (ext == "pmx")
+		{
+			auto pmxModel = std::make_shared<saba::PMXModel>();
+			if (!pmxModel->Load(modelPath, mmdDataPath))
+			{
+				std::cout << "Failed to load PMXModel.\n";
+				return nullptr;
+			}
+			return pmxModel;
+		}
+		std::cout << "Unsupported Model Ext : " << ext << "\n";
+		return nullptr;
+	}
+
+	std::unique_ptr<saba::VMDAnimation> CreateAnimation(
+		const std::shared_ptr<saba::MMDModel>& model,
+		const std::vector<saba::VMDFile>& vmdFiles
+	)
+	{
+		auto vmdAnim = std::make_unique<saba::VMDAnimation>();
+		if (!vmdAnim->Create(model))
+		{
+			std::cout << "Failed to create VMDAnimation.\n";
+			return nullptr;
+		}
+		for (const auto& vmdFile : vmdFiles)
+		{
+			if (!vmdAnim->Add(vmdFile))
+			{
+				std::cout << "Failed to add VMDAnimation.\n";
+				return nullptr;
+			}
+		}
+		return vmdAnim;
+	}
+
+	/*
+	One model instance and its animation.
+	Evaluates frames (beginFrameIndex + jobIndex + jobCount * n) in order.
+	*/
+	struct BakeInstance
+	{
+		std::shared_ptr<saba::MMDModel>		m_model;
+		std::unique_ptr<saba::VMDAnimation>	m_vmdAnim;
+	};
+
+	bool EvaluateFrames(
+		BakeInstance* instance,
+		const BakeConfig& config,
+		size_t frameCount,
+		size_t jobIndex,
+		size_t jobCount,
+		FrameQueue* queue
+	)
+	{
+		auto model = instance->m_model.get();
+		auto vmdAnim = instance->m_vmdAnim.get();
+		const size_t vtxCount = model->GetVertexCount();
+		const float vmdFramePerFrame = 30.0f / config.m_fps;
+		const float elapsed = 1.0f / config.m_fps;
+
+		for (size_t frameIndex = jobIndex; frameIndex < frameCount; frameIndex += jobCount)
+		{
+			auto frame = queue->Acquire();
+			frame->m_frameIndex = frameIndex;
+			frame->m_positions.resize(vtxCount);
+			frame->m_normals.resize(vtxCount);
+			frame->m_uvs.resize(vtxCount);
+
+			const float vmdFrame = float(config.m_beginFrame) + float(frameIndex) * vmdFramePerFrame;
+			model->BeginAnimation();
+			model->UpdateAllAnimation(vmdAnim, vmdFrame, elapsed);
+			model->EndAnimation();
+			model->Update(frame->m_positions.data(), frame->m_normals.data(), frame->m_uvs.data());
+
+			if (!queue->Push(std::move(frame)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+void Usage()
+{
+	std::cout << "mmdbake <pmd/pmx file> -vmd <vmd file> [-vmd <vmd file> ...]\n";
+	std::cout << "  [-o <output>] [-format bake|ply|obj] [-fps <fps>]\n";
+	std::cout << "  [-begin <vmd frame>] [-end <vmd frame>] [-uv] [-nophysics]\n";
+	std::cout << "  [-jobs <count>] [-queue <count>]\n";
+}
+
+bool ParseArgs(const std::vector<std::string>& args, BakeConfig* config)
+{
+	if (args.size() <= 1)
+	{
+		return false;
+	}
+	config->m_modelPath = args[1];
+
+	for (size_t i = 2; i < args.size(); i++)
+	{
+		const auto& arg = args[i];
+		// Options without value.
+		if (arg == "-uv")
+		{
+			config->m_writeUV = true;
+			continue;
+		}
+		else if (arg == "-nophysics")
+		{
+			config->m_enablePhysics = false;
+			continue;
+		}
+
+		i++;
+		if (i >= args.size())
+		{
+			return false;
+		}
+		const auto& value = args[i];
+		try
+		{
+			if (arg == "-vmd")
+			{
+				config->m_vmdPaths.push_back(value);
+			}
+			else if (arg == "-o")
+			{
+				config->m_outputPath = value;
+			}
+			else if (arg == "-format")
+			{
+				if (value == "bake")
+				{
+					config->m_format = OutputFormat::Bake;
+				}
+				else if (value == "ply")
+				{
+					config->m_format = OutputFormat::PLY;
+				}
+				else if (value == "obj")
+				{
+					config->m_format = OutputFormat::OBJ;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			else if (arg == "-fps")
+			{
+				config->m_fps = std::stof(value);
+				if (config->m_fps <= 0)
+				{
+					return false;
+				}
+			}
+			else if (arg == "-begin")
+			{
+				config->m_beginFrame = std::stoi(value);
+			}
+			else if (arg == "-end")
+			{
+				config->m_endFrame = std::stoi(value);
+			}
+			else if (arg == "-jobs")
+			{
+				config->m_jobCount = std::stoul(value);
+			}
+			else if (arg == "-queue")
+			{
+				config->m_queueSize = std::stoul(value);
+			}
+			else
+			{
+				return false;
+			}
+		}
+		catch (std::exception& e)
+		{
+			std::cout << "Invalid argument : " << arg << " " << value << " (" << e.what() << ")\n";
+			return false;
+		}
+	}
+	return !config->m_vmdPaths.empty();
+}
+
+bool MMDBake(const std::vector<std::string>& args)
+{
+	BakeConfig config;
+	if (!ParseArgs(args, &config))
+	{
+		Usage();
+		return false;
+	}
+
+	double startTime = saba::GetTime();
+
+	// Read VMD files once, and add to each instance.
+	std::vector<saba::VMDFile> vmdFiles(config.m_vmdPaths.size());
+	for (size_t i = 0; i < config.m_vmdPaths.size(); i++)
+	{
+		if (!saba::ReadVMDFile(&vmdFiles[i], config.m_vmdPaths[i].c_str()))
+		{
+			std::cout << "Failed to read VMD file : " << config.m_vmdPaths[i] << "\n";
+			return false;
+		}
+	}
+
+	// Physics depends on the previous frame, so frames are evaluated in order.
+	size_t jobCount = 1;
+	if (!config.m_enablePhysics)
+	{
+		jobCount = config.m_jobCount != 0 ? config.m_jobCount : size_t(std::thread::hardware_concurrency());
+		jobCount = std::max(jobCount, size_t(1));
+	}
+
+	// The first instance reads the model file, and the others share its mesh and morph data.
+	// Only the per-instance state (nodes, morphs, physics) is created in parallel.
+	std::vector<BakeInstance> instances(jobCount);
+	{
+		auto loadInstance = [&config, &vmdFiles, jobCount](BakeInstance* instance)
+		{
+			instance->m_model = LoadModel(config.m_modelPath);
+			if (instance->m_model == nullptr)
+			{
+				return;
+			}
+			instance->m_vmdAnim = CreateAnimation(instance->m_model, vmdFiles);
+			if (jobCount > 1)
+			{
+				// Frames are evaluated in parallel, so each model updates vertices on its own thread.
+				instance->m_model->SetParallelUpdateHint(1);
+			}
+		};
+		loadInstance(&instances[0]);
+		std::vector<std::thread> loadThreads;
+		if (instances[0].m_model != nullptr)
+		{
+			for (size_t i = 1; i < instances.size(); i++)
+			{
+				loadThreads.emplace_back(loadInstance, &instances[i]);
+			}
+		}
+		for (auto& loadThread : loadThreads)
+		{
+			loadThread.join();
+		}
+		for (const auto& instance : instances)
+		{
+			if (instance.m_model == nullptr || instance.m_vmdAnim == nullptr)
+			{
+				return false;
+			}
+		}
+	}
+
+	int32_t endFrame = config.m_endFrame >= 0 ? config.m_endFrame : instances[0].m_vmdAnim->GetMaxKeyTime();
+	if (endFrame < config.m_beginFrame)
+	{
+		std::cout << "Invalid frame range : " << config.m_beginFrame << " - " << endFrame << "\n";
+		return false;
+	}
+	const size_t frameCount = size_t(float(endFrame - config.m_beginFrame) * config.m_fps / 30.0f) + 1;
+
+	// Initialize pose.
+	for (auto& instance : instances)
+	{
+		instance.m_model->InitializeAnimation();
+		if (config.m_enablePhysics)
+		{
+			instance.m_vmdAnim->SyncPhysics(float(config.m_beginFrame));
+		}
+		else
+		{
+			// Rigid bodies follow the bones.
+			auto physicsMan = instance.m_model->GetPhysicsManager();
+			physicsMan->SetLODTransitionTime(0);
+			physicsMan->SetLOD(saba::MMDPhysicsLOD::Kinematic);
+			physicsMan->ResetPhysicsState();
+		}
+	}
+
+	std::unique_ptr<FrameWriter> writer;
+	switch (config.m_format)
+	{
+	case OutputFormat::Bake:
+		writer = std::make_unique<BakeFrameWriter>(config.m_outputPath + ".bake", config.m_fps, config.m_writeUV);
+		break;
+	case OutputFormat::PLY:
+		writer = std::make_unique<PLYFrameWriter>(config.m_outputPath);
+		break;
+	case OutputFormat::OBJ:
+		writer = std::make_unique<OBJFrameWriter>(config.m_outputPath);
+		break;
+	}
+	if (!writer->Begin(instances[0].m_model.get(), frameCount))
+	{
+		return false;
+	}
+
+	FrameQueue queue(std::max(config.m_queueSize, jobCount));
+	queue.Reset(frameCount);
+
+	std::atomic<bool> writeSucceeded(true);
+	std::thread writerThread([&queue, &writer, &writeSucceeded]()
+	{
+		while (auto frame = queue.Pop())
+		{
+			if (!writer->Write(*frame))
+			{
+				writeSucceeded = false;
+				queue.Cancel();
+				break;
+			}
+			queue.Release(std::move(frame));
+		}
+	});
+
+	std::vector<std::thread> evalThreads;
+	std::atomic<bool> evalSucceeded(true);
+	for (size_t jobIdx = 1; jobIdx < jobCount; jobIdx++)
+	{
+		evalThreads.emplace_back([&, jobIdx]()
+		{
+			if (!EvaluateFrames(&instances[jobIdx], config, frameCount, jobIdx, jobCount, &queue))
+			{
+				evalSucceeded = false;
+			}
+		});
+	}
+	if (!EvaluateFrames(&instances[0], config, frameCount, 0, jobCount, &queue))
+	{
+		evalSucceeded = false;
+	}
+	for (auto& evalThread : evalThreads)
+	{
+		evalThread.join();
+	}
+	if (!evalSucceeded)
+	{
+		queue.Cancel();
+	}
+	writerThread.join();
+
+	if (!writer->End() || !writeSucceeded || !evalSucceeded)
+	{
+		std::cout << "Failed to write frames.\n";
+		return false;
+	}
+
+	std::cout << "Baked " << frameCount << " frames (" << jobCount << " jobs) in "
+		<< saba::GetTime() - startTime << " sec.\n";
+	return true;
+}
+
+#if _WIN32
+#include <Windows.h>
+#include <shellapi.h>
+#endif
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> args(argc);
+#if _WIN32
+	{
+		WCHAR* cmdline = GetCommandLineW();
+		int wArgc;
+		WCHAR** wArgs = CommandLineToArgvW(cmdline, &wArgc);
+		for (int i = 0; i < argc; i++)
+		{
+			args[i] = saba::ToUtf8String(wArgs[i]);
+		}
+	}
+#else // _WIN32
+	for (int i = 0; i < argc; i++)
+	{
+		args[i] = argv[i];
+	}
+#endif
+
+	if (!MMDBake(args))
+	{
+		std::cout << "Failed to bake animation.\n";
+		return 1;
+	}
+
+	return 0;
+}
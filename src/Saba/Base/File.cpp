@@ -8,6 +8,15 @@
 
 #include <iterator>
 
+#if _WIN32
+#include <Windows.h>
+#else // _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
 namespace saba
 {
 	File::File()
@@ -226,6 +235,143 @@ namespace saba
 #endif // _WIN32
 	}
 
+	MappedFile::MappedFile()
+		: m_data(nullptr)
+		, m_size(0)
+		, m_isOpen(false)
+		, m_isMapped(false)
+#if _WIN32
+		, m_fileHandle(INVALID_HANDLE_VALUE)
+		, m_mappingHandle(nullptr)
+#endif // _WIN32
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(const char * filepath)
+	{
+		Close();
+
+		if (Map(filepath))
+		{
+			m_isOpen = true;
+			m_isMapped = true;
+			return true;
+		}
+
+		// 割り当てられない場合 (空のファイル等) は読み込む
+		File file;
+		if (!file.Open(filepath))
+		{
+			return false;
+		}
+		if (!file.ReadAll(&m_buffer))
+		{
+			return false;
+		}
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+		m_isOpen = true;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_isMapped)
+		{
+#if _WIN32
+			UnmapViewOfFile(m_data);
+			CloseHandle(m_mappingHandle);
+			CloseHandle(m_fileHandle);
+			m_mappingHandle = nullptr;
+			m_fileHandle = INVALID_HANDLE_VALUE;
+#else // _WIN32
+			munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif // _WIN32
+		}
+		m_data = nullptr;
+		m_size = 0;
+		m_isOpen = false;
+		m_isMapped = false;
+		m_buffer.clear();
+		m_buffer.shrink_to_fit();
+	}
+
+	bool MappedFile::Map(const char * filepath)
+	{
+#if _WIN32
+		std::wstring wFilepath;
+		if (!TryToWString(filepath, wFilepath))
+		{
+			return false;
+		}
+		HANDLE fileHandle = CreateFileW(
+			wFilepath.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr
+		);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0 ||
+			uint64_t(fileSize.QuadPart) > uint64_t(SIZE_MAX))
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+		HANDLE mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr)
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+		void* data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr)
+		{
+			CloseHandle(mappingHandle);
+			CloseHandle(fileHandle);
+			return false;
+		}
+		m_fileHandle = fileHandle;
+		m_mappingHandle = mappingHandle;
+		m_data = static_cast<const uint8_t*>(data);
+		m_size = size_t(fileSize.QuadPart);
+		return true;
+#else // _WIN32
+		int fd = open(filepath, O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+		{
+			close(fd);
+			return false;
+		}
+		void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		// 割り当てた後はファイルを閉じてもよい
+		close(fd);
+		if (data == MAP_FAILED)
+		{
+			return false;
+		}
+		m_data = static_cast<const uint8_t*>(data);
+		m_size = size_t(st.st_size);
+		return true;
+#endif // _WIN32
+	}
+
 	TextFileReader::TextFileReader(const char * filepath)
 	{
 		Open(filepath);
@@ -7,6 +7,7 @@
 #define SABA_BASE_FILE_H_
 
 #include <cstdio>
+#include <cstring>
 #include <vector>
 #include <cstdint>
 #include <string>
@@ -114,6 +115,140 @@ namespace saba
 		bool	m_badFlag;
 	};
 
+	/*
+	ファイル全体をメモリに割り当てる (mmap)。
+	割り当てられない場合は、ファイル全体を読み込む。
+	*/
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator = (const MappedFile&) = delete;
+
+		bool Open(const char* filepath);
+		bool Open(const std::string& filepath) { return Open(filepath.c_str()); }
+		void Close();
+		bool IsOpen() const { return m_isOpen; }
+		bool IsMapped() const { return m_isMapped; }
+
+		const uint8_t* GetData() const { return m_data; }
+		size_t GetSize() const { return m_size; }
+
+	private:
+		bool Map(const char* filepath);
+
+	private:
+		const uint8_t*			m_data;
+		size_t					m_size;
+		bool					m_isOpen;
+		bool					m_isMapped;
+		std::vector<uint8_t>	m_buffer;
+#if _WIN32
+		void*	m_fileHandle;
+		void*	m_mappingHandle;
+#endif // _WIN32
+	};
+
+	/*
+	メモリ上のバッファを File と同じ操作で読む。
+	範囲外を読もうとした場合は失敗し、IsBad() が true になる。
+	*/
+	class BufferReader
+	{
+	public:
+		using Offset = File::Offset;
+
+		BufferReader(const void* data, size_t size)
+			: m_data(static_cast<const uint8_t*>(data))
+			, m_size(size)
+			, m_pos(0)
+			, m_badFlag(false)
+		{
+		}
+
+		Offset GetSize() const { return Offset(m_size); }
+		bool IsBad() const { return m_badFlag; }
+		void ClearBadFlag() { m_badFlag = false; }
+		bool IsEOF() const { return m_pos >= m_size; }
+
+		bool Seek(Offset offset, File::SeekDir origin)
+		{
+			Offset base = 0;
+			switch (origin)
+			{
+			case File::SeekDir::Begin:
+				base = 0;
+				break;
+			case File::SeekDir::Current:
+				base = Offset(m_pos);
+				break;
+			case File::SeekDir::End:
+				base = Offset(m_size);
+				break;
+			default:
+				return false;
+			}
+			Offset pos = base + offset;
+			if (pos < 0 || pos > Offset(m_size))
+			{
+				m_badFlag = true;
+				return false;
+			}
+			m_pos = size_t(pos);
+			return true;
+		}
+		Offset Tell() const { return Offset(m_pos); }
+
+		// 残りのサイズで count 個の要素を読めるか (読み込む前に個数を確認する)
+		bool CanRead(int64_t count, size_t elementSize = 1) const
+		{
+			if (count < 0 || elementSize == 0)
+			{
+				return count == 0;
+			}
+			return uint64_t(count) <= uint64_t(m_size - m_pos) / elementSize;
+		}
+
+		template <typename T>
+		bool Read(T* buffer, size_t count = 1)
+		{
+			if (buffer == nullptr)
+			{
+				return false;
+			}
+			if (!CanRead(int64_t(count), sizeof(T)))
+			{
+				m_badFlag = true;
+				return false;
+			}
+			memcpy(buffer, m_data + m_pos, sizeof(T) * count);
+			m_pos += sizeof(T) * count;
+			return true;
+		}
+
+		// コピーせずに参照して読み進める (アラインメントは保証しない)
+		const uint8_t* ReadView(size_t size)
+		{
+			if (!CanRead(int64_t(size)))
+			{
+				m_badFlag = true;
+				return nullptr;
+			}
+			const uint8_t* view = m_data + m_pos;
+			m_pos += size;
+			return view;
+		}
+
+	private:
+		const uint8_t*	m_data;
+		size_t			m_size;
+		size_t			m_pos;
+		bool			m_badFlag;
+	};
+
 	class TextFileReader
 	{
 	public:
@@ -0,0 +1,52 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "Hash.h"
+
+#include <cstring>
+
+namespace saba
+{
+	uint64_t CalcHash64(const void* data, size_t size, uint64_t seed)
+	{
+		const uint64_t m = 0xc6a4a7935bd1e995ull;
+		const int r = 47;
+
+		uint64_t h = seed ^ (uint64_t(size) * m);
+
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		const uint8_t* end = p + (size / 8) * 8;
+		for (; p != end; p += 8)
+		{
+			uint64_t k;
+			memcpy(&k, p, sizeof(k));
+
+			k *= m;
+			k ^= k >> r;
+			k *= m;
+
+			h ^= k;
+			h *= m;
+		}
+
+		const size_t rest = size & 7;
+		if (rest != 0)
+		{
+			uint64_t k = 0;
+			for (size_t i = 0; i < rest; i++)
+			{
+				k |= uint64_t(p[i]) << (i * 8);
+			}
+			h ^= k;
+			h *= m;
+		}
+
+		h ^= h >> r;
+		h *= m;
+		h ^= h >> r;
+
+		return h;
+	}
+}
@@ -0,0 +1,19 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BASE_HASH_H_
+#define SABA_BASE_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace saba
+{
+	// 64 bit のハッシュ (MurmurHash64A)
+	// ファイルの内容が変わったかを調べるためのもの (暗号学的なハッシュではない)
+	uint64_t CalcHash64(const void* data, size_t size, uint64_t seed = 0);
+}
+
+#endif // !SABA_BASE_HASH_H_
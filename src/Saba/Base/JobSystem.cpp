@@ -0,0 +1,249 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "JobSystem.h"
+#include "Log.h"
+
+#include <algorithm>
+
+namespace saba
+{
+	namespace
+	{
+		thread_local JobSystem*	t_ownerJobSystem = nullptr;
+		thread_local size_t		t_workerIndex = 0;
+
+		size_t GetDefaultWorkerCount()
+		{
+			size_t hwCount = std::thread::hardware_concurrency();
+			if (hwCount <= 1)
+			{
+				return 1;
+			}
+			return hwCount - 1;
+		}
+	}
+
+	JobGroup::JobGroup()
+		: m_pendingCount(0)
+	{
+	}
+
+	JobGroup::~JobGroup()
+	{
+		SABA_ASSERT(m_pendingCount == 0);
+	}
+
+	JobSystem::JobSystem()
+		: JobSystem(GetDefaultWorkerCount())
+	{
+	}
+
+	JobSystem::JobSystem(size_t workerCount)
+		: m_queuedJobCount(0)
+		, m_submitIndex(0)
+		, m_exit(false)
+	{
+		// ワーカーが無い場合でも、Wait() で処理するためのキューを 1 つ用意する
+		size_t queueCount = std::max(workerCount, size_t(1));
+		m_queues.reserve(queueCount);
+		for (size_t i = 0; i < queueCount; i++)
+		{
+			m_queues.emplace_back(std::make_unique<WorkQueue>());
+		}
+
+		m_workers.reserve(workerCount);
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			m_workers.emplace_back([this, i]() { this->WorkerMain(i); });
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_workerCV.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			worker.join();
+		}
+		m_workers.clear();
+
+		// ワーカーが無い場合に残ったジョブを実行する
+		for (size_t queueIdx = 0; queueIdx < m_queues.size(); queueIdx++)
+		{
+			while (TryExecuteJob(queueIdx))
+			{
+			}
+		}
+	}
+
+	void JobSystem::Run(JobGroup* group, JobFunc job)
+	{
+		SABA_ASSERT(group != nullptr);
+
+		group->m_pendingCount++;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queuedJobCount++;
+		}
+
+		size_t queueIdx;
+		if (t_ownerJobSystem == this)
+		{
+			queueIdx = t_workerIndex;
+		}
+		else
+		{
+			queueIdx = m_submitIndex++ % m_queues.size();
+		}
+
+		{
+			auto& queue = *m_queues[queueIdx];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			queue.m_jobs.emplace_back(Job{ std::move(job), group });
+		}
+
+		m_workerCV.notify_one();
+		m_waiterCV.notify_all();
+	}
+
+	void JobSystem::Wait(JobGroup* group)
+	{
+		SABA_ASSERT(group != nullptr);
+
+		size_t queueIdx = GetQueueIndex();
+		while (group->m_pendingCount != 0)
+		{
+			if (TryExecuteJob(queueIdx))
+			{
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_waiterCV.wait(lock, [this, group]() {
+				return group->m_pendingCount == 0 || m_queuedJobCount != 0;
+			});
+		}
+	}
+
+	void JobSystem::ParallelFor(size_t count, size_t jobCount, const RangeFunc& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		jobCount = std::max(size_t(1), std::min(jobCount, count));
+		const size_t rangeSize = count / jobCount;
+		const size_t remainder = count % jobCount;
+
+		JobGroup group;
+		size_t begin = rangeSize + remainder;
+		for (size_t jobIdx = 1; jobIdx < jobCount; jobIdx++)
+		{
+			size_t end = begin + rangeSize;
+			Run(&group, [&func, begin, end]() { func(begin, end); });
+			begin = end;
+		}
+
+		func(0, rangeSize + remainder);
+
+		Wait(&group);
+	}
+
+	size_t JobSystem::GetQueueIndex()
+	{
+		if (t_ownerJobSystem == this)
+		{
+			return t_workerIndex;
+		}
+		return m_submitIndex % m_queues.size();
+	}
+
+	bool JobSystem::PopJob(size_t queueIdx, Job* job)
+	{
+		auto& queue = *m_queues[queueIdx];
+		std::lock_guard<std::mutex> lock(queue.m_mutex);
+		if (queue.m_jobs.empty())
+		{
+			return false;
+		}
+		*job = std::move(queue.m_jobs.back());
+		queue.m_jobs.pop_back();
+		return true;
+	}
+
+	bool JobSystem::StealJob(size_t queueIdx, Job* job)
+	{
+		const size_t queueCount = m_queues.size();
+		for (size_t i = 1; i < queueCount; i++)
+		{
+			auto& queue = *m_queues[(queueIdx + i) % queueCount];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			if (!queue.m_jobs.empty())
+			{
+				*job = std::move(queue.m_jobs.front());
+				queue.m_jobs.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool JobSystem::TryExecuteJob(size_t queueIdx)
+	{
+		Job job;
+		if (!PopJob(queueIdx, &job) && !StealJob(queueIdx, &job))
+		{
+			return false;
+		}
+		m_queuedJobCount--;
+
+		Execute(job);
+		return true;
+	}
+
+	void JobSystem::Execute(Job& job)
+	{
+		job.m_func();
+
+		if (--job.m_group->m_pendingCount == 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+			}
+			m_waiterCV.notify_all();
+		}
+	}
+
+	void JobSystem::WorkerMain(size_t workerIdx)
+	{
+		t_ownerJobSystem = this;
+		t_workerIndex = workerIdx;
+
+		while (true)
+		{
+			if (TryExecuteJob(workerIdx))
+			{
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workerCV.wait(lock, [this]() { return m_exit || m_queuedJobCount != 0; });
+			if (m_exit && m_queuedJobCount == 0)
+			{
+				break;
+			}
+		}
+
+		t_ownerJobSystem = nullptr;
+	}
+}
@@ -0,0 +1,98 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BASE_JOBSYSTEM_H_
+#define SABA_BASE_JOBSYSTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace saba
+{
+	class JobGroup
+	{
+	public:
+		JobGroup();
+		~JobGroup();
+
+		JobGroup(const JobGroup&) = delete;
+		JobGroup& operator = (const JobGroup&) = delete;
+
+		bool IsDone() const { return m_pendingCount == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<size_t>	m_pendingCount;
+	};
+
+	/*
+	常駐スレッドで動くジョブシステム。
+	ワーカーごとにキューを持ち、空になったワーカーは他のキューからジョブを盗む。
+	Wait を呼んだスレッドも、待機中はジョブを処理する。
+	*/
+	class JobSystem
+	{
+	public:
+		using JobFunc = std::function<void()>;
+		using RangeFunc = std::function<void(size_t begin, size_t end)>;
+
+		JobSystem();
+		explicit JobSystem(size_t workerCount);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator = (const JobSystem&) = delete;
+
+		size_t GetWorkerCount() const { return m_workers.size(); }
+		// ワーカーと Wait を呼ぶスレッドを合わせた数
+		size_t GetConcurrency() const { return m_workers.size() + 1; }
+
+		void Run(JobGroup* group, JobFunc job);
+		void Wait(JobGroup* group);
+
+		// [0, count) を jobCount 個に分けて実行し、すべて終わるまで待つ
+		void ParallelFor(size_t count, size_t jobCount, const RangeFunc& func);
+
+	private:
+		struct Job
+		{
+			JobFunc		m_func;
+			JobGroup*	m_group;
+		};
+
+		struct WorkQueue
+		{
+			std::mutex			m_mutex;
+			std::deque<Job>		m_jobs;
+		};
+
+		size_t GetQueueIndex();
+		bool PopJob(size_t queueIdx, Job* job);
+		bool StealJob(size_t queueIdx, Job* job);
+		bool TryExecuteJob(size_t queueIdx);
+		void Execute(Job& job);
+		void WorkerMain(size_t workerIdx);
+
+	private:
+		std::vector<std::unique_ptr<WorkQueue>>	m_queues;
+		std::vector<std::thread>				m_workers;
+
+		std::mutex				m_mutex;
+		std::condition_variable	m_workerCV;
+		std::condition_variable	m_waiterCV;
+		std::atomic<size_t>		m_queuedJobCount;
+		std::atomic<size_t>		m_submitIndex;
+		bool					m_exit;
+	};
+}
+
+#endif // !SABA_BASE_JOBSYSTEM_H_
@@ -0,0 +1,203 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "NumberFormat.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace saba
+{
+	namespace
+	{
+		// float の最小の非正規化数 (1e-45) を 17 桁にしても収まる範囲
+		const int MaxPow10 = 64;
+		const double Pow10Table[MaxPow10 + 1] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+			1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+			1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22, 1e23,
+			1e24, 1e25, 1e26, 1e27, 1e28, 1e29, 1e30, 1e31,
+			1e32, 1e33, 1e34, 1e35, 1e36, 1e37, 1e38, 1e39,
+			1e40, 1e41, 1e42, 1e43, 1e44, 1e45, 1e46, 1e47,
+			1e48, 1e49, 1e50, 1e51, 1e52, 1e53, 1e54, 1e55,
+			1e56, 1e57, 1e58, 1e59, 1e60, 1e61, 1e62, 1e63,
+			1e64,
+		};
+
+		// value * 10^exp
+		double MulPow10(double value, int exp)
+		{
+			if (exp >= 0)
+			{
+				return value * Pow10Table[exp];
+			}
+			else
+			{
+				return value / Pow10Table[-exp];
+			}
+		}
+
+		// 候補の値を double で計算した誤差 (相対 1e-16 程度) は、
+		// 元の値に戻る範囲 (相対 3e-8 以上) に比べて十分小さいので、少しだけ範囲を狭めて判定する
+		const double RoundTripMargin = 1.0 - 1e-6;
+
+		// ちょうど中点になる候補を整数で調べられる範囲 (float の間隔が 2 以上で、double で正確な整数)
+		const double TieCheckMin = 16777216.0;			// 2^24
+		const double TieCheckMax = 9007199254740992.0;	// 2^53
+
+		char* CopyChars(char* out, const char* str, size_t count)
+		{
+			memcpy(out, str, count);
+			return out + count;
+		}
+
+		char* FillZero(char* out, int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				*out++ = '0';
+			}
+			return out;
+		}
+	}
+
+	char* FormatFloat(char* buffer, float value)
+	{
+		char* out = buffer;
+		if (std::isnan(value))
+		{
+			return CopyChars(out, "nan", 3);
+		}
+		if (std::signbit(value))
+		{
+			*out++ = '-';
+		}
+		if (std::isinf(value))
+		{
+			return CopyChars(out, "inf", 3);
+		}
+		if (value == 0.0f)
+		{
+			*out++ = '0';
+			return out;
+		}
+
+		// 隣の float との中点までが、読み込んだときに元の値に戻る範囲
+		const float absValue = std::fabs(value);
+		const double v = double(absValue);
+		const float prev = std::nextafter(absValue, 0.0f);
+		const float next = std::nextafter(absValue, std::numeric_limits<float>::infinity());
+		const double lower = (v - double(prev)) * 0.5;
+		const double upper = std::isinf(next) ? lower : (double(next) - v) * 0.5;
+		uint32_t bits;
+		memcpy(&bits, &absValue, sizeof(bits));
+		const bool evenMantissa = (bits & 1) == 0;
+
+		// 桁数を 1 桁ずつ増やし、範囲に収まった最初の値を使う
+		// (float は 9 桁あれば必ず元の値に戻る)
+		const int e = int(std::floor(std::log10(v)));
+		uint64_t digits = 0;
+		int exp10 = 0;
+		for (int p = 1; p <= 17; p++)
+		{
+			const int k = e - (p - 1);
+			const uint64_t d = uint64_t(MulPow10(v, -k) + 0.5);
+			if (d == 0)
+			{
+				continue;
+			}
+			digits = d;
+			exp10 = k;
+
+			const double diff = MulPow10(double(d), k) - v;
+			const double halfGap = diff >= 0.0 ? upper : lower;
+			if (std::fabs(diff) < halfGap * RoundTripMargin)
+			{
+				break;
+			}
+
+			// ちょうど中点の場合は、仮数が偶数なら偶数丸めで元の値に戻る
+			if (evenMantissa && k >= 0 && v >= TieCheckMin && v < TieCheckMax)
+			{
+				uint64_t c = d;
+				for (int i = 0; i < k; i++)
+				{
+					c *= 10;
+				}
+				const uint64_t iv = uint64_t(v);
+				const uint64_t dist = c > iv ? c - iv : iv - c;
+				if (dist == uint64_t(c > iv ? upper : lower))
+				{
+					break;
+				}
+			}
+		}
+		while (digits % 10 == 0)
+		{
+			digits /= 10;
+			exp10++;
+		}
+
+		char digitBuffer[FormatUIntBufferSize];
+		const int n = int(FormatUInt(digitBuffer, digits) - digitBuffer);
+		// 先頭の桁の指数
+		const int pointPos = exp10 + n - 1;
+		if (pointPos >= -5 && pointPos < 9)
+		{
+			if (pointPos < 0)
+			{
+				// 0.00123
+				*out++ = '0';
+				*out++ = '.';
+				out = FillZero(out, -pointPos - 1);
+				out = CopyChars(out, digitBuffer, n);
+			}
+			else if (pointPos >= n - 1)
+			{
+				// 12300
+				out = CopyChars(out, digitBuffer, n);
+				out = FillZero(out, pointPos - (n - 1));
+			}
+			else
+			{
+				// 12.3
+				out = CopyChars(out, digitBuffer, pointPos + 1);
+				*out++ = '.';
+				out = CopyChars(out, digitBuffer + pointPos + 1, n - (pointPos + 1));
+			}
+		}
+		else
+		{
+			// 1.23e-7
+			*out++ = digitBuffer[0];
+			if (n > 1)
+			{
+				*out++ = '.';
+				out = CopyChars(out, digitBuffer + 1, n - 1);
+			}
+			*out++ = 'e';
+			if (pointPos < 0)
+			{
+				*out++ = '-';
+			}
+			out = FormatUInt(out, uint64_t(std::abs(pointPos)));
+		}
+		return out;
+	}
+
+	char* FormatUInt(char* buffer, uint64_t value)
+	{
+		char tmp[FormatUIntBufferSize];
+		char* p = tmp + FormatUIntBufferSize;
+		do
+		{
+			*--p = char('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+		return CopyChars(buffer, p, size_t(tmp + FormatUIntBufferSize - p));
+	}
+}
@@ -0,0 +1,30 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BASE_NUMBERFORMAT_H_
+#define SABA_BASE_NUMBERFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace saba
+{
+	/*
+	数値を文字列にする (ロケールに依存しない)。
+	buffer に書き込み、書き込んだ末尾の位置を返す ('\0' は書かない)。
+	*/
+
+	// FormatFloat に必要なバッファのサイズ ("-1.17549435e-38")
+	const size_t FormatFloatBufferSize = 16;
+	// FormatUInt に必要なバッファのサイズ
+	const size_t FormatUIntBufferSize = 20;
+
+	// 読み込むと元の値に戻る、最短の 10 進数で書き込む
+	// 指数が -5 から 8 の範囲は固定小数点、それ以外は "1.5e-7" の形式にする
+	char* FormatFloat(char* buffer, float value);
+	char* FormatUInt(char* buffer, uint64_t value);
+}
+
+#endif // !SABA_BASE_NUMBERFORMAT_H_
@@ -0,0 +1,119 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BASE_ORDEREDQUEUE_H_
+#define SABA_BASE_ORDEREDQUEUE_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+namespace saba
+{
+	/*
+	複数のスレッドから番号付きで追加した要素を、番号の順に取り出すキュー。
+	追加の順番は問わない。
+	次に取り出す番号より capacity 以上先の要素は、追いつくまで Push で待つ
+	(取り出す側が遅くても、保持する要素数が capacity を超えない)。
+	Cancel すると、待っている Push と Pop はすぐに失敗する。
+	*/
+	template <typename T>
+	class OrderedQueue
+	{
+	public:
+		explicit OrderedQueue(size_t capacity)
+			: m_capacity(std::max(capacity, size_t(1)))
+			, m_nextIndex(0)
+			, m_count(0)
+			, m_canceled(false)
+		{
+		}
+
+		OrderedQueue(const OrderedQueue&) = delete;
+		OrderedQueue& operator = (const OrderedQueue&) = delete;
+
+		// 0 から count - 1 までの番号を取り出せるようにする
+		void Reset(size_t count)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_items.clear();
+			m_nextIndex = 0;
+			m_count = count;
+			m_canceled = false;
+		}
+
+		// キャンセルされた場合は false
+		bool Push(size_t index, T item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this, index]()
+			{
+				return m_canceled || index < m_nextIndex + m_capacity;
+			});
+			if (m_canceled)
+			{
+				return false;
+			}
+			m_items[index] = std::move(item);
+			m_cv.notify_all();
+			return true;
+		}
+
+		// すべて取り出した場合と、キャンセルされた場合は false
+		bool Pop(T* item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]()
+			{
+				return m_canceled ||
+					m_nextIndex >= m_count ||
+					m_items.find(m_nextIndex) != m_items.end();
+			});
+			if (m_canceled || m_nextIndex >= m_count)
+			{
+				return false;
+			}
+			auto it = m_items.find(m_nextIndex);
+			*item = std::move(it->second);
+			m_items.erase(it);
+			m_nextIndex++;
+			m_cv.notify_all();
+			return true;
+		}
+
+		void Cancel()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_canceled = true;
+			m_cv.notify_all();
+		}
+
+		bool IsCanceled() const
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			return m_canceled;
+		}
+
+		// 取り出されるのを待っている要素の数
+		size_t GetPendingCount() const
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			return m_items.size();
+		}
+
+	private:
+		mutable std::mutex			m_mutex;
+		std::condition_variable		m_cv;
+		std::map<size_t, T>			m_items;
+		size_t						m_capacity;
+		size_t						m_nextIndex;
+		size_t						m_count;
+		bool						m_canceled;
+	};
+}
+
+#endif // !SABA_BASE_ORDEREDQUEUE_H_
@@ -15,10 +15,14 @@ namespace saba
 		size_t g_finalizerSize = 0;
 
 		SingletonFinalizer::FinalizerFunc g_finalizers[MaxFinalizerNum];
+
+		// シングルトンはワーカースレッドで最初に作られることもある
+		std::mutex g_finalizerMutex;
 	}
 
 	void SingletonFinalizer::AddFinalizer(FinalizerFunc finalizer)
 	{
+		std::lock_guard<std::mutex> lock(g_finalizerMutex);
 		if (g_finalizerSize >= MaxFinalizerNum)
 		{
 			exit(-1);
@@ -30,12 +34,22 @@ namespace saba
 
 	void SingletonFinalizer::Finalize()
 	{
-		for (size_t i = 0; i < g_finalizerSize; i++)
+		// 終了処理の中でシングルトンを使う場合があるので、ロックしたまま呼ばない
+		while (true)
 		{
-			size_t idx = g_finalizerSize - i - 1;
-			(g_finalizers[idx])();
+			FinalizerFunc finalizer;
+			{
+				std::lock_guard<std::mutex> lock(g_finalizerMutex);
+				if (g_finalizerSize == 0)
+				{
+					break;
+				}
+				g_finalizerSize -= 1;
+				finalizer = std::move(g_finalizers[g_finalizerSize]);
+				g_finalizers[g_finalizerSize] = nullptr;
+			}
+			finalizer();
 		}
-		g_finalizerSize = 0;
 	}
 
 }
@@ -0,0 +1,53 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_MMDGPUSKINNING_H_
+#define SABA_MODEL_MMD_MMDGPUSKINNING_H_
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace saba
+{
+	/*
+	GPU でスキニングとモーフを行うためのデータ。
+	頂点毎のデータはモデルの読み込み後に一度だけ転送し、
+	毎フレームはスキニング行列とモーフのウェイトだけを転送する。
+	*/
+	enum class MMDGPUSkinningType : int32_t
+	{
+		Linear = 0,			//!< BDEF1, BDEF2, BDEF4
+		SDEF = 1,
+		DualQuaternion = 2,	//!< QDEF
+	};
+
+	struct MMDGPUSkinningVertex
+	{
+		glm::ivec4	m_boneIndex;
+		glm::vec4	m_boneWeight;
+		glm::vec3	m_sdefC;
+		glm::vec3	m_sdefR0;
+		glm::vec3	m_sdefR1;
+		int32_t		m_skinningType;	//!< MMDGPUSkinningType
+		// モーフのリストの範囲 (x:オフセット y:個数)
+		glm::ivec2	m_positionMorph;
+		glm::ivec2	m_uvMorph;
+	};
+
+	struct MMDGPUSkinningData
+	{
+		// 頂点番号順
+		std::vector<MMDGPUSkinningVertex>	m_vertices;
+		// 頂点毎にまとめたモーフのリスト
+		std::vector<glm::vec4>	m_positionMorphs;	//!< xyz:移動量 w:ウェイトの番号
+		std::vector<glm::vec4>	m_uvMorphs;			//!< xy:UV の移動量 z:ウェイトの番号
+		size_t					m_morphWeightCount = 0;
+	};
+}
+
+#endif // !SABA_MODEL_MMD_MMDGPUSKINNING_H_
@@ -7,14 +7,58 @@
 #include "MMDPhysics.h"
 #include "VPDFile.h"
 #include "VMDAnimation.h"
+#include "VMDBakedAnimation.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cmath>
+
 #include <Saba/Base/Log.h>
 
 namespace saba
 {
+	namespace
+	{
+		// Reduced で物理演算する剛体の連なりの長さ (これより先はボーンに追従させる)
+		const int ReducedChainLength = 2;
+		// この時間静止していたら眠らせる (秒)
+		const float SleepTime = 1.0f;
+
+		glm::mat4 BlendTransform(const glm::mat4& m0, const glm::mat4& m1, float t)
+		{
+			glm::quat q0 = glm::quat_cast(glm::mat3(m0));
+			glm::quat q1 = glm::quat_cast(glm::mat3(m1));
+			glm::mat4 m = glm::mat4_cast(glm::slerp(q0, q1, t));
+			m[3] = glm::mix(m0[3], m1[3], t);
+			return m;
+		}
+
+		bool IsSameTransform(const glm::mat4& m0, const glm::mat4& m1)
+		{
+			const float Epsilon = 1.0e-4f;
+			for (int i = 0; i < 4; i++)
+			{
+				for (int j = 0; j < 4; j++)
+				{
+					if (std::abs(m0[i][j] - m1[i][j]) > Epsilon)
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+	}
+
 	MMDPhysicsManager::MMDPhysicsManager()
+		: m_lod(MMDPhysicsLOD::Full)
+		, m_lodTransitionTime(0.5f)
+		, m_enableSleep(false)
+		, m_sleeping(false)
+		, m_sleepLOD(MMDPhysicsLOD::Full)
+		, m_restTime(0)
+		, m_elapsed(0)
+		, m_kinematicMoved(false)
 	{
 	}
 
@@ -37,7 +81,12 @@ namespace saba
 
 	bool MMDPhysicsManager::Create()
 	{
-		m_mmdPhysics = std::make_unique<MMDPhysics>();
+		if (m_sharedPhysics != nullptr)
+		{
+			m_mmdPhysics = m_sharedPhysics;
+			return true;
+		}
+		m_mmdPhysics = std::make_shared<MMDPhysics>();
 		return m_mmdPhysics->Create();
 	}
 
@@ -66,6 +115,268 @@ namespace saba
 		return ret;
 	}
 
+	void MMDPhysicsManager::BeginPhysicsAnimation(float elapsed)
+	{
+		if (m_rigidBodyStates.size() != m_rigidBodys.size())
+		{
+			SetupRigidBodyStates();
+		}
+		m_elapsed = elapsed;
+		m_kinematicMoved = UpdateKinematicTransforms();
+
+		if (m_sleeping && (m_kinematicMoved || m_lod != m_sleepLOD))
+		{
+			WakeUp();
+		}
+
+		const float weightStep = m_lodTransitionTime > 0 ? elapsed / m_lodTransitionTime : 1.0f;
+		for (size_t i = 0; i < m_rigidBodys.size(); i++)
+		{
+			auto& rb = m_rigidBodys[i];
+			auto& state = m_rigidBodyStates[i];
+			if (!rb->IsDynamic())
+			{
+				rb->SetActivation(true);
+				continue;
+			}
+
+			if (IsActiveLOD(state))
+			{
+				if (!state.m_active)
+				{
+					// ボーンの姿勢から物理演算を始める
+					rb->ResetTransform();
+					rb->ResetVelocity();
+					state.m_active = true;
+				}
+				state.m_weight = std::min(state.m_weight + weightStep, 1.0f);
+			}
+			else if (state.m_active)
+			{
+				// ボーンの姿勢に近づけ終わるまでは物理演算を続ける
+				state.m_weight = std::max(state.m_weight - weightStep, 0.0f);
+				if (state.m_weight == 0.0f)
+				{
+					state.m_active = false;
+				}
+			}
+			rb->SetActivation(state.m_active);
+
+			if (state.m_active && state.m_weight < 1.0f)
+			{
+				state.m_animLocal = rb->GetNode()->GetLocalTransform();
+			}
+		}
+	}
+
+	void MMDPhysicsManager::UpdatePhysics(float elapsed)
+	{
+		auto physics = GetMMDPhysics();
+		if (physics == nullptr)
+		{
+			return;
+		}
+
+		// 共有しているワールドは、共有している側で一度だけ進める
+		if (IsSharedPhysics())
+		{
+			return;
+		}
+
+		if (m_sleeping)
+		{
+			return;
+		}
+		bool hasActive = std::any_of(
+			m_rigidBodyStates.begin(),
+			m_rigidBodyStates.end(),
+			[](const RigidBodyState& state) { return state.m_active; }
+		);
+		if (!hasActive)
+		{
+			return;
+		}
+
+		if (m_lod == MMDPhysicsLOD::Full)
+		{
+			physics->Update(elapsed);
+		}
+		else
+		{
+			// ステップの時間は変えずに (持ち越した時間と補間が LOD の切り替えでずれないように)、
+			// 1 回に進めるステップ数を減らす
+			physics->Update(elapsed, physics->GetFPS(), std::max(physics->GetMaxSubStepCount() / 2, 1));
+		}
+	}
+
+	void MMDPhysicsManager::EndPhysicsAnimation()
+	{
+		if (m_rigidBodyStates.size() != m_rigidBodys.size())
+		{
+			SetupRigidBodyStates();
+		}
+
+		// ボーンに追従している剛体は、アニメーションの姿勢のまま
+		auto physics = GetMMDPhysics();
+		const float interpolation = physics != nullptr ? physics->GetInterpolation() : 1.0f;
+		for (size_t i = 0; i < m_rigidBodys.size(); i++)
+		{
+			if (!m_rigidBodys[i]->IsDynamic() || m_rigidBodyStates[i].m_active)
+			{
+				m_rigidBodys[i]->ReflectGlobalTransform(interpolation);
+			}
+		}
+		for (size_t i = 0; i < m_rigidBodys.size(); i++)
+		{
+			if (!m_rigidBodys[i]->IsDynamic() || m_rigidBodyStates[i].m_active)
+			{
+				m_rigidBodys[i]->CalcLocalTransform();
+			}
+		}
+
+		bool transition = false;
+		for (size_t i = 0; i < m_rigidBodys.size(); i++)
+		{
+			const auto& state = m_rigidBodyStates[i];
+			if (m_rigidBodys[i]->IsDynamic() && state.m_active && state.m_weight < 1.0f)
+			{
+				auto node = m_rigidBodys[i]->GetNode();
+				node->SetLocalTransform(BlendTransform(state.m_animLocal, node->GetLocalTransform(), state.m_weight));
+				transition = true;
+			}
+		}
+
+		if (!m_enableSleep || m_sleeping)
+		{
+			return;
+		}
+		bool resting = !m_kinematicMoved && !transition;
+		for (size_t i = 0; i < m_rigidBodys.size() && resting; i++)
+		{
+			if (m_rigidBodys[i]->IsDynamic() && m_rigidBodyStates[i].m_active)
+			{
+				resting = m_rigidBodys[i]->IsResting();
+			}
+		}
+		m_restTime = resting ? m_restTime + m_elapsed : 0.0f;
+		if (m_restTime >= SleepTime)
+		{
+			Sleep();
+		}
+	}
+
+	void MMDPhysicsManager::ResetPhysicsState()
+	{
+		if (m_sleeping)
+		{
+			WakeUp();
+		}
+		m_restTime = 0;
+
+		SetupRigidBodyStates();
+		for (auto& state : m_rigidBodyStates)
+		{
+			state.m_active = IsActiveLOD(state);
+			state.m_weight = state.m_active ? 1.0f : 0.0f;
+		}
+	}
+
+	void MMDPhysicsManager::SetupRigidBodyStates()
+	{
+		m_rigidBodyStates.resize(m_rigidBodys.size());
+
+		std::unordered_map<const MMDNode*, const MMDRigidBody*> dynamicNodes;
+		for (const auto& rb : m_rigidBodys)
+		{
+			if (rb->IsDynamic() && rb->GetNode() != nullptr)
+			{
+				dynamicNodes[rb->GetNode()] = rb.get();
+			}
+		}
+
+		for (size_t i = 0; i < m_rigidBodys.size(); i++)
+		{
+			const auto& rb = m_rigidBodys[i];
+			auto& state = m_rigidBodyStates[i];
+
+			// 親をたどって、物理演算する剛体がいくつ連なっているかを数える
+			int chainLength = 0;
+			if (rb->IsDynamic() && rb->GetNode() != nullptr)
+			{
+				for (auto node = rb->GetNode()->GetParent(); node != nullptr; node = node->GetParent())
+				{
+					if (dynamicNodes.find(node) == dynamicNodes.end())
+					{
+						break;
+					}
+					chainLength++;
+				}
+			}
+			state.m_secondary = chainLength >= ReducedChainLength;
+			state.m_active = true;
+			state.m_weight = 1.0f;
+			state.m_animLocal = glm::mat4(1);
+			state.m_prevGlobal = rb->GetNode() != nullptr ? rb->GetNode()->GetGlobalTransform() : glm::mat4(1);
+		}
+	}
+
+	bool MMDPhysicsManager::IsActiveLOD(const RigidBodyState& state) const
+	{
+		switch (m_lod)
+		{
+		case MMDPhysicsLOD::Full:
+			return true;
+		case MMDPhysicsLOD::Reduced:
+			return !state.m_secondary;
+		default:
+			return false;
+		}
+	}
+
+	bool MMDPhysicsManager::UpdateKinematicTransforms()
+	{
+		bool moved = false;
+		for (size_t i = 0; i < m_rigidBodys.size(); i++)
+		{
+			const auto& rb = m_rigidBodys[i];
+			auto& state = m_rigidBodyStates[i];
+			if (rb->IsDynamic() || rb->GetNode() == nullptr)
+			{
+				continue;
+			}
+			const auto& global = rb->GetNode()->GetGlobalTransform();
+			if (!IsSameTransform(global, state.m_prevGlobal))
+			{
+				moved = true;
+			}
+			state.m_prevGlobal = global;
+		}
+		return moved;
+	}
+
+	void MMDPhysicsManager::Sleep()
+	{
+		for (size_t i = 0; i < m_rigidBodys.size(); i++)
+		{
+			if (m_rigidBodyStates[i].m_active)
+			{
+				m_rigidBodys[i]->Sleep();
+			}
+		}
+		m_sleeping = true;
+		m_sleepLOD = m_lod;
+	}
+
+	void MMDPhysicsManager::WakeUp()
+	{
+		for (auto& rb : m_rigidBodys)
+		{
+			rb->WakeUp();
+		}
+		m_sleeping = false;
+		m_restTime = 0;
+	}
+
 	void MMDModel::SaveBaseAnimation()
 	{
 		auto nodeMan = GetNodeManager();
@@ -153,6 +464,20 @@ namespace saba
 		}
 	}
 
+	void MMDModel::Update(glm::vec3* positions, glm::vec3* normals, glm::vec2* uvs)
+	{
+		// 更新したバッファからコピーする
+		Update();
+
+		const size_t vtxCount = GetVertexCount();
+		std::copy(GetUpdatePositions(), GetUpdatePositions() + vtxCount, positions);
+		std::copy(GetUpdateNormals(), GetUpdateNormals() + vtxCount, normals);
+		if (uvs != nullptr)
+		{
+			std::copy(GetUpdateUVs(), GetUpdateUVs() + vtxCount, uvs);
+		}
+	}
+
 	void MMDModel::UpdateAllAnimation(VMDAnimation * vmdAnim, float vmdFrame, float physicsElapsed)
 	{
 		if (vmdAnim != nullptr)
@@ -169,6 +494,35 @@ namespace saba
 		UpdateNodeAnimation(true);
 	}
 
+	void MMDModel::UpdateAllAnimation(VMDBakedAnimation * bakedAnim, float vmdFrame, float physicsElapsed)
+	{
+		const bool enableIKAndAppend = m_enableIKAndAppend;
+		if (bakedAnim != nullptr)
+		{
+			bakedAnim->EvaluateMorph(vmdFrame);
+		}
+
+		UpdateMorphAnimation();
+
+		if (bakedAnim != nullptr)
+		{
+			// ボーンモーフを反映した後に評価する
+			bakedAnim->EvaluateNode(vmdFrame);
+			if (bakedAnim->IsIKBaked())
+			{
+				m_enableIKAndAppend = false;
+			}
+		}
+
+		UpdateNodeAnimation(false);
+
+		UpdatePhysicsAnimation(physicsElapsed);
+
+		UpdateNodeAnimation(true);
+
+		m_enableIKAndAppend = enableIKAndAppend;
+	}
+
 	void MMDModel::LoadPose(const VPDFile & vpd, int frameCount)
 	{
 		struct Pose
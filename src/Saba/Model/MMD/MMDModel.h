@@ -14,9 +14,13 @@
 #include <string>
 #include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <unordered_map>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 namespace saba
 {
@@ -24,7 +28,88 @@ namespace saba
 	class MMDPhysics;
 	class MMDRigidBody;
 	class MMDJoint;
+	class VMDBakedAnimation;
 	struct VPDFile;
+	struct MMDGPUSkinningData;
+
+	struct MMDNameHash
+	{
+		uint64_t operator()(const std::string& name) const
+		{
+			return std::hash<std::string>()(name);
+		}
+	};
+
+	/*
+	名前からインデックスを引くためのハッシュテーブル。
+	ハッシュが同じ要素は、名前を比べて区別する。
+	登録後に名前が変わった要素や、範囲外になった要素は見つからない (Build し直す)。
+	*/
+	template <typename Hash>
+	class MMDNameIndexT
+	{
+	public:
+		static const size_t NPos = -1;
+
+		template <typename Container>
+		void Build(const Container& items)
+		{
+			m_indices.clear();
+			m_indices.reserve(items.size());
+			for (size_t i = 0; i < items.size(); i++)
+			{
+				// 同名がある場合は先頭を優先するので、番号順に並べる
+				m_indices[m_hash(items[i]->GetName())].push_back(i);
+			}
+			m_isBuilt = true;
+		}
+
+		void Clear()
+		{
+			m_indices.clear();
+			m_isBuilt = false;
+		}
+
+		bool IsBuilt() const { return m_isBuilt; }
+
+		// Build する前は線形探索する
+		template <typename Container>
+		size_t Find(const Container& items, const std::string& name) const
+		{
+			if (!m_isBuilt)
+			{
+				for (size_t i = 0; i < items.size(); i++)
+				{
+					if (items[i]->GetName() == name)
+					{
+						return i;
+					}
+				}
+				return NPos;
+			}
+
+			auto findIt = m_indices.find(m_hash(name));
+			if (findIt == m_indices.end())
+			{
+				return NPos;
+			}
+			for (size_t idx : findIt->second)
+			{
+				if (idx < items.size() && items[idx]->GetName() == name)
+				{
+					return idx;
+				}
+			}
+			return NPos;
+		}
+
+	private:
+		std::unordered_map<uint64_t, std::vector<size_t>>	m_indices;
+		Hash												m_hash;
+		bool												m_isBuilt = false;
+	};
+
+	using MMDNameIndex = MMDNameIndexT<MMDNameHash>;
 
 	class MMDNodeManager
 	{
@@ -86,6 +171,17 @@ namespace saba
 		}
 	};
 
+	/*
+	物理演算の LOD。
+	Full 以外では、一部またはすべての剛体を物理演算からボーンへの追従 (キネマティック) に切り替える。
+	*/
+	enum class MMDPhysicsLOD
+	{
+		Full,		//!< すべての剛体を物理演算する
+		Reduced,	//!< サブステップを減らし、剛体の連なり (髪やスカート) の先をボーンに追従させる
+		Kinematic,	//!< すべての剛体をボーンに追従させる
+	};
+
 	class MMDPhysicsManager
 	{
 	public:
@@ -96,6 +192,13 @@ namespace saba
 		~MMDPhysicsManager();
 
 		bool Create();
+		/*
+		他のモデルとワールドを共有する (Create の前に呼ぶ)。
+		ワールドを共有したモデルは UpdatePhysicsAnimation や ResetPhysics でワールドを進めない。
+		共有している側で、すべてのモデルの BeginPhysicsAnimation の後に MMDPhysics::Update を呼ぶ。
+		*/
+		void SetSharedPhysics(std::shared_ptr<MMDPhysics> physics) { m_sharedPhysics = std::move(physics); }
+		bool IsSharedPhysics() const { return m_sharedPhysics != nullptr; }
 
 		MMDPhysics* GetMMDPhysics();
 
@@ -105,12 +208,66 @@ namespace saba
 		MMDJoint* AddJoint();
 		std::vector<JointPtr>* GetJoints() { return &m_joints; }
 
+		/*
+		剛体をボーンへの追従に切り替えるときは、LODTransitionTime の間は物理演算を続けながらボーンの姿勢に近づける。
+		物理演算に戻すときは、ボーンの姿勢から物理演算を始めるので、ResetPhysics のように姿勢が飛ばない。
+		*/
+		void SetLOD(MMDPhysicsLOD lod) { m_lod = lod; }
+		MMDPhysicsLOD GetLOD() const { return m_lod; }
+		void SetLODTransitionTime(float time) { m_lodTransitionTime = time; }
+		float GetLODTransitionTime() const { return m_lodTransitionTime; }
+
+		/*
+		しばらく静止しているモデルの剛体を眠らせる。
+		キネマティックの剛体が動くか、LOD を変えると起きる。
+		ワールドを共有していない場合、眠っている間はワールドを進めない。
+		*/
+		void EnableSleep(bool enable) { m_enableSleep = enable; }
+		bool IsEnabledSleep() const { return m_enableSleep; }
+		bool IsSleeping() const { return m_sleeping; }
+
+		// MMDModel の BeginPhysicsAnimation, UpdatePhysicsAnimation, EndPhysicsAnimation から呼ぶ
+		void BeginPhysicsAnimation(float elapsed);
+		// LOD に合わせてワールドを進める
+		void UpdatePhysics(float elapsed);
+		// 剛体の姿勢をノードのローカル行列に反映する (グローバル行列の更新は呼び出し側で行う)
+		void EndPhysicsAnimation();
+		// MMDModel の ResetPhysics の後に呼ぶ
+		void ResetPhysicsState();
+
+	private:
+		struct RigidBodyState
+		{
+			bool		m_secondary;	//!< Reduced のときボーンに追従させる
+			bool		m_active;		//!< 物理演算している
+			float		m_weight;		//!< 物理演算の結果を反映する割合
+			glm::mat4	m_animLocal;	//!< 物理演算の前のローカル行列
+			glm::mat4	m_prevGlobal;	//!< 前のフレームのグローバル行列 (キネマティックの剛体)
+		};
+
+		void SetupRigidBodyStates();
+		bool IsActiveLOD(const RigidBodyState& state) const;
+		bool UpdateKinematicTransforms();
+		void Sleep();
+		void WakeUp();
 
 	private:
-		std::unique_ptr<MMDPhysics>	m_mmdPhysics;
+		std::shared_ptr<MMDPhysics>	m_mmdPhysics;
+		std::shared_ptr<MMDPhysics>	m_sharedPhysics;
 
 		std::vector<RigidBodyPtr>	m_rigidBodys;
 		std::vector<JointPtr>		m_joints;
+
+		MMDPhysicsLOD				m_lod;
+		float						m_lodTransitionTime;
+		std::vector<RigidBodyState>	m_rigidBodyStates;
+
+		bool			m_enableSleep;
+		bool			m_sleeping;
+		MMDPhysicsLOD	m_sleepLOD;
+		float			m_restTime;
+		float			m_elapsed;
+		bool			m_kinematicMoved;
 	};
 
 	struct MMDSubMesh
@@ -148,6 +305,15 @@ namespace saba
 		virtual size_t GetSubMeshCount() const = 0;
 		virtual const MMDSubMesh* GetSubMeshes() const = 0;
 
+		/*
+		頂点、面、サブメッシュのデータを他のインスタンスと共有している場合は、そのデータを返す。
+		同じデータを使うモデルは同じポインタを返すので、描画側のバッファの共有に使う。
+		共有していない場合は nullptr。
+		*/
+		virtual std::shared_ptr<const void> GetSharedMeshData() const { return nullptr; }
+		// UV モーフがない場合、更新後の UV は常に GetUVs() と同じになる
+		virtual bool HasUVMorph() const { return true; }
+
 		virtual MMDPhysics* GetMMDPhysics() = 0;
 
 		// ノードを初期化する
@@ -172,13 +338,51 @@ namespace saba
 		[[deprecated("Please use UpdateAllAnimation() function")]]
 		void UpdatePhysics(float elapsed);
 		virtual void UpdatePhysicsAnimation(float elapsed) = 0;
+		/*
+		UpdatePhysicsAnimation をワールドの更新の前後に分けたもの。
+		ワールドを複数のモデルで共有している場合は、すべてのモデルの BeginPhysicsAnimation の後に
+		MMDPhysics::Update を一度だけ呼び、その後それぞれの EndPhysicsAnimation を呼ぶ。
+		*/
+		virtual void BeginPhysicsAnimation(float elapsed) = 0;
+		virtual void EndPhysicsAnimation() = 0;
 		// 頂点を更新する
 		virtual void Update() = 0;
+		/*
+		頂点を更新して、指定したバッファ (頂点数分) に書き込む。
+		マップした GPU のバッファに直接書き込む場合に使う。
+		GetUpdatePositions(), GetUpdateNormals(), GetUpdateUVs() が更新されるかはモデルによる。
+		uvs が nullptr の場合は UV を書き込まない。
+		*/
+		virtual void Update(glm::vec3* positions, glm::vec3* normals, glm::vec2* uvs);
 		virtual void SetParallelUpdateHint(uint32_t parallelCount) = 0;
 
+		/*
+		GPU スキニング (MMDGPUSkinning.h)
+		有効な場合、Update() は頂点を更新せずに、スキニング行列とモーフのウェイトだけを更新する。
+		(GetUpdatePositions(), GetUpdateNormals(), GetUpdateUVs() は更新されない)
+		対応していないモデルは GetGPUSkinningData() が false を返す。
+		*/
+		virtual bool GetGPUSkinningData(MMDGPUSkinningData* /*data*/) const { return false; }
+		virtual void EnableGPUSkinning(bool /*enable*/) {}
+		virtual bool IsGPUSkinningEnabled() const { return false; }
+		// ノード数分
+		virtual const glm::mat4* GetSkinningTransforms() const { return nullptr; }
+		// SDEF の頂点が無い場合は nullptr
+		virtual const glm::quat* GetSDEFRotations() const { return nullptr; }
+		// MMDGPUSkinningData::m_morphWeightCount 分
+		virtual const float* GetMorphWeights() const { return nullptr; }
+
+		// false の場合、UpdateNodeAnimation で IK と付与を計算しない (IK を含めてベイクしたアニメーション用)
+		void EnableIKAndAppend(bool enable) { m_enableIKAndAppend = enable; }
+		bool IsIKAndAppendEnabled() const { return m_enableIKAndAppend; }
+
 		void UpdateAllAnimation(VMDAnimation* vmdAnim, float vmdFrame, float physicsElapsed);
+		void UpdateAllAnimation(VMDBakedAnimation* bakedAnim, float vmdFrame, float physicsElapsed);
 		void LoadPose(const VPDFile& vpd, int frameCount = 30);
 
+	protected:
+		bool	m_enableIKAndAppend = true;
+
 	protected:
 		template <typename NodeType>
 		class MMDNodeManagerT : public MMDNodeManager
@@ -190,19 +394,13 @@ namespace saba
 
 			size_t FindNodeIndex(const std::string& name) override
 			{
-				auto findIt = std::find_if(
-					m_nodes.begin(),
-					m_nodes.end(),
-					[&name](const NodePtr& node) { return node->GetName() == name; }
-				);
-				if (findIt == m_nodes.end())
-				{
-					return NPos;
-				}
-				else
-				{
-					return findIt - m_nodes.begin();
-				}
+				return m_nameIndex.Find(m_nodes, name);
+			}
+
+			// ノードの名前を設定した後に呼ぶ
+			void BuildNameIndex()
+			{
+				m_nameIndex.Build(m_nodes);
 			}
 
 			MMDNode* GetMMDNode(size_t idx) override
@@ -215,6 +413,7 @@ namespace saba
 				auto node = std::make_unique<NodeType>();
 				node->SetIndex((uint32_t)m_nodes.size());
 				m_nodes.emplace_back(std::move(node));
+				m_nameIndex.Clear();
 				return m_nodes[m_nodes.size() - 1].get();
 			}
 
@@ -230,6 +429,7 @@ namespace saba
 
 		private:
 			std::vector<NodePtr>	m_nodes;
+			MMDNameIndex			m_nameIndex;
 		};
 
 		template <typename IKSolverType>
@@ -242,19 +442,13 @@ namespace saba
 
 			size_t FindIKSolverIndex(const std::string& name) override
 			{
-				auto findIt = std::find_if(
-					m_ikSolvers.begin(),
-					m_ikSolvers.end(),
-					[&name](const IKSolverPtr& ikSolver) { return ikSolver->GetName() == name; }
-				);
-				if (findIt == m_ikSolvers.end())
-				{
-					return NPos;
-				}
-				else
-				{
-					return findIt - m_ikSolvers.begin();
-				}
+				return m_nameIndex.Find(m_ikSolvers, name);
+			}
+
+			// IK の名前を設定した後に呼ぶ
+			void BuildNameIndex()
+			{
+				m_nameIndex.Build(m_ikSolvers);
 			}
 
 			MMDIkSolver* GetMMDIKSolver(size_t idx) override
@@ -265,6 +459,7 @@ namespace saba
 			IKSolverType* AddIKSolver()
 			{
 				m_ikSolvers.emplace_back(std::make_unique<IKSolverType>());
+				m_nameIndex.Clear();
 				return m_ikSolvers[m_ikSolvers.size() - 1].get();
 			}
 
@@ -280,6 +475,7 @@ namespace saba
 
 		private:
 			std::vector<IKSolverPtr>	m_ikSolvers;
+			MMDNameIndex				m_nameIndex;
 		};
 
 		template <typename MorphType>
@@ -292,19 +488,13 @@ namespace saba
 
 			size_t FindMorphIndex(const std::string& name) override
 			{
-				auto findIt = std::find_if(
-					m_morphs.begin(),
-					m_morphs.end(),
-					[&name](const MorphPtr& morph) { return morph->GetName() == name; }
-				);
-				if (findIt == m_morphs.end())
-				{
-					return NPos;
-				}
-				else
-				{
-					return findIt - m_morphs.begin();
-				}
+				return m_nameIndex.Find(m_morphs, name);
+			}
+
+			// モーフの名前を設定した後に呼ぶ
+			void BuildNameIndex()
+			{
+				m_nameIndex.Build(m_morphs);
 			}
 
 			MMDMorph* GetMorph(size_t idx) override
@@ -315,6 +505,7 @@ namespace saba
 			MorphType* AddMorph()
 			{
 				m_morphs.emplace_back(std::make_unique<MorphType>());
+				m_nameIndex.Clear();
 				return m_morphs[m_morphs.size() - 1].get();
 			}
 
@@ -325,6 +516,7 @@ namespace saba
 
 		private:
 			std::vector<MorphPtr>	m_morphs;
+			MMDNameIndex			m_nameIndex;
 		};
 	};
 }
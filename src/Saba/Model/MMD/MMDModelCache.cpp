@@ -0,0 +1,259 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "MMDModelCache.h"
+
+#include <Saba/Base/Log.h>
+#include <Saba/Base/UnicodeUtil.h>
+
+#include <cstdio>
+#include <cstring>
+
+#if _WIN32
+#include <Windows.h>
+#endif // _WIN32
+
+namespace saba
+{
+	namespace
+	{
+		const char		ModelCacheMagic[8] = { 'S', 'a', 'b', 'a', 'M', 'D', 'C', '\0' };
+		const uint32_t	ModelCacheVersion = 1;
+		const size_t	ModelCacheSectionAlign = 16;
+
+		struct ModelCacheHeader
+		{
+			char		m_magic[8];
+			uint32_t	m_version;
+			uint32_t	m_format;
+			uint64_t	m_sourceSize;
+			uint64_t	m_sourceHash;
+			uint32_t	m_sectionCount;
+			uint32_t	m_reserved;
+		};
+
+		struct ModelCacheSection
+		{
+			uint32_t	m_id;
+			uint32_t	m_elementSize;
+			uint64_t	m_offset;
+			uint64_t	m_count;
+		};
+
+		size_t Align(size_t size, size_t align)
+		{
+			return (size + align - 1) / align * align;
+		}
+
+		void RemoveCacheFile(const std::string& filepath)
+		{
+#if _WIN32
+			std::wstring wFilepath;
+			if (TryToWString(filepath, wFilepath))
+			{
+				DeleteFileW(wFilepath.c_str());
+			}
+#else // _WIN32
+			remove(filepath.c_str());
+#endif // _WIN32
+		}
+
+		bool ReplaceCacheFile(const std::string& src, const std::string& dst)
+		{
+#if _WIN32
+			std::wstring wSrc;
+			std::wstring wDst;
+			if (!TryToWString(src, wSrc) || !TryToWString(dst, wDst))
+			{
+				return false;
+			}
+			return MoveFileExW(wSrc.c_str(), wDst.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else // _WIN32
+			return rename(src.c_str(), dst.c_str()) == 0;
+#endif // _WIN32
+		}
+	}
+
+	MMDModelCacheWriter::MMDModelCacheWriter()
+	{
+	}
+
+	void MMDModelCacheWriter::AddSection(uint32_t id, const void* data, size_t elementSize, size_t count)
+	{
+		Section section;
+		section.m_id = id;
+		section.m_elementSize = uint32_t(elementSize);
+		section.m_count = count;
+		section.m_data.resize(elementSize * count);
+		if (!section.m_data.empty())
+		{
+			memcpy(section.m_data.data(), data, section.m_data.size());
+		}
+		m_sections.emplace_back(std::move(section));
+	}
+
+	bool MMDModelCacheWriter::Save(const std::string& filepath, uint32_t format, uint64_t sourceSize, uint64_t sourceHash) const
+	{
+		ModelCacheHeader header;
+		memcpy(header.m_magic, ModelCacheMagic, sizeof(header.m_magic));
+		header.m_version = ModelCacheVersion;
+		header.m_format = format;
+		header.m_sourceSize = sourceSize;
+		header.m_sourceHash = sourceHash;
+		header.m_sectionCount = uint32_t(m_sections.size());
+		header.m_reserved = 0;
+
+		std::vector<ModelCacheSection> sectionTable(m_sections.size());
+		size_t offset = Align(sizeof(ModelCacheHeader) + sizeof(ModelCacheSection) * m_sections.size(), ModelCacheSectionAlign);
+		for (size_t i = 0; i < m_sections.size(); i++)
+		{
+			sectionTable[i].m_id = m_sections[i].m_id;
+			sectionTable[i].m_elementSize = m_sections[i].m_elementSize;
+			sectionTable[i].m_offset = offset;
+			sectionTable[i].m_count = m_sections[i].m_count;
+			offset = Align(offset + m_sections[i].m_data.size(), ModelCacheSectionAlign);
+		}
+
+		// 途中で失敗した場合に壊れたファイルが残らないように、一時ファイルに書いてから置き換える
+		std::string tempFilepath = filepath + ".tmp";
+		{
+			File file;
+			if (!file.Create(tempFilepath))
+			{
+				SABA_WARN("MMDModelCache : Failed to create file. {}", tempFilepath);
+				return false;
+			}
+
+			bool ret = file.Write(&header);
+			if (!sectionTable.empty())
+			{
+				ret = ret && file.Write(sectionTable.data(), sectionTable.size());
+			}
+			const uint8_t padding[ModelCacheSectionAlign] = {};
+			for (size_t i = 0; i < m_sections.size() && ret; i++)
+			{
+				size_t paddingSize = size_t(sectionTable[i].m_offset) - size_t(file.Tell());
+				if (paddingSize != 0)
+				{
+					ret = ret && file.Write(padding, paddingSize);
+				}
+				if (!m_sections[i].m_data.empty())
+				{
+					ret = ret && file.Write(m_sections[i].m_data.data(), m_sections[i].m_data.size());
+				}
+			}
+			if (!ret)
+			{
+				SABA_WARN("MMDModelCache : Failed to write file. {}", tempFilepath);
+				file.Close();
+				RemoveCacheFile(tempFilepath);
+				return false;
+			}
+		}
+
+		if (!ReplaceCacheFile(tempFilepath, filepath))
+		{
+			SABA_WARN("MMDModelCache : Failed to rename file. {}", filepath);
+			RemoveCacheFile(tempFilepath);
+			return false;
+		}
+
+		return true;
+	}
+
+	MMDModelCacheReader::MMDModelCacheReader()
+	{
+	}
+
+	bool MMDModelCacheReader::Open(const std::string& filepath, uint32_t format, uint64_t sourceSize, uint64_t sourceHash)
+	{
+		Close();
+
+		if (!m_file.Open(filepath))
+		{
+			return false;
+		}
+
+		BufferReader reader(m_file.GetData(), m_file.GetSize());
+		ModelCacheHeader header;
+		if (!reader.Read(&header))
+		{
+			SABA_INFO("MMDModelCache : Invalid header. {}", filepath);
+			Close();
+			return false;
+		}
+		if (memcmp(header.m_magic, ModelCacheMagic, sizeof(header.m_magic)) != 0 ||
+			header.m_version != ModelCacheVersion ||
+			header.m_format != format
+			)
+		{
+			SABA_INFO("MMDModelCache : Unsupported version. {}", filepath);
+			Close();
+			return false;
+		}
+		if (header.m_sourceSize != sourceSize || header.m_sourceHash != sourceHash)
+		{
+			SABA_INFO("MMDModelCache : Source file has been changed. {}", filepath);
+			Close();
+			return false;
+		}
+
+		if (!reader.CanRead(header.m_sectionCount, sizeof(ModelCacheSection)))
+		{
+			SABA_INFO("MMDModelCache : Invalid section table. {}", filepath);
+			Close();
+			return false;
+		}
+		m_sections.resize(header.m_sectionCount);
+		for (auto& section : m_sections)
+		{
+			ModelCacheSection src;
+			reader.Read(&src);
+
+			// セクションがファイルに収まっているかを確認する
+			const uint64_t fileSize = m_file.GetSize();
+			if (src.m_elementSize == 0 ||
+				src.m_offset > fileSize ||
+				src.m_count > (fileSize - src.m_offset) / src.m_elementSize
+				)
+			{
+				SABA_INFO("MMDModelCache : Invalid section. {}", filepath);
+				Close();
+				return false;
+			}
+			section.m_id = src.m_id;
+			section.m_elementSize = src.m_elementSize;
+			section.m_offset = src.m_offset;
+			section.m_count = src.m_count;
+		}
+
+		return true;
+	}
+
+	void MMDModelCacheReader::Close()
+	{
+		m_file.Close();
+		m_sections.clear();
+	}
+
+	const void* MMDModelCacheReader::FindSection(uint32_t id, size_t elementSize, size_t* count) const
+	{
+		for (const auto& section : m_sections)
+		{
+			if (section.m_id != id)
+			{
+				continue;
+			}
+			if (section.m_elementSize != elementSize)
+			{
+				SABA_INFO("MMDModelCache : Element size mismatch. id={}", id);
+				return nullptr;
+			}
+			*count = size_t(section.m_count);
+			return m_file.GetData() + section.m_offset;
+		}
+		return nullptr;
+	}
+}
@@ -0,0 +1,119 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_MMDMODELCACHE_H_
+#define SABA_MODEL_MMD_MMDMODELCACHE_H_
+
+#include <Saba/Base/File.h>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+namespace saba
+{
+	/*
+	モデルの読み込み時に作る配列を保存するキャッシュファイル (.sabacache)
+
+	ヘッダー、セクションテーブル、セクションのデータの順に並ぶ。
+	セクションのデータはファイル先頭から 16 バイトにアラインして配置する。
+	元のモデルファイルのサイズとハッシュを持ち、一致しない場合は使わない。
+	セクションは要素のサイズを持ち、構造体のレイアウトが変わった場合も使わない。
+	*/
+	class MMDModelCacheWriter
+	{
+	public:
+		MMDModelCacheWriter();
+
+		template <typename T>
+		void AddSection(uint32_t id, const std::vector<T>& data)
+		{
+			AddSection(id, data.data(), sizeof(T), data.size());
+		}
+
+		template <typename T>
+		void AddValue(uint32_t id, const T& value)
+		{
+			AddSection(id, &value, sizeof(T), 1);
+		}
+
+		void AddSection(uint32_t id, const void* data, size_t elementSize, size_t count);
+
+		bool Save(const std::string& filepath, uint32_t format, uint64_t sourceSize, uint64_t sourceHash) const;
+
+	private:
+		struct Section
+		{
+			uint32_t				m_id;
+			uint32_t				m_elementSize;
+			uint64_t				m_count;
+			std::vector<uint8_t>	m_data;
+		};
+
+		std::vector<Section>	m_sections;
+	};
+
+	class MMDModelCacheReader
+	{
+	public:
+		MMDModelCacheReader();
+
+		MMDModelCacheReader(const MMDModelCacheReader&) = delete;
+		MMDModelCacheReader& operator = (const MMDModelCacheReader&) = delete;
+
+		// format, sourceSize, sourceHash が一致しない場合は失敗する
+		bool Open(const std::string& filepath, uint32_t format, uint64_t sourceSize, uint64_t sourceHash);
+		void Close();
+		bool IsOpen() const { return m_file.IsOpen(); }
+
+		template <typename T>
+		bool ReadSection(uint32_t id, std::vector<T>* data) const
+		{
+			size_t count = 0;
+			auto src = FindSection(id, sizeof(T), &count);
+			if (src == nullptr)
+			{
+				return false;
+			}
+			data->resize(count);
+			if (count != 0)
+			{
+				memcpy(data->data(), src, sizeof(T) * count);
+			}
+			return true;
+		}
+
+		template <typename T>
+		bool ReadValue(uint32_t id, T* value) const
+		{
+			size_t count = 0;
+			auto src = FindSection(id, sizeof(T), &count);
+			if (src == nullptr || count != 1)
+			{
+				return false;
+			}
+			memcpy(value, src, sizeof(T));
+			return true;
+		}
+
+	private:
+		const void* FindSection(uint32_t id, size_t elementSize, size_t* count) const;
+
+	private:
+		struct SectionInfo
+		{
+			uint32_t	m_id;
+			uint32_t	m_elementSize;
+			uint64_t	m_offset;
+			uint64_t	m_count;
+		};
+
+		MappedFile					m_file;
+		std::vector<SectionInfo>	m_sections;
+	};
+}
+
+#endif // !SABA_MODEL_MMD_MMDMODELCACHE_H_
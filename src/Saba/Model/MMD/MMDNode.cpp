@@ -4,6 +4,7 @@
 //
 
 #include "MMDNode.h"
+#include "MMDNodeHierarchy.h"
 
 #include <Saba/Base/Log.h>
 
@@ -26,12 +27,16 @@ namespace saba
 		, m_baseAnimTranslate(0)
 		, m_baseAnimRotate(1, 0, 0, 0)
 		, m_ikRotate(1, 0, 0, 0)
-		, m_local(1)
-		, m_global(1)
+		, m_local(&m_localStorage)
+		, m_global(&m_globalStorage)
 		, m_inverseInit(1)
 		, m_initTranslate(0)
 		, m_initRotate(1, 0, 0, 0)
 		, m_initScale(1)
+		, m_localStorage(1)
+		, m_globalStorage(1)
+		, m_hierarchy(nullptr)
+		, m_hierarchyOrder(0)
 	{
 	}
 
@@ -46,6 +51,7 @@ namespace saba
 		SABA_ASSERT(child->m_parent == nullptr);
 		SABA_ASSERT(child->m_next == nullptr);
 		SABA_ASSERT(child->m_prev == nullptr);
+		SABA_ASSERT(m_hierarchy == nullptr && child->m_hierarchy == nullptr);
 		child->m_parent = this;
 		if (m_child == nullptr)
 		{
@@ -82,13 +88,19 @@ namespace saba
 
 	void MMDNode::UpdateGlobalTransform()
 	{
+		if (m_hierarchy != nullptr)
+		{
+			m_hierarchy->UpdateSubtree(m_hierarchyOrder);
+			return;
+		}
+
 		if (m_parent == nullptr)
 		{
-			m_global = m_local;
+			*m_global = *m_local;
 		}
 		else
 		{
-			m_global = m_parent->m_global * m_local;
+			*m_global = (*m_parent->m_global) * (*m_local);
 		}
 		MMDNode* child = m_child;
 		while (child != nullptr)
@@ -100,6 +112,12 @@ namespace saba
 
 	void MMDNode::UpdateChildTransform()
 	{
+		if (m_hierarchy != nullptr)
+		{
+			m_hierarchy->UpdateChildren(m_hierarchyOrder);
+			return;
+		}
+
 		MMDNode* child = m_child;
 		while (child != nullptr)
 		{
@@ -110,7 +128,7 @@ namespace saba
 
 	void MMDNode::CalculateInverseInitTransform()
 	{
-		m_inverseInit = glm::inverse(m_global);
+		m_inverseInit = glm::inverse(*m_global);
 	}
 
 	void MMDNode::OnBeginUpdateTransform()
@@ -130,7 +148,25 @@ namespace saba
 		{
 			r = glm::mat4_cast(m_ikRotate) * r;
 		}
-		m_local = t * r * s;
+		*m_local = t * r * s;
+	}
+
+	void MMDNode::AttachHierarchy(MMDNodeHierarchy* hierarchy, uint32_t order, glm::mat4* local, glm::mat4* global)
+	{
+		m_hierarchy = hierarchy;
+		m_hierarchyOrder = order;
+		m_local = local;
+		m_global = global;
+	}
+
+	void MMDNode::DetachHierarchy()
+	{
+		m_localStorage = *m_local;
+		m_globalStorage = *m_global;
+		m_local = &m_localStorage;
+		m_global = &m_globalStorage;
+		m_hierarchy = nullptr;
+		m_hierarchyOrder = 0;
 	}
 
 }
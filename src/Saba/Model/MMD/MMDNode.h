@@ -13,10 +13,16 @@
 
 namespace saba
 {
+	class MMDNodeHierarchy;
+
 	class MMDNode
 	{
 	public:
 		MMDNode();
+		virtual ~MMDNode() = default;
+
+		MMDNode(const MMDNode&) = delete;
+		MMDNode& operator = (const MMDNode&) = delete;
 
 		void AddChild(MMDNode* child);
 		// アニメーションの前後て呼ぶ
@@ -62,11 +68,14 @@ namespace saba
 		MMDNode* GetNext() const { return m_next; }
 		MMDNode* GetPrev() const { return m_prev; }
 
-		void SetLocalTransform(const glm::mat4& m) { m_local = m; }
-		const glm::mat4& GetLocalTransform() const { return m_local; }
+		void SetLocalTransform(const glm::mat4& m) { *m_local = m; }
+		const glm::mat4& GetLocalTransform() const { return *m_local; }
+
+		void SetGlobalTransform(const glm::mat4& m) { *m_global = m; }
+		const glm::mat4& GetGlobalTransform() const { return *m_global; }
 
-		void SetGlobalTransform(const glm::mat4& m) { m_global = m; }
-		const glm::mat4& GetGlobalTransform() const { return m_global; }
+		MMDNodeHierarchy* GetHierarchy() const { return m_hierarchy; }
+		uint32_t GetHierarchyOrder() const { return m_hierarchyOrder; }
 
 		void CalculateInverseInitTransform();
 		const glm::mat4& GetInverseInitTransform() const { return m_inverseInit; }
@@ -138,13 +147,25 @@ namespace saba
 
 		glm::quat	m_ikRotate;
 
-		glm::mat4		m_local;
-		glm::mat4		m_global;
+		// MMDNodeHierarchy に登録されている場合は、その配列を指す
+		glm::mat4*		m_local;
+		glm::mat4*		m_global;
 		glm::mat4		m_inverseInit;
 
 		glm::vec3	m_initTranslate;
 		glm::quat	m_initRotate;
 		glm::vec3	m_initScale;
+
+	private:
+		friend class MMDNodeHierarchy;
+		void AttachHierarchy(MMDNodeHierarchy* hierarchy, uint32_t order, glm::mat4* local, glm::mat4* global);
+		void DetachHierarchy();
+
+	private:
+		glm::mat4			m_localStorage;
+		glm::mat4			m_globalStorage;
+		MMDNodeHierarchy*	m_hierarchy;
+		uint32_t			m_hierarchyOrder;
 	};
 }
 
@@ -0,0 +1,144 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "MMDNodeHierarchy.h"
+#include "MMDNode.h"
+
+#include <Saba/Base/Log.h>
+
+#include <algorithm>
+
+namespace saba
+{
+	MMDNodeHierarchy::MMDNodeHierarchy()
+	{
+	}
+
+	MMDNodeHierarchy::~MMDNodeHierarchy()
+	{
+		Clear();
+	}
+
+	void MMDNodeHierarchy::Build(const std::vector<MMDNode*>& nodes)
+	{
+		Clear();
+
+		const size_t nodeCount = nodes.size();
+		m_nodes.reserve(nodeCount);
+		m_parents.reserve(nodeCount);
+		m_subtreeEnds.resize(nodeCount);
+
+		// 深さ優先で並べる (再帰は使わない)
+		struct StackItem
+		{
+			MMDNode*	m_node;
+			int32_t		m_parentOrder;
+		};
+		std::vector<StackItem> stack;
+		std::vector<uint32_t> openOrders;
+		for (auto root : nodes)
+		{
+			if (root->GetParent() != nullptr)
+			{
+				continue;
+			}
+
+			stack.push_back({ root, -1 });
+			while (!stack.empty())
+			{
+				auto item = stack.back();
+				stack.pop_back();
+
+				// 親が閉じた部分木を確定させる
+				while (!openOrders.empty() && int32_t(openOrders.back()) != item.m_parentOrder)
+				{
+					m_subtreeEnds[openOrders.back()] = uint32_t(m_nodes.size());
+					openOrders.pop_back();
+				}
+
+				const uint32_t order = uint32_t(m_nodes.size());
+				m_nodes.push_back(item.m_node);
+				m_parents.push_back(item.m_parentOrder);
+				openOrders.push_back(order);
+
+				// 子を逆順に積んで、元の順番で取り出す
+				size_t childStart = stack.size();
+				for (auto child = item.m_node->GetChild(); child != nullptr; child = child->GetNext())
+				{
+					stack.push_back({ child, int32_t(order) });
+				}
+				std::reverse(stack.begin() + childStart, stack.end());
+			}
+			while (!openOrders.empty())
+			{
+				m_subtreeEnds[openOrders.back()] = uint32_t(m_nodes.size());
+				openOrders.pop_back();
+			}
+		}
+
+		if (m_nodes.size() != nodeCount)
+		{
+			SABA_WARN("MMDNodeHierarchy : unreachable node count {}", nodeCount - m_nodes.size());
+		}
+
+		m_subtreeEnds.resize(m_nodes.size());
+		m_locals.resize(m_nodes.size());
+		m_globals.resize(m_nodes.size());
+		for (size_t order = 0; order < m_nodes.size(); order++)
+		{
+			auto node = m_nodes[order];
+			m_locals[order] = node->GetLocalTransform();
+			m_globals[order] = node->GetGlobalTransform();
+			node->AttachHierarchy(this, uint32_t(order), &m_locals[order], &m_globals[order]);
+		}
+	}
+
+	void MMDNodeHierarchy::Clear()
+	{
+		for (auto node : m_nodes)
+		{
+			node->DetachHierarchy();
+		}
+		m_nodes.clear();
+		m_parents.clear();
+		m_subtreeEnds.clear();
+		m_locals.clear();
+		m_globals.clear();
+	}
+
+	void MMDNodeHierarchy::UpdateGlobalTransforms()
+	{
+		UpdateRange(0, m_nodes.size());
+	}
+
+	void MMDNodeHierarchy::UpdateSubtree(size_t order)
+	{
+		UpdateRange(order, m_subtreeEnds[order]);
+	}
+
+	void MMDNodeHierarchy::UpdateChildren(size_t order)
+	{
+		UpdateRange(order + 1, m_subtreeEnds[order]);
+	}
+
+	void MMDNodeHierarchy::UpdateRange(size_t begin, size_t end)
+	{
+		const auto* parents = m_parents.data();
+		const auto* locals = m_locals.data();
+		auto* globals = m_globals.data();
+		for (size_t order = begin; order < end; order++)
+		{
+			const auto parent = parents[order];
+			if (parent < 0)
+			{
+				globals[order] = locals[order];
+			}
+			else
+			{
+				globals[order] = globals[parent] * locals[order];
+			}
+		}
+	}
+}
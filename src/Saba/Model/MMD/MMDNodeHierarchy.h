@@ -0,0 +1,73 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_MMDNODEHIERARCHY_H_
+#define SABA_MODEL_MMD_MMDNODEHIERARCHY_H_
+
+#include <glm/mat4x4.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace saba
+{
+	class MMDNode;
+
+	/*
+	ノードの階層を深さ優先 (親が先) の順に平坦化したもの。
+	ローカル行列とグローバル行列はここで連続した配列として持ち、
+	登録したノードの Get/SetLocalTransform などはこの配列を参照する。
+	子孫は連続した範囲になるため、部分木の更新は範囲を一度なめるだけで済む。
+
+	登録したノードより先に破棄すること (破棄時にノードへ行列を書き戻す)。
+	*/
+	class MMDNodeHierarchy
+	{
+	public:
+		MMDNodeHierarchy();
+		~MMDNodeHierarchy();
+
+		MMDNodeHierarchy(const MMDNodeHierarchy&) = delete;
+		MMDNodeHierarchy& operator = (const MMDNodeHierarchy&) = delete;
+
+		// 親子関係を設定した後に呼ぶ
+		template <typename NodeContainer>
+		void Build(const NodeContainer& nodes)
+		{
+			std::vector<MMDNode*> nodePtrs;
+			nodePtrs.reserve(nodes.size());
+			for (const auto& node : nodes)
+			{
+				nodePtrs.push_back(&(*node));
+			}
+			Build(nodePtrs);
+		}
+		void Build(const std::vector<MMDNode*>& nodes);
+		void Clear();
+
+		size_t GetNodeCount() const { return m_nodes.size(); }
+		MMDNode* GetNode(size_t order) const { return m_nodes[order]; }
+		int32_t GetParentOrder(size_t order) const { return m_parents[order]; }
+		size_t GetSubtreeEnd(size_t order) const { return m_subtreeEnds[order]; }
+
+		// 全ノードのグローバル行列を更新する
+		void UpdateGlobalTransforms();
+		// order のノードと、その子孫のグローバル行列を更新する
+		void UpdateSubtree(size_t order);
+		// order の子孫のグローバル行列を更新する (order 自身は更新しない)
+		void UpdateChildren(size_t order);
+
+	private:
+		void UpdateRange(size_t begin, size_t end);
+
+	private:
+		std::vector<MMDNode*>	m_nodes;		// 深さ優先順
+		std::vector<int32_t>	m_parents;		// 親の順番 (-1 : ルート)
+		std::vector<uint32_t>	m_subtreeEnds;	// 子孫の範囲の終端 (含まない)
+		std::vector<glm::mat4>	m_locals;
+		std::vector<glm::mat4>	m_globals;
+	};
+}
+
+#endif // !SABA_MODEL_MMD_MMDNODEHIERARCHY_H_
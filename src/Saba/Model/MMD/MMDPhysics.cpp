@@ -8,19 +8,37 @@
 #include "MMDNode.h"
 #include "MMDModel.h"
 #include "Saba/Base/Log.h"
+#include "Saba/Base/Singleton.h"
+#include "Saba/Base/JobSystem.h"
+#include "Saba/Base/Time.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 #include <btBulletCollisionCommon.h>
 #include <btBulletDynamicsCommon.h>
 
+#if defined(SABA_BULLET_MULTITHREAD)
+#include <LinearMath/btThreads.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#if BT_BULLET_VERSION >= 288
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#endif
+#endif // defined(SABA_BULLET_MULTITHREAD)
+
 namespace saba
 {
 	class MMDMotionState : public btMotionState
 	{
 	public:
 		virtual void Reset() = 0;
-		virtual void ReflectGlobalTransform() = 0;
+		// interpolation : 前のステップと最後のステップの間の位置 (0 - 1)
+		virtual void ReflectGlobalTransform(float interpolation) = 0;
+		// 補間をやめて、最後のステップの姿勢を使う (ステップが進まなくなる場合)
+		virtual void ClearInterpolation() {}
 	};
 
 	namespace
@@ -30,6 +48,18 @@ namespace saba
 			const glm::mat4 invZ = glm::scale(glm::mat4(1), glm::vec3(1, 1, -1));
 			return invZ * m * invZ;
 		}
+
+		btTransform InterpolateTransform(const btTransform& t0, const btTransform& t1, float t)
+		{
+			if (t >= 1.0f)
+			{
+				return t1;
+			}
+			btTransform result;
+			result.setOrigin(t0.getOrigin().lerp(t1.getOrigin(), btScalar(t)));
+			result.setRotation(t0.getRotation().slerp(t1.getRotation(), btScalar(t)));
+			return result;
+		}
 	}
 
 	struct MMDFilterCallback : public btOverlapFilterCallback
@@ -45,17 +75,151 @@ namespace saba
 			{
 				return true;
 			}
+			// ワールドを共有している場合、別のモデルの剛体とは衝突しない
+			auto rb0 = GetMMDRigidBody(proxy0);
+			auto rb1 = GetMMDRigidBody(proxy1);
+			if (rb0 != nullptr && rb1 != nullptr && rb0->GetModel() != rb1->GetModel())
+			{
+				return false;
+			}
 			bool collides = (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) != 0;
 			collides = collides && (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
 			return collides;
 		}
 
+		static MMDRigidBody* GetMMDRigidBody(btBroadphaseProxy* proxy)
+		{
+			auto obj = static_cast<btCollisionObject*>(proxy->m_clientObject);
+			if (obj == nullptr)
+			{
+				return nullptr;
+			}
+			return static_cast<MMDRigidBody*>(obj->getUserPointer());
+		}
+
 		std::vector<btBroadphaseProxy*> m_nonFilterProxy;
 	};
 
+#if defined(SABA_BULLET_MULTITHREAD)
+	namespace
+	{
+		// Bullet の並列処理を JobSystem で行う
+		class MMDPhysicsTaskScheduler : public btITaskScheduler
+		{
+		public:
+			MMDPhysicsTaskScheduler()
+				: btITaskScheduler("SabaJobSystem")
+			{
+			}
+
+			int getMaxNumThreads() const override
+			{
+				return int(Singleton<JobSystem>::Get()->GetConcurrency());
+			}
+
+			int getNumThreads() const override
+			{
+				return getMaxNumThreads();
+			}
+
+			void setNumThreads(int /*numThreads*/) override
+			{
+			}
+
+			void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override
+			{
+				btPushThreadsAreRunning();
+				auto& jobSystem = *Singleton<JobSystem>::Get();
+				const size_t count = size_t(iEnd - iBegin);
+				jobSystem.ParallelFor(
+					count,
+					GetJobCount(count, grainSize),
+					[iBegin, &body](size_t begin, size_t end)
+					{
+						body.forLoop(iBegin + int(begin), iBegin + int(end));
+					}
+				);
+				btPopThreadsAreRunning();
+			}
+
+#if BT_BULLET_VERSION >= 288
+			btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override
+			{
+				btPushThreadsAreRunning();
+				auto& jobSystem = *Singleton<JobSystem>::Get();
+				const size_t count = size_t(iEnd - iBegin);
+				const size_t jobCount = GetJobCount(count, grainSize);
+				const size_t rangeSize = (count + jobCount - 1) / jobCount;
+				std::vector<btScalar> sums(jobCount, btScalar(0));
+				JobGroup group;
+				for (size_t jobIdx = 0; jobIdx < jobCount; jobIdx++)
+				{
+					const int begin = iBegin + int(std::min(jobIdx * rangeSize, count));
+					const int end = iBegin + int(std::min((jobIdx + 1) * rangeSize, count));
+					auto sum = &sums[jobIdx];
+					jobSystem.Run(&group, [begin, end, sum, &body]()
+					{
+						if (begin < end)
+						{
+							*sum = body.sumLoop(begin, end);
+						}
+					});
+				}
+				jobSystem.Wait(&group);
+				btPopThreadsAreRunning();
+
+				btScalar total = btScalar(0);
+				for (const auto sum : sums)
+				{
+					total += sum;
+				}
+				return total;
+			}
+#endif // BT_BULLET_VERSION >= 288
+
+		private:
+			static size_t GetJobCount(size_t count, int grainSize)
+			{
+				const size_t grain = size_t(std::max(grainSize, 1));
+				const size_t concurrency = Singleton<JobSystem>::Get()->GetConcurrency();
+				return std::max(size_t(1), std::min((count + grain - 1) / grain, concurrency));
+			}
+		};
+
+		/*
+		Bullet はスレッド毎に番号を振り、BT_MAX_THREAD_COUNT を超えると使えない。
+		JobSystem のワーカーと、Update を呼ぶスレッドの分が足りない場合はシングルスレッドで動かす。
+		*/
+		bool SetupTaskScheduler()
+		{
+			static std::once_flag initFlag;
+			static bool initialized = false;
+			std::call_once(initFlag, []()
+			{
+				const size_t concurrency = Singleton<JobSystem>::Get()->GetConcurrency();
+				const size_t ExtraThreadCount = 4;
+				if (concurrency + ExtraThreadCount > size_t(BT_MAX_THREAD_COUNT))
+				{
+					SABA_WARN("Bullet multithread disabled. (concurrency {} > BT_MAX_THREAD_COUNT {})", concurrency, BT_MAX_THREAD_COUNT);
+					return;
+				}
+				static MMDPhysicsTaskScheduler taskScheduler;
+				btSetTaskScheduler(&taskScheduler);
+				initialized = true;
+			});
+			return initialized;
+		}
+	}
+#endif // defined(SABA_BULLET_MULTITHREAD)
+
 	MMDPhysics::MMDPhysics()
 		: m_fps(120.0f)
 		, m_maxSubStepCount(10)
+		, m_maxUpdateTime(0)
+		, m_accumulator(0)
+		, m_stepCost(0)
+		, m_interpolation(1.0f)
+		, m_multiThreaded(false)
 	{
 	}
 
@@ -68,18 +232,57 @@ namespace saba
 	{
 		m_broadphase = std::make_unique<btDbvtBroadphase>();
 		m_collisionConfig = std::make_unique<btDefaultCollisionConfiguration>();
-		m_dispatcher = std::make_unique<btCollisionDispatcher>(m_collisionConfig.get());
 
-		m_solver = std::make_unique<btSequentialImpulseConstraintSolver>();
+		m_multiThreaded = false;
+#if defined(SABA_BULLET_MULTITHREAD)
+		if (SetupTaskScheduler())
+		{
+			// 衝突判定と island 毎の拘束の計算を並列に行う
+			m_dispatcher = std::make_unique<btCollisionDispatcherMt>(m_collisionConfig.get());
+			auto solverPool = std::make_unique<btConstraintSolverPoolMt>(int(Singleton<JobSystem>::Get()->GetConcurrency()));
+#if BT_BULLET_VERSION >= 288
+			m_solverMt = std::make_unique<btSequentialImpulseConstraintSolverMt>();
+			m_world = std::make_unique<btDiscreteDynamicsWorldMt>(
+				m_dispatcher.get(),
+				m_broadphase.get(),
+				solverPool.get(),
+				m_solverMt.get(),
+				m_collisionConfig.get()
+				);
+#else
+			m_world = std::make_unique<btDiscreteDynamicsWorldMt>(
+				m_dispatcher.get(),
+				m_broadphase.get(),
+				solverPool.get(),
+				m_collisionConfig.get()
+				);
+#endif
+			m_solver = std::move(solverPool);
+			m_multiThreaded = true;
+		}
+#endif // defined(SABA_BULLET_MULTITHREAD)
+		if (!m_multiThreaded)
+		{
+			m_dispatcher = std::make_unique<btCollisionDispatcher>(m_collisionConfig.get());
 
-		m_world = std::make_unique<btDiscreteDynamicsWorld>(
-			m_dispatcher.get(),
-			m_broadphase.get(),
-			m_solver.get(),
-			m_collisionConfig.get()
-			);
+			m_solver = std::make_unique<btSequentialImpulseConstraintSolver>();
+
+			m_world = std::make_unique<btDiscreteDynamicsWorld>(
+				m_dispatcher.get(),
+				m_broadphase.get(),
+				m_solver.get(),
+				m_collisionConfig.get()
+				);
+		}
 
 		m_world->setGravity(btVector3(0, -9.8f * 10.0f, 0));
+#if BT_BULLET_VERSION >= 283
+		// ステップの後の姿勢をそのまま MotionState に渡す (補間は MMDMotionState で行う)
+		m_world->setLatencyMotionStateInterpolation(true);
+#endif
+		m_accumulator = 0;
+		m_stepCost = 0;
+		m_interpolation = 1.0f;
 
 		m_groundShape = std::make_unique<btStaticPlaneShape>(btVector3(0, 1, 0), 0.0f);
 
@@ -108,11 +311,12 @@ namespace saba
 			m_world->removeRigidBody(m_groundRB.get());
 		}
 
+		m_world = nullptr;
 		m_broadphase = nullptr;
 		m_collisionConfig = nullptr;
 		m_dispatcher = nullptr;
 		m_solver = nullptr;
-		m_world = nullptr;
+		m_solverMt = nullptr;
 		m_groundShape = nullptr;
 		m_groundMS = nullptr;
 		m_groundRB = nullptr;
@@ -141,14 +345,63 @@ namespace saba
 
 	void MMDPhysics::Update(float time)
 	{
-		if (m_world != nullptr)
+		Update(time, float(m_fps), m_maxSubStepCount);
+	}
+
+	void MMDPhysics::Update(float time, float fps, int maxSubStepCount)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		if (m_world == nullptr)
+		{
+			return;
+		}
+
+		const double fixedStep = 1.0 / fps;
+		const int maxStepCount = std::max(maxSubStepCount, 1);
+
+		// 進めきれない時間は捨てる (遅いフレームの後に、さらに多くのステップを進めないようにする)
+		m_accumulator = std::min(m_accumulator + double(time), fixedStep * maxStepCount);
+
+		int stepCount = int(m_accumulator / fixedStep);
+		double stepTime = fixedStep;
+		if (stepCount > 0 && m_maxUpdateTime > 0 && m_stepCost > 0)
+		{
+			// 時間内に収まらない場合は、ステップを大きくして回数を減らす
+			const double MaxStepScale = 4.0;
+			int budgetStepCount = std::max(int(m_maxUpdateTime / m_stepCost), 1);
+			if (budgetStepCount < stepCount)
+			{
+				stepTime = std::min(fixedStep * stepCount / budgetStepCount, fixedStep * MaxStepScale);
+				stepCount = budgetStepCount;
+			}
+		}
+
+		const double startTime = GetTime();
+		for (int i = 0; i < stepCount; i++)
+		{
+			const double stepStartTime = GetTime();
+			m_world->stepSimulation(static_cast<btScalar>(stepTime), 0);
+			m_accumulator = std::max(m_accumulator - stepTime, 0.0);
+
+			const double cost = GetTime() - stepStartTime;
+			m_stepCost = m_stepCost > 0 ? m_stepCost * 0.9 + cost * 0.1 : cost;
+
+			if (m_maxUpdateTime > 0 && GetTime() - startTime > m_maxUpdateTime)
+			{
+				break;
+			}
+		}
+		if (m_accumulator > fixedStep)
 		{
-			m_world->stepSimulation(time, m_maxSubStepCount, static_cast<btScalar>(1.0 / m_fps));
+			m_accumulator = std::fmod(m_accumulator, fixedStep);
 		}
+
+		m_interpolation = float(m_accumulator / fixedStep);
 	}
 
 	void MMDPhysics::AddRigidBody(MMDRigidBody * mmdRB)
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
 		m_world->addRigidBody(
 			mmdRB->GetRigidBody(),
 			1 << mmdRB->GetGroup(),
@@ -158,11 +411,13 @@ namespace saba
 
 	void MMDPhysics::RemoveRigidBody(MMDRigidBody * mmdRB)
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
 		m_world->removeRigidBody(mmdRB->GetRigidBody());
 	}
 
 	void MMDPhysics::AddJoint(MMDJoint * mmdJoint)
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
 		if (mmdJoint->GetConstraint() != nullptr)
 		{
 			m_world->addConstraint(mmdJoint->GetConstraint());
@@ -171,6 +426,7 @@ namespace saba
 
 	void MMDPhysics::RemoveJoint(MMDJoint * mmdJoint)
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
 		if (mmdJoint->GetConstraint() != nullptr)
 		{
 			m_world->removeConstraint(mmdJoint->GetConstraint());
@@ -211,7 +467,7 @@ namespace saba
 			m_transform = m_initialTransform;
 		}
 
-		virtual void ReflectGlobalTransform() override
+		virtual void ReflectGlobalTransform(float /*interpolation*/) override
 		{
 		}
 
@@ -240,6 +496,7 @@ namespace saba
 
 		void setWorldTransform(const btTransform& worldTransform) override
 		{
+			m_prevTransform = m_transform;
 			m_transform = worldTransform;
 		}
 
@@ -247,12 +504,18 @@ namespace saba
 		{
 			glm::mat4 global = InvZ(m_node->GetGlobalTransform() * m_offset);
 			m_transform.setFromOpenGLMatrix(&global[0][0]);
+			m_prevTransform = m_transform;
 		}
 
-		void ReflectGlobalTransform() override
+		void ClearInterpolation() override
+		{
+			m_prevTransform = m_transform;
+		}
+
+		void ReflectGlobalTransform(float interpolation) override
 		{
 			alignas(16) glm::mat4 world;
-			m_transform.getOpenGLMatrix(&world[0][0]);
+			InterpolateTransform(m_prevTransform, m_transform, interpolation).getOpenGLMatrix(&world[0][0]);
 			glm::mat4 btGlobal = InvZ(world) * m_invOffset;
 
 			if (m_override)
@@ -267,6 +530,7 @@ namespace saba
 		glm::mat4	m_offset;
 		glm::mat4	m_invOffset;
 		btTransform	m_transform;
+		btTransform	m_prevTransform;
 		bool		m_override;
 	};
 
@@ -289,6 +553,7 @@ namespace saba
 
 		void setWorldTransform(const btTransform& worldTransform) override
 		{
+			m_prevTransform = m_transform;
 			m_transform = worldTransform;
 		}
 
@@ -296,12 +561,18 @@ namespace saba
 		{
 			glm::mat4 global = InvZ(m_node->GetGlobalTransform() * m_offset);
 			m_transform.setFromOpenGLMatrix(&global[0][0]);
+			m_prevTransform = m_transform;
+		}
+
+		void ClearInterpolation() override
+		{
+			m_prevTransform = m_transform;
 		}
 
-		void ReflectGlobalTransform() override
+		void ReflectGlobalTransform(float interpolation) override
 		{
 			alignas(16) glm::mat4 world;
-			m_transform.getOpenGLMatrix(&world[0][0]);
+			InterpolateTransform(m_prevTransform, m_transform, interpolation).getOpenGLMatrix(&world[0][0]);
 			glm::mat4 btGlobal = InvZ(world) * m_invOffset;
 			glm::mat4 global = m_node->GetGlobalTransform();
 			btGlobal[3] = global[3];
@@ -318,6 +589,7 @@ namespace saba
 		glm::mat4	m_offset;
 		glm::mat4	m_invOffset;
 		btTransform	m_transform;
+		btTransform	m_prevTransform;
 		bool		m_override;
 
 	};
@@ -354,7 +626,7 @@ namespace saba
 		{
 		}
 
-		void ReflectGlobalTransform() override
+		void ReflectGlobalTransform(float /*interpolation*/) override
 		{
 		}
 
@@ -367,6 +639,7 @@ namespace saba
 		: m_rigidBodyType(RigidBodyType::Kinematic)
 		, m_group(0)
 		, m_groupMask(0)
+		, m_model(nullptr)
 		, m_node(0)
 		, m_offsetMat(1)
 	{
@@ -496,6 +769,7 @@ namespace saba
 		m_rigidBodyType = (RigidBodyType)pmdRigidBody.m_rigidBodyType;
 		m_group = pmdRigidBody.m_groupIndex;
 		m_groupMask = pmdRigidBody.m_groupTarget;
+		m_model = model;
 		m_node = node;
 		m_name = pmdRigidBody.m_rigidBodyName.ToUtf8String();
 
@@ -614,6 +888,7 @@ namespace saba
 		m_rigidBodyType = (RigidBodyType)pmxRigidBody.m_op;
 		m_group = pmxRigidBody.m_group;
 		m_groupMask = pmxRigidBody.m_collisionGroup;
+		m_model = model;
 		m_node = node;
 		m_name = pmxRigidBody.m_name;
 
@@ -671,6 +946,7 @@ namespace saba
 
 	void MMDRigidBody::Reset(MMDPhysics* physics)
 	{
+		std::lock_guard<std::recursive_mutex> lock(physics->GetMutex());
 		auto cache = physics->GetDynamicsWorld()->getPairCache();
 		if (cache != nullptr)
 		{
@@ -682,15 +958,63 @@ namespace saba
 		m_rigidBody->clearForces();
 	}
 
-	void MMDRigidBody::ReflectGlobalTransform()
+	void MMDRigidBody::ResetWorldTransform(MMDPhysics* physics)
+	{
+		std::lock_guard<std::recursive_mutex> lock(physics->GetMutex());
+		btTransform transform;
+		m_kinematicMotionState->getWorldTransform(transform);
+		m_rigidBody->setWorldTransform(transform);
+		m_rigidBody->setInterpolationWorldTransform(transform);
+	}
+
+	void MMDRigidBody::ResetVelocity()
+	{
+		m_rigidBody->setAngularVelocity(btVector3(0, 0, 0));
+		m_rigidBody->setLinearVelocity(btVector3(0, 0, 0));
+		m_rigidBody->clearForces();
+	}
+
+	bool MMDRigidBody::IsResting() const
+	{
+		const btScalar linearThreshold = m_rigidBody->getLinearSleepingThreshold();
+		const btScalar angularThreshold = m_rigidBody->getAngularSleepingThreshold();
+		return m_rigidBody->getLinearVelocity().length2() < linearThreshold * linearThreshold &&
+			m_rigidBody->getAngularVelocity().length2() < angularThreshold * angularThreshold;
+	}
+
+	void MMDRigidBody::Sleep()
+	{
+		if (m_rigidBodyType == RigidBodyType::Kinematic)
+		{
+			return;
+		}
+		ResetVelocity();
+		// 眠っている剛体は、Bullet が積分と拘束の計算を行わない
+		m_rigidBody->forceActivationState(ISLAND_SLEEPING);
+		if (m_activeMotionState != nullptr)
+		{
+			m_activeMotionState->ClearInterpolation();
+		}
+	}
+
+	void MMDRigidBody::WakeUp()
+	{
+		if (m_rigidBodyType == RigidBodyType::Kinematic)
+		{
+			return;
+		}
+		m_rigidBody->forceActivationState(DISABLE_DEACTIVATION);
+	}
+
+	void MMDRigidBody::ReflectGlobalTransform(float interpolation)
 	{
 		if (m_activeMotionState != nullptr)
 		{
-			m_activeMotionState->ReflectGlobalTransform();
+			m_activeMotionState->ReflectGlobalTransform(interpolation);
 		}
 		if (m_kinematicMotionState != nullptr)
 		{
-			m_kinematicMotionState->ReflectGlobalTransform();
+			m_kinematicMotionState->ReflectGlobalTransform(interpolation);
 		}
 	}
 
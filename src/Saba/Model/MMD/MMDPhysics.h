@@ -14,6 +14,7 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <cinttypes>
 
 // Bullet Types
@@ -24,7 +25,7 @@ class btDiscreteDynamicsWorld;
 class btBroadphaseInterface;
 class btDefaultCollisionConfiguration;
 class btCollisionDispatcher;
-class btSequentialImpulseConstraintSolver;
+class btConstraintSolver;
 class btMotionState;
 struct btOverlapFilterCallback;
 
@@ -49,14 +50,28 @@ namespace saba
 		void Destroy();
 
 		btRigidBody* GetRigidBody() const;
+		MMDModel* GetModel() const { return m_model; }
+		MMDNode* GetNode() const { return m_node; }
+		// 物理演算する剛体か (SetActivation(false) でボーンに追従させることができる)
+		bool IsDynamic() const { return m_rigidBodyType != RigidBodyType::Kinematic; }
 		uint16_t GetGroup() const;
 		uint16_t GetGroupMask() const;
 
 		void SetActivation(bool activation);
 		void ResetTransform();
 		void Reset(MMDPhysics* physics);
-
-		void ReflectGlobalTransform();
+		// ワールドを進めずに、剛体をボーンに追従した姿勢に移す (共有したワールドの ResetPhysics 用)
+		void ResetWorldTransform(MMDPhysics* physics);
+		// 速度と力を消す (Reset と違い、ワールドは変更しない)
+		void ResetVelocity();
+
+		// 速度が Bullet の Sleeping Threshold より小さいか
+		bool IsResting() const;
+		void Sleep();
+		void WakeUp();
+
+		// interpolation : MMDPhysics::GetInterpolation (1 の場合は最後のステップの姿勢)
+		void ReflectGlobalTransform(float interpolation = 1.0f);
 		void CalcLocalTransform();
 
 		glm::mat4 GetTransform();
@@ -79,6 +94,7 @@ namespace saba
 		uint16_t		m_group;
 		uint16_t		m_groupMask;
 
+		MMDModel*	m_model;
 		MMDNode*	m_node;
 		glm::mat4	m_offsetMat;
 
@@ -103,6 +119,13 @@ namespace saba
 		std::unique_ptr<btTypedConstraint>	m_constraint;
 	};
 
+	/*
+	Bullet のワールド。
+	複数のモデルで共有することができる (MMDPhysicsManager::SetSharedPhysics)。
+	共有した場合、剛体のグループはモデル毎に扱い、別のモデルの剛体とは衝突しない。
+	SABA_BULLET_MULTITHREAD を定義してビルドした場合は、Bullet のマルチスレッド版の
+	Dispatcher と Solver を使い、Singleton<JobSystem> で並列に処理する。
+	*/
 	class MMDPhysics
 	{
 	public:
@@ -119,7 +142,30 @@ namespace saba
 		float GetFPS() const;
 		void SetMaxSubStepCount(int numSteps);
 		int GetMaxSubStepCount() const;
+		/*
+		ワールドは 1 / FPS の固定の時間で進め、余った時間は次の Update に持ち越す。
+		1 回の Update で進めるのは MaxSubStepCount ステップ分までで、それを超えた時間は捨てる。
+		MaxUpdateTime を設定した場合は、ステップにかかった時間から回数を見積もり、
+		収まらない場合はステップを大きくして (精度を落として) 回数を減らす。
+		*/
 		void Update(float time);
+		// FPS とサブステップ数を指定して進める
+		void Update(float time, float fps, int maxSubStepCount);
+
+		// 1 回の Update でステップに使う時間 (秒、0 の場合は制限しない)
+		void SetMaxUpdateTime(double time) { m_maxUpdateTime = time; }
+		double GetMaxUpdateTime() const { return m_maxUpdateTime; }
+		// 持ち越した時間の、ステップに対する割合 (剛体の姿勢を前のステップとの間で補間する)
+		float GetInterpolation() const { return m_interpolation; }
+
+		/*
+		ワールドを変更する関数 (Update, Add/Remove, MMDRigidBody::Reset) はこの mutex でロックする。
+		共有したワールドで、複数のモデルの物理演算の前後の処理を並列に行う間は、
+		他のスレッドからワールドを変更されないように呼び出し側でロックしておく。
+		*/
+		std::recursive_mutex& GetMutex() { return m_mutex; }
+
+		bool IsMultiThreaded() const { return m_multiThreaded; }
 
 		void AddRigidBody(MMDRigidBody* mmdRB);
 		void RemoveRigidBody(MMDRigidBody* mmdRB);
@@ -132,7 +178,8 @@ namespace saba
 		std::unique_ptr<btBroadphaseInterface>				m_broadphase;
 		std::unique_ptr<btDefaultCollisionConfiguration>	m_collisionConfig;
 		std::unique_ptr<btCollisionDispatcher>				m_dispatcher;
-		std::unique_ptr<btSequentialImpulseConstraintSolver>	m_solver;
+		std::unique_ptr<btConstraintSolver>					m_solver;
+		std::unique_ptr<btConstraintSolver>					m_solverMt;
 		std::unique_ptr<btDiscreteDynamicsWorld>			m_world;
 		std::unique_ptr<btCollisionShape>					m_groundShape;
 		std::unique_ptr<btMotionState>						m_groundMS;
@@ -141,6 +188,13 @@ namespace saba
 
 		double	m_fps;
 		int		m_maxSubStepCount;
+		double	m_maxUpdateTime;
+		double	m_accumulator;
+		double	m_stepCost;		//!< 1 ステップにかかる時間の平均
+		float	m_interpolation;
+		bool	m_multiThreaded;
+
+		std::recursive_mutex	m_mutex;
 	};
 
 }
@@ -0,0 +1,601 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "MMDSkinning.h"
+
+#include <Saba/Base/Log.h>
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SABA_SKINNING_X86
+#endif
+
+#if defined(SABA_SKINNING_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SABA_SKINNING_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(SABA_SKINNING_SSE2) && (defined(_MSC_VER) || defined(__GNUC__))
+#define SABA_SKINNING_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SABA_TARGET_AVX2
+#else
+#define SABA_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define SABA_SKINNING_NEON
+#include <arm_neon.h>
+#endif
+
+namespace saba
+{
+	namespace
+	{
+		inline glm::vec3 GetMorphedPosition(const MMDSkinningContext& ctx, size_t i, uint32_t vtx)
+		{
+			if (ctx.m_morphPositions == nullptr)
+			{
+				return ctx.m_positions[i];
+			}
+			return ctx.m_positions[i] + ctx.m_morphPositions[vtx];
+		}
+
+		/*
+		Scalar
+		*/
+		inline void SkinVertex(const MMDSkinningContext& ctx, size_t i, uint32_t vtx, const glm::mat4& m)
+		{
+			const auto pos = GetMorphedPosition(ctx, i, vtx);
+			ctx.m_updatePositions[vtx] = glm::vec3(m * glm::vec4(pos, 1));
+			ctx.m_updateNormals[vtx] = glm::normalize(glm::mat3(m) * ctx.m_normals[i]);
+		}
+
+		void SkinningScalar(const MMDSkinningContext& ctx, const MMDSkinningWeight1* vertices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& v = vertices[i];
+				SkinVertex(ctx, i, v.m_vertex, ctx.m_transforms[v.m_boneIndex]);
+			}
+		}
+
+		void SkinningScalar(const MMDSkinningContext& ctx, const MMDSkinningWeight2* vertices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& v = vertices[i];
+				const auto& m0 = ctx.m_transforms[v.m_boneIndex[0]];
+				const auto& m1 = ctx.m_transforms[v.m_boneIndex[1]];
+				const auto w0 = DequantizeMMDSkinningWeight(v.m_boneWeight);
+				const auto w1 = 1.0f - w0;
+				SkinVertex(ctx, i, v.m_vertex, m0 * w0 + m1 * w1);
+			}
+		}
+
+		void SkinningScalar(const MMDSkinningContext& ctx, const MMDSkinningWeight4* vertices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& v = vertices[i];
+				const auto& m0 = ctx.m_transforms[v.m_boneIndex[0]];
+				const auto& m1 = ctx.m_transforms[v.m_boneIndex[1]];
+				const auto& m2 = ctx.m_transforms[v.m_boneIndex[2]];
+				const auto& m3 = ctx.m_transforms[v.m_boneIndex[3]];
+				const auto w0 = DequantizeMMDSkinningWeight(v.m_boneWeight[0]);
+				const auto w1 = DequantizeMMDSkinningWeight(v.m_boneWeight[1]);
+				const auto w2 = DequantizeMMDSkinningWeight(v.m_boneWeight[2]);
+				const auto w3 = DequantizeMMDSkinningWeight(v.m_boneWeight[3]);
+				SkinVertex(ctx, i, v.m_vertex, m0 * w0 + m1 * w1 + m2 * w2 + m3 * w3);
+			}
+		}
+
+#if defined(SABA_SKINNING_SSE2)
+		/*
+		SSE2
+		行列の列を 1 レジスタに載せて、頂点毎に分岐なしでブレンドする
+		*/
+		struct MatSSE
+		{
+			__m128	m_col[4];
+		};
+
+		inline void LoadMat(MatSSE* dst, const glm::mat4& m)
+		{
+			dst->m_col[0] = _mm_loadu_ps(&m[0][0]);
+			dst->m_col[1] = _mm_loadu_ps(&m[1][0]);
+			dst->m_col[2] = _mm_loadu_ps(&m[2][0]);
+			dst->m_col[3] = _mm_loadu_ps(&m[3][0]);
+		}
+
+		inline void BlendMat(MatSSE* dst, const glm::mat4& m, float weight)
+		{
+			const __m128 w = _mm_set1_ps(weight);
+			dst->m_col[0] = _mm_add_ps(dst->m_col[0], _mm_mul_ps(_mm_loadu_ps(&m[0][0]), w));
+			dst->m_col[1] = _mm_add_ps(dst->m_col[1], _mm_mul_ps(_mm_loadu_ps(&m[1][0]), w));
+			dst->m_col[2] = _mm_add_ps(dst->m_col[2], _mm_mul_ps(_mm_loadu_ps(&m[2][0]), w));
+			dst->m_col[3] = _mm_add_ps(dst->m_col[3], _mm_mul_ps(_mm_loadu_ps(&m[3][0]), w));
+		}
+
+		inline void ScaleMat(MatSSE* dst, const glm::mat4& m, float weight)
+		{
+			const __m128 w = _mm_set1_ps(weight);
+			dst->m_col[0] = _mm_mul_ps(_mm_loadu_ps(&m[0][0]), w);
+			dst->m_col[1] = _mm_mul_ps(_mm_loadu_ps(&m[1][0]), w);
+			dst->m_col[2] = _mm_mul_ps(_mm_loadu_ps(&m[2][0]), w);
+			dst->m_col[3] = _mm_mul_ps(_mm_loadu_ps(&m[3][0]), w);
+		}
+
+		inline void StoreVec3(glm::vec3* dst, __m128 v)
+		{
+			_mm_storel_pi(reinterpret_cast<__m64*>(&dst->x), v);
+			_mm_store_ss(&dst->z, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)));
+		}
+
+		inline __m128 NormalizeVec3(__m128 v)
+		{
+			const __m128 sq = _mm_mul_ps(v, v);
+			__m128 dot = _mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1)));
+			dot = _mm_add_ss(dot, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2)));
+			__m128 invLen = _mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(dot));
+			invLen = _mm_shuffle_ps(invLen, invLen, _MM_SHUFFLE(0, 0, 0, 0));
+			return _mm_mul_ps(v, invLen);
+		}
+
+		inline void SkinVertex(const MMDSkinningContext& ctx, size_t i, uint32_t vtx, const MatSSE& m)
+		{
+			const auto p = GetMorphedPosition(ctx, i, vtx);
+			const auto& n = ctx.m_normals[i];
+
+			const __m128 px = _mm_set1_ps(p.x);
+			const __m128 py = _mm_set1_ps(p.y);
+			const __m128 pz = _mm_set1_ps(p.z);
+			const __m128 pos = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(m.m_col[0], px), _mm_mul_ps(m.m_col[1], py)),
+				_mm_add_ps(_mm_mul_ps(m.m_col[2], pz), m.m_col[3])
+			);
+
+			const __m128 nx = _mm_set1_ps(n.x);
+			const __m128 ny = _mm_set1_ps(n.y);
+			const __m128 nz = _mm_set1_ps(n.z);
+			const __m128 nor = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(m.m_col[0], nx), _mm_mul_ps(m.m_col[1], ny)),
+				_mm_mul_ps(m.m_col[2], nz)
+			);
+
+			StoreVec3(&ctx.m_updatePositions[vtx], pos);
+			StoreVec3(&ctx.m_updateNormals[vtx], NormalizeVec3(nor));
+		}
+
+		inline void SkinVertexSSE(const MMDSkinningContext& ctx, size_t i, const MMDSkinningWeight1& v)
+		{
+			MatSSE m;
+			LoadMat(&m, ctx.m_transforms[v.m_boneIndex]);
+			SkinVertex(ctx, i, v.m_vertex, m);
+		}
+
+		inline void SkinVertexSSE(const MMDSkinningContext& ctx, size_t i, const MMDSkinningWeight2& v)
+		{
+			const float w0 = DequantizeMMDSkinningWeight(v.m_boneWeight);
+			MatSSE m;
+			ScaleMat(&m, ctx.m_transforms[v.m_boneIndex[0]], w0);
+			BlendMat(&m, ctx.m_transforms[v.m_boneIndex[1]], 1.0f - w0);
+			SkinVertex(ctx, i, v.m_vertex, m);
+		}
+
+		inline void SkinVertexSSE(const MMDSkinningContext& ctx, size_t i, const MMDSkinningWeight4& v)
+		{
+			MatSSE m;
+			ScaleMat(&m, ctx.m_transforms[v.m_boneIndex[0]], DequantizeMMDSkinningWeight(v.m_boneWeight[0]));
+			BlendMat(&m, ctx.m_transforms[v.m_boneIndex[1]], DequantizeMMDSkinningWeight(v.m_boneWeight[1]));
+			BlendMat(&m, ctx.m_transforms[v.m_boneIndex[2]], DequantizeMMDSkinningWeight(v.m_boneWeight[2]));
+			BlendMat(&m, ctx.m_transforms[v.m_boneIndex[3]], DequantizeMMDSkinningWeight(v.m_boneWeight[3]));
+			SkinVertex(ctx, i, v.m_vertex, m);
+		}
+
+		template <typename Vertex>
+		void SkinningSSE2(const MMDSkinningContext& ctx, const Vertex* vertices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				SkinVertexSSE(ctx, i, vertices[i]);
+			}
+		}
+#endif // SABA_SKINNING_SSE2
+
+#if defined(SABA_SKINNING_AVX2)
+		/*
+		AVX2 + FMA
+		2 頂点分の行列の列を 1 つの 256bit レジスタに載せて処理する
+		*/
+		struct MatAVX
+		{
+			__m256	m_col[4];
+		};
+
+		SABA_TARGET_AVX2 inline __m256 LoadColumn2(const glm::mat4& m0, const glm::mat4& m1, int col)
+		{
+			return _mm256_insertf128_ps(
+				_mm256_castps128_ps256(_mm_loadu_ps(&m0[col][0])),
+				_mm_loadu_ps(&m1[col][0]),
+				1
+			);
+		}
+
+		SABA_TARGET_AVX2 inline __m256 Set2(float v0, float v1)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(v0)), _mm_set1_ps(v1), 1);
+		}
+
+		SABA_TARGET_AVX2 inline void LoadMat(MatAVX* dst, const glm::mat4& m0, const glm::mat4& m1)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				dst->m_col[col] = LoadColumn2(m0, m1, col);
+			}
+		}
+
+		SABA_TARGET_AVX2 inline void ScaleMat(MatAVX* dst, const glm::mat4& m0, const glm::mat4& m1, __m256 w)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				dst->m_col[col] = _mm256_mul_ps(LoadColumn2(m0, m1, col), w);
+			}
+		}
+
+		SABA_TARGET_AVX2 inline void BlendMat(MatAVX* dst, const glm::mat4& m0, const glm::mat4& m1, __m256 w)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				dst->m_col[col] = _mm256_fmadd_ps(LoadColumn2(m0, m1, col), w, dst->m_col[col]);
+			}
+		}
+
+		SABA_TARGET_AVX2 inline __m256 NormalizeVec3x2(__m256 v)
+		{
+			const __m256 sq = _mm256_mul_ps(v, v);
+			__m256 dot = _mm256_add_ps(sq, _mm256_permute_ps(sq, _MM_SHUFFLE(1, 1, 1, 1)));
+			dot = _mm256_add_ps(dot, _mm256_permute_ps(sq, _MM_SHUFFLE(2, 2, 2, 2)));
+			__m256 invLen = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(dot));
+			invLen = _mm256_permute_ps(invLen, _MM_SHUFFLE(0, 0, 0, 0));
+			return _mm256_mul_ps(v, invLen);
+		}
+
+		SABA_TARGET_AVX2 inline void SkinVertex2(const MMDSkinningContext& ctx, size_t i, uint32_t vtx0, uint32_t vtx1, const MatAVX& m)
+		{
+			const auto p0 = GetMorphedPosition(ctx, i, vtx0);
+			const auto p1 = GetMorphedPosition(ctx, i + 1, vtx1);
+			const auto& n0 = ctx.m_normals[i];
+			const auto& n1 = ctx.m_normals[i + 1];
+
+			__m256 pos = _mm256_add_ps(m.m_col[3], _mm256_mul_ps(m.m_col[2], Set2(p0.z, p1.z)));
+			pos = _mm256_fmadd_ps(m.m_col[1], Set2(p0.y, p1.y), pos);
+			pos = _mm256_fmadd_ps(m.m_col[0], Set2(p0.x, p1.x), pos);
+
+			__m256 nor = _mm256_mul_ps(m.m_col[2], Set2(n0.z, n1.z));
+			nor = _mm256_fmadd_ps(m.m_col[1], Set2(n0.y, n1.y), nor);
+			nor = _mm256_fmadd_ps(m.m_col[0], Set2(n0.x, n1.x), nor);
+			nor = NormalizeVec3x2(nor);
+
+			StoreVec3(&ctx.m_updatePositions[vtx0], _mm256_castps256_ps128(pos));
+			StoreVec3(&ctx.m_updatePositions[vtx1], _mm256_extractf128_ps(pos, 1));
+			StoreVec3(&ctx.m_updateNormals[vtx0], _mm256_castps256_ps128(nor));
+			StoreVec3(&ctx.m_updateNormals[vtx1], _mm256_extractf128_ps(nor, 1));
+		}
+
+		SABA_TARGET_AVX2 inline void SkinVertex2AVX(const MMDSkinningContext& ctx, size_t i, const MMDSkinningWeight1& v0, const MMDSkinningWeight1& v1)
+		{
+			MatAVX m;
+			LoadMat(&m, ctx.m_transforms[v0.m_boneIndex], ctx.m_transforms[v1.m_boneIndex]);
+			SkinVertex2(ctx, i, v0.m_vertex, v1.m_vertex, m);
+		}
+
+		SABA_TARGET_AVX2 inline void SkinVertex2AVX(const MMDSkinningContext& ctx, size_t i, const MMDSkinningWeight2& v0, const MMDSkinningWeight2& v1)
+		{
+			const auto* transforms = ctx.m_transforms;
+			const float w0 = DequantizeMMDSkinningWeight(v0.m_boneWeight);
+			const float w1 = DequantizeMMDSkinningWeight(v1.m_boneWeight);
+			MatAVX m;
+			ScaleMat(&m, transforms[v0.m_boneIndex[0]], transforms[v1.m_boneIndex[0]], Set2(w0, w1));
+			BlendMat(&m, transforms[v0.m_boneIndex[1]], transforms[v1.m_boneIndex[1]], Set2(1.0f - w0, 1.0f - w1));
+			SkinVertex2(ctx, i, v0.m_vertex, v1.m_vertex, m);
+		}
+
+		SABA_TARGET_AVX2 inline __m256 DequantizeWeight2(uint16_t w0, uint16_t w1)
+		{
+			return Set2(DequantizeMMDSkinningWeight(w0), DequantizeMMDSkinningWeight(w1));
+		}
+
+		SABA_TARGET_AVX2 inline void SkinVertex2AVX(const MMDSkinningContext& ctx, size_t i, const MMDSkinningWeight4& v0, const MMDSkinningWeight4& v1)
+		{
+			const auto* transforms = ctx.m_transforms;
+			MatAVX m;
+			ScaleMat(&m, transforms[v0.m_boneIndex[0]], transforms[v1.m_boneIndex[0]], DequantizeWeight2(v0.m_boneWeight[0], v1.m_boneWeight[0]));
+			for (int bi = 1; bi < 4; bi++)
+			{
+				BlendMat(&m, transforms[v0.m_boneIndex[bi]], transforms[v1.m_boneIndex[bi]], DequantizeWeight2(v0.m_boneWeight[bi], v1.m_boneWeight[bi]));
+			}
+			SkinVertex2(ctx, i, v0.m_vertex, v1.m_vertex, m);
+		}
+
+		template <typename Vertex>
+		SABA_TARGET_AVX2 void SkinningAVX2(const MMDSkinningContext& ctx, const Vertex* vertices, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2)
+			{
+				SkinVertex2AVX(ctx, i, vertices[i], vertices[i + 1]);
+			}
+			if (i < count)
+			{
+				SkinVertexSSE(ctx, i, vertices[i]);
+			}
+		}
+
+		bool IsAVX2Supported()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+			{
+				return false;
+			}
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			const bool fma = (info[2] & (1 << 12)) != 0;
+			if (!osxsave || !avx || !fma)
+			{
+				return false;
+			}
+			// OS が YMM レジスタを保存するか
+			if ((_xgetbv(0) & 0x6) != 0x6)
+			{
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+		}
+#endif // SABA_SKINNING_AVX2
+
+#if defined(SABA_SKINNING_NEON)
+		/*
+		NEON
+		*/
+		struct MatNEON
+		{
+			float32x4_t	m_col[4];
+		};
+
+		inline void LoadMat(MatNEON* dst, const glm::mat4& m)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				dst->m_col[col] = vld1q_f32(&m[col][0]);
+			}
+		}
+
+		inline void ScaleMat(MatNEON* dst, const glm::mat4& m, float weight)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				dst->m_col[col] = vmulq_n_f32(vld1q_f32(&m[col][0]), weight);
+			}
+		}
+
+		inline void BlendMat(MatNEON* dst, const glm::mat4& m, float weight)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				dst->m_col[col] = vaddq_f32(dst->m_col[col], vmulq_n_f32(vld1q_f32(&m[col][0]), weight));
+			}
+		}
+
+		inline void StoreVec3(glm::vec3* dst, float32x4_t v)
+		{
+			vst1_f32(&dst->x, vget_low_f32(v));
+			vst1q_lane_f32(&dst->z, v, 2);
+		}
+
+		inline void SkinVertex(const MMDSkinningContext& ctx, size_t i, uint32_t vtx, const MatNEON& m)
+		{
+			const auto p = GetMorphedPosition(ctx, i, vtx);
+			const auto& n = ctx.m_normals[i];
+
+			const float32x4_t pos = vaddq_f32(
+				vaddq_f32(vmulq_n_f32(m.m_col[0], p.x), vmulq_n_f32(m.m_col[1], p.y)),
+				vaddq_f32(vmulq_n_f32(m.m_col[2], p.z), m.m_col[3])
+			);
+			const float32x4_t nor = vaddq_f32(
+				vaddq_f32(vmulq_n_f32(m.m_col[0], n.x), vmulq_n_f32(m.m_col[1], n.y)),
+				vmulq_n_f32(m.m_col[2], n.z)
+			);
+
+			const float32x4_t sq = vmulq_f32(nor, nor);
+			const float dot = vgetq_lane_f32(sq, 0) + vgetq_lane_f32(sq, 1) + vgetq_lane_f32(sq, 2);
+			const float invLen = 1.0f / std::sqrt(dot);
+
+			StoreVec3(&ctx.m_updatePositions[vtx], pos);
+			StoreVec3(&ctx.m_updateNormals[vtx], vmulq_n_f32(nor, invLen));
+		}
+
+		void SkinningNEON(const MMDSkinningContext& ctx, const MMDSkinningWeight1* vertices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& v = vertices[i];
+				MatNEON m;
+				LoadMat(&m, ctx.m_transforms[v.m_boneIndex]);
+				SkinVertex(ctx, i, v.m_vertex, m);
+			}
+		}
+
+		void SkinningNEON(const MMDSkinningContext& ctx, const MMDSkinningWeight2* vertices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& v = vertices[i];
+				const float w0 = DequantizeMMDSkinningWeight(v.m_boneWeight);
+				MatNEON m;
+				ScaleMat(&m, ctx.m_transforms[v.m_boneIndex[0]], w0);
+				BlendMat(&m, ctx.m_transforms[v.m_boneIndex[1]], 1.0f - w0);
+				SkinVertex(ctx, i, v.m_vertex, m);
+			}
+		}
+
+		void SkinningNEON(const MMDSkinningContext& ctx, const MMDSkinningWeight4* vertices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& v = vertices[i];
+				MatNEON m;
+				ScaleMat(&m, ctx.m_transforms[v.m_boneIndex[0]], DequantizeMMDSkinningWeight(v.m_boneWeight[0]));
+				BlendMat(&m, ctx.m_transforms[v.m_boneIndex[1]], DequantizeMMDSkinningWeight(v.m_boneWeight[1]));
+				BlendMat(&m, ctx.m_transforms[v.m_boneIndex[2]], DequantizeMMDSkinningWeight(v.m_boneWeight[2]));
+				BlendMat(&m, ctx.m_transforms[v.m_boneIndex[3]], DequantizeMMDSkinningWeight(v.m_boneWeight[3]));
+				SkinVertex(ctx, i, v.m_vertex, m);
+			}
+		}
+#endif // SABA_SKINNING_NEON
+
+		MMDSkinningISA DetectMMDSkinningISA()
+		{
+#if defined(SABA_SKINNING_AVX2)
+			if (IsAVX2Supported())
+			{
+				return MMDSkinningISA::AVX2;
+			}
+#endif
+#if defined(SABA_SKINNING_SSE2)
+			return MMDSkinningISA::SSE2;
+#elif defined(SABA_SKINNING_NEON)
+			return MMDSkinningISA::NEON;
+#else
+			return MMDSkinningISA::Scalar;
+#endif
+		}
+
+		std::atomic<MMDSkinningISA>& GetCurrentISA()
+		{
+			static std::atomic<MMDSkinningISA> currentISA;
+			static std::once_flag initFlag;
+			std::call_once(initFlag, []()
+			{
+				currentISA = DetectMMDSkinningISA();
+				SABA_INFO("MMD Skinning ISA : {}", GetMMDSkinningISAName(currentISA));
+			});
+			return currentISA;
+		}
+
+		template <typename Vertex>
+		void DispatchSkinning(const MMDSkinningContext& ctx, const Vertex* vertices, size_t count)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+
+			switch (GetCurrentISA().load(std::memory_order_relaxed))
+			{
+#if defined(SABA_SKINNING_AVX2)
+			case MMDSkinningISA::AVX2:
+				SkinningAVX2(ctx, vertices, count);
+				break;
+#endif
+#if defined(SABA_SKINNING_SSE2)
+			case MMDSkinningISA::SSE2:
+				SkinningSSE2(ctx, vertices, count);
+				break;
+#endif
+#if defined(SABA_SKINNING_NEON)
+			case MMDSkinningISA::NEON:
+				SkinningNEON(ctx, vertices, count);
+				break;
+#endif
+			default:
+				SkinningScalar(ctx, vertices, count);
+				break;
+			}
+		}
+	}
+
+	MMDSkinningISA GetMMDSkinningISA()
+	{
+		return GetCurrentISA();
+	}
+
+	bool SetMMDSkinningISA(MMDSkinningISA isa)
+	{
+		if (!IsMMDSkinningISASupported(isa))
+		{
+			SABA_WARN("MMD Skinning ISA [{}] is not supported.", GetMMDSkinningISAName(isa));
+			return false;
+		}
+		GetCurrentISA() = isa;
+		return true;
+	}
+
+	bool IsMMDSkinningISASupported(MMDSkinningISA isa)
+	{
+		switch (isa)
+		{
+		case MMDSkinningISA::Scalar:
+			return true;
+#if defined(SABA_SKINNING_SSE2)
+		case MMDSkinningISA::SSE2:
+			return true;
+#endif
+#if defined(SABA_SKINNING_AVX2)
+		case MMDSkinningISA::AVX2:
+			return IsAVX2Supported();
+#endif
+#if defined(SABA_SKINNING_NEON)
+		case MMDSkinningISA::NEON:
+			return true;
+#endif
+		default:
+			return false;
+		}
+	}
+
+	const char* GetMMDSkinningISAName(MMDSkinningISA isa)
+	{
+		switch (isa)
+		{
+		case MMDSkinningISA::Scalar: return "Scalar";
+		case MMDSkinningISA::SSE2: return "SSE2";
+		case MMDSkinningISA::AVX2: return "AVX2";
+		case MMDSkinningISA::NEON: return "NEON";
+		default: return "Unknown";
+		}
+	}
+
+	void MMDSkinning(const MMDSkinningContext& ctx, const MMDSkinningWeight1* vertices, size_t count)
+	{
+		DispatchSkinning(ctx, vertices, count);
+	}
+
+	void MMDSkinning(const MMDSkinningContext& ctx, const MMDSkinningWeight2* vertices, size_t count)
+	{
+		DispatchSkinning(ctx, vertices, count);
+	}
+
+	void MMDSkinning(const MMDSkinningContext& ctx, const MMDSkinningWeight4* vertices, size_t count)
+	{
+		DispatchSkinning(ctx, vertices, count);
+	}
+}
@@ -0,0 +1,92 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_MMDSKINNING_H_
+#define SABA_MODEL_MMD_MMDSKINNING_H_
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <cstdint>
+#include <cstddef>
+
+namespace saba
+{
+	/*
+	線形ブレンドスキニング (BDEF1/2/4) の頂点カーネル。
+	頂点はスキニングタイプ毎にまとめておき、分岐なしで処理する。
+	実行時に CPU を判定して SIMD 実装を選択する。
+	*/
+	enum class MMDSkinningISA
+	{
+		Scalar,
+		SSE2,
+		AVX2,	//!< AVX2 + FMA
+		NEON,
+	};
+
+	/*
+	ボーンインデックスは 16bit、ウェイトは 16bit の正規化整数で保持する。
+	位置と法線は頂点リストと同じ順番に並べた配列から読む (MMDSkinningContext)。
+	*/
+	const size_t MMDSkinningMaxBoneCount = 0xFFFF;
+
+	inline uint16_t QuantizeMMDSkinningWeight(float weight)
+	{
+		weight = weight < 0.0f ? 0.0f : (weight > 1.0f ? 1.0f : weight);
+		return uint16_t(weight * 65535.0f + 0.5f);
+	}
+
+	inline float DequantizeMMDSkinningWeight(uint16_t weight)
+	{
+		return float(weight) * (1.0f / 65535.0f);
+	}
+
+	struct MMDSkinningWeight1
+	{
+		uint32_t	m_vertex;
+		uint16_t	m_boneIndex;
+		uint16_t	m_padding;
+	};
+
+	struct MMDSkinningWeight2
+	{
+		uint32_t	m_vertex;
+		uint16_t	m_boneIndex[2];
+		uint16_t	m_boneWeight;	//!< m_boneIndex[1] の重みは 1 - m_boneWeight
+		uint16_t	m_padding;
+	};
+
+	struct MMDSkinningWeight4
+	{
+		uint32_t	m_vertex;
+		uint16_t	m_boneIndex[4];
+		uint16_t	m_boneWeight[4];
+	};
+
+	struct MMDSkinningContext
+	{
+		const glm::mat4*	m_transforms;
+		// 頂点リストと同じ並び
+		const glm::vec3*	m_positions;
+		const glm::vec3*	m_normals;
+		// 頂点番号でアクセスする (モーフが掛かっていない範囲では nullptr)
+		const glm::vec3*	m_morphPositions;
+		glm::vec3*			m_updatePositions;
+		glm::vec3*			m_updateNormals;
+	};
+
+	// 最初の呼び出し時に CPU を判定する
+	MMDSkinningISA GetMMDSkinningISA();
+	// 非対応の ISA を指定した場合は false を返す
+	bool SetMMDSkinningISA(MMDSkinningISA isa);
+	bool IsMMDSkinningISASupported(MMDSkinningISA isa);
+	const char* GetMMDSkinningISAName(MMDSkinningISA isa);
+
+	void MMDSkinning(const MMDSkinningContext& ctx, const MMDSkinningWeight1* vertices, size_t count);
+	void MMDSkinning(const MMDSkinningContext& ctx, const MMDSkinningWeight2* vertices, size_t count);
+	void MMDSkinning(const MMDSkinningContext& ctx, const MMDSkinningWeight4* vertices, size_t count);
+}
+
+#endif // !SABA_MODEL_MMD_MMDSKINNING_H_
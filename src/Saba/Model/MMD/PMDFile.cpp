@@ -16,12 +16,12 @@ namespace saba
 	namespace
 	{
 		template <typename T>
-		bool Read(T* data, File& file)
+		bool Read(T* data, BufferReader& file)
 		{
 			return file.Read(data);
 		}
 
-		bool ReadHeader(PMDFile* pmdFile, File& file)
+		bool ReadHeader(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -51,7 +51,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadVertex(PMDFile* pmdFile, File& file)
+		bool ReadVertex(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -59,7 +59,7 @@ namespace saba
 			}
 
 			uint32_t vertexCount = 0;
-			if (!Read(&vertexCount, file))
+			if (!Read(&vertexCount, file) || !file.CanRead(vertexCount))
 			{
 				return false;
 			}
@@ -80,7 +80,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadFace(PMDFile* pmdFile, File& file)
+		bool ReadFace(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -88,7 +88,7 @@ namespace saba
 			}
 
 			uint32_t faceCount = 0;
-			if (!Read(&faceCount, file))
+			if (!Read(&faceCount, file) || !file.CanRead(faceCount))
 			{
 				return false;
 			}
@@ -105,7 +105,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadMaterial(PMDFile* pmdFile, File& file)
+		bool ReadMaterial(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -113,7 +113,7 @@ namespace saba
 			}
 
 			uint32_t materialCount = 0;
-			if (!Read(&materialCount, file))
+			if (!Read(&materialCount, file) || !file.CanRead(materialCount))
 			{
 				return false;
 			}
@@ -136,7 +136,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadBone(PMDFile* pmdFile, File& file)
+		bool ReadBone(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -144,7 +144,7 @@ namespace saba
 			}
 
 			uint16_t boneCount = 0;
-			if (!Read(&boneCount, file))
+			if (!Read(&boneCount, file) || !file.CanRead(boneCount))
 			{
 				return false;
 			}
@@ -164,7 +164,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadIK(PMDFile* pmdFile, File& file)
+		bool ReadIK(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -172,7 +172,7 @@ namespace saba
 			}
 
 			uint16_t ikCount = 0;
-			if (!Read(&ikCount, file))
+			if (!Read(&ikCount, file) || !file.CanRead(ikCount))
 			{
 				return false;
 			}
@@ -197,7 +197,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadBlendShape(PMDFile* pmdFile, File& file)
+		bool ReadBlendShape(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -205,7 +205,7 @@ namespace saba
 			}
 
 			uint16_t blendShapeCount = 0;
-			if (!Read(&blendShapeCount, file))
+			if (!Read(&blendShapeCount, file) || !file.CanRead(blendShapeCount))
 			{
 				return false;
 			}
@@ -217,7 +217,10 @@ namespace saba
 				Read(&morph.m_morphName, file);
 
 				uint32_t vertexCount = 0;
-				Read(&vertexCount, file);
+				if (!Read(&vertexCount, file) || !file.CanRead(vertexCount))
+				{
+					return false;
+				}
 				morph.m_vertices.resize(vertexCount);
 
 				uint8_t morphType;
@@ -233,7 +236,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadBlendShapeDisplayList(PMDFile* pmdFile, File& file)
+		bool ReadBlendShapeDisplayList(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -241,7 +244,7 @@ namespace saba
 			}
 
 			uint8_t displayListCount = 0;
-			if (!Read(&displayListCount, file))
+			if (!Read(&displayListCount, file) || !file.CanRead(displayListCount))
 			{
 				return false;
 			}
@@ -255,7 +258,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadBoneDisplayList(PMDFile* pmdFile, File& file)
+		bool ReadBoneDisplayList(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -263,7 +266,7 @@ namespace saba
 			}
 
 			uint8_t displayListCount = 0;
-			if (!Read(&displayListCount, file))
+			if (!Read(&displayListCount, file) || !file.CanRead(displayListCount))
 			{
 				return false;
 			}
@@ -284,7 +287,7 @@ namespace saba
 			}
 
 			uint32_t displayCount = 0;
-			if (!Read(&displayCount, file))
+			if (!Read(&displayCount, file) || !file.CanRead(displayCount))
 			{
 				return false;
 			}
@@ -295,13 +298,17 @@ namespace saba
 
 				uint8_t frameIdx = 0;
 				Read(&frameIdx, file);
+				if (frameIdx >= pmdFile->m_boneDisplayLists.size())
+				{
+					return false;
+				}
 				pmdFile->m_boneDisplayLists[frameIdx].m_displayList.push_back(boneIdx);
 			}
 
 			return !file.IsBad();
 		}
 
-		bool ReadExt(PMDFile* pmdFile, File& file)
+		bool ReadExt(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -350,7 +357,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadToonTextureName(PMDFile* pmdFile, File& file)
+		bool ReadToonTextureName(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -365,7 +372,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadRigidBodyExt(PMDFile* pmdFile, File& file)
+		bool ReadRigidBodyExt(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -373,7 +380,7 @@ namespace saba
 			}
 
 			uint32_t rigidBodyCount = 0;
-			if (!Read(&rigidBodyCount, file))
+			if (!Read(&rigidBodyCount, file) || !file.CanRead(rigidBodyCount))
 			{
 				return false;
 			}
@@ -402,7 +409,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadJointExt(PMDFile* pmdFile, File& file)
+		bool ReadJointExt(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (file.IsBad())
 			{
@@ -410,7 +417,7 @@ namespace saba
 			}
 
 			uint32_t jointCount = 0;
-			if (!Read(&jointCount, file))
+			if (!Read(&jointCount, file) || !file.CanRead(jointCount))
 			{
 				return false;
 			}
@@ -434,7 +441,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadPMDFile(PMDFile* pmdFile, File& file)
+		bool ReadPMDFile(PMDFile* pmdFile, BufferReader& file)
 		{
 			if (!ReadHeader(pmdFile, file))
 			{
@@ -544,14 +551,15 @@ namespace saba
 	{
 		SABA_INFO("PMD File Open. {}", filename);
 
-		File file;
+		MappedFile file;
 		if (!file.Open(filename))
 		{
 			SABA_INFO("PMD File Open Fail. {}", filename);
 			return false;
 		}
+		BufferReader reader(file.GetData(), file.GetSize());
 
-		if (!ReadPMDFile(pmdFile, file))
+		if (!ReadPMDFile(pmdFile, reader))
 		{
 			SABA_INFO("PMD File Read Fail. {}", filename);
 			return false;
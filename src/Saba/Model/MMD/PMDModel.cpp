@@ -10,6 +10,8 @@
 #include <Saba/Base/Path.h>
 #include <Saba/Base/File.h>
 #include <Saba/Base/Log.h>
+#include <Saba/Base/Singleton.h>
+#include <Saba/Base/JobSystem.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -66,13 +68,7 @@ namespace saba
 			morph->SetWeight(0);
 		}
 
-		for (auto& node : (*m_nodeMan.GetNodes()))
-		{
-			if (node->GetParent() == nullptr)
-			{
-				node->UpdateGlobalTransform();
-			}
-		}
+		m_nodeHierarchy.UpdateGlobalTransforms();
 
 		for (auto& solver : (*m_ikSolverMan.GetIKSolvers()))
 		{
@@ -115,12 +111,11 @@ namespace saba
 			node->UpdateLocalTransform();
 		}
 
-		for (auto& node : (*m_nodeMan.GetNodes()))
+		m_nodeHierarchy.UpdateGlobalTransforms();
+
+		if (!m_enableIKAndAppend)
 		{
-			if (node->GetParent() == nullptr)
-			{
-				node->UpdateGlobalTransform();
-			}
+			return;
 		}
 
 		for (auto& solver : (*m_ikSolverMan.GetIKSolvers()))
@@ -147,7 +142,18 @@ namespace saba
 			rb->ResetTransform();
 		}
 
-		physics->Update(1.0f / 60.0f);
+		if (physicsMan->IsSharedPhysics())
+		{
+			// 共有しているワールドは進めずに、このモデルの剛体だけを動かす
+			for (auto& rb : (*rigidbodys))
+			{
+				rb->ResetWorldTransform(physics);
+			}
+		}
+		else
+		{
+			physics->Update(1.0f / 60.0f);
+		}
 
 		for (auto& rb : (*rigidbodys))
 		{
@@ -158,18 +164,14 @@ namespace saba
 			rb->CalcLocalTransform();
 		}
 
-		for (auto& node : (*m_nodeMan.GetNodes()))
-		{
-			if (node->GetParent() == nullptr)
-			{
-				node->UpdateGlobalTransform();
-			}
-		}
+		m_nodeHierarchy.UpdateGlobalTransforms();
 
 		for (auto& rb : (*rigidbodys))
 		{
 			rb->Reset(physics);
 		}
+
+		physicsMan->ResetPhysicsState();
 	}
 
 	void PMDModel::UpdatePhysicsAnimation(float elapsed)
@@ -182,39 +184,29 @@ namespace saba
 			return;
 		}
 
-		auto rigidbodys = physicsMan->GetRigidBodys();
-		auto joints = physicsMan->GetJoints();
-		for (auto& rb : (*rigidbodys))
-		{
-			rb->SetActivation(true);
-		}
+		BeginPhysicsAnimation(elapsed);
 
-		physics->Update(elapsed);
+		physicsMan->UpdatePhysics(elapsed);
 
-		for (auto& rb : (*rigidbodys))
-		{
-			rb->ReflectGlobalTransform();
-		}
-		for (auto& rb : (*rigidbodys))
-		{
-			rb->CalcLocalTransform();
-		}
+		EndPhysicsAnimation();
+	}
 
-		for (auto& node : (*m_nodeMan.GetNodes()))
-		{
-			if (node->GetParent() == nullptr)
-			{
-				node->UpdateGlobalTransform();
-			}
-		}
+	void PMDModel::BeginPhysicsAnimation(float elapsed)
+	{
+		GetPhysicsManager()->BeginPhysicsAnimation(elapsed);
+	}
+
+	void PMDModel::EndPhysicsAnimation()
+	{
+		GetPhysicsManager()->EndPhysicsAnimation();
+
+		m_nodeHierarchy.UpdateGlobalTransforms();
 	}
 
 	void PMDModel::Update()
 	{
 		const auto* position = &m_positions[0];
 		const auto* normal = &m_normals[0];
-		const auto* bone = &m_bones[0];
-		const auto* boneWeight = &m_boneWeights[0];
 		auto* updatePosition = &m_updatePositions[0];
 		auto* updateNormal = &m_updateNormals[0];
 
@@ -278,10 +270,34 @@ namespace saba
 			m_transforms[i] = nodes[i]->GetGlobalTransform() * nodes[i]->GetInverseInitTransform();
 		}
 
-		for (size_t i = 0; i < numVertices; i++)
+		// 頂点数に応じてジョブ数を決める (1 ジョブあたり最低 LowerVertexCount 頂点)
+		auto& jobSystem = *Singleton<JobSystem>::Get();
+		size_t parallelCount = m_parallelUpdateCount;
+		if (parallelCount == 0)
+		{
+			parallelCount = jobSystem.GetConcurrency();
+		}
+		const size_t LowerVertexCount = 1000;
+		size_t jobCount = std::min(parallelCount, (numVertices + LowerVertexCount - 1) / LowerVertexCount);
+
+		jobSystem.ParallelFor(numVertices, jobCount, [this](size_t begin, size_t end) {
+			this->Update(begin, end);
+		});
+	}
+
+	void PMDModel::SetParallelUpdateHint(uint32_t parallelCount)
+	{
+		m_parallelUpdateCount = parallelCount;
+	}
+
+	void PMDModel::Update(size_t vertexBegin, size_t vertexEnd)
+	{
+		const auto* bone = &m_bones[vertexBegin];
+		const auto* boneWeight = &m_boneWeights[vertexBegin];
+		auto* updatePosition = &m_updatePositions[vertexBegin];
+		auto* updateNormal = &m_updateNormals[vertexBegin];
+		for (size_t i = vertexBegin; i < vertexEnd; i++)
 		{
-			auto node0 = m_nodeMan.GetNode(bone->x);
-			auto node1 = m_nodeMan.GetNode(bone->y);
 			auto w0 = boneWeight->x;
 			auto w1 = boneWeight->y;
 			const auto& m0 = m_transforms[bone->x];
@@ -500,6 +516,7 @@ namespace saba
 			node->CalculateInverseInitTransform();
 			node->SaveInitialTRS();
 		}
+		m_nodeHierarchy.Build(*m_nodeMan.GetNodes());
 		m_transforms.resize(m_nodeMan.GetNodeCount());
 
 		// IKを作成
@@ -579,6 +596,10 @@ namespace saba
 			}
 		}
 
+		m_nodeMan.BuildNameIndex();
+		m_ikSolverMan.BuildNameIndex();
+		m_morphMan.BuildNameIndex();
+
 		ResetPhysics();
 
 		return true;
@@ -597,6 +618,7 @@ namespace saba
 
 		m_indices.clear();
 
+		m_nodeHierarchy.Clear();
 		m_nodeMan.GetNodes()->clear();
 	}
 
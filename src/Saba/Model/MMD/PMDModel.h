@@ -8,6 +8,7 @@
 
 #include "MMDMaterial.h"
 #include "MMDModel.h"
+#include "MMDNodeHierarchy.h"
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -43,6 +44,7 @@ namespace saba
 
 		size_t GetSubMeshCount() const override { return m_subMeshes.size(); }
 		const MMDSubMesh* GetSubMeshes() const override { return &m_subMeshes[0]; }
+		bool HasUVMorph() const override { return false; }
 
 		MMDPhysics* GetMMDPhysics() override { return m_physicsMan.GetMMDPhysics(); }
 
@@ -57,9 +59,12 @@ namespace saba
 		// Physicsを更新する
 		void ResetPhysics() override;
 		void UpdatePhysicsAnimation(float elapsed) override;
+		void BeginPhysicsAnimation(float elapsed) override;
+		void EndPhysicsAnimation() override;
 		// 頂点データーを更新する
 		void Update() override;
-		void SetParallelUpdateHint(uint32_t) override {}
+		using MMDModel::Update;
+		void SetParallelUpdateHint(uint32_t parallelCount) override;
 
 		bool Load(const std::string& filepath, const std::string& mmdDataDir);
 		void Destroy();
@@ -82,6 +87,9 @@ namespace saba
 			std::vector<MorphVertex>	m_vertices;
 		};
 
+	private:
+		void Update(size_t vertexBegin, size_t vertexEnd);
+
 	private:
 		std::vector<glm::vec3>	m_positions;
 		std::vector<glm::vec3>	m_normals;
@@ -106,6 +114,9 @@ namespace saba
 		MMDIKManagerT<MMDIkSolver>	m_ikSolverMan;
 		MMDMorphManagerT<PMDMorph>	m_morphMan;
 		MMDPhysicsManager			m_physicsMan;
+		MMDNodeHierarchy			m_nodeHierarchy;	// m_nodeMan より後に宣言する
+
+		uint32_t	m_parallelUpdateCount = 0;
 	};
 }
 
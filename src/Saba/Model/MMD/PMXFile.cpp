@@ -17,18 +17,18 @@ namespace saba
 	{
 
 		template <typename T>
-		bool Read(T* val, File& file)
+		bool Read(T* val, BufferReader& file)
 		{
 			return file.Read(val);
 		}
 
 		template <typename T>
-		bool Read(T* valArray, size_t size, File& file)
+		bool Read(T* valArray, size_t size, BufferReader& file)
 		{
 			return file.Read(valArray, size);
 		}
 
-		bool ReadString(PMXFile* pmx, std::string* val, File& file)
+		bool ReadString(PMXFile* pmx, std::string* val, BufferReader& file)
 		{
 			uint32_t bufSize;
 			if (!Read(&bufSize, file))
@@ -64,7 +64,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadIndex(int32_t* index, uint8_t indexSize, File& file)
+		bool ReadIndex(int32_t* index, uint8_t indexSize, BufferReader& file)
 		{
 			switch (indexSize)
 			{
@@ -109,7 +109,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadHeader(PMXFile* pmxFile, File& file)
+		bool ReadHeader(PMXFile* pmxFile, BufferReader& file)
 		{
 			auto& header = pmxFile->m_header;
 
@@ -131,7 +131,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadInfo(PMXFile* pmx, File& file)
+		bool ReadInfo(PMXFile* pmx, BufferReader& file)
 		{
 			auto& info = pmx->m_info;
 
@@ -143,10 +143,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadVertex(PMXFile* pmx, File& file)
+		bool ReadVertex(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t vertexCount;
-			if (!Read(&vertexCount, file))
+			if (!Read(&vertexCount, file) || !file.CanRead(vertexCount))
 			{
 				return false;
 			}
@@ -201,8 +201,8 @@ namespace saba
 					ReadIndex(&vertex.m_boneIndices[3], pmx->m_header.m_boneIndexSize, file);
 					Read(&vertex.m_boneWeights[0], file);
 					Read(&vertex.m_boneWeights[1], file);
+					Read(&vertex.m_boneWeights[2], file);
 					Read(&vertex.m_boneWeights[3], file);
-					Read(&vertex.m_boneWeights[4], file);
 					break;
 				default:
 					return false;
@@ -213,10 +213,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadFace(PMXFile* pmx, File& file)
+		bool ReadFace(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t faceCount = 0;
-			if (!Read(&faceCount, file))
+			if (!Read(&faceCount, file) || !file.CanRead(faceCount))
 			{
 				return false;
 			}
@@ -269,10 +269,77 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadTexture(PMXFile* pmx, File& file)
+		// 頂点は可変長なので、ウェイトの種類からサイズを求めて読み飛ばす
+		bool SkipVertex(PMXFile* pmx, BufferReader& file)
+		{
+			int32_t vertexCount;
+			if (!Read(&vertexCount, file) || !file.CanRead(vertexCount))
+			{
+				return false;
+			}
+
+			const BufferReader::Offset uvSize = (2 + 3 + 3 + 4 * pmx->m_header.m_addUVNum) * sizeof(float);
+			const BufferReader::Offset boneSize = pmx->m_header.m_boneIndexSize;
+			const BufferReader::Offset edgeSize = sizeof(float);
+			for (int32_t i = 0; i < vertexCount; i++)
+			{
+				PMXVertexWeight weightType;
+				if (!file.Seek(uvSize, File::SeekDir::Current) || !Read(&weightType, file))
+				{
+					return false;
+				}
+
+				BufferReader::Offset weightSize = 0;
+				switch (weightType)
+				{
+				case PMXVertexWeight::BDEF1:
+					weightSize = boneSize;
+					break;
+				case PMXVertexWeight::BDEF2:
+					weightSize = boneSize * 2 + sizeof(float);
+					break;
+				case PMXVertexWeight::BDEF4:
+				case PMXVertexWeight::QDEF:
+					weightSize = boneSize * 4 + sizeof(float) * 4;
+					break;
+				case PMXVertexWeight::SDEF:
+					weightSize = boneSize * 2 + sizeof(float) + sizeof(float) * 3 * 3;
+					break;
+				default:
+					return false;
+				}
+				if (!file.Seek(weightSize + edgeSize, File::SeekDir::Current))
+				{
+					return false;
+				}
+			}
+
+			pmx->m_vertices.clear();
+
+			return !file.IsBad();
+		}
+
+		bool SkipFace(PMXFile* pmx, BufferReader& file)
+		{
+			int32_t faceCount = 0;
+			if (!Read(&faceCount, file) || !file.CanRead(faceCount, pmx->m_header.m_vertexIndexSize))
+			{
+				return false;
+			}
+			if (!file.Seek(BufferReader::Offset(faceCount) * pmx->m_header.m_vertexIndexSize, File::SeekDir::Current))
+			{
+				return false;
+			}
+
+			pmx->m_faces.clear();
+
+			return !file.IsBad();
+		}
+
+		bool ReadTexture(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t texCount = 0;
-			if (!Read(&texCount, file))
+			if (!Read(&texCount, file) || !file.CanRead(texCount))
 			{
 				return false;
 			}
@@ -287,10 +354,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadMaterial(PMXFile* pmx, File& file)
+		bool ReadMaterial(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t matCount = 0;
-			if (!Read(&matCount, file))
+			if (!Read(&matCount, file) || !file.CanRead(matCount))
 			{
 				return false;
 			}
@@ -340,10 +407,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadBone(PMXFile* pmx, File& file)
+		bool ReadBone(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t boneCount;
-			if (!Read(&boneCount, file))
+			if (!Read(&boneCount, file) || !file.CanRead(boneCount))
 			{
 				return false;
 			}
@@ -400,7 +467,7 @@ namespace saba
 					Read(&bone.m_ikLimit, file);
 
 					int32_t linkCount;
-					if (!Read(&linkCount, file))
+					if (!Read(&linkCount, file) || !file.CanRead(linkCount))
 					{
 						return false;
 					}
@@ -423,10 +490,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadMorph(PMXFile* pmx, File& file)
+		bool ReadMorph(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t morphCount;
-			if (!Read(&morphCount, file))
+			if (!Read(&morphCount, file) || !file.CanRead(morphCount))
 			{
 				return false;
 			}
@@ -442,7 +509,7 @@ namespace saba
 				Read(&morph.m_morphType, file);
 
 				int32_t dataCount;
-				if (!Read(&dataCount, file))
+				if (!Read(&dataCount, file) || !file.CanRead(dataCount))
 				{
 					return false;
 				}
@@ -537,10 +604,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadDisplayFrame(PMXFile* pmx, File& file)
+		bool ReadDisplayFrame(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t displayFrameCount;
-			if (!Read(&displayFrameCount, file))
+			if (!Read(&displayFrameCount, file) || !file.CanRead(displayFrameCount))
 			{
 				return false;
 			}
@@ -554,7 +621,7 @@ namespace saba
 
 				Read(&displayFrame.m_flag, file);
 				int32_t targetCount;
-				if (!Read(&targetCount, file))
+				if (!Read(&targetCount, file) || !file.CanRead(targetCount))
 				{
 					return false;
 				}
@@ -580,10 +647,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadRigidbody(PMXFile* pmx, File& file)
+		bool ReadRigidbody(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t rbCount;
-			if (!Read(&rbCount, file))
+			if (!Read(&rbCount, file) || !file.CanRead(rbCount))
 			{
 				return false;
 			}
@@ -617,10 +684,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadJoint(PMXFile* pmx, File& file)
+		bool ReadJoint(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t jointCount;
-			if (!Read(&jointCount, file))
+			if (!Read(&jointCount, file) || !file.CanRead(jointCount))
 			{
 				return false;
 			}
@@ -651,10 +718,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadSoftbody(PMXFile* pmx, File& file)
+		bool ReadSoftbody(PMXFile* pmx, BufferReader& file)
 		{
 			int32_t sbCount;
-			if (!Read(&sbCount, file))
+			if (!Read(&sbCount, file) || !file.CanRead(sbCount))
 			{
 				return false;
 			}
@@ -713,7 +780,7 @@ namespace saba
 				Read(&sb.m_VST, file);
 
 				int32_t arCount;
-				if (!Read(&arCount, file))
+				if (!Read(&arCount, file) || !file.CanRead(arCount))
 				{
 					return false;
 				}
@@ -726,7 +793,7 @@ namespace saba
 				}
 
 				int32_t pvCount;
-				if (!Read(&pvCount, file))
+				if (!Read(&pvCount, file) || !file.CanRead(pvCount))
 				{
 					return false;
 				}
@@ -740,7 +807,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadPMXFile(PMXFile * pmxFile, File& file)
+		bool ReadPMXFile(PMXFile * pmxFile, BufferReader& file, bool skipMesh)
 		{
 			if (!ReadHeader(pmxFile, file))
 			{
@@ -754,16 +821,33 @@ namespace saba
 				return false;
 			}
 
-			if (!ReadVertex(pmxFile, file))
+			if (skipMesh)
 			{
-				SABA_ERROR("ReadVertex Fail.");
-				return false;
-			}
+				if (!SkipVertex(pmxFile, file))
+				{
+					SABA_ERROR("SkipVertex Fail.");
+					return false;
+				}
 
-			if (!ReadFace(pmxFile, file))
+				if (!SkipFace(pmxFile, file))
+				{
+					SABA_ERROR("SkipFace Fail.");
+					return false;
+				}
+			}
+			else
 			{
-				SABA_ERROR("ReadFace Fail.");
-				return false;
+				if (!ReadVertex(pmxFile, file))
+				{
+					SABA_ERROR("ReadVertex Fail.");
+					return false;
+				}
+
+				if (!ReadFace(pmxFile, file))
+				{
+					SABA_ERROR("ReadFace Fail.");
+					return false;
+				}
 			}
 
 			if (!ReadTexture(pmxFile, file))
@@ -823,14 +907,15 @@ namespace saba
 
 	bool ReadPMXFile(PMXFile * pmxFile, const char* filename)
 	{
-		File file;
+		MappedFile file;
 		if (!file.Open(filename))
 		{
 			SABA_INFO("PMX File Open Fail. {}", filename);
 			return false;
 		}
+		BufferReader reader(file.GetData(), file.GetSize());
 
-		if (!ReadPMXFile(pmxFile, file))
+		if (!ReadPMXFile(pmxFile, reader, false))
 		{
 			SABA_INFO("PMX File Read Fail. {}", filename);
 			return false;
@@ -840,5 +925,17 @@ namespace saba
 		return true;
 	}
 
+	bool ReadPMXFile(PMXFile * pmxFile, const void* data, size_t size, bool skipMesh)
+	{
+		BufferReader reader(data, size);
+		if (!ReadPMXFile(pmxFile, reader, skipMesh))
+		{
+			SABA_INFO("PMX File Read Fail.");
+			return false;
+		}
+
+		return true;
+	}
+
 
 }
@@ -594,6 +594,9 @@ namespace saba
 	};
 
 	bool ReadPMXFile(PMXFile* pmdFile, const char* filename);
+	// メモリ上の PMX を読み込む
+	// skipMesh が true の場合は頂点と面を読み飛ばす (m_vertices と m_faces は空になる)
+	bool ReadPMXFile(PMXFile* pmxFile, const void* data, size_t size, bool skipMesh = false);
 }
 
 #endif // !SABA_MODEL_PMXFILE_H_
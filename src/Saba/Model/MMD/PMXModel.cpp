@@ -8,11 +8,15 @@
 
 #include "PMXFile.h"
 #include "MMDPhysics.h"
+#include "MMDModelCache.h"
+#include "MMDGPUSkinning.h"
 
 #include <Saba/Base/Path.h>
 #include <Saba/Base/File.h>
+#include <Saba/Base/Hash.h>
 #include <Saba/Base/Log.h>
 #include <Saba/Base/Singleton.h>
+#include <Saba/Base/JobSystem.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -20,18 +24,147 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/dual_quaternion.hpp>
 #include <map>
+#include <mutex>
 #include <limits>
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
 
 namespace saba
 {
+	namespace
+	{
+		// キャッシュに保存する内容や構造体が変わった場合は更新する
+		const uint32_t PMXModelCacheFormat = 1;
+
+		namespace PMXModelCacheSection
+		{
+			enum : uint32_t
+			{
+				MeshInfo = 1,
+				Positions,
+				Normals,
+				UVs,
+				Indices,
+				// スキニングの頂点リストは頂点、位置、法線の 3 つのセクションを使う
+				Weight1 = 16,
+				Weight2 = 20,
+				Weight4 = 24,
+				SDEF = 28,
+				DualQuaternion = 32,
+			};
+		}
+
+		struct PMXModelCacheMeshInfo
+		{
+			uint32_t	m_vertexCount;
+			uint32_t	m_indexCount;
+			uint32_t	m_indexElementSize;
+			uint32_t	m_reserved;
+			glm::vec3	m_bboxMin;
+			glm::vec3	m_bboxMax;
+		};
+
+		template <typename Stream>
+		void AddSkinningStream(MMDModelCacheWriter* writer, uint32_t sectionID, const Stream& stream)
+		{
+			writer->AddSection(sectionID + 0, stream.m_vertices);
+			writer->AddSection(sectionID + 1, stream.m_positions);
+			writer->AddSection(sectionID + 2, stream.m_normals);
+		}
+
+		template <typename Stream>
+		bool ReadSkinningStream(const MMDModelCacheReader& reader, uint32_t sectionID, Stream* stream)
+		{
+			return reader.ReadSection(sectionID + 0, &stream->m_vertices)
+				&& reader.ReadSection(sectionID + 1, &stream->m_positions)
+				&& reader.ReadSection(sectionID + 2, &stream->m_normals)
+				&& stream->m_positions.size() == stream->m_vertices.size()
+				&& stream->m_normals.size() == stream->m_vertices.size();
+		}
+
+		template <typename T>
+		void ReleaseVector(std::vector<T>* vec)
+		{
+			std::vector<T>().swap(*vec);
+		}
+
+		// 読み込み前や Destroy 後のインスタンスが参照する、空の Asset
+		const PMXModel::AssetPtr& GetEmptyAsset()
+		{
+			static const PMXModel::AssetPtr emptyAsset = std::make_shared<PMXModel::Asset>();
+			return emptyAsset;
+		}
+
+		/*
+		読み込んだ PMX の Asset。
+		インスタンスが残っている間だけ共有し、すべてのインスタンスが手放したら破棄される。
+		*/
+		class PMXModelAssetCache
+		{
+		public:
+			struct Key
+			{
+				std::string	m_dirPath;
+				std::string	m_mmdDataDir;
+				uint64_t	m_sourceSize;
+				uint64_t	m_sourceHash;
+
+				bool operator < (const Key& key) const
+				{
+					if (m_sourceHash != key.m_sourceHash) { return m_sourceHash < key.m_sourceHash; }
+					if (m_sourceSize != key.m_sourceSize) { return m_sourceSize < key.m_sourceSize; }
+					if (m_dirPath != key.m_dirPath) { return m_dirPath < key.m_dirPath; }
+					return m_mmdDataDir < key.m_mmdDataDir;
+				}
+			};
+
+			PMXModel::AssetPtr Find(const Key& key)
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				auto findIt = m_assets.find(key);
+				if (findIt == m_assets.end())
+				{
+					return nullptr;
+				}
+				return findIt->second.lock();
+			}
+
+			// 同時に同じ PMX を読み込んだ場合は、先に登録された Asset を返す
+			PMXModel::AssetPtr Add(const Key& key, const PMXModel::AssetPtr& asset)
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				for (auto it = m_assets.begin(); it != m_assets.end();)
+				{
+					if (it->second.expired())
+					{
+						it = m_assets.erase(it);
+					}
+					else
+					{
+						++it;
+					}
+				}
+
+				auto& entry = m_assets[key];
+				if (auto sharedAsset = entry.lock())
+				{
+					return sharedAsset;
+				}
+				entry = asset;
+				return asset;
+			}
+
+		private:
+			std::mutex	m_mutex;
+			std::map<Key, std::weak_ptr<const PMXModel::Asset>>	m_assets;
+		};
+	}
+
 	PMXModel::PMXModel()
-		: m_parallelUpdateCount(0)
+		: m_asset(GetEmptyAsset())
+		, m_gpuSkinning(false)
+		, m_parallelUpdateCount(0)
 	{
 	}
 
@@ -67,13 +200,7 @@ namespace saba
 			ikSolver->Enable(true);
 		}
 
-		for (const auto& node : (*m_nodeMan.GetNodes()))
-		{
-			if (node->GetParent() == nullptr)
-			{
-				node->UpdateGlobalTransform();
-			}
-		}
+		m_nodeHierarchy.UpdateGlobalTransforms();
 
 		for (auto pmxNode : m_sortedNodes)
 		{
@@ -90,13 +217,7 @@ namespace saba
 			}
 		}
 
-		for (const auto& node : (*m_nodeMan.GetNodes()))
-		{
-			if (node->GetParent() == nullptr)
-			{
-				node->UpdateGlobalTransform();
-			}
-		}
+		m_nodeHierarchy.UpdateGlobalTransforms();
 
 		EndAnimation();
 
@@ -109,12 +230,7 @@ namespace saba
 		{
 			node->BeginUpdateTransform();
 		}
-		size_t vtxCount = m_morphPositions.size();
-		for (size_t vtxIdx = 0; vtxIdx < vtxCount; vtxIdx++)
-		{
-			m_morphPositions[vtxIdx] = glm::vec3(0);
-			m_morphUVs[vtxIdx] = glm::vec4(0);
-		}
+		ResetMorphVertices();
 	}
 
 	void PMXModel::EndAnimation()
@@ -165,23 +281,27 @@ namespace saba
 			}
 		}
 
-		for (auto pmxNode : m_sortedNodes)
+		// IK を含めてベイクしたアニメーションでは、付与と IK を計算しない
+		if (m_enableIKAndAppend)
 		{
-			if (pmxNode->IsDeformAfterPhysics() != afterPhysicsAnim)
+			for (auto pmxNode : m_sortedNodes)
 			{
-				continue;
-			}
+				if (pmxNode->IsDeformAfterPhysics() != afterPhysicsAnim)
+				{
+					continue;
+				}
 
-			if (pmxNode->GetAppendNode() != nullptr)
-			{
-				pmxNode->UpdateAppendTransform();
-				pmxNode->UpdateGlobalTransform();
-			}
-			if (pmxNode->GetIKSolver() != nullptr)
-			{
-				auto ikSolver = pmxNode->GetIKSolver();
-				ikSolver->Solve();
-				pmxNode->UpdateGlobalTransform();
+				if (pmxNode->GetAppendNode() != nullptr)
+				{
+					pmxNode->UpdateAppendTransform();
+					pmxNode->UpdateGlobalTransform();
+				}
+				if (pmxNode->GetIKSolver() != nullptr)
+				{
+					auto ikSolver = pmxNode->GetIKSolver();
+					ikSolver->Solve();
+					pmxNode->UpdateGlobalTransform();
+				}
 			}
 		}
 
@@ -216,7 +336,18 @@ namespace saba
 			rb->ResetTransform();
 		}
 
-		physics->Update(1.0f / 60.0f);
+		if (physicsMan->IsSharedPhysics())
+		{
+			// 共有しているワールドは進めずに、このモデルの剛体だけを動かす
+			for (auto& rb : (*rigidbodys))
+			{
+				rb->ResetWorldTransform(physics);
+			}
+		}
+		else
+		{
+			physics->Update(1.0f / 60.0f);
+		}
 
 		for (auto& rb : (*rigidbodys))
 		{
@@ -228,18 +359,14 @@ namespace saba
 			rb->CalcLocalTransform();
 		}
 
-		for (const auto& node : (*m_nodeMan.GetNodes()))
-		{
-			if (node->GetParent() == nullptr)
-			{
-				node->UpdateGlobalTransform();
-			}
-		}
+		m_nodeHierarchy.UpdateGlobalTransforms();
 
 		for (auto& rb : (*rigidbodys))
 		{
 			rb->Reset(physics);
 		}
+
+		physicsMan->ResetPhysicsState();
 	}
 
 	void PMXModel::UpdatePhysicsAnimation(float elapsed)
@@ -252,34 +379,31 @@ namespace saba
 			return;
 		}
 
-		auto rigidbodys = physicsMan->GetRigidBodys();
-		for (auto& rb : (*rigidbodys))
-		{
-			rb->SetActivation(true);
-		}
+		BeginPhysicsAnimation(elapsed);
 
-		physics->Update(elapsed);
+		physicsMan->UpdatePhysics(elapsed);
 
-		for (auto& rb : (*rigidbodys))
-		{
-			rb->ReflectGlobalTransform();
-		}
+		EndPhysicsAnimation();
+	}
 
-		for (auto& rb : (*rigidbodys))
-		{
-			rb->CalcLocalTransform();
-		}
+	void PMXModel::BeginPhysicsAnimation(float elapsed)
+	{
+		GetPhysicsManager()->BeginPhysicsAnimation(elapsed);
+	}
 
-		for (const auto& node : (*m_nodeMan.GetNodes()))
-		{
-			if (node->GetParent() == nullptr)
-			{
-				node->UpdateGlobalTransform();
-			}
-		}
+	void PMXModel::EndPhysicsAnimation()
+	{
+		GetPhysicsManager()->EndPhysicsAnimation();
+
+		m_nodeHierarchy.UpdateGlobalTransforms();
 	}
 
 	void PMXModel::Update()
+	{
+		Update(m_updatePositions.data(), m_updateNormals.data(), m_updateUVs.data());
+	}
+
+	void PMXModel::Update(glm::vec3* positions, glm::vec3* normals, glm::vec2* uvs)
 	{
 		auto& nodes = (*m_nodeMan.GetNodes());
 
@@ -288,35 +412,46 @@ namespace saba
 		{
 			m_transforms[i] = nodes[i]->GetGlobalTransform() * nodes[i]->GetInverseInitTransform();
 		}
+		if (!m_asset->m_sdefStream.m_vertices.empty())
+		{
+			for (size_t i = 0; i < nodes.size(); i++)
+			{
+				m_sdefRotations[i] = glm::quat_cast(nodes[i]->GetGlobalTransform());
+			}
+		}
+
+		// 頂点は GPU で更新する
+		if (m_gpuSkinning)
+		{
+			return;
+		}
 
 		if (m_parallelUpdateCount != m_updateRanges.size())
 		{
 			SetupParallelUpdate();
 		}
 
-		size_t futureCount = m_parallelUpdateFutures.size();
-		for (size_t i = 0; i < futureCount; i++)
+		VertexOutput output;
+		output.m_positions = positions;
+		output.m_normals = normals;
+		output.m_uvs = uvs;
+
+		auto& jobSystem = *Singleton<JobSystem>::Get();
+		JobGroup jobGroup;
+		for (size_t rangeIndex = 1; rangeIndex < m_updateRanges.size(); rangeIndex++)
 		{
-			size_t rangeIndex = i + 1;
 			if (m_updateRanges[rangeIndex].m_vertexCount != 0)
 			{
-				m_parallelUpdateFutures[i] = std::async(
-					std::launch::async,
-					[this, rangeIndex]() { this->Update(this->m_updateRanges[rangeIndex]); }
+				jobSystem.Run(
+					&jobGroup,
+					[this, rangeIndex, output]() { this->Update(this->m_updateRanges[rangeIndex], output); }
 				);
 			}
 		}
 
-		Update(m_updateRanges[0]);
+		Update(m_updateRanges[0], output);
 
-		for (size_t i = 0; i < futureCount; i++)
-		{
-			size_t rangeIndex = i + 1;
-			if (m_updateRanges[rangeIndex].m_vertexCount != 0)
-			{
-				m_parallelUpdateFutures[i].wait();
-			}
-		}
+		jobSystem.Wait(&jobGroup);
 	}
 
 	void PMXModel::SetParallelUpdateHint(uint32_t parallelCount)
@@ -324,172 +459,259 @@ namespace saba
 		m_parallelUpdateCount = parallelCount;
 	}
 
-	bool PMXModel::Load(const std::string& filepath, const std::string& mmdDataDir)
+	bool PMXModel::GetGPUSkinningData(MMDGPUSkinningData* data) const
 	{
-		Destroy();
-
-		PMXFile pmx;
-		if (!ReadPMXFile(&pmx, filepath.c_str()))
+		const size_t vtxCount = m_asset->m_positions.size();
+		if (vtxCount == 0)
 		{
 			return false;
 		}
 
-		std::string dirPath = PathUtil::GetDirectoryName(filepath);
-
-		size_t vertexCount = pmx.m_vertices.size();
-		m_positions.reserve(vertexCount);
-		m_normals.reserve(vertexCount);
-		m_uvs.reserve(vertexCount);
-		m_vertexBoneInfos.reserve(vertexCount);
-		m_bboxMax = glm::vec3(-std::numeric_limits<float>::max());
-		m_bboxMin = glm::vec3(std::numeric_limits<float>::max());
+		MMDGPUSkinningVertex initVtx;
+		initVtx.m_boneIndex = glm::ivec4(0);
+		initVtx.m_boneWeight = glm::vec4(0);
+		initVtx.m_sdefC = glm::vec3(0);
+		initVtx.m_sdefR0 = glm::vec3(0);
+		initVtx.m_sdefR1 = glm::vec3(0);
+		initVtx.m_skinningType = int32_t(MMDGPUSkinningType::Linear);
+		initVtx.m_positionMorph = glm::ivec2(0);
+		initVtx.m_uvMorph = glm::ivec2(0);
+		data->m_vertices.assign(vtxCount, initVtx);
 
-		bool warnSDEF = false;
-		bool infoQDEF = false;
-		for (const auto& v : pmx.m_vertices)
+		for (const auto& vtx : m_asset->m_weight1Stream.m_vertices)
 		{
-			glm::vec3 pos = v.m_position * glm::vec3(1, 1, -1);
-			glm::vec3 nor = v.m_normal * glm::vec3(1, 1, -1);
-			glm::vec2 uv = glm::vec2(v.m_uv.x, 1.0f - v.m_uv.y);
-			m_positions.push_back(pos);
-			m_normals.push_back(nor);
-			m_uvs.push_back(uv);
-			VertexBoneInfo vtxBoneInfo;
-			if (PMXVertexWeight::SDEF != v.m_weightType)
+			auto& dest = data->m_vertices[vtx.m_vertex];
+			dest.m_boneIndex.x = vtx.m_boneIndex;
+			dest.m_boneWeight.x = 1.0f;
+		}
+		for (const auto& vtx : m_asset->m_weight2Stream.m_vertices)
+		{
+			auto& dest = data->m_vertices[vtx.m_vertex];
+			const float w0 = DequantizeMMDSkinningWeight(vtx.m_boneWeight);
+			dest.m_boneIndex = glm::ivec4(vtx.m_boneIndex[0], vtx.m_boneIndex[1], 0, 0);
+			dest.m_boneWeight = glm::vec4(w0, 1.0f - w0, 0, 0);
+		}
+		auto setWeight4 = [data](const MMDSkinningWeight4& vtx, MMDGPUSkinningType skinningType)
+		{
+			auto& dest = data->m_vertices[vtx.m_vertex];
+			for (int bi = 0; bi < 4; bi++)
 			{
-				vtxBoneInfo.m_boneIndex[0] = v.m_boneIndices[0];
-				vtxBoneInfo.m_boneIndex[1] = v.m_boneIndices[1];
-				vtxBoneInfo.m_boneIndex[2] = v.m_boneIndices[2];
-				vtxBoneInfo.m_boneIndex[3] = v.m_boneIndices[3];
-
-				vtxBoneInfo.m_boneWeight[0] = v.m_boneWeights[0];
-				vtxBoneInfo.m_boneWeight[1] = v.m_boneWeights[1];
-				vtxBoneInfo.m_boneWeight[2] = v.m_boneWeights[2];
-				vtxBoneInfo.m_boneWeight[3] = v.m_boneWeights[3];
+				dest.m_boneIndex[bi] = vtx.m_boneIndex[bi];
+				dest.m_boneWeight[bi] = DequantizeMMDSkinningWeight(vtx.m_boneWeight[bi]);
 			}
+			dest.m_skinningType = int32_t(skinningType);
+		};
+		for (const auto& vtx : m_asset->m_weight4Stream.m_vertices)
+		{
+			setWeight4(vtx, MMDGPUSkinningType::Linear);
+		}
+		for (const auto& vtx : m_asset->m_dualQuaternionStream.m_vertices)
+		{
+			setWeight4(vtx, MMDGPUSkinningType::DualQuaternion);
+		}
+		for (const auto& vtx : m_asset->m_sdefStream.m_vertices)
+		{
+			auto& dest = data->m_vertices[vtx.m_vertex];
+			dest.m_boneIndex = glm::ivec4(vtx.m_boneIndex[0], vtx.m_boneIndex[1], 0, 0);
+			dest.m_boneWeight = glm::vec4(vtx.m_boneWeight, 1.0f - vtx.m_boneWeight, 0, 0);
+			dest.m_sdefC = vtx.m_sdefC;
+			dest.m_sdefR0 = vtx.m_sdefR0;
+			dest.m_sdefR1 = vtx.m_sdefR1;
+			dest.m_skinningType = int32_t(MMDGPUSkinningType::SDEF);
+		}
 
-			switch (v.m_weightType)
+		// モーフを頂点毎にまとめる
+		auto buildMorphList = [vtxCount](
+			const auto& morphDatas,
+			const auto& getMorphElements,
+			const auto& makeMorph,
+			size_t weightOffset,
+			glm::ivec2 MMDGPUSkinningVertex::*morphRange,
+			std::vector<MMDGPUSkinningVertex>* vertices,
+			std::vector<glm::vec4>* morphs
+			)
+		{
+			for (const auto& morphData : morphDatas)
 			{
-			case PMXVertexWeight::BDEF1:
-				vtxBoneInfo.m_skinningType = SkinningType::Weight1;
-				break;
-			case PMXVertexWeight::BDEF2:
-				vtxBoneInfo.m_skinningType = SkinningType::Weight2;
-				vtxBoneInfo.m_boneWeight[1] = 1.0f - vtxBoneInfo.m_boneWeight[0];
-				break;
-			case PMXVertexWeight::BDEF4:
-				vtxBoneInfo.m_skinningType = SkinningType::Weight4;
-				break;
-			case PMXVertexWeight::SDEF:
-				if (!warnSDEF)
-				{
-					SABA_WARN("Use SDEF");
-					warnSDEF = true;
-				}
-				vtxBoneInfo.m_skinningType = SkinningType::SDEF;
+				for (const auto& elem : getMorphElements(morphData))
 				{
-					auto i0 = v.m_boneIndices[0];
-					auto i1 = v.m_boneIndices[1];
-					auto w0 = v.m_boneWeights[0];
-					auto w1 = 1.0f - w0;
-
-					auto center = v.m_sdefC * glm::vec3(1, 1, -1);
-					auto r0 = v.m_sdefR0 * glm::vec3(1, 1, -1);
-					auto r1 = v.m_sdefR1 * glm::vec3(1, 1, -1);
-					auto rw = r0 * w0 + r1 * w1;
-					r0 = center + r0 - rw;
-					r1 = center + r1 - rw;
-					auto cr0 = (center + r0) * 0.5f;
-					auto cr1 = (center + r1) * 0.5f;
-
-					vtxBoneInfo.m_sdef.m_boneIndex[0] = v.m_boneIndices[0];
-					vtxBoneInfo.m_sdef.m_boneIndex[1] = v.m_boneIndices[1];
-					vtxBoneInfo.m_sdef.m_boneWeight = v.m_boneWeights[0];
-					vtxBoneInfo.m_sdef.m_sdefC = center;
-					vtxBoneInfo.m_sdef.m_sdefR0 = cr0;
-					vtxBoneInfo.m_sdef.m_sdefR1 = cr1;
+					if (elem.m_index < vtxCount)
+					{
+						((*vertices)[elem.m_index].*morphRange).y++;
+					}
 				}
-				break;
-			case PMXVertexWeight::QDEF:
-				vtxBoneInfo.m_skinningType = SkinningType::DualQuaternion;
-				if (!infoQDEF)
+			}
+			int32_t offset = 0;
+			for (auto& vtx : (*vertices))
+			{
+				(vtx.*morphRange).x = offset;
+				offset += (vtx.*morphRange).y;
+				(vtx.*morphRange).y = 0;
+			}
+			morphs->resize(offset);
+			for (size_t dataIdx = 0; dataIdx < morphDatas.size(); dataIdx++)
+			{
+				const float weightIndex = float(weightOffset + dataIdx);
+				for (const auto& elem : getMorphElements(morphDatas[dataIdx]))
 				{
-					SABA_INFO("Use QDEF");
-					infoQDEF = true;
+					if (elem.m_index < vtxCount)
+					{
+						auto& range = (*vertices)[elem.m_index].*morphRange;
+						(*morphs)[range.x + range.y] = makeMorph(elem, weightIndex);
+						range.y++;
+					}
 				}
-				break;
-			default:
-				vtxBoneInfo.m_skinningType = SkinningType::Weight1;
-				SABA_ERROR("Unknown PMX Vertex Weight Type: {}", (int)v.m_weightType);
-				break;
 			}
-			m_vertexBoneInfos.push_back(vtxBoneInfo);
+		};
+		buildMorphList(
+			m_asset->m_positionMorphDatas,
+			[](const PositionMorphData& morphData) -> const auto& { return morphData.m_morphVertices; },
+			[](const PositionMorph& morph, float weightIndex) { return glm::vec4(morph.m_position, weightIndex); },
+			0,
+			&MMDGPUSkinningVertex::m_positionMorph,
+			&data->m_vertices,
+			&data->m_positionMorphs
+		);
+		buildMorphList(
+			m_asset->m_uvMorphDatas,
+			[](const UVMorphData& morphData) -> const auto& { return morphData.m_morphUVs; },
+			[](const UVMorph& morph, float weightIndex) { return glm::vec4(morph.m_uv.x, morph.m_uv.y, weightIndex, 0); },
+			m_asset->m_positionMorphDatas.size(),
+			&MMDGPUSkinningVertex::m_uvMorph,
+			&data->m_vertices,
+			&data->m_uvMorphs
+		);
+		data->m_morphWeightCount = m_asset->m_positionMorphDatas.size() + m_asset->m_uvMorphDatas.size();
 
-			m_bboxMax = glm::max(m_bboxMax, pos);
-			m_bboxMin = glm::min(m_bboxMin, pos);
+		return true;
+	}
+
+	void PMXModel::EnableGPUSkinning(bool enable)
+	{
+		m_gpuSkinning = enable;
+		m_morphWeights.assign(m_asset->m_positionMorphDatas.size() + m_asset->m_uvMorphDatas.size(), 0.0f);
+	}
+
+	const glm::quat* PMXModel::GetSDEFRotations() const
+	{
+		if (m_asset->m_sdefStream.m_vertices.empty())
+		{
+			return nullptr;
 		}
-		m_morphPositions.resize(m_positions.size());
-		m_morphUVs.resize(m_positions.size());
-		m_updatePositions.resize(m_positions.size());
-		m_updateNormals.resize(m_normals.size());
-		m_updateUVs.resize(m_uvs.size());
+		return m_sdefRotations.data();
+	}
 
+	bool PMXModel::Load(const std::string& filepath, const std::string& mmdDataDir)
+	{
+		return Load(filepath, mmdDataDir, std::string());
+	}
 
-		m_indexElementSize = pmx.m_header.m_vertexIndexSize;
-		m_indices.resize(pmx.m_faces.size() * 3 * m_indexElementSize);
-		m_indexCount = pmx.m_faces.size() * 3;
-		switch (m_indexElementSize)
+	bool PMXModel::Load(const std::string& filepath, const std::string& mmdDataDir, const std::string& cachePath)
+	{
+		Destroy();
+
+		auto asset = LoadAsset(filepath, mmdDataDir, cachePath);
+		if (asset == nullptr)
 		{
-		case 1:
+			return false;
+		}
+		return Create(asset);
+	}
+
+	PMXModel::AssetPtr PMXModel::LoadAsset(const std::string& filepath, const std::string& mmdDataDir, const std::string& cachePath)
+	{
+		MappedFile pmxData;
+		if (!pmxData.Open(filepath))
 		{
-			int idx = 0;
-			uint8_t* indices = (uint8_t*)m_indices.data();
-			for (const auto& face : pmx.m_faces)
-			{
-				for (int i = 0; i < 3; i++)
-				{
-					auto vi = face.m_vertices[3 - i - 1];
-					indices[idx] = (uint8_t)vi;
-					idx++;
-				}
-			}
-			break;
+			SABA_INFO("PMX File Open Fail. {}", filepath);
+			return nullptr;
 		}
-		case 2:
+
+		// テクスチャのパスはディレクトリで変わるので、キーに含める
+		std::string dirPath = PathUtil::GetDirectoryName(filepath);
+		PMXModelAssetCache::Key assetKey;
+		assetKey.m_dirPath = dirPath;
+		assetKey.m_mmdDataDir = mmdDataDir;
+		assetKey.m_sourceSize = pmxData.GetSize();
+		assetKey.m_sourceHash = CalcHash64(pmxData.GetData(), pmxData.GetSize());
+		auto& assetCache = *Singleton<PMXModelAssetCache>::Get();
+		if (auto sharedAsset = assetCache.Find(assetKey))
 		{
-			int idx = 0;
-			uint16_t* indices = (uint16_t*)m_indices.data();
-			for (const auto& face : pmx.m_faces)
-			{
-				for (int i = 0; i < 3; i++)
-				{
-					auto vi = face.m_vertices[3 - i - 1];
-					indices[idx] = (uint16_t)vi;
-					idx++;
-				}
+			SABA_INFO("PMX Asset Shared. {}", filepath);
+			return sharedAsset;
+		}
+
+		auto asset = std::make_shared<Asset>();
+
+		// キャッシュが有効なら、頂点と面は PMX から読まずにキャッシュから復元する
+		const uint64_t sourceHash = assetKey.m_sourceHash;
+		bool useCache = false;
+		if (!cachePath.empty())
+		{
+			useCache = asset->LoadMeshCache(cachePath, pmxData.GetSize(), sourceHash);
+		}
+
+		PMXFile pmx;
+		if (!ReadPMXFile(&pmx, pmxData.GetData(), pmxData.GetSize(), useCache))
+		{
+			SABA_INFO("PMX File Read Fail. {}", filepath);
+			return nullptr;
+		}
+		SABA_INFO("PMX File Read Successed. {}", filepath);
+
+		if (pmx.m_bones.size() > MMDSkinningMaxBoneCount)
+		{
+			SABA_ERROR("PMX Bone Count is too large: {} (max {})", pmx.m_bones.size(), MMDSkinningMaxBoneCount);
+			return nullptr;
+		}
+
+		if (useCache && !asset->ValidateMeshCache(pmx))
+		{
+			// 壊れたキャッシュは使わずに PMX から読み直して作り直す
+			SABA_WARN("PMX Model Cache is broken. {}", cachePath);
+			asset->ClearMesh();
+			useCache = false;
+			pmx = PMXFile();
+			if (!ReadPMXFile(&pmx, pmxData.GetData(), pmxData.GetSize(), false))
+			{
+				SABA_INFO("PMX File Read Fail. {}", filepath);
+				return nullptr;
 			}
-			break;
 		}
-		case 4:
+
+		if (!useCache)
 		{
-			int idx = 0;
-			uint32_t* indices = (uint32_t*)m_indices.data();
-			for (const auto& face : pmx.m_faces)
+			if (!asset->LoadMesh(pmx))
 			{
-				for (int i = 0; i < 3; i++)
-				{
-					auto vi = face.m_vertices[3 - i - 1];
-					indices[idx] = (uint32_t)vi;
-					idx++;
-				}
+				return nullptr;
 			}
-			break;
 		}
-		default:
-			SABA_ERROR("Unsupported Index Size: [{}]", m_indexElementSize);
-			return false;
+
+		asset->LoadMaterials(pmx, dirPath, mmdDataDir);
+		asset->LoadMorphs(pmx);
+
+		if (!cachePath.empty() && !useCache)
+		{
+			asset->SaveMeshCache(cachePath, pmxData.GetSize(), sourceHash);
+		}
+
+		// 変換済みの頂点、面、モーフの要素は PMXFile に残さない
+		ReleaseVector(&pmx.m_vertices);
+		ReleaseVector(&pmx.m_faces);
+		for (auto& pmxMorph : pmx.m_morphs)
+		{
+			ReleaseVector(&pmxMorph.m_positionMorph);
+			ReleaseVector(&pmxMorph.m_uvMorph);
+			ReleaseVector(&pmxMorph.m_materialMorph);
+			ReleaseVector(&pmxMorph.m_groupMorph);
 		}
+		asset->m_pmx = std::move(pmx);
+
+		return assetCache.Add(assetKey, asset);
+	}
 
+	void PMXModel::Asset::LoadMaterials(const PMXFile& pmx, const std::string& dirPath, const std::string& mmdDataDir)
+	{
 		std::vector<std::string> texturePaths;
 		texturePaths.reserve(pmx.m_textures.size());
 		for (const auto& pmxTex : pmx.m_textures)
@@ -572,7 +794,156 @@ namespace saba
 
 			beginIndex = beginIndex + pmxMat.m_numFaceVertices;
 		}
-		m_initMaterials = m_materials;
+	}
+
+	void PMXModel::Asset::LoadMorphs(const PMXFile& pmx)
+	{
+		size_t boneMorphCount = 0;
+		m_morphs.reserve(pmx.m_morphs.size());
+		for (const auto& pmxMorph : pmx.m_morphs)
+		{
+			MorphInfo morph;
+			morph.m_morphType = MorphType::None;
+			morph.m_dataIndex = 0;
+			if (pmxMorph.m_morphType == PMXMorphType::Position)
+			{
+				morph.m_morphType = MorphType::Position;
+				morph.m_dataIndex = m_positionMorphDatas.size();
+				PositionMorphData morphData;
+				morphData.m_vertexBegin = std::numeric_limits<uint32_t>::max();
+				morphData.m_vertexEnd = 0;
+				for (const auto& vtx : pmxMorph.m_positionMorph)
+				{
+					PositionMorph morphVtx;
+					morphVtx.m_index = vtx.m_vertexIndex;
+					morphVtx.m_position = vtx.m_position * glm::vec3(1, 1, -1);
+					morphData.m_morphVertices.push_back(morphVtx);
+					morphData.m_vertexBegin = std::min(morphData.m_vertexBegin, morphVtx.m_index);
+					morphData.m_vertexEnd = std::max(morphData.m_vertexEnd, morphVtx.m_index + 1);
+				}
+				m_positionMorphDatas.emplace_back(std::move(morphData));
+			}
+			else if (pmxMorph.m_morphType == PMXMorphType::UV)
+			{
+				morph.m_morphType = MorphType::UV;
+				morph.m_dataIndex = m_uvMorphDatas.size();
+				UVMorphData morphData;
+				morphData.m_vertexBegin = std::numeric_limits<uint32_t>::max();
+				morphData.m_vertexEnd = 0;
+				for (const auto& uv : pmxMorph.m_uvMorph)
+				{
+					UVMorph morphUV;
+					morphUV.m_index = uv.m_vertexIndex;
+					morphUV.m_uv = uv.m_uv;
+					morphData.m_morphUVs.push_back(morphUV);
+					morphData.m_vertexBegin = std::min(morphData.m_vertexBegin, morphUV.m_index);
+					morphData.m_vertexEnd = std::max(morphData.m_vertexEnd, morphUV.m_index + 1);
+				}
+				m_uvMorphDatas.emplace_back(std::move(morphData));
+			}
+			else if (pmxMorph.m_morphType == PMXMorphType::Material)
+			{
+				morph.m_morphType = MorphType::Material;
+				morph.m_dataIndex = m_materialMorphDatas.size();
+
+				MaterialMorphData materialMorphData;
+				materialMorphData.m_materialMorphs = pmxMorph.m_materialMorph;
+				m_materialMorphDatas.emplace_back(materialMorphData);
+			}
+			else if (pmxMorph.m_morphType == PMXMorphType::Bone)
+			{
+				morph.m_morphType = MorphType::Bone;
+				// ボーンモーフのデータはノードを参照するので、インスタンス毎に作る
+				morph.m_dataIndex = boneMorphCount;
+				boneMorphCount++;
+			}
+			else if (pmxMorph.m_morphType == PMXMorphType::Group)
+			{
+				morph.m_morphType = MorphType::Group;
+				morph.m_dataIndex = m_groupMorphDatas.size();
+
+				GroupMorphData groupMorphData;
+				groupMorphData.m_groupMorphs = pmxMorph.m_groupMorph;
+				m_groupMorphDatas.emplace_back(groupMorphData);
+			}
+			else
+			{
+				SABA_WARN("Not Supported Morp Type({}): [{}]",
+					(uint8_t)pmxMorph.m_morphType,
+					pmxMorph.m_name
+				);
+			}
+			m_morphs.push_back(morph);
+		}
+
+		// Check whether Group Morph infinite loop.
+		{
+			std::vector<int32_t> groupMorphStack;
+			std::function<void(int32_t)> fixInifinitGropuMorph;
+			fixInifinitGropuMorph = [this, &pmx, &fixInifinitGropuMorph, &groupMorphStack](int32_t morphIdx)
+			{
+				const auto& morph = m_morphs[morphIdx];
+
+				if (morph.m_morphType == MorphType::Group)
+				{
+					auto& groupMorphData = m_groupMorphDatas[morph.m_dataIndex];
+					for (size_t i = 0; i < groupMorphData.m_groupMorphs.size(); i++)
+					{
+						auto& groupMorph = groupMorphData.m_groupMorphs[i];
+
+						auto findIt = std::find(
+							groupMorphStack.begin(),
+							groupMorphStack.end(),
+							groupMorph.m_morphIndex
+						);
+						if (findIt != groupMorphStack.end())
+						{
+							SABA_WARN("Infinit Group Morph:[{}][{}][{}]",
+								morphIdx, pmx.m_morphs[morphIdx].m_name, i
+							);
+							groupMorph.m_morphIndex = -1;
+						}
+						else
+						{
+							groupMorphStack.push_back(morphIdx);
+							if (groupMorph.m_morphIndex>0)
+								fixInifinitGropuMorph(groupMorph.m_morphIndex);
+							else
+								SABA_ERROR("Invalid morph index: group={}, morph={}", groupMorph.m_morphIndex, morphIdx);
+							groupMorphStack.pop_back();
+						}
+					}
+				}
+			};
+
+			for (int32_t morphIdx = 0; morphIdx < int32_t(m_morphs.size()); morphIdx++)
+			{
+				fixInifinitGropuMorph(morphIdx);
+				groupMorphStack.clear();
+			}
+
+		}
+	}
+
+	bool PMXModel::Create(const AssetPtr& asset)
+	{
+		Destroy();
+
+		if (asset == nullptr)
+		{
+			return false;
+		}
+		m_asset = asset;
+		const PMXFile& pmx = asset->m_pmx;
+
+		const size_t vertexCount = asset->m_positions.size();
+		m_morphPositions.resize(vertexCount);
+		m_morphUVs.resize(vertexCount);
+		m_updatePositions.resize(vertexCount);
+		m_updateNormals.resize(vertexCount);
+		m_updateUVs.resize(vertexCount);
+
+		m_materials = asset->m_materials;
 		m_mulMaterialFactors.resize(m_materials.size());
 		m_addMaterialFactors.resize(m_materials.size());
 
@@ -659,7 +1030,9 @@ namespace saba
 			}
 			node->SaveInitialTRS();
 		}
+		m_nodeHierarchy.Build(*m_nodeMan.GetNodes());
 		m_transforms.resize(m_nodeMan.GetNodeCount());
+		m_sdefRotations.resize(m_nodeMan.GetNodeCount());
 
 		m_sortedNodes.clear();
 		m_sortedNodes.reserve(m_nodeMan.GetNodeCount());
@@ -716,54 +1089,16 @@ namespace saba
 		}
 
 		// Morph
-		for (const auto& pmxMorph : pmx.m_morphs)
+		for (size_t morphIdx = 0; morphIdx < pmx.m_morphs.size(); morphIdx++)
 		{
+			const auto& pmxMorph = pmx.m_morphs[morphIdx];
 			auto morph = m_morphMan.AddMorph();
 			morph->SetName(pmxMorph.m_name);
 			morph->SetWeight(0.0f);
-			morph->m_morphType = MorphType::None;
-			if (pmxMorph.m_morphType == PMXMorphType::Position)
-			{
-				morph->m_morphType = MorphType::Position;
-				morph->m_dataIndex = m_positionMorphDatas.size();
-				PositionMorphData morphData;
-				for (const auto& vtx : pmxMorph.m_positionMorph)
-				{
-					PositionMorph morphVtx;
-					morphVtx.m_index = vtx.m_vertexIndex;
-					morphVtx.m_position = vtx.m_position * glm::vec3(1, 1, -1);
-					morphData.m_morphVertices.push_back(morphVtx);
-				}
-				m_positionMorphDatas.emplace_back(std::move(morphData));
-			}
-			else if (pmxMorph.m_morphType == PMXMorphType::UV)
-			{
-				morph->m_morphType = MorphType::UV;
-				morph->m_dataIndex = m_uvMorphDatas.size();
-				UVMorphData morphData;
-				for (const auto& uv : pmxMorph.m_uvMorph)
-				{
-					UVMorph morphUV;
-					morphUV.m_index = uv.m_vertexIndex;
-					morphUV.m_uv = uv.m_uv;
-					morphData.m_morphUVs.push_back(morphUV);
-				}
-				m_uvMorphDatas.emplace_back(std::move(morphData));
-			}
-			else if (pmxMorph.m_morphType == PMXMorphType::Material)
+			morph->m_morphType = asset->m_morphs[morphIdx].m_morphType;
+			morph->m_dataIndex = asset->m_morphs[morphIdx].m_dataIndex;
+			if (morph->m_morphType == MorphType::Bone)
 			{
-				morph->m_morphType = MorphType::Material;
-				morph->m_dataIndex = m_materialMorphDatas.size();
-
-				MaterialMorphData materialMorphData;
-				materialMorphData.m_materialMorphs = pmxMorph.m_materialMorph;
-				m_materialMorphDatas.emplace_back(materialMorphData);
-			}
-			else if (pmxMorph.m_morphType == PMXMorphType::Bone)
-			{
-				morph->m_morphType = MorphType::Bone;
-				morph->m_dataIndex = m_boneMorphDatas.size();
-
 				BoneMorphData boneMorphData;
 				for (const auto& pmxBoneMorphElem : pmxMorph.m_boneMorph)
 				{
@@ -779,71 +1114,6 @@ namespace saba
 				}
 				m_boneMorphDatas.emplace_back(boneMorphData);
 			}
-			else if (pmxMorph.m_morphType == PMXMorphType::Group)
-			{
-				morph->m_morphType = MorphType::Group;
-				morph->m_dataIndex = m_groupMorphDatas.size();
-
-				GroupMorphData groupMorphData;
-				groupMorphData.m_groupMorphs = pmxMorph.m_groupMorph;
-				m_groupMorphDatas.emplace_back(groupMorphData);
-			}
-			else
-			{
-				SABA_WARN("Not Supported Morp Type({}): [{}]",
-					(uint8_t)pmxMorph.m_morphType,
-					pmxMorph.m_name
-				);
-			}
-		}
-
-		// Check whether Group Morph infinite loop.
-		{
-			std::vector<int32_t> groupMorphStack;
-			std::function<void(int32_t)> fixInifinitGropuMorph;
-			fixInifinitGropuMorph = [this, &fixInifinitGropuMorph, &groupMorphStack](int32_t morphIdx)
-			{
-				const auto& morphs = (*m_morphMan.GetMorphs());
-				const auto& morph = morphs[morphIdx];
-
-				if (morph->m_morphType == MorphType::Group)
-				{
-					auto& groupMorphData = m_groupMorphDatas[morph->m_dataIndex];
-					for (size_t i = 0; i < groupMorphData.m_groupMorphs.size(); i++)
-					{
-						auto& groupMorph = groupMorphData.m_groupMorphs[i];
-
-						auto findIt = std::find(
-							groupMorphStack.begin(),
-							groupMorphStack.end(),
-							groupMorph.m_morphIndex
-						);
-						if (findIt != groupMorphStack.end())
-						{
-							SABA_WARN("Infinit Group Morph:[{}][{}][{}]",
-								morphIdx, morph->GetName(), i
-							);
-							groupMorph.m_morphIndex = -1;
-						}
-						else
-						{
-							groupMorphStack.push_back(morphIdx);
-							if (groupMorph.m_morphIndex>0)
-								fixInifinitGropuMorph(groupMorph.m_morphIndex);
-							else
-								SABA_ERROR("Invalid morph index: group={}, morph={}", groupMorph.m_morphIndex, morphIdx);
-							groupMorphStack.pop_back();
-						}
-					}
-				}
-			};
-
-			for (int32_t morphIdx = 0; morphIdx < int32_t(m_morphMan.GetMorphCount()); morphIdx++)
-			{
-				fixInifinitGropuMorph(morphIdx);
-				groupMorphStack.clear();
-			}
-
 		}
 
 		// Physics
@@ -896,6 +1166,10 @@ namespace saba
 			}
 		}
 
+		m_nodeMan.BuildNameIndex();
+		m_ikSolverMan.BuildNameIndex();
+		m_morphMan.BuildNameIndex();
+
 		ResetPhysics();
 
 		SetupParallelUpdate();
@@ -903,42 +1177,453 @@ namespace saba
 		return true;
 	}
 
-	void PMXModel::Destroy()
+	bool PMXModel::Asset::LoadMesh(const PMXFile& pmx)
 	{
-		m_materials.clear();
-		m_subMeshes.clear();
-
-		m_positions.clear();
-		m_normals.clear();
-		m_uvs.clear();
-		m_vertexBoneInfos.clear();
+		size_t vertexCount = pmx.m_vertices.size();
+		m_positions.reserve(vertexCount);
+		m_normals.reserve(vertexCount);
+		m_uvs.reserve(vertexCount);
+		m_bboxMax = glm::vec3(-std::numeric_limits<float>::max());
+		m_bboxMin = glm::vec3(std::numeric_limits<float>::max());
 
-		m_indices.clear();
+		// 無効なボーン (-1) はウェイト 0 でボーン 0 を参照させる
+		auto toBoneIndex = [](int32_t boneIndex) -> uint16_t
+		{
+			return boneIndex < 0 ? uint16_t(0) : uint16_t(boneIndex);
+		};
+		auto toBoneWeight = [](int32_t boneIndex, float weight) -> uint16_t
+		{
+			return boneIndex < 0 ? uint16_t(0) : QuantizeMMDSkinningWeight(weight);
+		};
 
+		bool warnSDEF = false;
+		bool infoQDEF = false;
+		for (const auto& v : pmx.m_vertices)
+		{
+			glm::vec3 pos = v.m_position * glm::vec3(1, 1, -1);
+			glm::vec3 nor = v.m_normal * glm::vec3(1, 1, -1);
+			glm::vec2 uv = glm::vec2(v.m_uv.x, 1.0f - v.m_uv.y);
+			const uint32_t vtxIdx = uint32_t(m_positions.size());
+			m_positions.push_back(pos);
+			m_normals.push_back(nor);
+			m_uvs.push_back(uv);
+
+			MMDSkinningWeight4 weight4;
+			weight4.m_vertex = vtxIdx;
+			for (int bi = 0; bi < 4; bi++)
+			{
+				weight4.m_boneIndex[bi] = toBoneIndex(v.m_boneIndices[bi]);
+				weight4.m_boneWeight[bi] = toBoneWeight(v.m_boneIndices[bi], v.m_boneWeights[bi]);
+			}
+
+			switch (v.m_weightType)
+			{
+			case PMXVertexWeight::BDEF1:
+			{
+				MMDSkinningWeight1 weight1;
+				weight1.m_vertex = vtxIdx;
+				weight1.m_boneIndex = toBoneIndex(v.m_boneIndices[0]);
+				weight1.m_padding = 0;
+				m_weight1Stream.Add(weight1, pos, nor);
+				break;
+			}
+			case PMXVertexWeight::BDEF2:
+			{
+				MMDSkinningWeight2 weight2;
+				weight2.m_vertex = vtxIdx;
+				weight2.m_boneIndex[0] = toBoneIndex(v.m_boneIndices[0]);
+				weight2.m_boneIndex[1] = toBoneIndex(v.m_boneIndices[1]);
+				weight2.m_boneWeight = QuantizeMMDSkinningWeight(v.m_boneWeights[0]);
+				weight2.m_padding = 0;
+				m_weight2Stream.Add(weight2, pos, nor);
+				break;
+			}
+			case PMXVertexWeight::BDEF4:
+				m_weight4Stream.Add(weight4, pos, nor);
+				break;
+			case PMXVertexWeight::SDEF:
+				if (!warnSDEF)
+				{
+					SABA_WARN("Use SDEF");
+					warnSDEF = true;
+				}
+				{
+					auto w0 = v.m_boneWeights[0];
+					auto w1 = 1.0f - w0;
+
+					auto center = v.m_sdefC * glm::vec3(1, 1, -1);
+					auto r0 = v.m_sdefR0 * glm::vec3(1, 1, -1);
+					auto r1 = v.m_sdefR1 * glm::vec3(1, 1, -1);
+					auto rw = r0 * w0 + r1 * w1;
+					r0 = center + r0 - rw;
+					r1 = center + r1 - rw;
+					auto cr0 = (center + r0) * 0.5f;
+					auto cr1 = (center + r1) * 0.5f;
+
+					SDEFVertex sdef;
+					sdef.m_vertex = vtxIdx;
+					sdef.m_boneIndex[0] = toBoneIndex(v.m_boneIndices[0]);
+					sdef.m_boneIndex[1] = toBoneIndex(v.m_boneIndices[1]);
+					sdef.m_boneWeight = w0;
+					sdef.m_sdefC = center;
+					sdef.m_sdefR0 = cr0;
+					sdef.m_sdefR1 = cr1;
+					m_sdefStream.Add(sdef, pos, nor);
+				}
+				break;
+			case PMXVertexWeight::QDEF:
+				if (!infoQDEF)
+				{
+					SABA_INFO("Use QDEF");
+					infoQDEF = true;
+				}
+				m_dualQuaternionStream.Add(weight4, pos, nor);
+				break;
+			default:
+			{
+				SABA_ERROR("Unknown PMX Vertex Weight Type: {}", (int)v.m_weightType);
+				MMDSkinningWeight1 weight1;
+				weight1.m_vertex = vtxIdx;
+				weight1.m_boneIndex = toBoneIndex(v.m_boneIndices[0]);
+				weight1.m_padding = 0;
+				m_weight1Stream.Add(weight1, pos, nor);
+				break;
+			}
+			}
+
+			m_bboxMax = glm::max(m_bboxMax, pos);
+			m_bboxMin = glm::min(m_bboxMin, pos);
+		}
+		SABA_INFO("PMX Skinning Vertices : BDEF1 {}, BDEF2 {}, BDEF4 {}, SDEF {}, QDEF {}",
+			m_weight1Stream.m_vertices.size(),
+			m_weight2Stream.m_vertices.size(),
+			m_weight4Stream.m_vertices.size(),
+			m_sdefStream.m_vertices.size(),
+			m_dualQuaternionStream.m_vertices.size()
+		);
+
+		m_indexElementSize = pmx.m_header.m_vertexIndexSize;
+		m_indices.resize(pmx.m_faces.size() * 3 * m_indexElementSize);
+		m_indexCount = pmx.m_faces.size() * 3;
+		switch (m_indexElementSize)
+		{
+		case 1:
+		{
+			int idx = 0;
+			uint8_t* indices = (uint8_t*)m_indices.data();
+			for (const auto& face : pmx.m_faces)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					auto vi = face.m_vertices[3 - i - 1];
+					indices[idx] = (uint8_t)vi;
+					idx++;
+				}
+			}
+			break;
+		}
+		case 2:
+		{
+			int idx = 0;
+			uint16_t* indices = (uint16_t*)m_indices.data();
+			for (const auto& face : pmx.m_faces)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					auto vi = face.m_vertices[3 - i - 1];
+					indices[idx] = (uint16_t)vi;
+					idx++;
+				}
+			}
+			break;
+		}
+		case 4:
+		{
+			int idx = 0;
+			uint32_t* indices = (uint32_t*)m_indices.data();
+			for (const auto& face : pmx.m_faces)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					auto vi = face.m_vertices[3 - i - 1];
+					indices[idx] = (uint32_t)vi;
+					idx++;
+				}
+			}
+			break;
+		}
+		default:
+			SABA_ERROR("Unsupported Index Size: [{}]", m_indexElementSize);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool PMXModel::Asset::LoadMeshCache(const std::string& cachePath, uint64_t sourceSize, uint64_t sourceHash)
+	{
+		MMDModelCacheReader reader;
+		if (!reader.Open(cachePath, PMXModelCacheFormat, sourceSize, sourceHash))
+		{
+			return false;
+		}
+
+		PMXModelCacheMeshInfo meshInfo;
+		bool ret = reader.ReadValue(PMXModelCacheSection::MeshInfo, &meshInfo)
+			&& reader.ReadSection(PMXModelCacheSection::Positions, &m_positions)
+			&& reader.ReadSection(PMXModelCacheSection::Normals, &m_normals)
+			&& reader.ReadSection(PMXModelCacheSection::UVs, &m_uvs)
+			&& reader.ReadSection(PMXModelCacheSection::Indices, &m_indices)
+			&& ReadSkinningStream(reader, PMXModelCacheSection::Weight1, &m_weight1Stream)
+			&& ReadSkinningStream(reader, PMXModelCacheSection::Weight2, &m_weight2Stream)
+			&& ReadSkinningStream(reader, PMXModelCacheSection::Weight4, &m_weight4Stream)
+			&& ReadSkinningStream(reader, PMXModelCacheSection::SDEF, &m_sdefStream)
+			&& ReadSkinningStream(reader, PMXModelCacheSection::DualQuaternion, &m_dualQuaternionStream);
+		if (!ret)
+		{
+			SABA_INFO("PMX Model Cache Read Fail. {}", cachePath);
+			ClearMesh();
+			return false;
+		}
+
+		m_indexCount = meshInfo.m_indexCount;
+		m_indexElementSize = meshInfo.m_indexElementSize;
+		m_bboxMin = meshInfo.m_bboxMin;
+		m_bboxMax = meshInfo.m_bboxMax;
+
+		SABA_INFO("PMX Model Cache Read Successed. {}", cachePath);
+
+		return true;
+	}
+
+	bool PMXModel::Asset::ValidateMeshCache(const PMXFile& pmx) const
+	{
+		const size_t vertexCount = m_positions.size();
+		if (m_normals.size() != vertexCount || m_uvs.size() != vertexCount)
+		{
+			return false;
+		}
+
+		if (m_indexElementSize != pmx.m_header.m_vertexIndexSize ||
+			m_indices.size() != m_indexCount * m_indexElementSize)
+		{
+			return false;
+		}
+
+		// 描画で範囲外を参照しないように、面の頂点番号を確認する
+		auto isValidIndices = [this, vertexCount](auto indices)
+		{
+			for (size_t i = 0; i < m_indexCount; i++)
+			{
+				if (size_t(indices[i]) >= vertexCount)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+		bool validIndices = false;
+		switch (m_indexElementSize)
+		{
+		case 1:
+			validIndices = isValidIndices((const uint8_t*)m_indices.data());
+			break;
+		case 2:
+			validIndices = isValidIndices((const uint16_t*)m_indices.data());
+			break;
+		case 4:
+			validIndices = isValidIndices((const uint32_t*)m_indices.data());
+			break;
+		default:
+			break;
+		}
+		if (!validIndices)
+		{
+			return false;
+		}
+
+		// 各マテリアルのサブメッシュ [beginIndex, beginIndex + numFaceVertices) が面の範囲に収まる
+		size_t beginIndex = 0;
+		for (const auto& pmxMat : pmx.m_materials)
+		{
+			if (pmxMat.m_numFaceVertices < 0 ||
+				size_t(pmxMat.m_numFaceVertices) > m_indexCount - beginIndex)
+			{
+				return false;
+			}
+			beginIndex += size_t(pmxMat.m_numFaceVertices);
+		}
+
+		// 各頂点はいずれかのスキニングの頂点リストに含まれる
+		const size_t skinningVertexCount =
+			m_weight1Stream.m_vertices.size() +
+			m_weight2Stream.m_vertices.size() +
+			m_weight4Stream.m_vertices.size() +
+			m_sdefStream.m_vertices.size() +
+			m_dualQuaternionStream.m_vertices.size();
+		if (skinningVertexCount != vertexCount)
+		{
+			return false;
+		}
+
+		// SetupParallelUpdate は頂点リストを二分探索して分割するので、頂点の番号順に並んでいる必要がある
+		auto isSorted = [](const auto& vertices)
+		{
+			return std::adjacent_find(
+				vertices.begin(),
+				vertices.end(),
+				[](const auto& v0, const auto& v1) { return v0.m_vertex >= v1.m_vertex; }
+			) == vertices.end();
+		};
+		if (!isSorted(m_weight1Stream.m_vertices) ||
+			!isSorted(m_weight2Stream.m_vertices) ||
+			!isSorted(m_weight4Stream.m_vertices) ||
+			!isSorted(m_sdefStream.m_vertices) ||
+			!isSorted(m_dualQuaternionStream.m_vertices))
+		{
+			return false;
+		}
+
+		// スキニングで範囲外を参照しないように、頂点とボーンの番号を確認する
+		const size_t boneCount = std::max(pmx.m_bones.size(), size_t(1));
+		auto isValid = [vertexCount, boneCount](uint32_t vertex, const uint16_t* boneIndices, size_t boneIndexCount)
+		{
+			if (vertex >= vertexCount)
+			{
+				return false;
+			}
+			for (size_t i = 0; i < boneIndexCount; i++)
+			{
+				if (boneIndices[i] >= boneCount)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+		for (const auto& v : m_weight1Stream.m_vertices)
+		{
+			if (!isValid(v.m_vertex, &v.m_boneIndex, 1)) { return false; }
+		}
+		for (const auto& v : m_weight2Stream.m_vertices)
+		{
+			if (!isValid(v.m_vertex, v.m_boneIndex, 2)) { return false; }
+		}
+		for (const auto& v : m_weight4Stream.m_vertices)
+		{
+			if (!isValid(v.m_vertex, v.m_boneIndex, 4)) { return false; }
+		}
+		for (const auto& v : m_sdefStream.m_vertices)
+		{
+			if (!isValid(v.m_vertex, v.m_boneIndex, 2)) { return false; }
+		}
+		for (const auto& v : m_dualQuaternionStream.m_vertices)
+		{
+			if (!isValid(v.m_vertex, v.m_boneIndex, 4)) { return false; }
+		}
+
+		return true;
+	}
+
+	void PMXModel::Asset::SaveMeshCache(const std::string& cachePath, uint64_t sourceSize, uint64_t sourceHash) const
+	{
+		PMXModelCacheMeshInfo meshInfo;
+		meshInfo.m_vertexCount = uint32_t(m_positions.size());
+		meshInfo.m_indexCount = uint32_t(m_indexCount);
+		meshInfo.m_indexElementSize = uint32_t(m_indexElementSize);
+		meshInfo.m_reserved = 0;
+		meshInfo.m_bboxMin = m_bboxMin;
+		meshInfo.m_bboxMax = m_bboxMax;
+
+		MMDModelCacheWriter writer;
+		writer.AddValue(PMXModelCacheSection::MeshInfo, meshInfo);
+		writer.AddSection(PMXModelCacheSection::Positions, m_positions);
+		writer.AddSection(PMXModelCacheSection::Normals, m_normals);
+		writer.AddSection(PMXModelCacheSection::UVs, m_uvs);
+		writer.AddSection(PMXModelCacheSection::Indices, m_indices);
+		AddSkinningStream(&writer, PMXModelCacheSection::Weight1, m_weight1Stream);
+		AddSkinningStream(&writer, PMXModelCacheSection::Weight2, m_weight2Stream);
+		AddSkinningStream(&writer, PMXModelCacheSection::Weight4, m_weight4Stream);
+		AddSkinningStream(&writer, PMXModelCacheSection::SDEF, m_sdefStream);
+		AddSkinningStream(&writer, PMXModelCacheSection::DualQuaternion, m_dualQuaternionStream);
+
+		if (writer.Save(cachePath, PMXModelCacheFormat, sourceSize, sourceHash))
+		{
+			SABA_INFO("PMX Model Cache Saved. {}", cachePath);
+		}
+	}
+
+	void PMXModel::Asset::ClearMesh()
+	{
+		m_positions.clear();
+		m_normals.clear();
+		m_uvs.clear();
+		m_weight1Stream.Clear();
+		m_weight2Stream.Clear();
+		m_weight4Stream.Clear();
+		m_sdefStream.Clear();
+		m_dualQuaternionStream.Clear();
+		m_indices.clear();
+		m_indexCount = 0;
+		m_indexElementSize = 0;
+	}
+
+	std::shared_ptr<const void> PMXModel::GetSharedMeshData() const
+	{
+		if (m_asset == GetEmptyAsset())
+		{
+			return nullptr;
+		}
+		return m_asset;
+	}
+
+	void PMXModel::Destroy()
+	{
+		// 共有している Asset は、最後のインスタンスが手放したときに破棄される
+		m_asset = GetEmptyAsset();
+
+		m_materials.clear();
+		m_mulMaterialFactors.clear();
+		m_addMaterialFactors.clear();
+		m_boneMorphDatas.clear();
+
+		m_updatePositions.clear();
+		m_updateNormals.clear();
+		m_updateUVs.clear();
+		m_morphPositions.clear();
+		m_morphUVs.clear();
+
+		m_nodeHierarchy.Clear();
 		m_nodeMan.GetNodes()->clear();
 
+		m_activePositionMorphs.clear();
+		m_activeUVMorphs.clear();
+		m_gpuSkinning = false;
+		m_morphWeights.clear();
+
 		m_updateRanges.clear();
 	}
 
 	void PMXModel::SetupParallelUpdate()
 	{
+		// 常駐ワーカー + 呼び出しスレッドの数をジョブ数の既定値にする
+		const size_t concurrency = Singleton<JobSystem>::Get()->GetConcurrency();
 		if (m_parallelUpdateCount == 0)
 		{
-			m_parallelUpdateCount = std::thread::hardware_concurrency();
+			m_parallelUpdateCount = uint32_t(concurrency);
 		}
-		size_t maxParallelCount = std::max(size_t(16), size_t(std::thread::hardware_concurrency()));
+		size_t maxParallelCount = std::max(size_t(16), concurrency);
 		if (m_parallelUpdateCount > maxParallelCount)
 		{
 			SABA_WARN("PMXModel::SetParallelUpdateCount parallelCount > {}", maxParallelCount);
-			m_parallelUpdateCount = 16;
+			m_parallelUpdateCount = uint32_t(maxParallelCount);
 		}
 
-		SABA_INFO("Select PMX Parallel Update Count : {}", m_parallelUpdateCount);
+		SABA_INFO("Select PMX Parallel Update Job Count : {}", m_parallelUpdateCount);
 
 		m_updateRanges.resize(m_parallelUpdateCount);
-		m_parallelUpdateFutures.resize(m_parallelUpdateCount - 1);
 
-		const size_t vertexCount = m_positions.size();
+		const size_t vertexCount = m_asset->m_positions.size();
 		const size_t LowerVertexCount = 1000;
 		if (vertexCount < m_updateRanges.size() * LowerVertexCount)
 		{
@@ -974,138 +1659,140 @@ namespace saba
 				offset = range.m_vertexOffset + range.m_vertexCount;
 			}
 		}
+
+		// 頂点の範囲に含まれる、スキニングタイプ毎の頂点リストの範囲を求める
+		auto findSkinningRange = [](const auto& stream, const UpdateRange& range)
+		{
+			const auto& vertices = stream.m_vertices;
+			auto lessVertex = [](const auto& v, size_t vtxIdx) { return v.m_vertex < vtxIdx; };
+			auto beginIt = std::lower_bound(vertices.begin(), vertices.end(), range.m_vertexOffset, lessVertex);
+			auto endIt = std::lower_bound(beginIt, vertices.end(), range.m_vertexOffset + range.m_vertexCount, lessVertex);
+			SkinningRange skinningRange;
+			skinningRange.m_offset = size_t(beginIt - vertices.begin());
+			skinningRange.m_count = size_t(endIt - beginIt);
+			return skinningRange;
+		};
+		for (auto& range : m_updateRanges)
+		{
+			range.m_weight1 = findSkinningRange(m_asset->m_weight1Stream, range);
+			range.m_weight2 = findSkinningRange(m_asset->m_weight2Stream, range);
+			range.m_weight4 = findSkinningRange(m_asset->m_weight4Stream, range);
+			range.m_sdef = findSkinningRange(m_asset->m_sdefStream, range);
+			range.m_dualQuaternion = findSkinningRange(m_asset->m_dualQuaternionStream, range);
+
+			// どの頂点が変形済みかは分からないので、次の BeginAnimation まではすべて加算する
+			range.m_morphPosition = true;
+			range.m_morphUV = true;
+		}
 	}
 
-	void PMXModel::Update(const UpdateRange & range)
+	void PMXModel::Update(const UpdateRange & range, const VertexOutput& output)
 	{
-		const auto* position = m_positions.data() + range.m_vertexOffset;
-		const auto* normal = m_normals.data() + range.m_vertexOffset;
-		const auto* uv = m_uvs.data() + range.m_vertexOffset;
-		const auto* morphPos = m_morphPositions.data() + range.m_vertexOffset;
-		const auto* morphUV = m_morphUVs.data() + range.m_vertexOffset;
-		const auto* vtxInfo = m_vertexBoneInfos.data() + range.m_vertexOffset;
+		const auto* morphPositions = range.m_morphPosition ? m_morphPositions.data() : nullptr;
 		const auto* transforms = m_transforms.data();
-		auto* updatePosition = m_updatePositions.data() + range.m_vertexOffset;
-		auto* updateNormal = m_updateNormals.data() + range.m_vertexOffset;
-		auto* updateUV = m_updateUVs.data() + range.m_vertexOffset;
-
-		for (size_t i = 0; i < range.m_vertexCount; i++)
-		{
-			glm::mat4 m;
-			switch (vtxInfo->m_skinningType)
-			{
-			case PMXModel::SkinningType::Weight1:
+		auto* updatePositions = output.m_positions;
+		auto* updateNormals = output.m_normals;
+
+		// BDEF1, BDEF2, BDEF4
+		MMDSkinningContext ctx;
+		ctx.m_transforms = transforms;
+		ctx.m_morphPositions = morphPositions;
+		ctx.m_updatePositions = updatePositions;
+		ctx.m_updateNormals = updateNormals;
+		auto skinning = [&ctx](const auto& stream, const SkinningRange& skinningRange)
+		{
+			ctx.m_positions = stream.m_positions.data() + skinningRange.m_offset;
+			ctx.m_normals = stream.m_normals.data() + skinningRange.m_offset;
+			MMDSkinning(ctx, stream.m_vertices.data() + skinningRange.m_offset, skinningRange.m_count);
+		};
+		skinning(m_asset->m_weight1Stream, range.m_weight1);
+		skinning(m_asset->m_weight2Stream, range.m_weight2);
+		skinning(m_asset->m_weight4Stream, range.m_weight4);
+
+		// SDEF
+		// https://github.com/powroupi/blender_mmd_tools/blob/dev_test/mmd_tools/core/sdef.py
+		for (size_t i = range.m_sdef.m_offset; i < range.m_sdef.m_offset + range.m_sdef.m_count; i++)
+		{
+			const auto& sdef = m_asset->m_sdefStream.m_vertices[i];
+			const auto vtxIdx = sdef.m_vertex;
+			const auto i0 = sdef.m_boneIndex[0];
+			const auto i1 = sdef.m_boneIndex[1];
+			const auto w0 = sdef.m_boneWeight;
+			const auto w1 = 1.0f - w0;
+			const auto center = sdef.m_sdefC;
+			const auto cr0 = sdef.m_sdefR0;
+			const auto cr1 = sdef.m_sdefR1;
+			const auto& q0 = m_sdefRotations[i0];
+			const auto& q1 = m_sdefRotations[i1];
+			const auto& m0 = transforms[i0];
+			const auto& m1 = transforms[i1];
+
+			auto pos = m_asset->m_sdefStream.m_positions[i];
+			if (morphPositions != nullptr)
 			{
-				const auto i0 = vtxInfo->m_boneIndex[0];
-				const auto& m0 = transforms[i0];
-				m = m0;
-				break;
+				pos += morphPositions[vtxIdx];
 			}
-			case PMXModel::SkinningType::Weight2:
-			{
-				const auto i0 = vtxInfo->m_boneIndex[0];
-				const auto i1 = vtxInfo->m_boneIndex[1];
-				const auto w0 = vtxInfo->m_boneWeight[0];
-				const auto w1 = vtxInfo->m_boneWeight[1];
-				const auto& m0 = transforms[i0];
-				const auto& m1 = transforms[i1];
-				m = m0 * w0 + m1 * w1;
-				break;
-			}
-			case PMXModel::SkinningType::Weight4:
-			{
-				const auto i0 = vtxInfo->m_boneIndex[0];
-				const auto i1 = vtxInfo->m_boneIndex[1];
-				const auto i2 = vtxInfo->m_boneIndex[2];
-				const auto i3 = vtxInfo->m_boneIndex[3];
-				const auto w0 = vtxInfo->m_boneWeight[0];
-				const auto w1 = vtxInfo->m_boneWeight[1];
-				const auto w2 = vtxInfo->m_boneWeight[2];
-				const auto w3 = vtxInfo->m_boneWeight[3];
-				const auto& m0 = transforms[i0];
-				const auto& m1 = transforms[i1];
-				const auto& m2 = transforms[i2];
-				const auto& m3 = transforms[i3];
-				m = m0 * w0 + m1 * w1 + m2 * w2 + m3 * w3;
-				break;
-			}
-			case PMXModel::SkinningType::SDEF:
-			{
-				// https://github.com/powroupi/blender_mmd_tools/blob/dev_test/mmd_tools/core/sdef.py
-
-				auto& nodes = (*m_nodeMan.GetNodes());
-				const auto i0 = vtxInfo->m_sdef.m_boneIndex[0];
-				const auto i1 = vtxInfo->m_sdef.m_boneIndex[1];
-				const auto w0 = vtxInfo->m_sdef.m_boneWeight;
-				const auto w1 = 1.0f - w0;
-				const auto center = vtxInfo->m_sdef.m_sdefC;
-				const auto cr0 = vtxInfo->m_sdef.m_sdefR0;
-				const auto cr1 = vtxInfo->m_sdef.m_sdefR1;
-				const auto q0 = glm::quat_cast(nodes[i0]->GetGlobalTransform());
-				const auto q1 = glm::quat_cast(nodes[i1]->GetGlobalTransform());
-				const auto m0 = transforms[i0];
-				const auto m1 = transforms[i1];
-
-				const auto pos = *position + *morphPos;
-				const auto rot_mat = glm::mat3_cast(glm::slerp(q0, q1, w1));
+			const auto rot_mat = glm::mat3_cast(glm::slerp(q0, q1, w1));
 
-				*updatePosition = glm::mat3(rot_mat) * (pos - center) + glm::vec3(m0 * glm::vec4(cr0, 1)) * w0 + glm::vec3(m1 * glm::vec4(cr1, 1)) * w1;
-				*updateNormal = rot_mat * *normal;
+			updatePositions[vtxIdx] = glm::mat3(rot_mat) * (pos - center) + glm::vec3(m0 * glm::vec4(cr0, 1)) * w0 + glm::vec3(m1 * glm::vec4(cr1, 1)) * w1;
+			updateNormals[vtxIdx] = rot_mat * m_asset->m_sdefStream.m_normals[i];
+		}
 
-				break;
-			}
-			case PMXModel::SkinningType::DualQuaternion:
+		// QDEF
+		//
+		// Skinning with Dual Quaternions
+		// https://www.cs.utah.edu/~ladislav/dq/index.html
+		//
+		for (size_t i = range.m_dualQuaternion.m_offset; i < range.m_dualQuaternion.m_offset + range.m_dualQuaternion.m_count; i++)
+		{
+			const auto& vtx = m_asset->m_dualQuaternionStream.m_vertices[i];
+			glm::dualquat dq[4];
+			float w[4];
+			for (int bi = 0; bi < 4; bi++)
 			{
-				//
-				// Skinning with Dual Quaternions
-				// https://www.cs.utah.edu/~ladislav/dq/index.html
-				//
-				glm::dualquat dq[4];
-				float w[4] = { 0 };
-				for (int bi = 0; bi < 4; bi++)
-				{
-					auto boneID = vtxInfo->m_boneIndex[bi];
-					if (boneID != -1)
-					{ 
-						dq[bi] = glm::dualquat_cast(glm::mat3x4(glm::transpose(transforms[boneID])));
-						dq[bi] = glm::normalize(dq[bi]);
-						w[bi] = vtxInfo->m_boneWeight[bi];
-					}
-					else
-					{
-						w[bi] = 0;
-					}
-				}
-				if (glm::dot(dq[0].real, dq[1].real) < 0) { w[1] *= -1.0f; }
-				if (glm::dot(dq[0].real, dq[2].real) < 0) { w[2] *= -1.0f; }
-				if (glm::dot(dq[0].real, dq[3].real) < 0) { w[3] *= -1.0f; }
-				auto blendDQ = w[0] * dq[0]
-					+ w[1] * dq[1]
-					+ w[2] * dq[2]
-					+ w[3] * dq[3];
-				blendDQ = glm::normalize(blendDQ);
-				m = glm::transpose(glm::mat3x4_cast(blendDQ));
-				break;
+				dq[bi] = glm::dualquat_cast(glm::mat3x4(glm::transpose(transforms[vtx.m_boneIndex[bi]])));
+				dq[bi] = glm::normalize(dq[bi]);
+				w[bi] = DequantizeMMDSkinningWeight(vtx.m_boneWeight[bi]);
 			}
-			default:
-				break;
-			}
-
-			if (PMXModel::SkinningType::SDEF != vtxInfo->m_skinningType)
+			if (glm::dot(dq[0].real, dq[1].real) < 0) { w[1] *= -1.0f; }
+			if (glm::dot(dq[0].real, dq[2].real) < 0) { w[2] *= -1.0f; }
+			if (glm::dot(dq[0].real, dq[3].real) < 0) { w[3] *= -1.0f; }
+			auto blendDQ = w[0] * dq[0]
+				+ w[1] * dq[1]
+				+ w[2] * dq[2]
+				+ w[3] * dq[3];
+			blendDQ = glm::normalize(blendDQ);
+			auto m = glm::transpose(glm::mat3x4_cast(blendDQ));
+
+			const auto vtxIdx = vtx.m_vertex;
+			auto pos = m_asset->m_dualQuaternionStream.m_positions[i];
+			if (morphPositions != nullptr)
 			{
-				*updatePosition = glm::vec3(m * glm::vec4(*position + *morphPos, 1));
-				*updateNormal = glm::normalize(glm::mat3(m) * *normal);
+				pos += morphPositions[vtxIdx];
 			}
+			updatePositions[vtxIdx] = glm::vec3(m * glm::vec4(pos, 1));
+			updateNormals[vtxIdx] = glm::normalize(glm::mat3(m) * m_asset->m_dualQuaternionStream.m_normals[i]);
+		}
+
+		// UV
+		if (output.m_uvs == nullptr)
+		{
+			return;
+		}
+		const auto* uv = m_asset->m_uvs.data() + range.m_vertexOffset;
+		auto* updateUV = output.m_uvs + range.m_vertexOffset;
+		if (!range.m_morphUV)
+		{
+			std::copy(uv, uv + range.m_vertexCount, updateUV);
+			return;
+		}
+		const auto* morphUV = m_morphUVs.data() + range.m_vertexOffset;
+		for (size_t i = 0; i < range.m_vertexCount; i++)
+		{
 			*updateUV = *uv + glm::vec2((*morphUV).x, (*morphUV).y);
 
-			vtxInfo++;
-			position++;
-			normal++;
 			uv++;
-			updatePosition++;
-			updateNormal++;
 			updateUV++;
-			morphPos++;
 			morphUV++;
 		}
 	}
@@ -1116,19 +1803,19 @@ namespace saba
 		{
 		case MorphType::Position:
 			MorphPosition(
-				m_positionMorphDatas[morph->m_dataIndex],
+				m_asset->m_positionMorphDatas[morph->m_dataIndex],
 				weight
 			);
 			break;
 		case MorphType::UV:
 			MorphUV(
-				m_uvMorphDatas[morph->m_dataIndex],
+				m_asset->m_uvMorphDatas[morph->m_dataIndex],
 				weight
 			);
 			break;
 		case MorphType::Material:
 			MorphMaterial(
-				m_materialMorphDatas[morph->m_dataIndex],
+				m_asset->m_materialMorphDatas[morph->m_dataIndex],
 				weight
 			);
 			break;
@@ -1140,7 +1827,7 @@ namespace saba
 			break;
 		case MorphType::Group:
 		{
-			auto& groupMorphData = m_groupMorphDatas[morph->m_dataIndex];
+			auto& groupMorphData = m_asset->m_groupMorphDatas[morph->m_dataIndex];
 			for (const auto& groupMorph : groupMorphData.m_groupMorphs)
 			{
 				if (groupMorph.m_morphIndex == -1) { continue; }
@@ -1161,10 +1848,18 @@ namespace saba
 			return;
 		}
 
+		if (m_gpuSkinning)
+		{
+			m_morphWeights[&morphData - m_asset->m_positionMorphDatas.data()] += weight;
+			return;
+		}
+
 		for (const auto& morphVtx : morphData.m_morphVertices)
 		{
 			m_morphPositions[morphVtx.m_index] += morphVtx.m_position * weight;
 		}
+		m_activePositionMorphs.push_back(&morphData);
+		MarkMorphRange(morphData.m_vertexBegin, morphData.m_vertexEnd, &UpdateRange::m_morphPosition);
 	}
 
 	void PMXModel::MorphUV(const UVMorphData & morphData, float weight)
@@ -1174,10 +1869,61 @@ namespace saba
 			return;
 		}
 
+		if (m_gpuSkinning)
+		{
+			m_morphWeights[m_asset->m_positionMorphDatas.size() + (&morphData - m_asset->m_uvMorphDatas.data())] += weight;
+			return;
+		}
+
 		for (const auto& morphUV : morphData.m_morphUVs)
 		{
 			m_morphUVs[morphUV.m_index] += morphUV.m_uv * weight;
 		}
+		m_activeUVMorphs.push_back(&morphData);
+		MarkMorphRange(morphData.m_vertexBegin, morphData.m_vertexEnd, &UpdateRange::m_morphUV);
+	}
+
+	void PMXModel::ResetMorphVertices()
+	{
+		std::fill(m_morphWeights.begin(), m_morphWeights.end(), 0.0f);
+
+		// 前回加算したモーフの頂点だけを 0 に戻す
+		// (同じモーフが複数回含まれる場合もあるが、0 に戻すだけなので問題ない)
+		for (auto morphData : m_activePositionMorphs)
+		{
+			for (const auto& morphVtx : morphData->m_morphVertices)
+			{
+				m_morphPositions[morphVtx.m_index] = glm::vec3(0);
+			}
+		}
+		m_activePositionMorphs.clear();
+
+		for (auto morphData : m_activeUVMorphs)
+		{
+			for (const auto& morphUV : morphData->m_morphUVs)
+			{
+				m_morphUVs[morphUV.m_index] = glm::vec4(0);
+			}
+		}
+		m_activeUVMorphs.clear();
+
+		for (auto& range : m_updateRanges)
+		{
+			range.m_morphPosition = false;
+			range.m_morphUV = false;
+		}
+	}
+
+	void PMXModel::MarkMorphRange(uint32_t vertexBegin, uint32_t vertexEnd, bool UpdateRange::*morphFlag)
+	{
+		for (auto& range : m_updateRanges)
+		{
+			if (vertexBegin < range.m_vertexOffset + range.m_vertexCount &&
+				range.m_vertexOffset < vertexEnd)
+			{
+				range.*morphFlag = true;
+			}
+		}
 	}
 
 	void PMXModel::BeginMorphMaterial()
@@ -1210,11 +1956,11 @@ namespace saba
 		for (size_t matIdx = 0; matIdx < matCount; matIdx++)
 		{
 			m_mulMaterialFactors[matIdx] = initMul;
-			m_mulMaterialFactors[matIdx].m_diffuse = m_initMaterials[matIdx].m_diffuse;
-			m_mulMaterialFactors[matIdx].m_alpha = m_initMaterials[matIdx].m_alpha;
-			m_mulMaterialFactors[matIdx].m_specular = m_initMaterials[matIdx].m_specular;
-			m_mulMaterialFactors[matIdx].m_specularPower = m_initMaterials[matIdx].m_specularPower;
-			m_mulMaterialFactors[matIdx].m_ambient = m_initMaterials[matIdx].m_ambient;
+			m_mulMaterialFactors[matIdx].m_diffuse = m_asset->m_materials[matIdx].m_diffuse;
+			m_mulMaterialFactors[matIdx].m_alpha = m_asset->m_materials[matIdx].m_alpha;
+			m_mulMaterialFactors[matIdx].m_specular = m_asset->m_materials[matIdx].m_specular;
+			m_mulMaterialFactors[matIdx].m_specularPower = m_asset->m_materials[matIdx].m_specularPower;
+			m_mulMaterialFactors[matIdx].m_ambient = m_asset->m_materials[matIdx].m_ambient;
 
 			m_addMaterialFactors[matIdx] = initAdd;
 		}
@@ -1415,7 +2161,7 @@ namespace saba
 
 		glm::vec3 s = GetScale();
 
-		m_local = glm::translate(glm::mat4(1), t)
+		*m_local = glm::translate(glm::mat4(1), t)
 			* glm::mat4_cast(r)
 			* glm::scale(glm::mat4(1), s);
 	}
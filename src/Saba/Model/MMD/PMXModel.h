@@ -9,6 +9,8 @@
 #include "MMDMaterial.h"
 #include "MMDModel.h"
 #include "MMDIkSolver.h"
+#include "MMDSkinning.h"
+#include "MMDNodeHierarchy.h"
 #include "PMXFile.h"
 
 #include <glm/vec2.hpp>
@@ -17,7 +19,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
-#include <future>
+#include <memory>
 
 namespace saba
 {
@@ -83,23 +85,26 @@ namespace saba
 		MMDMorphManager* GetMorphManager() override { return &m_morphMan; };
 		MMDPhysicsManager* GetPhysicsManager() override { return &m_physicsMan; }
 
-		size_t GetVertexCount() const override { return m_positions.size(); }
-		const glm::vec3* GetPositions() const override { return m_positions.data(); }
-		const glm::vec3* GetNormals() const override { return m_normals.data(); }
-		const glm::vec2* GetUVs() const override { return m_uvs.data(); }
+		size_t GetVertexCount() const override { return m_asset->m_positions.size(); }
+		const glm::vec3* GetPositions() const override { return m_asset->m_positions.data(); }
+		const glm::vec3* GetNormals() const override { return m_asset->m_normals.data(); }
+		const glm::vec2* GetUVs() const override { return m_asset->m_uvs.data(); }
 		const glm::vec3* GetUpdatePositions() const override { return m_updatePositions.data(); }
 		const glm::vec3* GetUpdateNormals() const override { return m_updateNormals.data(); }
 		const glm::vec2* GetUpdateUVs() const override { return m_updateUVs.data(); }
 
-		size_t GetIndexElementSize() const override { return m_indexElementSize; }
-		size_t GetIndexCount() const override { return m_indexCount; }
-		const void* GetIndices() const override { return &m_indices[0]; }
+		size_t GetIndexElementSize() const override { return m_asset->m_indexElementSize; }
+		size_t GetIndexCount() const override { return m_asset->m_indexCount; }
+		const void* GetIndices() const override { return m_asset->m_indices.data(); }
 
 		size_t GetMaterialCount() const override { return m_materials.size(); }
-		const MMDMaterial* GetMaterials() const override { return &m_materials[0]; }
+		const MMDMaterial* GetMaterials() const override { return m_materials.data(); }
 
-		size_t GetSubMeshCount() const override { return m_subMeshes.size(); }
-		const MMDSubMesh* GetSubMeshes() const override { return &m_subMeshes[0]; }
+		size_t GetSubMeshCount() const override { return m_asset->m_subMeshes.size(); }
+		const MMDSubMesh* GetSubMeshes() const override { return m_asset->m_subMeshes.data(); }
+
+		std::shared_ptr<const void> GetSharedMeshData() const override;
+		bool HasUVMorph() const override { return !m_asset->m_uvMorphDatas.empty(); }
 
 		MMDPhysics* GetMMDPhysics() override { return m_physicsMan.GetMMDPhysics(); }
 
@@ -114,46 +119,42 @@ namespace saba
 		// Physicsを更新する
 		void ResetPhysics() override;
 		void UpdatePhysicsAnimation(float elapsed) override;
+		void BeginPhysicsAnimation(float elapsed) override;
+		void EndPhysicsAnimation() override;
 		// 頂点データーを更新する
 		void Update() override;
+		// m_updatePositions などを経由せずに、直接書き込む
+		void Update(glm::vec3* positions, glm::vec3* normals, glm::vec2* uvs) override;
 		void SetParallelUpdateHint(uint32_t parallelCount) override;
 
+		bool GetGPUSkinningData(MMDGPUSkinningData* data) const override;
+		void EnableGPUSkinning(bool enable) override;
+		bool IsGPUSkinningEnabled() const override { return m_gpuSkinning; }
+		const glm::mat4* GetSkinningTransforms() const override { return m_transforms.data(); }
+		const glm::quat* GetSDEFRotations() const override;
+		const float* GetMorphWeights() const override { return m_morphWeights.data(); }
+
+		/*
+		同じ PMX (内容、ディレクトリ、MMD のデータのディレクトリが同じ) を読み込んだインスタンスが残っている場合は、
+		読み込み済みの Asset を共有する。
+		*/
 		bool Load(const std::string& filepath, const std::string& mmdDataDir);
+		// cachePath のキャッシュ (.sabacache) が有効なら、頂点と面のデータをキャッシュから読み込む
+		// 無効な場合は PMX から作り、cachePath に保存する
+		bool Load(const std::string& filepath, const std::string& mmdDataDir, const std::string& cachePath);
 		void Destroy();
 
-		const glm::vec3& GetBBoxMin() const { return m_bboxMin; }
-		const glm::vec3& GetBBoxMax() const { return m_bboxMax; }
+		const glm::vec3& GetBBoxMin() const { return m_asset->m_bboxMin; }
+		const glm::vec3& GetBBoxMax() const { return m_asset->m_bboxMax; }
 
-	public:
-		enum class SkinningType
-		{
-			Weight1,
-			Weight2,
-			Weight4,
-			SDEF,
-			DualQuaternion,
-		};
-		struct VertexBoneInfo
-		{
-			SkinningType	m_skinningType;
-			union
-			{
-				struct
-				{
-					int32_t	m_boneIndex[4];
-					float	m_boneWeight[4];
-				};
-				struct
-				{
-					int32_t	m_boneIndex[2];
-					float	m_boneWeight;
-
-					glm::vec3	m_sdefC;
-					glm::vec3	m_sdefR0;
-					glm::vec3	m_sdefR1;
-				} m_sdef;
-			};
-		};
+		struct Asset;
+		using AssetPtr = std::shared_ptr<const Asset>;
+
+		// Load と同じ方法で Asset だけを読み込む (共有できる場合は読み込み済みのものを返す)
+		static AssetPtr LoadAsset(const std::string& filepath, const std::string& mmdDataDir, const std::string& cachePath = std::string());
+		// 読み込み済みの Asset からインスタンスを作る
+		bool Create(const AssetPtr& asset);
+		const AssetPtr& GetAsset() const { return m_asset; }
 
 	private:
 		struct PositionMorph
@@ -165,6 +166,9 @@ namespace saba
 		struct PositionMorphData
 		{
 			std::vector<PositionMorph>	m_morphVertices;
+			// 変形する頂点番号の範囲 [m_vertexBegin, m_vertexEnd)
+			uint32_t					m_vertexBegin;
+			uint32_t					m_vertexEnd;
 		};
 
 		struct UVMorph
@@ -176,6 +180,9 @@ namespace saba
 		struct UVMorphData
 		{
 			std::vector<UVMorph>	m_morphUVs;
+			// 変形する頂点番号の範囲 [m_vertexBegin, m_vertexEnd)
+			uint32_t				m_vertexBegin;
+			uint32_t				m_vertexEnd;
 		};
 
 		struct MaterialFactor
@@ -237,15 +244,127 @@ namespace saba
 			size_t		m_dataIndex;
 		};
 
+		struct MorphInfo
+		{
+			MorphType	m_morphType;
+			size_t		m_dataIndex;
+		};
+
+		struct SDEFVertex
+		{
+			uint32_t	m_vertex;
+			uint16_t	m_boneIndex[2];
+			float		m_boneWeight;
+			glm::vec3	m_sdefC;
+			glm::vec3	m_sdefR0;
+			glm::vec3	m_sdefR1;
+		};
+
+		// スキニングタイプ毎の頂点リスト (頂点番号順)
+		template <typename Vertex>
+		struct SkinningStream
+		{
+			std::vector<Vertex>		m_vertices;
+			// m_vertices と同じ並びの位置と法線
+			std::vector<glm::vec3>	m_positions;
+			std::vector<glm::vec3>	m_normals;
+
+			void Add(const Vertex& vertex, const glm::vec3& position, const glm::vec3& normal)
+			{
+				m_vertices.push_back(vertex);
+				m_positions.push_back(position);
+				m_normals.push_back(normal);
+			}
+
+			void Clear()
+			{
+				m_vertices.clear();
+				m_positions.clear();
+				m_normals.clear();
+			}
+		};
+
+		struct SkinningRange
+		{
+			size_t	m_offset;
+			size_t	m_count;
+		};
+
 		struct UpdateRange
 		{
 			size_t	m_vertexOffset;
 			size_t	m_vertexCount;
+
+			// スキニングタイプ毎の頂点リストの範囲
+			SkinningRange	m_weight1;
+			SkinningRange	m_weight2;
+			SkinningRange	m_weight4;
+			SkinningRange	m_sdef;
+			SkinningRange	m_dualQuaternion;
+
+			// 範囲内にモーフで変形した頂点があるか (false の場合は加算しない)
+			bool	m_morphPosition;
+			bool	m_morphUV;
+		};
+
+	public:
+		/*
+		PMX から作った、インスタンスで変更しないデータ。
+		同じ PMX の複数のインスタンスで共有し、インスタンスはポーズ、モーフ、物理演算、変形後の頂点だけを持つ。
+		*/
+		struct Asset
+		{
+			std::vector<glm::vec3>	m_positions;
+			std::vector<glm::vec3>	m_normals;
+			std::vector<glm::vec2>	m_uvs;
+
+			SkinningStream<MMDSkinningWeight1>	m_weight1Stream;
+			SkinningStream<MMDSkinningWeight2>	m_weight2Stream;
+			SkinningStream<MMDSkinningWeight4>	m_weight4Stream;
+			SkinningStream<SDEFVertex>			m_sdefStream;
+			SkinningStream<MMDSkinningWeight4>	m_dualQuaternionStream;
+
+			std::vector<char>	m_indices;
+			size_t				m_indexCount = 0;
+			size_t				m_indexElementSize = 0;
+
+			glm::vec3	m_bboxMin = glm::vec3(0);
+			glm::vec3	m_bboxMax = glm::vec3(0);
+
+			// モーフ前のマテリアル
+			std::vector<MMDMaterial>	m_materials;
+			std::vector<MMDSubMesh>		m_subMeshes;
+
+			// PMXFile::m_morphs と同じ並び
+			std::vector<MorphInfo>			m_morphs;
+			std::vector<PositionMorphData>	m_positionMorphDatas;
+			std::vector<UVMorphData>		m_uvMorphDatas;
+			std::vector<MaterialMorphData>	m_materialMorphDatas;
+			std::vector<GroupMorphData>		m_groupMorphDatas;
+
+			// ボーン、ボーンモーフ、剛体、ジョイントの定義
+			// (頂点、面と、上のデータに変換したモーフの要素は空にしてある)
+			PMXFile	m_pmx;
+
+			bool LoadMesh(const PMXFile& pmx);
+			bool LoadMeshCache(const std::string& cachePath, uint64_t sourceSize, uint64_t sourceHash);
+			bool ValidateMeshCache(const PMXFile& pmx) const;
+			void SaveMeshCache(const std::string& cachePath, uint64_t sourceSize, uint64_t sourceHash) const;
+			void ClearMesh();
+			void LoadMaterials(const PMXFile& pmx, const std::string& dirPath, const std::string& mmdDataDir);
+			void LoadMorphs(const PMXFile& pmx);
 		};
 
 	private:
+		struct VertexOutput
+		{
+			glm::vec3*	m_positions;
+			glm::vec3*	m_normals;
+			glm::vec2*	m_uvs;
+		};
+
 		void SetupParallelUpdate();
-		void Update(const UpdateRange& range);
+		void Update(const UpdateRange& range, const VertexOutput& output);
 
 		void Morph(PMXMorph* morph, float weight);
 
@@ -253,6 +372,9 @@ namespace saba
 
 		void MorphUV(const UVMorphData& morphData, float weight);
 
+		void ResetMorphVertices();
+		void MarkMorphRange(uint32_t vertexBegin, uint32_t vertexEnd, bool UpdateRange::*morphFlag);
+
 		void BeginMorphMaterial();
 		void EndMorphMaterial();
 		void MorphMaterial(const MaterialMorphData& morphData, float weight);
@@ -260,49 +382,42 @@ namespace saba
 		void MorphBone(const BoneMorphData& morphData, float weight);
 
 	private:
-		std::vector<glm::vec3>	m_positions;
-		std::vector<glm::vec3>	m_normals;
-		std::vector<glm::vec2>	m_uvs;
-		std::vector<VertexBoneInfo>	m_vertexBoneInfos;
+		AssetPtr				m_asset;
+
 		std::vector<glm::vec3>	m_updatePositions;
 		std::vector<glm::vec3>	m_updateNormals;
 		std::vector<glm::vec2>	m_updateUVs;
 		std::vector<glm::mat4>	m_transforms;
+		std::vector<glm::quat>	m_sdefRotations;
 
-		std::vector<char>	m_indices;
-		size_t				m_indexCount;
-		size_t				m_indexElementSize;
-
-		std::vector<PositionMorphData>	m_positionMorphDatas;
-		std::vector<UVMorphData>		m_uvMorphDatas;
-		std::vector<MaterialMorphData>	m_materialMorphDatas;
+		// ボーンモーフはノードを参照するので、インスタンス毎に作る
 		std::vector<BoneMorphData>		m_boneMorphDatas;
-		std::vector<GroupMorphData>		m_groupMorphDatas;
 
 		// PositionMorph用
 		std::vector<glm::vec3>	m_morphPositions;
 		std::vector<glm::vec4>	m_morphUVs;
+		// m_morphPositions, m_morphUVs に加算したモーフ (次の BeginAnimation でその頂点だけ 0 に戻す)
+		std::vector<const PositionMorphData*>	m_activePositionMorphs;
+		std::vector<const UVMorphData*>			m_activeUVMorphs;
+		// GPU スキニング用 (PositionMorph, UVMorph の順)
+		bool					m_gpuSkinning;
+		std::vector<float>		m_morphWeights;
 
 		// マテリアルMorph用
-		std::vector<MMDMaterial>	m_initMaterials;
 		std::vector<MaterialFactor>	m_mulMaterialFactors;
 		std::vector<MaterialFactor>	m_addMaterialFactors;
 
-		glm::vec3		m_bboxMin;
-		glm::vec3		m_bboxMax;
-
 		std::vector<MMDMaterial>	m_materials;
-		std::vector<MMDSubMesh>		m_subMeshes;
 		std::vector<PMXNode*>		m_sortedNodes;
 
 		MMDNodeManagerT<PMXNode>	m_nodeMan;
 		MMDIKManagerT<MMDIkSolver>	m_ikSolverMan;
 		MMDMorphManagerT<PMXMorph>	m_morphMan;
 		MMDPhysicsManager			m_physicsMan;
+		MMDNodeHierarchy			m_nodeHierarchy;	// m_nodeMan より後に宣言する
 
-		uint32_t							m_parallelUpdateCount;
-		std::vector<UpdateRange>			m_updateRanges;
-		std::vector<std::future<void>>		m_parallelUpdateFutures;
+		uint32_t					m_parallelUpdateCount;
+		std::vector<UpdateRange>	m_updateRanges;
 	};
 }
 
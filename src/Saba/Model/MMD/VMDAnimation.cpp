@@ -9,8 +9,12 @@
 #include <Saba/Base/Log.h>
 
 #include <algorithm>
+#include <array>
+#include <cstring>
 #include <iterator>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace saba
@@ -26,6 +30,7 @@ namespace saba
 
 			bezier.m_cp1 = glm::vec2((float)x0 / 127.0f, (float)y0 / 127.0f);
 			bezier.m_cp2 = glm::vec2((float)x1 / 127.0f, (float)y1 / 127.0f);
+			bezier.Bake();
 		}
 
 		glm::mat3 InvZ(const glm::mat3& m)
@@ -98,6 +103,132 @@ namespace saba
 		return t;
 	}
 
+	/*
+	t を等間隔に分割した点の x を持つ。
+	x から区間を求め、区間内を線形に逆算した t をニュートン法で一度補正する。
+	*/
+	struct VMDBezierTable
+	{
+		static const int SegmentCount = 64;
+
+		bool	m_isLinear;
+		float	m_x[SegmentCount + 1];			// t = i / SegmentCount の x
+		uint8_t	m_firstSegments[SegmentCount];	// x = i / SegmentCount を含む区間
+	};
+
+	namespace
+	{
+		class VMDBezierTableCache
+		{
+		public:
+			const VMDBezierTable* Get(const VMDBezier& bezier)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				std::array<float, 4> key = { bezier.m_cp1.x, bezier.m_cp1.y, bezier.m_cp2.x, bezier.m_cp2.y };
+				auto findIt = m_tables.find(key);
+				if (findIt != m_tables.end())
+				{
+					return findIt->second.get();
+				}
+
+				auto table = Create(bezier);
+				auto tablePtr = table.get();
+				m_tables.emplace(key, std::move(table));
+				return tablePtr;
+			}
+
+		private:
+			static std::unique_ptr<VMDBezierTable> Create(const VMDBezier& bezier)
+			{
+				const int segCount = VMDBezierTable::SegmentCount;
+				auto table = std::make_unique<VMDBezierTable>();
+				table->m_isLinear = bezier.m_cp1.x == bezier.m_cp1.y && bezier.m_cp2.x == bezier.m_cp2.y;
+				for (int i = 0; i <= segCount; i++)
+				{
+					table->m_x[i] = bezier.EvalX(float(i) / float(segCount));
+				}
+				int seg = 0;
+				for (int i = 0; i < segCount; i++)
+				{
+					const float x = float(i) / float(segCount);
+					while (seg < segCount - 1 && table->m_x[seg + 1] <= x)
+					{
+						seg++;
+					}
+					table->m_firstSegments[i] = uint8_t(seg);
+				}
+				return table;
+			}
+
+		private:
+			std::mutex	m_mutex;
+			std::map<std::array<float, 4>, std::unique_ptr<VMDBezierTable>>	m_tables;
+		};
+
+		VMDBezierTableCache& GetVMDBezierTableCache()
+		{
+			static VMDBezierTableCache cache;
+			return cache;
+		}
+	}
+
+	void VMDBezier::Bake()
+	{
+		// 制御点が [0, 1] の外にあると x が単調にならないため、テーブルは使わない
+		auto inRange = [](const glm::vec2& cp) {
+			return cp.x >= 0.0f && cp.x <= 1.0f && cp.y >= 0.0f && cp.y <= 1.0f;
+		};
+		if (!inRange(m_cp1) || !inRange(m_cp2))
+		{
+			m_table = nullptr;
+			return;
+		}
+		m_table = GetVMDBezierTableCache().Get(*this);
+	}
+
+	float VMDBezier::EvalYFromX(float x) const
+	{
+		if (m_table == nullptr)
+		{
+			return EvalY(FindBezierX(x));
+		}
+		if (m_table->m_isLinear)
+		{
+			return x;
+		}
+
+		const int segCount = VMDBezierTable::SegmentCount;
+		x = glm::clamp(x, 0.0f, 1.0f);
+		int seg = m_table->m_firstSegments[std::min(int(x * float(segCount)), segCount - 1)];
+		while (seg < segCount - 1 && m_table->m_x[seg + 1] < x)
+		{
+			seg++;
+		}
+
+		const float x0 = m_table->m_x[seg];
+		const float x1 = m_table->m_x[seg + 1];
+		const float t0 = float(seg) / float(segCount);
+		const float t1 = float(seg + 1) / float(segCount);
+		float t = t0;
+		if (x1 > x0)
+		{
+			t = t0 + (x - x0) / (x1 - x0) * (t1 - t0);
+		}
+
+		// dx/dt
+		const float it = 1.0f - t;
+		const float dx = 3.0f * it * it * m_cp1.x
+			+ 6.0f * it * t * (m_cp2.x - m_cp1.x)
+			+ 3.0f * t * t * (1.0f - m_cp2.x);
+		if (dx > 1.0e-6f)
+		{
+			t = glm::clamp(t - (EvalX(t) - x) / dx, t0, t1);
+		}
+
+		return EvalY(t);
+	}
+
 	VMDNodeController::VMDNodeController()
 		: m_node(nullptr)
 		, m_startKeyIndex(0)
@@ -142,14 +273,10 @@ namespace saba
 
 				float timeRange = float(key1.m_time - key0.m_time);
 				float time = (t - float(key0.m_time)) / timeRange;
-				float tx_x = key0.m_txBezier.FindBezierX(time);
-				float ty_x = key0.m_tyBezier.FindBezierX(time);
-				float tz_x = key0.m_tzBezier.FindBezierX(time);
-				float rot_x = key0.m_rotBezier.FindBezierX(time);
-				float tx_y = key0.m_txBezier.EvalY(tx_x);
-				float ty_y = key0.m_tyBezier.EvalY(ty_x);
-				float tz_y = key0.m_tzBezier.EvalY(tz_x);
-				float rot_y = key0.m_rotBezier.EvalY(rot_x);
+				float tx_y = key0.m_txBezier.EvalYFromX(time);
+				float ty_y = key0.m_tyBezier.EvalYFromX(time);
+				float tz_y = key0.m_tzBezier.EvalYFromX(time);
+				float rot_y = key0.m_rotBezier.EvalYFromX(time);
 
 				vt = glm::mix(key0.m_translate, key1.m_translate, glm::vec3(tx_y, ty_y, tz_y));
 				q = glm::slerp(key0.m_rotate, key1.m_rotate, rot_y);
@@ -181,6 +308,192 @@ namespace saba
 		);
 	}
 
+	namespace
+	{
+		struct VMDBindingTrackMap
+		{
+			void Clear()
+			{
+				m_rawNames.clear();
+				m_utf8Names.clear();
+			}
+
+			std::unordered_map<std::string, uint32_t>	m_rawNames;		// SJIS のままの名前
+			std::unordered_map<std::string, uint32_t>	m_utf8Names;
+		};
+
+		template <typename Name>
+		void AddVMDBindingKey(
+			std::vector<std::string>& names,
+			std::vector<uint32_t>& keyTracks,
+			VMDBindingTrackMap& trackMap,
+			const Name*& prevName,
+			const Name& name
+		)
+		{
+			// 同じ名前のキーは連続していることが多いので、直前の名前と比較してから検索する
+			if (prevName != nullptr && strcmp(prevName->ToCString(), name.ToCString()) == 0)
+			{
+				keyTracks.push_back(keyTracks.back());
+				return;
+			}
+			prevName = &name;
+
+			// UTF-8 への変換は、初めて出てきた名前だけ行う
+			auto rawIt = trackMap.m_rawNames.find(name.ToString());
+			if (rawIt != trackMap.m_rawNames.end())
+			{
+				keyTracks.push_back(rawIt->second);
+				return;
+			}
+
+			std::string utf8Name = name.ToUtf8String();
+			auto insertIt = trackMap.m_utf8Names.emplace(utf8Name, uint32_t(names.size()));
+			if (insertIt.second)
+			{
+				names.emplace_back(std::move(utf8Name));
+			}
+			trackMap.m_rawNames.emplace(name.ToString(), insertIt.first->second);
+			keyTracks.push_back(insertIt.first->second);
+		}
+	}
+
+	void VMDBinding::Create(const VMDFile & vmd)
+	{
+		Clear();
+
+		VMDBindingTrackMap trackMap;
+		const decltype(VMDMotion::m_boneName)* prevBoneName = nullptr;
+		m_nodeTracks.m_keyTracks.reserve(vmd.m_motions.size());
+		for (const auto& motion : vmd.m_motions)
+		{
+			AddVMDBindingKey(m_nodeTracks.m_names, m_nodeTracks.m_keyTracks, trackMap, prevBoneName, motion.m_boneName);
+		}
+
+		trackMap.Clear();
+		const decltype(VMDIkInfo::m_name)* prevIKName = nullptr;
+		for (const auto& ik : vmd.m_iks)
+		{
+			for (const auto& ikInfo : ik.m_ikInfos)
+			{
+				AddVMDBindingKey(m_ikTracks.m_names, m_ikTracks.m_keyTracks, trackMap, prevIKName, ikInfo.m_name);
+			}
+		}
+
+		trackMap.Clear();
+		const decltype(VMDMorph::m_blendShapeName)* prevMorphName = nullptr;
+		m_morphTracks.m_keyTracks.reserve(vmd.m_morphs.size());
+		for (const auto& morph : vmd.m_morphs)
+		{
+			AddVMDBindingKey(m_morphTracks.m_names, m_morphTracks.m_keyTracks, trackMap, prevMorphName, morph.m_blendShapeName);
+		}
+
+		m_nodeTracks.m_indices.resize(m_nodeTracks.m_names.size(), size_t(NPos));
+		m_ikTracks.m_indices.resize(m_ikTracks.m_names.size(), size_t(NPos));
+		m_morphTracks.m_indices.resize(m_morphTracks.m_names.size(), size_t(NPos));
+	}
+
+	bool VMDBinding::Bind(MMDModel * model)
+	{
+		if (model == nullptr)
+		{
+			SABA_ERROR("VMDBinding : Model is null.");
+			return false;
+		}
+
+		auto nodeMan = model->GetNodeManager();
+		for (size_t i = 0; i < m_nodeTracks.m_names.size(); i++)
+		{
+			m_nodeTracks.m_indices[i] = nodeMan->FindNodeIndex(m_nodeTracks.m_names[i]);
+		}
+
+		auto ikMan = model->GetIKManager();
+		for (size_t i = 0; i < m_ikTracks.m_names.size(); i++)
+		{
+			m_ikTracks.m_indices[i] = ikMan->FindIKSolverIndex(m_ikTracks.m_names[i]);
+		}
+
+		auto morphMan = model->GetMorphManager();
+		for (size_t i = 0; i < m_morphTracks.m_names.size(); i++)
+		{
+			m_morphTracks.m_indices[i] = morphMan->FindMorphIndex(m_morphTracks.m_names[i]);
+		}
+
+		m_nodeCount = nodeMan->GetNodeCount();
+		m_ikSolverCount = ikMan->GetIKSolverCount();
+		m_morphCount = morphMan->GetMorphCount();
+		m_isBound = true;
+
+		return true;
+	}
+
+	void VMDBinding::Clear()
+	{
+		m_nodeTracks = Tracks();
+		m_ikTracks = Tracks();
+		m_morphTracks = Tracks();
+		m_nodeCount = 0;
+		m_ikSolverCount = 0;
+		m_morphCount = 0;
+		m_isBound = false;
+	}
+
+	bool VMDBinding::IsCompatible(MMDModel * model) const
+	{
+		if (!m_isBound || model == nullptr)
+		{
+			return false;
+		}
+
+		auto nodeMan = model->GetNodeManager();
+		auto ikMan = model->GetIKManager();
+		auto morphMan = model->GetMorphManager();
+		if (nodeMan->GetNodeCount() != m_nodeCount ||
+			ikMan->GetIKSolverCount() != m_ikSolverCount ||
+			morphMan->GetMorphCount() != m_morphCount)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < m_nodeTracks.m_names.size(); i++)
+		{
+			size_t idx = m_nodeTracks.m_indices[i];
+			if (idx != NPos && nodeMan->GetMMDNode(idx)->GetName() != m_nodeTracks.m_names[i])
+			{
+				return false;
+			}
+		}
+		for (size_t i = 0; i < m_ikTracks.m_names.size(); i++)
+		{
+			size_t idx = m_ikTracks.m_indices[i];
+			if (idx != NPos && ikMan->GetMMDIKSolver(idx)->GetName() != m_ikTracks.m_names[i])
+			{
+				return false;
+			}
+		}
+		for (size_t i = 0; i < m_morphTracks.m_names.size(); i++)
+		{
+			size_t idx = m_morphTracks.m_indices[i];
+			if (idx != NPos && morphMan->GetMorph(idx)->GetName() != m_morphTracks.m_names[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool VMDBinding::IsCompatible(const VMDFile & vmd) const
+	{
+		size_t ikInfoCount = 0;
+		for (const auto& ik : vmd.m_iks)
+		{
+			ikInfoCount += ik.m_ikInfos.size();
+		}
+		return m_nodeTracks.m_keyTracks.size() == vmd.m_motions.size() &&
+			m_ikTracks.m_keyTracks.size() == ikInfoCount &&
+			m_morphTracks.m_keyTracks.size() == vmd.m_morphs.size();
+	}
+
 	VMDAnimation::VMDAnimation()
 	{
 	}
@@ -193,151 +506,161 @@ namespace saba
 
 	bool VMDAnimation::Add(const VMDFile & vmd)
 	{
+		VMDBinding binding;
+		binding.Create(vmd);
+		if (!binding.Bind(m_model.get()))
+		{
+			return false;
+		}
+		return Add(vmd, binding);
+	}
+
+	bool VMDAnimation::Add(const VMDFile & vmd, const VMDBinding & binding)
+	{
+		if (m_model == nullptr)
+		{
+			SABA_ERROR("VMDAnimation : Model is null.");
+			return false;
+		}
+		if (!binding.IsCompatible(vmd) || !binding.IsCompatible(m_model.get()))
+		{
+			SABA_ERROR("VMDAnimation : Binding does not match.");
+			return false;
+		}
+
 		// Node Controller
-		std::map<std::string, NodeControllerPtr> nodeCtrlMap;
+		auto nodeMan = m_model->GetNodeManager();
+		std::vector<NodeControllerPtr> nodeCtrls(nodeMan->GetNodeCount());
 		for (auto& nodeCtrl : m_nodeControllers)
 		{
-			std::string name = nodeCtrl->GetNode()->GetName();
-			nodeCtrlMap.emplace(std::make_pair(name, std::move(nodeCtrl)));
+			size_t nodeIdx = nodeCtrl->GetNode()->GetIndex();
+			nodeCtrls[nodeIdx] = std::move(nodeCtrl);
 		}
 		m_nodeControllers.clear();
-		for (const auto& motion : vmd.m_motions)
+		for (size_t motionIdx = 0; motionIdx < vmd.m_motions.size(); motionIdx++)
 		{
-			std::string nodeName = motion.m_boneName.ToUtf8String();
-			auto findIt = nodeCtrlMap.find(nodeName);
-			VMDNodeController* nodeCtrl = nullptr;
-			if (findIt == std::end(nodeCtrlMap))
+			size_t nodeIdx = binding.GetNodeIndex(motionIdx);
+			if (nodeIdx == VMDBinding::NPos)
 			{
-				auto node = m_model->GetNodeManager()->GetMMDNode(nodeName);
-				if (node != nullptr)
-				{
-					auto val = std::make_pair(
-						nodeName,
-						std::make_unique<VMDNodeController>()
-					);
-					nodeCtrl = val.second.get();
-					nodeCtrl->SetNode(node);
-					nodeCtrlMap.emplace(std::move(val));
-				}
+				continue;
 			}
-			else
+
+			auto& nodeCtrl = nodeCtrls[nodeIdx];
+			if (nodeCtrl == nullptr)
 			{
-				nodeCtrl = (*findIt).second.get();
+				nodeCtrl = std::make_unique<VMDNodeController>();
+				nodeCtrl->SetNode(nodeMan->GetMMDNode(nodeIdx));
 			}
 
+			VMDNodeAnimationKey key;
+			key.Set(vmd.m_motions[motionIdx]);
+			nodeCtrl->AddKey(key);
+		}
+		for (auto& nodeCtrl : nodeCtrls)
+		{
 			if (nodeCtrl != nullptr)
 			{
-				VMDNodeAnimationKey key;
-				key.Set(motion);
-				nodeCtrl->AddKey(key);
+				nodeCtrl->SortKeys();
+				m_nodeControllers.emplace_back(std::move(nodeCtrl));
 			}
 		}
-		m_nodeControllers.reserve(nodeCtrlMap.size());
-		for (auto& pair : nodeCtrlMap)
-		{
-			pair.second->SortKeys();
-			m_nodeControllers.emplace_back(std::move(pair.second));
-		}
-		nodeCtrlMap.clear();
 
 		// IK Contoroller
-		std::map<std::string, IKControllerPtr> ikCtrlMap;
+		auto ikMan = m_model->GetIKManager();
+		std::vector<IKControllerPtr> ikCtrls(ikMan->GetIKSolverCount());
 		for (auto& ikCtrl : m_ikControllers)
 		{
-			std::string name = ikCtrl->GetIkSolver()->GetName();
-			ikCtrlMap.emplace(std::make_pair(name, std::move(ikCtrl)));
+			size_t ikIdx = ikMan->FindIKSolverIndex(ikCtrl->GetIkSolver()->GetName());
+			if (ikIdx == VMDBinding::NPos)
+			{
+				// 名前が変更されている場合は、そのまま残す
+				ikCtrls.emplace_back(std::move(ikCtrl));
+			}
+			else
+			{
+				ikCtrls[ikIdx] = std::move(ikCtrl);
+			}
 		}
 		m_ikControllers.clear();
+		size_t ikInfoIdx = 0;
 		for (const auto& ik : vmd.m_iks)
 		{
 			for (const auto& ikInfo : ik.m_ikInfos)
 			{
-				std::string ikName = ikInfo.m_name.ToUtf8String();
-				auto findIt = ikCtrlMap.find(ikName);
-				VMDIKController* ikCtrl = nullptr;
-				if (findIt == std::end(ikCtrlMap))
-				{
-					auto* ikSolver = m_model->GetIKManager()->GetMMDIKSolver(ikName);
-					if (ikSolver != nullptr)
-					{
-						auto val = std::make_pair(
-							ikName,
-							std::make_unique<VMDIKController>()
-						);
-						ikCtrl = val.second.get();
-						ikCtrl->SetIKSolver(ikSolver);
-						ikCtrlMap.emplace(std::move(val));
-					}
-				}
-				else
+				size_t ikIdx = binding.GetIKSolverIndex(ikInfoIdx++);
+				if (ikIdx == VMDBinding::NPos)
 				{
-					ikCtrl = (*findIt).second.get();
+					continue;
 				}
 
-				if (ikCtrl != nullptr)
+				auto& ikCtrl = ikCtrls[ikIdx];
+				if (ikCtrl == nullptr)
 				{
-					VMDIKAnimationKey key;
-					key.m_time = int32_t(ik.m_frame);
-					key.m_enable = ikInfo.m_enable != 0;
-					ikCtrl->AddKey(key);
+					ikCtrl = std::make_unique<VMDIKController>();
+					ikCtrl->SetIKSolver(ikMan->GetMMDIKSolver(ikIdx));
 				}
+
+				VMDIKAnimationKey key;
+				key.m_time = int32_t(ik.m_frame);
+				key.m_enable = ikInfo.m_enable != 0;
+				ikCtrl->AddKey(key);
 			}
 		}
-		m_ikControllers.reserve(ikCtrlMap.size());
-		for (auto& pair : ikCtrlMap)
+		for (auto& ikCtrl : ikCtrls)
 		{
-			pair.second->SortKeys();
-			m_ikControllers.emplace_back(std::move(pair.second));
+			if (ikCtrl != nullptr)
+			{
+				ikCtrl->SortKeys();
+				m_ikControllers.emplace_back(std::move(ikCtrl));
+			}
 		}
-		ikCtrlMap.clear();
 
 		// Morph Controller
-		std::map<std::string, MorphControllerPtr> morphCtrlMap;
+		auto morphMan = m_model->GetMorphManager();
+		std::vector<MorphControllerPtr> morphCtrls(morphMan->GetMorphCount());
 		for (auto& morphCtrl : m_morphControllers)
 		{
-			std::string name = morphCtrl->GetMorph()->GetName();
-			morphCtrlMap.emplace(std::make_pair(name, std::move(morphCtrl)));
+			size_t morphIdx = morphMan->FindMorphIndex(morphCtrl->GetMorph()->GetName());
+			if (morphIdx == VMDBinding::NPos)
+			{
+				// 名前が変更されている場合は、そのまま残す
+				morphCtrls.emplace_back(std::move(morphCtrl));
+			}
+			else
+			{
+				morphCtrls[morphIdx] = std::move(morphCtrl);
+			}
 		}
 		m_morphControllers.clear();
-		for (const auto& morph : vmd.m_morphs)
+		for (size_t keyIdx = 0; keyIdx < vmd.m_morphs.size(); keyIdx++)
 		{
-			std::string morphName = morph.m_blendShapeName.ToUtf8String();
-			auto findIt = morphCtrlMap.find(morphName);
-			VMDMorphController* morphCtrl = nullptr;
-			if (findIt == std::end(morphCtrlMap))
+			size_t morphIdx = binding.GetMorphIndex(keyIdx);
+			if (morphIdx == VMDBinding::NPos)
 			{
-				auto* mmdMorph = m_model->GetMorphManager()->GetMorph(morphName);
-				if (mmdMorph != nullptr)
-				{
-					auto val = std::make_pair(
-						morphName,
-						std::make_unique<VMDMorphController>()
-					);
-					morphCtrl = val.second.get();
-					morphCtrl->SetBlendKeyShape(mmdMorph);
-					morphCtrlMap.emplace(std::move(val));
-				}
+				continue;
 			}
-			else
+
+			auto& morphCtrl = morphCtrls[morphIdx];
+			if (morphCtrl == nullptr)
 			{
-				morphCtrl = (*findIt).second.get();
+				morphCtrl = std::make_unique<VMDMorphController>();
+				morphCtrl->SetBlendKeyShape(morphMan->GetMorph(morphIdx));
 			}
 
+			const auto& morph = vmd.m_morphs[keyIdx];
+			VMDMorphAnimationKey key;
+			key.m_time = int32_t(morph.m_frame);
+			key.m_weight = morph.m_weight;
+			morphCtrl->AddKey(key);
+		}
+		for (auto& morphCtrl : morphCtrls)
+		{
 			if (morphCtrl != nullptr)
 			{
-				VMDMorphAnimationKey key;
-				key.m_time = int32_t(morph.m_frame);
-				key.m_weight = morph.m_weight;
-				morphCtrl->AddKey(key);
+				morphCtrl->SortKeys();
+				m_morphControllers.emplace_back(std::move(morphCtrl));
 			}
 		}
-		m_morphControllers.reserve(morphCtrlMap.size());
-		for (auto& pair : morphCtrlMap)
-		{
-			pair.second->SortKeys();
-			m_morphControllers.emplace_back(std::move(pair.second));
-		}
-		morphCtrlMap.clear();
 
 		m_maxKeyTime = CalculateMaxKeyTime();
 
@@ -14,12 +14,15 @@
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 namespace saba
 {
+	struct VMDBezierTable;
+
 	struct VMDBezier
 	{
 		float EvalX(float t) const;
@@ -28,8 +31,15 @@ namespace saba
 
 		float FindBezierX(float time) const;
 
+		// 制御点から補間テーブルを用意する (制御点を変更したら再度呼ぶ)
+		// テーブルは同じ制御点の曲線で共有する
+		void Bake();
+		// x に対応する y を求める (Bake していない場合は FindBezierX を使う)
+		float EvalYFromX(float x) const;
+
 		glm::vec2	m_cp1;
 		glm::vec2	m_cp2;
+		const VMDBezierTable*	m_table = nullptr;
 	};
 
 	struct VMDNodeAnimationKey
@@ -133,6 +143,61 @@ namespace saba
 		size_t					m_startKeyIndex;
 	};
 
+	/*
+	VMD のボーン名、IK 名、モーフ名をモデルのインデックスに解決したもの。
+	名前の変換 (SJIS -> UTF-8) と検索は、キー毎ではなく名前毎に一度だけ行う。
+	同じ構造のモデル (同じファイルから読み込んだモデル等) であれば、
+	一度 Bind した結果をそのまま使い回せる。
+	*/
+	class VMDBinding
+	{
+	public:
+		static const size_t NPos = -1;
+
+		// VMD に含まれる名前を集める
+		void Create(const VMDFile& vmd);
+		// 名前をモデルのインデックスへ解決する
+		bool Bind(MMDModel* model);
+		void Clear();
+
+		// Bind したモデルと同じ構造か (要素数と、解決した名前で判定する)
+		bool IsCompatible(MMDModel* model) const;
+		// Create した VMD と同じキー数か
+		bool IsCompatible(const VMDFile& vmd) const;
+
+		// VMDFile のキーの並びでアクセスする (NPos : モデルに無い)
+		// IK は m_iks の m_ikInfos を順に並べたもの
+		size_t GetNodeIndex(size_t motionIdx) const { return GetIndex(m_nodeTracks, motionIdx); }
+		size_t GetIKSolverIndex(size_t ikInfoIdx) const { return GetIndex(m_ikTracks, ikInfoIdx); }
+		size_t GetMorphIndex(size_t morphIdx) const { return GetIndex(m_morphTracks, morphIdx); }
+
+		size_t GetNodeTrackCount() const { return m_nodeTracks.m_names.size(); }
+		size_t GetIKTrackCount() const { return m_ikTracks.m_names.size(); }
+		size_t GetMorphTrackCount() const { return m_morphTracks.m_names.size(); }
+
+	private:
+		struct Tracks
+		{
+			std::vector<std::string>	m_names;
+			std::vector<size_t>			m_indices;		// モデル側のインデックス
+			std::vector<uint32_t>		m_keyTracks;	// キー毎のトラック番号
+		};
+
+		static size_t GetIndex(const Tracks& tracks, size_t keyIdx)
+		{
+			return tracks.m_indices[tracks.m_keyTracks[keyIdx]];
+		}
+
+	private:
+		Tracks	m_nodeTracks;
+		Tracks	m_ikTracks;
+		Tracks	m_morphTracks;
+		size_t	m_nodeCount = 0;
+		size_t	m_ikSolverCount = 0;
+		size_t	m_morphCount = 0;
+		bool	m_isBound = false;
+	};
+
 	class VMDAnimation
 	{
 	public:
@@ -140,6 +205,8 @@ namespace saba
 
 		bool Create(std::shared_ptr<MMDModel> model);
 		bool Add(const VMDFile& vmd);
+		// binding は vmd から Create し、このモデルと同じ構造のモデルへ Bind したもの
+		bool Add(const VMDFile& vmd, const VMDBinding& binding);
 		void Destroy();
 
 		void Evaluate(float t, float weight = 1.0f);
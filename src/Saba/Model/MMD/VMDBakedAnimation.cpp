@@ -0,0 +1,609 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "VMDBakedAnimation.h"
+
+#include <Saba/Base/Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/quaternion.hpp>
+
+namespace saba
+{
+	namespace
+	{
+		const char		BakedAnimationMagic[8] = { 'S', 'a', 'b', 'a', 'V', 'B', 'A', '\0' };
+		const uint32_t	BakedAnimationVersion = 2;
+		const uint32_t	BakedAnimationFlagIK = 0x1;
+		const size_t	BakedAnimationFrameAlign = 16;
+
+		struct BakedAnimationHeader
+		{
+			char		m_magic[8];
+			uint32_t	m_version;
+			uint32_t	m_flags;
+			uint32_t	m_frameCount;
+			uint32_t	m_nodeCount;
+			uint32_t	m_morphCount;
+			uint32_t	m_ikCount;
+			uint32_t	m_translateNodeCount;
+			uint32_t	m_frameSize;
+		};
+
+		size_t Align(size_t size, size_t align)
+		{
+			return (size + align - 1) / align * align;
+		}
+
+		void PackRotate(const glm::quat& q, int16_t* dst)
+		{
+			const float v[4] = { q.x, q.y, q.z, q.w };
+			for (int i = 0; i < 4; i++)
+			{
+				float c = glm::clamp(v[i], -1.0f, 1.0f);
+				dst[i] = int16_t(std::round(c * 32767.0f));
+			}
+		}
+
+		glm::quat UnpackRotate(const int16_t* src)
+		{
+			const float s = 1.0f / 32767.0f;
+			return glm::normalize(glm::quat(float(src[3]) * s, float(src[0]) * s, float(src[1]) * s, float(src[2]) * s));
+		}
+
+		template <typename T>
+		T ReadFrameValue(const uint8_t* frame, size_t offset)
+		{
+			T value;
+			memcpy(&value, frame + offset, sizeof(T));
+			return value;
+		}
+
+		template <typename T>
+		void WriteFrameValue(uint8_t* frame, size_t offset, const T& value)
+		{
+			memcpy(frame + offset, &value, sizeof(T));
+		}
+
+		bool WriteString(File& file, const std::string& str)
+		{
+			uint32_t len = uint32_t(str.size());
+			return file.Write(&len) && (len == 0 || file.Write(str.data(), len));
+		}
+
+		bool ReadString(BufferReader& reader, std::string* str)
+		{
+			uint32_t len = 0;
+			if (!reader.Read(&len) || !reader.CanRead(len))
+			{
+				return false;
+			}
+			const uint8_t* data = reader.ReadView(len);
+			str->assign(reinterpret_cast<const char*>(data), len);
+			return true;
+		}
+	}
+
+	VMDBakedAnimation::VMDBakedAnimation()
+	{
+		Clear();
+	}
+
+	VMDBakedAnimation::~VMDBakedAnimation()
+	{
+		Destroy();
+	}
+
+	bool VMDBakedAnimation::Create(std::shared_ptr<MMDModel> model)
+	{
+		m_model = model;
+		if (m_frameCount != 0 && !IsCompatible())
+		{
+			SABA_ERROR("VMDBakedAnimation : Model layout does not match.");
+			return false;
+		}
+		return true;
+	}
+
+	bool VMDBakedAnimation::Bake(VMDAnimation * vmdAnim, bool bakeIK)
+	{
+		if (m_model == nullptr || vmdAnim == nullptr)
+		{
+			SABA_ERROR("VMDBakedAnimation : Model or animation is null.");
+			return false;
+		}
+
+		Clear();
+
+		auto nodeMan = m_model->GetNodeManager();
+		auto morphMan = m_model->GetMorphManager();
+		auto ikMan = m_model->GetIKManager();
+		const size_t nodeCount = nodeMan->GetNodeCount();
+		const size_t morphCount = morphMan->GetMorphCount();
+		const size_t ikCount = ikMan->GetIKSolverCount();
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			m_nodeNames.push_back(nodeMan->GetMMDNode(i)->GetName());
+		}
+		for (size_t i = 0; i < morphCount; i++)
+		{
+			m_morphNames.push_back(morphMan->GetMorph(i)->GetName());
+		}
+		for (size_t i = 0; i < ikCount; i++)
+		{
+			m_ikNames.push_back(ikMan->GetMMDIKSolver(i)->GetName());
+		}
+
+		m_isIKBaked = bakeIK;
+		m_frameCount = uint32_t(std::max(vmdAnim->GetMaxKeyTime(), 0) + 1);
+
+		// 一旦全フレームを評価してから、移動を持つノードを選んで詰める
+		std::vector<glm::vec3> translates(m_frameCount * nodeCount);
+		std::vector<glm::quat> rotates(m_frameCount * nodeCount);
+		std::vector<float> morphWeights(m_frameCount * morphCount);
+		std::vector<uint8_t> ikEnables(m_frameCount * ikCount);
+
+		const bool enableIKAndAppend = m_model->IsIKAndAppendEnabled();
+		m_model->EnableIKAndAppend(true);
+		m_model->InitializeAnimation();
+		for (uint32_t frame = 0; frame < m_frameCount; frame++)
+		{
+			m_model->BeginAnimation();
+			vmdAnim->Evaluate(float(frame));
+
+			for (size_t i = 0; i < morphCount; i++)
+			{
+				morphWeights[frame * morphCount + i] = morphMan->GetMorph(i)->GetWeight();
+			}
+			for (size_t i = 0; i < ikCount; i++)
+			{
+				ikEnables[frame * ikCount + i] = ikMan->GetMMDIKSolver(i)->Enabled() ? 1 : 0;
+			}
+
+			if (bakeIK)
+			{
+				m_model->UpdateMorphAnimation();
+				m_model->UpdateNodeAnimation(false);
+				m_model->UpdateNodeAnimation(true);
+
+				for (size_t i = 0; i < nodeCount; i++)
+				{
+					auto node = nodeMan->GetMMDNode(i);
+					const auto& local = node->GetLocalTransform();
+					const auto& scale = node->GetScale();
+					glm::mat3 rotateMat(
+						glm::vec3(local[0]) / scale.x,
+						glm::vec3(local[1]) / scale.y,
+						glm::vec3(local[2]) / scale.z
+					);
+					translates[frame * nodeCount + i] = glm::vec3(local[3]) - node->GetInitialTranslate();
+					rotates[frame * nodeCount + i] = glm::normalize(glm::quat_cast(rotateMat));
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < nodeCount; i++)
+				{
+					auto node = nodeMan->GetMMDNode(i);
+					translates[frame * nodeCount + i] = node->GetAnimationTranslate();
+					rotates[frame * nodeCount + i] = node->GetAnimationRotate();
+				}
+			}
+
+			m_model->EndAnimation();
+		}
+		m_model->EnableIKAndAppend(enableIKAndAppend);
+		m_model->InitializeAnimation();
+
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			for (uint32_t frame = 0; frame < m_frameCount; frame++)
+			{
+				if (translates[frame * nodeCount + i] != glm::vec3(0))
+				{
+					m_translateNodes.push_back(uint32_t(i));
+					break;
+				}
+			}
+		}
+
+		SetupLayout();
+		m_frames.resize(m_frameSize * m_frameCount, 0);
+		for (uint32_t frame = 0; frame < m_frameCount; frame++)
+		{
+			uint8_t* dst = &m_frames[m_frameSize * frame];
+			for (size_t i = 0; i < m_translateNodes.size(); i++)
+			{
+				const auto& t = translates[frame * nodeCount + m_translateNodes[i]];
+				WriteFrameValue(dst, m_translateOffset + sizeof(glm::vec3) * i, t);
+			}
+			for (size_t i = 0; i < nodeCount; i++)
+			{
+				int16_t packed[4];
+				PackRotate(rotates[frame * nodeCount + i], packed);
+				WriteFrameValue(dst, m_rotateOffset + sizeof(packed) * i, packed);
+			}
+			for (size_t i = 0; i < morphCount; i++)
+			{
+				WriteFrameValue(dst, m_morphOffset + sizeof(float) * i, morphWeights[frame * morphCount + i]);
+			}
+			for (size_t i = 0; i < ikCount; i++)
+			{
+				if (ikEnables[frame * ikCount + i] != 0)
+				{
+					dst[m_ikOffset + i / 8] |= uint8_t(1 << (i % 8));
+				}
+			}
+		}
+
+		SABA_INFO("VMDBakedAnimation : Bake frames [{}] size [{}]", m_frameCount, m_frames.size());
+
+		return true;
+	}
+
+	bool VMDBakedAnimation::Save(const std::string & filepath) const
+	{
+		if (m_frames.size() != m_frameSize * m_frameCount || m_frameCount == 0)
+		{
+			SABA_ERROR("VMDBakedAnimation : Frames are not in memory.");
+			return false;
+		}
+
+		File file;
+		if (!file.Create(filepath))
+		{
+			SABA_ERROR("VMDBakedAnimation : Failed to create file. {}", filepath);
+			return false;
+		}
+
+		BakedAnimationHeader header;
+		memcpy(header.m_magic, BakedAnimationMagic, sizeof(header.m_magic));
+		header.m_version = BakedAnimationVersion;
+		header.m_flags = m_isIKBaked ? BakedAnimationFlagIK : 0;
+		header.m_frameCount = m_frameCount;
+		header.m_nodeCount = uint32_t(m_nodeNames.size());
+		header.m_morphCount = uint32_t(m_morphNames.size());
+		header.m_ikCount = uint32_t(m_ikNames.size());
+		header.m_translateNodeCount = uint32_t(m_translateNodes.size());
+		header.m_frameSize = uint32_t(m_frameSize);
+
+		bool ret = file.Write(&header);
+		for (const auto& names : { &m_nodeNames, &m_morphNames, &m_ikNames })
+		{
+			for (const auto& name : *names)
+			{
+				ret = ret && WriteString(file, name);
+			}
+		}
+		if (!m_translateNodes.empty())
+		{
+			ret = ret && file.Write(m_translateNodes.data(), m_translateNodes.size());
+		}
+
+		// フレームはファイル先頭からアラインした位置に置く
+		const uint8_t padding[BakedAnimationFrameAlign] = {};
+		size_t paddingSize = Align(size_t(file.Tell()), BakedAnimationFrameAlign) - size_t(file.Tell());
+		if (paddingSize != 0)
+		{
+			ret = ret && file.Write(padding, paddingSize);
+		}
+		ret = ret && file.Write(m_frames.data(), m_frames.size());
+
+		if (!ret)
+		{
+			SABA_ERROR("VMDBakedAnimation : Failed to write file. {}", filepath);
+			return false;
+		}
+		return true;
+	}
+
+	bool VMDBakedAnimation::Load(const std::string & filepath)
+	{
+		if (!OpenStream(filepath))
+		{
+			return false;
+		}
+
+		const uint8_t* frames = m_mappedFile.GetData() + m_fileFrameOffset;
+		m_frames.assign(frames, frames + m_frameSize * m_frameCount);
+		m_mappedFile.Close();
+		return true;
+	}
+
+	bool VMDBakedAnimation::OpenStream(const std::string & filepath)
+	{
+		Clear();
+
+		if (!m_mappedFile.Open(filepath))
+		{
+			SABA_ERROR("VMDBakedAnimation : Failed to open file. {}", filepath);
+			return false;
+		}
+
+		BufferReader reader(m_mappedFile.GetData(), m_mappedFile.GetSize());
+		if (!ReadHeader(reader))
+		{
+			SABA_ERROR("VMDBakedAnimation : Failed to read file. {}", filepath);
+			Clear();
+			return false;
+		}
+		return true;
+	}
+
+	void VMDBakedAnimation::Destroy()
+	{
+		Clear();
+		m_model.reset();
+	}
+
+	void VMDBakedAnimation::Evaluate(float t, float weight)
+	{
+		EvaluateMorph(t, weight);
+		EvaluateNode(t, weight);
+	}
+
+	void VMDBakedAnimation::EvaluateMorph(float t, float weight)
+	{
+		FrameSample sample;
+		if (!GetFrameSample(t, &sample))
+		{
+			return;
+		}
+
+		auto morphMan = m_model->GetMorphManager();
+		for (size_t i = 0; i < m_morphNames.size(); i++)
+		{
+			const size_t offset = m_morphOffset + sizeof(float) * i;
+			float w0 = ReadFrameValue<float>(sample.m_frame0, offset);
+			float w1 = ReadFrameValue<float>(sample.m_frame1, offset);
+			float w = w0 + (w1 - w0) * sample.m_rate;
+
+			auto morph = morphMan->GetMorph(i);
+			if (weight == 1.0f)
+			{
+				morph->SetWeight(w);
+			}
+			else
+			{
+				morph->SetWeight(glm::mix(morph->GetBaseAnimationWeight(), w, weight));
+			}
+		}
+	}
+
+	void VMDBakedAnimation::EvaluateNode(float t, float weight)
+	{
+		FrameSample sample;
+		if (!GetFrameSample(t, &sample))
+		{
+			return;
+		}
+
+		auto nodeMan = m_model->GetNodeManager();
+		const size_t nodeCount = m_nodeNames.size();
+		size_t translateIdx = 0;
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			glm::vec3 vt(0);
+			if (translateIdx < m_translateNodes.size() && m_translateNodes[translateIdx] == i)
+			{
+				const size_t offset = m_translateOffset + sizeof(glm::vec3) * translateIdx;
+				auto t0 = ReadFrameValue<glm::vec3>(sample.m_frame0, offset);
+				auto t1 = ReadFrameValue<glm::vec3>(sample.m_frame1, offset);
+				vt = glm::mix(t0, t1, sample.m_rate);
+				translateIdx++;
+			}
+
+			const size_t rotateOffset = m_rotateOffset + sizeof(int16_t) * 4 * i;
+			auto q0 = UnpackRotate(reinterpret_cast<const int16_t*>(sample.m_frame0 + rotateOffset));
+			auto q1 = UnpackRotate(reinterpret_cast<const int16_t*>(sample.m_frame1 + rotateOffset));
+			glm::quat q = sample.m_rate == 0.0f ? q0 : glm::slerp(q0, q1, sample.m_rate);
+
+			auto node = nodeMan->GetMMDNode(i);
+			if (m_isIKBaked)
+			{
+				// IK と付与を計算した後のローカルのポーズを、アニメーションの値に戻す
+				vt = node->GetInitialTranslate() + vt - node->GetTranslate();
+				q = q * glm::inverse(node->GetRotate());
+				node->SetIKRotate(glm::quat(1, 0, 0, 0));
+			}
+
+			if (weight == 1.0f)
+			{
+				node->SetAnimationRotate(q);
+				node->SetAnimationTranslate(vt);
+			}
+			else
+			{
+				auto baseQ = node->GetBaseAnimationRotate();
+				auto baseT = node->GetBaseAnimationTranslate();
+				node->SetAnimationRotate(glm::slerp(baseQ, q, weight));
+				node->SetAnimationTranslate(glm::mix(baseT, vt, weight));
+			}
+		}
+
+		if (!m_isIKBaked)
+		{
+			auto ikMan = m_model->GetIKManager();
+			for (size_t i = 0; i < m_ikNames.size(); i++)
+			{
+				auto ikSolver = ikMan->GetMMDIKSolver(i);
+				if (weight < 1.0f)
+				{
+					ikSolver->Enable(ikSolver->GetBaseAnimationEnabled());
+				}
+				else
+				{
+					bool enable = (sample.m_frame0[m_ikOffset + i / 8] & (1 << (i % 8))) != 0;
+					ikSolver->Enable(enable);
+				}
+			}
+		}
+	}
+
+	void VMDBakedAnimation::Clear()
+	{
+		m_isIKBaked = false;
+		m_frameCount = 0;
+		m_nodeNames.clear();
+		m_morphNames.clear();
+		m_ikNames.clear();
+		m_translateNodes.clear();
+		m_translateOffset = 0;
+		m_rotateOffset = 0;
+		m_morphOffset = 0;
+		m_ikOffset = 0;
+		m_frameSize = 0;
+		m_frames.clear();
+		m_mappedFile.Close();
+		m_fileFrameOffset = 0;
+	}
+
+	void VMDBakedAnimation::SetupLayout()
+	{
+		// [移動 (vec3) x 移動を持つノード数][回転 (int16 x 4) x ノード数][モーフ (float) x モーフ数][IK (bit) x IK 数]
+		m_translateOffset = 0;
+		m_rotateOffset = m_translateOffset + sizeof(glm::vec3) * m_translateNodes.size();
+		m_morphOffset = m_rotateOffset + sizeof(int16_t) * 4 * m_nodeNames.size();
+		m_ikOffset = m_morphOffset + sizeof(float) * m_morphNames.size();
+		// どのフレームもアラインした位置から始まるようにする
+		m_frameSize = Align(m_ikOffset + (m_ikNames.size() + 7) / 8, BakedAnimationFrameAlign);
+	}
+
+	bool VMDBakedAnimation::ReadHeader(BufferReader & reader)
+	{
+		BakedAnimationHeader header;
+		if (!reader.Read(&header))
+		{
+			return false;
+		}
+		if (memcmp(header.m_magic, BakedAnimationMagic, sizeof(header.m_magic)) != 0 ||
+			header.m_version != BakedAnimationVersion)
+		{
+			SABA_ERROR("VMDBakedAnimation : Unsupported format.");
+			return false;
+		}
+
+		m_isIKBaked = (header.m_flags & BakedAnimationFlagIK) != 0;
+		m_frameCount = header.m_frameCount;
+		const uint32_t fileSize = uint32_t(std::min<File::Offset>(reader.GetSize(), UINT32_MAX));
+		if (header.m_nodeCount > fileSize || header.m_morphCount > fileSize ||
+			header.m_ikCount > fileSize || header.m_translateNodeCount > header.m_nodeCount)
+		{
+			return false;
+		}
+
+		m_nodeNames.resize(header.m_nodeCount);
+		m_morphNames.resize(header.m_morphCount);
+		m_ikNames.resize(header.m_ikCount);
+		for (auto names : { &m_nodeNames, &m_morphNames, &m_ikNames })
+		{
+			for (auto& name : *names)
+			{
+				if (!ReadString(reader, &name))
+				{
+					return false;
+				}
+			}
+		}
+
+		m_translateNodes.resize(header.m_translateNodeCount);
+		if (!m_translateNodes.empty() && !reader.Read(m_translateNodes.data(), m_translateNodes.size()))
+		{
+			return false;
+		}
+		for (size_t i = 0; i < m_translateNodes.size(); i++)
+		{
+			if (m_translateNodes[i] >= header.m_nodeCount ||
+				(i != 0 && m_translateNodes[i] <= m_translateNodes[i - 1]))
+			{
+				return false;
+			}
+		}
+
+		SetupLayout();
+		m_fileFrameOffset = Align(size_t(reader.Tell()), BakedAnimationFrameAlign);
+		if (header.m_frameSize != m_frameSize || m_frameCount == 0 ||
+			uint64_t(reader.GetSize()) < uint64_t(m_fileFrameOffset) + uint64_t(m_frameSize) * m_frameCount)
+		{
+			return false;
+		}
+
+		if (m_model != nullptr && !IsCompatible())
+		{
+			SABA_ERROR("VMDBakedAnimation : Model layout does not match.");
+			return false;
+		}
+		return true;
+	}
+
+	bool VMDBakedAnimation::IsCompatible() const
+	{
+		auto nodeMan = m_model->GetNodeManager();
+		auto morphMan = m_model->GetMorphManager();
+		auto ikMan = m_model->GetIKManager();
+		if (nodeMan->GetNodeCount() != m_nodeNames.size() ||
+			morphMan->GetMorphCount() != m_morphNames.size() ||
+			ikMan->GetIKSolverCount() != m_ikNames.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < m_nodeNames.size(); i++)
+		{
+			if (nodeMan->GetMMDNode(i)->GetName() != m_nodeNames[i])
+			{
+				return false;
+			}
+		}
+		for (size_t i = 0; i < m_morphNames.size(); i++)
+		{
+			if (morphMan->GetMorph(i)->GetName() != m_morphNames[i])
+			{
+				return false;
+			}
+		}
+		for (size_t i = 0; i < m_ikNames.size(); i++)
+		{
+			if (ikMan->GetMMDIKSolver(i)->GetName() != m_ikNames[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool VMDBakedAnimation::GetFrameSample(float t, FrameSample* sample)
+	{
+		if (m_model == nullptr || m_frameCount == 0)
+		{
+			return false;
+		}
+
+		const float lastFrame = float(m_frameCount - 1);
+		t = glm::clamp(t, 0.0f, lastFrame);
+		const uint32_t frame0 = std::min(uint32_t(t), m_frameCount - 1);
+		const uint32_t frame1 = std::min(frame0 + 1, m_frameCount - 1);
+
+		sample->m_frame0 = GetFrame(frame0);
+		sample->m_frame1 = GetFrame(frame1);
+		sample->m_rate = t - float(frame0);
+		return sample->m_frame0 != nullptr && sample->m_frame1 != nullptr;
+	}
+
+	const uint8_t* VMDBakedAnimation::GetFrame(uint32_t frameIdx)
+	{
+		if (!m_frames.empty())
+		{
+			return &m_frames[m_frameSize * frameIdx];
+		}
+
+		if (!m_mappedFile.IsOpen())
+		{
+			return nullptr;
+		}
+		return m_mappedFile.GetData() + m_fileFrameOffset + m_frameSize * frameIdx;
+	}
+}
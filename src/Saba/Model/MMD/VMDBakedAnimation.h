@@ -0,0 +1,102 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_VMDBAKEDANIMATION_H_
+#define SABA_MODEL_MMD_VMDBAKEDANIMATION_H_
+
+#include "MMDModel.h"
+#include "VMDAnimation.h"
+
+#include <Saba/Base/File.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace saba
+{
+	/*
+	VMDAnimation を 1 フレーム毎に評価した結果 (ノードの移動、回転、モーフのウェイト) を
+	フレーム単位の連続した固定長のバッファとして保持する。
+	Evaluate は前後の 2 フレームを補間するだけになる。
+
+	IK と付与を含めてベイクした場合は、それらを計算した後のローカルのポーズを保持し、
+	再生時は IK と付与の計算を行わない (MMDModel::EnableIKAndAppend)。
+	物理演算の結果は含まない。
+
+	ファイルに保存でき、全体を読み込むか、ファイルをマップしてフレームをそのまま参照して再生できる。
+	フレームは固定長で、ファイルとメモリのどちらでも 16 バイトにアラインした位置から始まる。
+	同じ構造 (ノード、モーフ、IK の名前と順番) のモデルでのみ再生できる。
+	*/
+	class VMDBakedAnimation
+	{
+	public:
+		VMDBakedAnimation();
+		~VMDBakedAnimation();
+
+		VMDBakedAnimation(const VMDBakedAnimation&) = delete;
+		VMDBakedAnimation& operator = (const VMDBakedAnimation&) = delete;
+
+		bool Create(std::shared_ptr<MMDModel> model);
+		// モデルのアニメーションはベイク後に初期化される
+		bool Bake(VMDAnimation* vmdAnim, bool bakeIK = false);
+		bool Save(const std::string& filepath) const;
+		// ファイル全体を読み込む
+		bool Load(const std::string& filepath);
+		// ファイルをマップし、再生時にフレームを直接参照する (ファイルは開いたままになる)
+		bool OpenStream(const std::string& filepath);
+		void Destroy();
+
+		// IK と付与を含めてベイクした場合は、UpdateMorphAnimation の後に EvaluateNode を呼ぶこと
+		void Evaluate(float t, float weight = 1.0f);
+		void EvaluateMorph(float t, float weight = 1.0f);
+		void EvaluateNode(float t, float weight = 1.0f);
+
+		bool IsIKBaked() const { return m_isIKBaked; }
+		uint32_t GetFrameCount() const { return m_frameCount; }
+		int32_t GetMaxKeyTime() const { return m_frameCount == 0 ? 0 : int32_t(m_frameCount - 1); }
+
+	private:
+		struct FrameSample
+		{
+			const uint8_t*	m_frame0;
+			const uint8_t*	m_frame1;
+			float			m_rate;
+		};
+
+		void Clear();
+		void SetupLayout();
+		bool ReadHeader(BufferReader& reader);
+		bool IsCompatible() const;
+		bool GetFrameSample(float t, FrameSample* sample);
+		const uint8_t* GetFrame(uint32_t frameIdx);
+
+	private:
+		std::shared_ptr<MMDModel>	m_model;
+
+		bool						m_isIKBaked;
+		uint32_t					m_frameCount;
+		std::vector<std::string>	m_nodeNames;
+		std::vector<std::string>	m_morphNames;
+		std::vector<std::string>	m_ikNames;
+		std::vector<uint32_t>		m_translateNodes;	// 移動を持つノード
+
+		// フレームのレイアウト
+		size_t	m_translateOffset;
+		size_t	m_rotateOffset;
+		size_t	m_morphOffset;
+		size_t	m_ikOffset;
+		size_t	m_frameSize;
+
+		std::vector<uint8_t>	m_frames;
+
+		// ストリーム再生
+		MappedFile				m_mappedFile;
+		size_t					m_fileFrameOffset;
+	};
+}
+
+#endif // !SABA_MODEL_MMD_VMDBAKEDANIMATION_H_
@@ -8,17 +8,19 @@
 #include <Saba/Base/Log.h>
 #include <Saba/Base/File.h>
 
+#include <cstring>
+
 namespace saba
 {
 	namespace
 	{
 		template <typename T>
-		bool Read(T* val, File& file)
+		bool Read(T* val, BufferReader& file)
 		{
 			return file.Read(val);
 		}
 
-		bool ReadHeader(VMDFile* vmd, File& file)
+		bool ReadHeader(VMDFile* vmd, BufferReader& file)
 		{
 			Read(&vmd->m_header.m_header, file);
 			Read(&vmd->m_header.m_modelName, file);
@@ -34,10 +36,20 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadMotion(VMDFile* vmd, File& file)
+		bool ReadMotion(VMDFile* vmd, BufferReader& file)
 		{
+			// ボーン名 (15) + フレーム (4) + 位置 (12) + 回転 (16) + 補間 (64)
+			const size_t MotionRecordSize = 111;
+
 			uint32_t motionCount = 0;
-			if (!Read(&motionCount, file))
+			if (!Read(&motionCount, file) || !file.CanRead(motionCount, MotionRecordSize))
+			{
+				return false;
+			}
+
+			// 固定長のレコードなので、まとめて参照してから展開する
+			const uint8_t* records = file.ReadView(size_t(motionCount) * MotionRecordSize);
+			if (records == nullptr)
 			{
 				return false;
 			}
@@ -45,20 +57,26 @@ namespace saba
 			vmd->m_motions.resize(motionCount);
 			for (auto& motion : vmd->m_motions)
 			{
-				Read(&motion.m_boneName, file);
-				Read(&motion.m_frame, file);
-				Read(&motion.m_translate, file);
-				Read(&motion.m_quaternion, file);
-				Read(&motion.m_interpolation, file);
+				const uint8_t* record = records;
+				memcpy(motion.m_boneName.m_buffer, record, 15);
+				record += 15;
+				memcpy(&motion.m_frame, record, sizeof(uint32_t));
+				record += sizeof(uint32_t);
+				memcpy(&motion.m_translate, record, sizeof(float) * 3);
+				record += sizeof(float) * 3;
+				memcpy(&motion.m_quaternion, record, sizeof(float) * 4);
+				record += sizeof(float) * 4;
+				memcpy(motion.m_interpolation.data(), record, motion.m_interpolation.size());
+				records += MotionRecordSize;
 			}
 
 			return !file.IsBad();
 		}
 
-		bool ReadBlendShape(VMDFile* vmd, File& file)
+		bool ReadBlendShape(VMDFile* vmd, BufferReader& file)
 		{
 			uint32_t blendShapeCount = 0;
-			if (!Read(&blendShapeCount, file))
+			if (!Read(&blendShapeCount, file) || !file.CanRead(blendShapeCount))
 			{
 				return false;
 			}
@@ -74,10 +92,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadCamera(VMDFile* vmd, File& file)
+		bool ReadCamera(VMDFile* vmd, BufferReader& file)
 		{
 			uint32_t cameraCount = 0;
-			if (!Read(&cameraCount, file))
+			if (!Read(&cameraCount, file) || !file.CanRead(cameraCount))
 			{
 				return false;
 			}
@@ -97,10 +115,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadLight(VMDFile* vmd, File& file)
+		bool ReadLight(VMDFile* vmd, BufferReader& file)
 		{
 			uint32_t lightCount = 0;
-			if (!Read(&lightCount, file))
+			if (!Read(&lightCount, file) || !file.CanRead(lightCount))
 			{
 				return false;
 			}
@@ -116,10 +134,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadShadow(VMDFile* vmd, File& file)
+		bool ReadShadow(VMDFile* vmd, BufferReader& file)
 		{
 			uint32_t shadowCount = 0;
-			if (!Read(&shadowCount, file))
+			if (!Read(&shadowCount, file) || !file.CanRead(shadowCount))
 			{
 				return false;
 			}
@@ -135,10 +153,10 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadIK(VMDFile* vmd, File& file)
+		bool ReadIK(VMDFile* vmd, BufferReader& file)
 		{
 			uint32_t ikCount = 0;
-			if (!Read(&ikCount, file))
+			if (!Read(&ikCount, file) || !file.CanRead(ikCount))
 			{
 				return false;
 			}
@@ -149,7 +167,7 @@ namespace saba
 				Read(&ik.m_frame, file);
 				Read(&ik.m_show, file);
 				uint32_t ikInfoCount = 0;
-				if (!Read(&ikInfoCount, file))
+				if (!Read(&ikInfoCount, file) || !file.CanRead(ikInfoCount))
 				{
 					return false;
 				}
@@ -164,7 +182,7 @@ namespace saba
 			return !file.IsBad();
 		}
 
-		bool ReadVMDFile(VMDFile* vmd, File& file)
+		bool ReadVMDFile(VMDFile* vmd, BufferReader& file)
 		{
 			if (!ReadHeader(vmd, file))
 			{
@@ -229,14 +247,15 @@ namespace saba
 
 	bool ReadVMDFile(VMDFile * vmd, const char * filename)
 	{
-		File file;
+		MappedFile file;
 		if (!file.Open(filename))
 		{
 			SABA_WARN("VMD File Open Fail. {}", filename);
 			return false;
 		}
+		BufferReader reader(file.GetData(), file.GetSize());
 
-		return ReadVMDFile(vmd, file);
+		return ReadVMDFile(vmd, reader);
 	}
 
 }
@@ -689,4 +689,45 @@ namespace saba
 		return CreateShaderProgram(ppVsCode.c_str(), ppFsCode.c_str());
 	}
 
+	GLProgramObject GLSLShaderUtil::CreateTransformFeedbackProgram(const char * shaderName, const char * const * varyings, GLsizei varyingCount)
+	{
+		std::string vsFilePath = PathUtil::Combine(m_shaderDir, shaderName) + ".vert";
+
+		std::string vsCode;
+		{
+			SABA_INFO("Vertex Shader File Open. {}", vsFilePath);
+			TextFileReader glslFile(vsFilePath);
+			if (!glslFile.IsOpen())
+			{
+				SABA_WARN("Open fail.");
+				return GLProgramObject();
+			}
+			vsCode = glslFile.ReadAll();
+		}
+
+		GLSLInclude include = m_include;
+		if (!m_shaderDir.empty())
+		{
+			include.AddInclude(m_shaderDir);
+		}
+
+		std::string ppMessage;
+		std::string ppVsCode;
+		bool ret = PreprocessGLSL(
+			&ppVsCode,
+			GLSLShaderLang::Vertex,
+			vsCode,
+			m_define,
+			include,
+			&ppMessage);
+		if (!ret)
+		{
+			std::cout << "preprocess fail.\n";
+			std::cout << ppMessage;
+			return GLProgramObject();
+		}
+
+		return CreateTransformFeedbackShaderProgram(ppVsCode.c_str(), varyings, varyingCount);
+	}
+
 }
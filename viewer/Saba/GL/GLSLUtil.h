@@ -85,6 +85,8 @@ namespace saba
 
 		GLProgramObject CreateProgram(const char* shaderName);
 		GLProgramObject CreateProgram(const char* vsCode, const char* fsCode);
+		// shaderName.vert だけを使う Transform Feedback 用のプログラム
+		GLProgramObject CreateTransformFeedbackProgram(const char* shaderName, const char* const* varyings, GLsizei varyingCount);
 
 	private:
 		std::string	m_shaderDir;
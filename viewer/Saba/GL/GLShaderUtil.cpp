@@ -82,6 +82,43 @@ namespace saba
 
 			return shader;
 		}
+
+		GLProgramObject LinkShaderProgram(GLProgramObject prog)
+		{
+			std::cout << "Start: Shader Program Link\n";
+
+			glLinkProgram(prog);
+
+			GLint infoLength;
+			glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &infoLength);
+			if (infoLength != 0)
+			{
+				std::vector<char> info;
+				info.reserve(size_t(infoLength) + 1);
+				info.resize(infoLength);
+
+				GLsizei len;
+				glGetProgramInfoLog(prog, infoLength, &len, &info[0]);
+				if (info[size_t(infoLength) - 1] != '\0')
+				{
+					info.push_back('\0');
+				}
+
+				std::cout << &info[0] << "\n";
+			}
+
+			GLint linkStatus;
+			glGetProgramiv(prog, GL_LINK_STATUS, &linkStatus);
+
+			if (linkStatus != GL_TRUE)
+			{
+				return GLProgramObject();
+			}
+
+			std::cout << "Success: Shader Program Link\n";
+
+			return prog;
+		}
 	}
 
 	GLProgramObject CreateShaderProgram(const char * vsCode, const char * fsCode)
@@ -101,41 +138,33 @@ namespace saba
 		GLProgramObject prog;
 		prog.Create();
 
-		std::cout << "Start: Shader Program Link\n";
-
 		glAttachShader(prog, vs);
 		glAttachShader(prog, fs);
-		glLinkProgram(prog);
-
-		GLint infoLength;
-		glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &infoLength);
-		if (infoLength != 0)
-		{
-			std::vector<char> info;
-			info.reserve(size_t(infoLength) + 1);
-			info.resize(infoLength);
-
-			GLsizei len;
-			glGetProgramInfoLog(prog, infoLength, &len, &info[0]);
-			if (info[size_t(infoLength) - 1] != '\0')
-			{
-				info.push_back('\0');
-			}
 
-			std::cout << &info[0] << "\n";
-		}
-
-		GLint linkStatus;
-		glGetProgramiv(prog, GL_LINK_STATUS, &linkStatus);
+		return LinkShaderProgram(std::move(prog));
+	}
 
-		if (linkStatus != GL_TRUE)
+	GLProgramObject CreateTransformFeedbackShaderProgram(
+		const char*			vsCode,
+		const char* const*	varyings,
+		GLsizei				varyingCount,
+		GLenum				bufferMode
+	)
+	{
+		GLVertexShaderObject vs(CreateShader<GL_VERTEX_SHADER>(vsCode));
+		if (vs == 0)
 		{
 			return GLProgramObject();
 		}
 
-		std::cout << "Success: Shader Program Link\n";
+		GLProgramObject prog;
+		prog.Create();
+
+		glAttachShader(prog, vs);
+		// リンクする前に設定する
+		glTransformFeedbackVaryings(prog, varyingCount, varyings, bufferMode);
 
-		return prog;
+		return LinkShaderProgram(std::move(prog));
 	}
 	void SetUniform(GLint uniform, GLint value)
 	{
@@ -20,6 +20,13 @@ namespace saba
 {
 
 	GLProgramObject CreateShaderProgram(const char* vsCode, const char* fsCode);
+	// 頂点シェーダーだけのプログラムを作り、varyings を Transform Feedback で書き出す
+	GLProgramObject CreateTransformFeedbackShaderProgram(
+		const char*			vsCode,
+		const char* const*	varyings,
+		GLsizei				varyingCount,
+		GLenum				bufferMode = GL_SEPARATE_ATTRIBS
+	);
 
 	void SetUniform(GLint uniform, GLint value);
 	void SetUniform(GLint uniform, float value);
@@ -0,0 +1,337 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "GLTextureCache.h"
+
+#include <Saba/Base/File.h>
+#include <Saba/Base/Hash.h>
+#include <Saba/Base/Log.h>
+
+#include <tinyddsloader.h>
+
+#include <algorithm>
+
+namespace saba
+{
+	namespace
+	{
+		size_t CalcDDSSize(const tinyddsloader::DDSFile& dds)
+		{
+			const size_t faceCount = dds.IsCubemap() ? 6 : 1;
+			size_t size = 0;
+			for (uint32_t level = 0; level < dds.GetMipCount(); level++)
+			{
+				auto imageData = dds.GetImageData(level, 0);
+				if (imageData != nullptr)
+				{
+					size += size_t(imageData->m_memSlicePitch) * std::max(imageData->m_depth, uint32_t(1));
+				}
+			}
+			return size * dds.GetArraySize() * faceCount;
+		}
+
+		size_t CalcImageMemorySize(const GLTextureImage* image)
+		{
+			if (image == nullptr)
+			{
+				return 0;
+			}
+			size_t size = sizeof(GLTextureImage) + image->m_pixels.size();
+			if (image->m_dds != nullptr)
+			{
+				size += CalcDDSSize(*image->m_dds);
+			}
+			return size;
+		}
+
+		// GL の内部形式による違いは考慮しない見積もり
+		size_t CalcTextureVRAMSize(const GLTextureImage& image, bool genMipmap)
+		{
+			if (image.m_dds != nullptr)
+			{
+				return CalcDDSSize(*image.m_dds);
+			}
+			if (!image.m_compressedMips.empty())
+			{
+				return genMipmap ? image.m_pixels.size() : size_t(image.m_compressedMips[0].m_size);
+			}
+			const size_t size = image.m_pixels.size();
+			return genMipmap ? size + size / 3 : size;
+		}
+	}
+
+	GLTextureCache::GLTextureCache()
+		: m_vramBudget(DefaultVRAMBudget)
+		, m_memoryBudget(DefaultMemoryBudget)
+		, m_vramUsage(0)
+		, m_memoryUsage(0)
+		, m_useCounter(0)
+		, m_compression(false)
+	{
+	}
+
+	GLTextureCache::~GLTextureCache()
+	{
+		Clear();
+	}
+
+	bool GLTextureCache::MakeKey(Key* key, const std::string& filename)
+	{
+		MappedFile file;
+		if (!file.Open(filename))
+		{
+			return false;
+		}
+		key->m_hash = CalcHash64(file.GetData(), file.GetSize());
+		key->m_size = file.GetSize();
+		return true;
+	}
+
+	std::shared_ptr<GLTextureImage> GLTextureCache::GetImage(const std::string& filename)
+	{
+		Key key;
+		if (!MakeKey(&key, filename))
+		{
+			SABA_WARN("Texture File Open Fail. [{}]", filename);
+			return nullptr;
+		}
+		return GetImage(key, filename);
+	}
+
+	std::shared_ptr<GLTextureImage> GLTextureCache::GetImage(const Key& key, const std::string& filename)
+	{
+		std::shared_ptr<ImageEntry> entry;
+		bool compression = false;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			compression = m_compression;
+			auto& slot = m_images[key];
+			if (slot == nullptr)
+			{
+				slot = std::make_shared<ImageEntry>();
+			}
+			entry = slot;
+			entry->m_lastUse = ++m_useCounter;
+		}
+
+		// 他のスレッドがデコード中の場合は、ここで完了を待つ
+		std::unique_lock<std::mutex> decodeLock(entry->m_decodeMutex);
+		if (entry->m_decoded)
+		{
+			return entry->m_image;
+		}
+
+		auto image = LoadImage(key, filename, compression);
+		entry->m_image = image;
+		entry->m_memorySize = CalcImageMemorySize(image.get());
+		entry->m_decoded = true;
+		decodeLock.unlock();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		// デコード中に Clear された場合は数えない
+		auto findIt = m_images.find(key);
+		if (findIt != m_images.end() && (*findIt).second == entry)
+		{
+			m_memoryUsage += entry->m_memorySize;
+			EvictImages();
+		}
+		return image;
+	}
+
+	std::shared_ptr<GLTextureImage> GLTextureCache::LoadImage(const Key& key, const std::string& filename, bool compression)
+	{
+		auto image = std::make_shared<GLTextureImage>();
+		const std::string cachePath = filename + ".sabatex";
+		if (compression && LoadCompressedTextureImage(image.get(), cachePath, key.m_size, key.m_hash))
+		{
+			return image;
+		}
+
+		if (!DecodeTextureFromFile(image.get(), filename))
+		{
+			SABA_WARN("Texture Decode Fail. [{}]", filename);
+			return nullptr;
+		}
+		// DDS と HDR の画像は圧縮しない
+		if (compression && CompressTextureImage(image.get()))
+		{
+			SaveCompressedTextureImage(*image, cachePath, key.m_size, key.m_hash);
+		}
+		return image;
+	}
+
+	GLTextureRef GLTextureCache::GetTexture(const std::string& filename, bool genMipmap, const GLTextureImage* image)
+	{
+		Key key;
+		if (!MakeKey(&key, filename))
+		{
+			SABA_WARN("Texture File Open Fail. [{}]", filename);
+			return GLTextureRef();
+		}
+		const TextureKey texKey(key, genMipmap);
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			auto findIt = m_textures.find(texKey);
+			if (findIt != m_textures.end())
+			{
+				(*findIt).second.m_lastUse = ++m_useCounter;
+				return (*findIt).second.m_texture;
+			}
+		}
+
+		std::shared_ptr<GLTextureImage> decodedImage;
+		if (image == nullptr)
+		{
+			decodedImage = GetImage(key, filename);
+			image = decodedImage.get();
+		}
+		if (image == nullptr)
+		{
+			return GLTextureRef();
+		}
+
+		GLTextureRef tex = CreateTextureFromImage(*image, genMipmap);
+		if (tex == 0)
+		{
+			SABA_WARN("Texture Upload Fail. [{}]", filename);
+			return GLTextureRef();
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto& entry = m_textures[texKey];
+		entry.m_texture = tex;
+		entry.m_vramSize = CalcTextureVRAMSize(*image, genMipmap);
+		entry.m_lastUse = ++m_useCounter;
+		m_vramUsage += entry.m_vramSize;
+		EvictTextures();
+		return tex;
+	}
+
+	void GLTextureCache::EnableCompression(bool enable)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_compression == enable)
+		{
+			return;
+		}
+		m_compression = enable;
+		// デコード中のものは、古い設定のまま返される
+		for (const auto& image : m_images)
+		{
+			if (image.second->m_decoded)
+			{
+				m_memoryUsage -= image.second->m_memorySize;
+			}
+		}
+		m_images.clear();
+	}
+
+	bool GLTextureCache::IsEnabledCompression() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_compression;
+	}
+
+	void GLTextureCache::SetVRAMBudget(size_t budget)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_vramBudget = budget;
+		EvictTextures();
+	}
+
+	void GLTextureCache::SetMemoryBudget(size_t budget)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_memoryBudget = budget;
+		EvictImages();
+	}
+
+	size_t GLTextureCache::GetVRAMBudget() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_vramBudget;
+	}
+
+	size_t GLTextureCache::GetMemoryBudget() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_memoryBudget;
+	}
+
+	size_t GLTextureCache::GetVRAMUsage() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_vramUsage;
+	}
+
+	size_t GLTextureCache::GetMemoryUsage() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_memoryUsage;
+	}
+
+	void GLTextureCache::Clear()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_textures.clear();
+		m_images.clear();
+		m_vramUsage = 0;
+		m_memoryUsage = 0;
+	}
+
+	void GLTextureCache::EvictImages()
+	{
+		while (m_memoryUsage > m_memoryBudget)
+		{
+			// デコード中のものと、キャッシュの外から参照されているものは残す
+			auto evictIt = m_images.end();
+			for (auto it = m_images.begin(); it != m_images.end(); ++it)
+			{
+				const auto& entry = (*it).second;
+				if (entry.use_count() != 1 || entry->m_image == nullptr || entry->m_image.use_count() != 1)
+				{
+					continue;
+				}
+				if (evictIt == m_images.end() || entry->m_lastUse < (*evictIt).second->m_lastUse)
+				{
+					evictIt = it;
+				}
+			}
+			if (evictIt == m_images.end())
+			{
+				break;
+			}
+			m_memoryUsage -= (*evictIt).second->m_memorySize;
+			m_images.erase(evictIt);
+		}
+	}
+
+	void GLTextureCache::EvictTextures()
+	{
+		while (m_vramUsage > m_vramBudget)
+		{
+			// モデルが使っているテクスチャは破棄できない
+			auto evictIt = m_textures.end();
+			for (auto it = m_textures.begin(); it != m_textures.end(); ++it)
+			{
+				const auto& entry = (*it).second;
+				if (entry.m_texture.GetRefCount() != 1)
+				{
+					continue;
+				}
+				if (evictIt == m_textures.end() || entry.m_lastUse < (*evictIt).second.m_lastUse)
+				{
+					evictIt = it;
+				}
+			}
+			if (evictIt == m_textures.end())
+			{
+				break;
+			}
+			m_vramUsage -= (*evictIt).second.m_vramSize;
+			m_textures.erase(evictIt);
+		}
+	}
+}
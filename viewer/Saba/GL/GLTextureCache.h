@@ -0,0 +1,125 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_GL_GLTEXTURECACHE_H_
+#define SABA_GL_GLTEXTURECACHE_H_
+
+#include "GLObject.h"
+#include "GLTextureUtil.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace saba
+{
+	/*
+	プロセス全体で共有するテクスチャのキャッシュ (Singleton<GLTextureCache>::Get() で使う)。
+	ファイルの内容のハッシュをキーにするので、別のパスにある同じ画像も一度だけデコード、転送する。
+
+	デコードした画像はどのスレッドからでも取得できる。
+	同じ画像を同時に要求した場合は、後から来た方がデコードの完了を待つ。
+	GL のテクスチャは GL のスレッドで取得する。
+
+	使用量が予算を超えた場合は、キャッシュの外から参照されていないものを、
+	最後に使ったのが古い順に破棄する。
+
+	圧縮を有効にすると、デコードした画像を BC1 / BC3 に圧縮し、画像ファイルと同じ場所に
+	キャッシュファイル (.sabatex) を作る。次からはデコードせずにキャッシュファイルを読み込む。
+	*/
+	class GLTextureCache
+	{
+	public:
+		struct Key
+		{
+			uint64_t	m_hash = 0;
+			uint64_t	m_size = 0;
+
+			bool operator < (const Key& key) const
+			{
+				if (m_hash != key.m_hash) { return m_hash < key.m_hash; }
+				return m_size < key.m_size;
+			}
+		};
+
+		static const size_t DefaultVRAMBudget = size_t(512) * 1024 * 1024;
+		static const size_t DefaultMemoryBudget = size_t(256) * 1024 * 1024;
+
+		GLTextureCache();
+		~GLTextureCache();
+
+		GLTextureCache(const GLTextureCache&) = delete;
+		GLTextureCache& operator = (const GLTextureCache&) = delete;
+
+		// ファイルの内容からキーを作る
+		static bool MakeKey(Key* key, const std::string& filename);
+
+		// デコードに失敗した場合は nullptr を返す (失敗したこともキャッシュする)
+		std::shared_ptr<GLTextureImage> GetImage(const std::string& filename);
+
+		// GL のスレッドで呼び出す
+		// キャッシュにない場合、image があればファイルを読まずにその画像を転送する
+		GLTextureRef GetTexture(const std::string& filename, bool genMipmap = true, const GLTextureImage* image = nullptr);
+
+		// GL のスレッドで IsS3TCSupported() を確認してから有効にする
+		// 切り替えると、デコード済みの画像は破棄する
+		void EnableCompression(bool enable);
+		bool IsEnabledCompression() const;
+
+		void SetVRAMBudget(size_t budget);
+		void SetMemoryBudget(size_t budget);
+		size_t GetVRAMBudget() const;
+		size_t GetMemoryBudget() const;
+		size_t GetVRAMUsage() const;
+		size_t GetMemoryUsage() const;
+
+		// キャッシュが持っている参照を手放す (GL のコンテキストを破棄する前に呼ぶ)
+		void Clear();
+
+	private:
+		struct ImageEntry
+		{
+			std::mutex	m_decodeMutex;
+			bool		m_decoded = false;
+			std::shared_ptr<GLTextureImage>	m_image;
+			size_t		m_memorySize = 0;
+			uint64_t	m_lastUse = 0;
+		};
+
+		struct TextureEntry
+		{
+			GLTextureRef	m_texture;
+			size_t			m_vramSize = 0;
+			uint64_t		m_lastUse = 0;
+		};
+		// (画像, ミップマップを作るか)
+		using TextureKey = std::pair<Key, bool>;
+
+		std::shared_ptr<GLTextureImage> GetImage(const Key& key, const std::string& filename);
+		static std::shared_ptr<GLTextureImage> LoadImage(const Key& key, const std::string& filename, bool compression);
+
+		// m_mutex をロックして呼ぶ
+		void EvictImages();
+		void EvictTextures();
+
+	private:
+		mutable std::mutex	m_mutex;
+		std::map<Key, std::shared_ptr<ImageEntry>>	m_images;
+		std::map<TextureKey, TextureEntry>			m_textures;
+
+		size_t		m_vramBudget;
+		size_t		m_memoryBudget;
+		size_t		m_vramUsage;
+		size_t		m_memoryUsage;
+		uint64_t	m_useCounter;
+		bool		m_compression;
+	};
+}
+
+#endif // !SABA_GL_GLTEXTURECACHE_H_
@@ -7,8 +7,11 @@
 #include <Saba/Base/File.h>
 #include <Saba/Base/Path.h>
 #include <Saba/Base/Log.h>
+#include <Saba/Model/MMD/MMDModelCache.h>
 
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 #define ENABLE_GLI 0
 
@@ -27,6 +30,10 @@
 #define TINYDDSLOADER_IMPLEMENTATION
 #include <tinyddsloader.h>
 
+#define STB_DXT_IMPLEMENTATION
+#define STB_DXT_STATIC
+#include <stb_dxt.h>
+
 using namespace tinyddsloader;
 
 #ifndef GL_EXT_texture_compression_s3tc
@@ -246,7 +253,7 @@ namespace saba
 			}
 		}
 
-		bool LoadGLTexture(GLuint tex, DDSFile& dds)
+		bool LoadGLTexture(GLuint tex, const DDSFile& dds)
 		{
 			GLenum target = GL_INVALID_ENUM;
 			bool isArray = false;
@@ -342,7 +349,6 @@ namespace saba
 				glBindTexture(target, 0);
 				return false;
 			}
-			dds.Flip();
 
 			uint32_t numFaces = dds.IsCubemap() ? 6 : 1;
 			for (uint32_t layer = 0; layer < dds.GetArraySize(); layer++)
@@ -402,7 +408,7 @@ namespace saba
 			return true;
 		}
 
-		bool LoadTextureFromDDS(const GLTextureObject& tex, const char * filename)
+		bool DecodeTextureFromDDS(GLTextureImage* image, const char * filename)
 		{
 			File file;
 			if (!file.Open(filename))
@@ -415,34 +421,54 @@ namespace saba
 				return false;
 			}
 
-			tinyddsloader::DDSFile dds;
-			if (tinyddsloader::Result::Success != dds.Load(std::move(data)))
+			auto dds = std::make_shared<tinyddsloader::DDSFile>();
+			if (tinyddsloader::Result::Success != dds->Load(std::move(data)))
 			{
 				return false;
 			}
-
-			if (!LoadGLTexture(tex, dds))
+			if (!TranslateFormat(dds->GetFormat(), nullptr))
 			{
 				return false;
 			}
+			dds->Flip();
+
+			image->m_width = int(dds->GetWidth());
+			image->m_height = int(dds->GetHeight());
+			image->m_dds = std::move(dds);
 
 			return true;
 		}
 
-		bool LoadTextureFromStb(const GLTextureObject& tex, const char * filename, bool genMipMap, bool rgba)
+		// stbi_set_flip_vertically_on_load はプロセス全体の設定なので、
+		// ワーカースレッドから呼ばずにデコード後に上下を反転する
+		void FlipRows(std::vector<uint8_t>* pixels, size_t rowSize, int height)
 		{
-			glBindTexture(GL_TEXTURE_2D, tex);
-
-			stbi_set_flip_vertically_on_load(true);
+			std::vector<uint8_t> tmp(rowSize);
+			uint8_t* top = pixels->data();
+			uint8_t* bottom = pixels->data() + rowSize * size_t(height - 1);
+			while (top < bottom)
+			{
+				memcpy(tmp.data(), top, rowSize);
+				memcpy(top, bottom, rowSize);
+				memcpy(bottom, tmp.data(), rowSize);
+				top += rowSize;
+				bottom -= rowSize;
+			}
+		}
 
-			File file;
+		bool DecodeTextureFromStb(GLTextureImage* image, const char * filename, bool rgba)
+		{
+			MappedFile file;
 			if (!file.Open(filename))
 			{
 				return false;
 			}
+			const stbi_uc* data = file.GetData();
+			const int dataSize = int(file.GetSize());
+
 			int x, y, comp;
 			int reqComp = 0;
-			int ret = stbi_info_from_file(file.GetFilePointer(), &x, &y, &comp);
+			int ret = stbi_info_from_memory(data, dataSize, &x, &y, &comp);
 			if (ret == 0)
 			{
 				return false;
@@ -464,52 +490,97 @@ namespace saba
 				reqComp = STBI_rgb_alpha;
 			}
 
-			file.Seek(0, File::SeekDir::Begin);
-			if (stbi_is_hdr_from_file(file.GetFilePointer()))
+			const size_t pixelCount = size_t(x) * size_t(y) * size_t(reqComp);
+			if (stbi_is_hdr_from_memory(data, dataSize))
 			{
-				file.Seek(0, File::SeekDir::Begin);
-				float* image = stbi_loadf_from_file(file.GetFilePointer(), &x, &y, &comp, reqComp);
-				if (image == nullptr)
+				float* pixels = stbi_loadf_from_memory(data, dataSize, &x, &y, &comp, reqComp);
+				if (pixels == nullptr)
 				{
 					return false;
 				}
 
+				const uint8_t* bytes = reinterpret_cast<const uint8_t*>(pixels);
+				image->m_pixels.assign(bytes, bytes + pixelCount * sizeof(float));
+				FlipRows(&image->m_pixels, size_t(x) * size_t(reqComp) * sizeof(float), y);
+				image->m_type = GL_FLOAT;
+				image->m_unpackAlignment = 4;
 				if (reqComp == STBI_rgb_alpha)
 				{
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, x, y, 0, GL_RGBA, GL_FLOAT, image);
+					image->m_internalFormat = GL_RGBA32F;
+					image->m_format = GL_RGBA;
 				}
 				else
 				{
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, x, y, 0, GL_RGB, GL_FLOAT, image);
+					image->m_internalFormat = GL_RGB32F;
+					image->m_format = GL_RGB;
 				}
 
-				stbi_image_free(image);
+				stbi_image_free(pixels);
 			}
 			else
 			{
-				file.Seek(0, File::SeekDir::Begin);
-				uint8_t* image = stbi_load_from_file(file.GetFilePointer(), &x, &y, &comp, reqComp);
-				if (image == nullptr)
+				uint8_t* pixels = stbi_load_from_memory(data, dataSize, &x, &y, &comp, reqComp);
+				if (pixels == nullptr)
 				{
 					return false;
 				}
 
+				image->m_pixels.assign(pixels, pixels + pixelCount);
+				FlipRows(&image->m_pixels, size_t(x) * size_t(reqComp), y);
+				image->m_type = GL_UNSIGNED_BYTE;
 				if (reqComp == STBI_rgb_alpha)
 				{
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, x, y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+					image->m_internalFormat = GL_RGBA;
+					image->m_format = GL_RGBA;
+					image->m_unpackAlignment = 4;
 				}
 				else
 				{
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, x, y, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+					image->m_internalFormat = GL_RGB;
+					image->m_format = GL_RGB;
+					image->m_unpackAlignment = 1;
 				}
 
-				stbi_image_free(image);
+				stbi_image_free(pixels);
+			}
+			image->m_width = x;
+			image->m_height = y;
+
+			return true;
+		}
+
+		bool UploadStbImage(const GLTextureObject& tex, const GLTextureImage& image, bool genMipMap)
+		{
+			glBindTexture(GL_TEXTURE_2D, tex);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, image.m_unpackAlignment);
+
+			// ピクセルバッファオブジェクトに書き込んでから転送する
+			// 割り当てに失敗した場合は、メモリから直接転送する
+			GLBufferObject pbo;
+			const void* pixels = image.m_pixels.data();
+			if (pbo.Create())
+			{
+				const GLsizeiptr size = GLsizeiptr(image.m_pixels.size());
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+				glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+				void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+				if (dst != nullptr)
+				{
+					memcpy(dst, image.m_pixels.data(), image.m_pixels.size());
+					if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE)
+					{
+						pixels = nullptr;
+					}
+				}
+				if (pixels != nullptr)
+				{
+					glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				}
 			}
 
+			glTexImage2D(GL_TEXTURE_2D, 0, image.m_internalFormat, image.m_width, image.m_height, 0, image.m_format, image.m_type, pixels);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
 			if (genMipMap)
 			{
 				glGenerateMipmap(GL_TEXTURE_2D);
@@ -525,6 +596,315 @@ namespace saba
 
 			return true;
 		}
+
+		bool UploadCompressedImage(const GLTextureObject& tex, const GLTextureImage& image, bool genMipMap)
+		{
+			// 圧縮済みの画像はミップマップを作れないので、作っておいたものを転送する
+			const size_t levelCount = genMipMap ? image.m_compressedMips.size() : 1;
+			glBindTexture(GL_TEXTURE_2D, tex);
+			for (size_t level = 0; level < levelCount; level++)
+			{
+				const auto& mip = image.m_compressedMips[level];
+				glCompressedTexImage2D(
+					GL_TEXTURE_2D, GLint(level), image.m_internalFormat,
+					GLsizei(mip.m_width), GLsizei(mip.m_height), 0,
+					GLsizei(mip.m_size), image.m_pixels.data() + mip.m_offset
+				);
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(levelCount - 1));
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			return true;
+		}
+
+		bool UploadTexture(const GLTextureObject& tex, const GLTextureImage& image, bool genMipMap)
+		{
+			if (image.m_dds != nullptr)
+			{
+				return LoadGLTexture(tex, *image.m_dds);
+			}
+			else if (!image.m_compressedMips.empty())
+			{
+				return UploadCompressedImage(tex, image, genMipMap);
+			}
+			else if (!image.m_pixels.empty())
+			{
+				return UploadStbImage(tex, image, genMipMap);
+			}
+			return false;
+		}
+	}
+
+	namespace
+	{
+		const uint32_t TextureCacheFormat = 1;
+
+		namespace TextureCacheSection
+		{
+			enum : uint32_t
+			{
+				Info = 1,
+				Mips,
+				Pixels,
+			};
+		}
+
+		struct TextureCacheInfo
+		{
+			uint32_t	m_internalFormat;
+			int32_t		m_width;
+			int32_t		m_height;
+		};
+
+		// 2x2 の平均で縮小する (奇数の大きさの場合は端の画素を繰り返す)
+		void DownsampleRGBA(std::vector<uint8_t>* dst, const std::vector<uint8_t>& src, int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+		{
+			dst->resize(size_t(dstWidth) * size_t(dstHeight) * 4);
+			for (int y = 0; y < dstHeight; y++)
+			{
+				const int y0 = std::min(y * 2, srcHeight - 1);
+				const int y1 = std::min(y * 2 + 1, srcHeight - 1);
+				for (int x = 0; x < dstWidth; x++)
+				{
+					const int x0 = std::min(x * 2, srcWidth - 1);
+					const int x1 = std::min(x * 2 + 1, srcWidth - 1);
+					const uint8_t* p00 = &src[(size_t(y0) * srcWidth + x0) * 4];
+					const uint8_t* p01 = &src[(size_t(y0) * srcWidth + x1) * 4];
+					const uint8_t* p10 = &src[(size_t(y1) * srcWidth + x0) * 4];
+					const uint8_t* p11 = &src[(size_t(y1) * srcWidth + x1) * 4];
+					uint8_t* out = &(*dst)[(size_t(y) * dstWidth + x) * 4];
+					for (int c = 0; c < 4; c++)
+					{
+						out[c] = uint8_t((int(p00[c]) + p01[c] + p10[c] + p11[c] + 2) / 4);
+					}
+				}
+			}
+		}
+
+		// 4x4 のブロック毎に圧縮する (端のブロックは端の画素を繰り返す)
+		void CompressRGBABlocks(std::vector<uint8_t>* out, const std::vector<uint8_t>& rgba, int width, int height, bool alpha)
+		{
+			const size_t blockSize = alpha ? 16 : 8;
+			const int blockCountX = (width + 3) / 4;
+			const int blockCountY = (height + 3) / 4;
+			size_t offset = out->size();
+			out->resize(offset + size_t(blockCountX) * size_t(blockCountY) * blockSize);
+
+			uint8_t block[4 * 4 * 4];
+			for (int by = 0; by < blockCountY; by++)
+			{
+				for (int bx = 0; bx < blockCountX; bx++)
+				{
+					for (int py = 0; py < 4; py++)
+					{
+						const int y = std::min(by * 4 + py, height - 1);
+						for (int px = 0; px < 4; px++)
+						{
+							const int x = std::min(bx * 4 + px, width - 1);
+							memcpy(&block[(py * 4 + px) * 4], &rgba[(size_t(y) * width + x) * 4], 4);
+						}
+					}
+					stb_compress_dxt_block(out->data() + offset, block, alpha ? 1 : 0, STB_DXT_NORMAL);
+					offset += blockSize;
+				}
+			}
+		}
+	}
+
+	GLTextureImage::GLTextureImage()
+		: m_width(0)
+		, m_height(0)
+		, m_internalFormat(GL_RGBA)
+		, m_format(GL_RGBA)
+		, m_type(GL_UNSIGNED_BYTE)
+		, m_unpackAlignment(4)
+	{
+	}
+
+	bool DecodeTextureFromFile(GLTextureImage* image, const char* filename, bool rgba)
+	{
+		std::string ext = PathUtil::GetExt(filename);
+		bool successed = false;
+		if (ext == "dds")
+		{
+			successed = DecodeTextureFromDDS(image, filename);
+			if (!successed)
+			{
+				SABA_WARN("DecodeTextureFromDDS fail.");
+			}
+		}
+		else
+		{
+			successed = DecodeTextureFromStb(image, filename, rgba);
+			if (!successed)
+			{
+				SABA_WARN("DecodeTextureFromStb fail.");
+			}
+		}
+		return successed;
+	}
+
+	bool DecodeTextureFromFile(GLTextureImage* image, const std::string& filename, bool rgba)
+	{
+		return DecodeTextureFromFile(image, filename.c_str(), rgba);
+	}
+
+	bool CompressTextureImage(GLTextureImage* image)
+	{
+		if (image->m_dds != nullptr ||
+			!image->m_compressedMips.empty() ||
+			image->m_pixels.empty() ||
+			image->m_type != GL_UNSIGNED_BYTE ||
+			(image->m_format != GL_RGB && image->m_format != GL_RGBA))
+		{
+			return false;
+		}
+
+		// アルファの有無 (IsAlphaTexture の結果) は圧縮前と同じにする
+		const bool alpha = image->m_format == GL_RGBA;
+		int width = image->m_width;
+		int height = image->m_height;
+		std::vector<uint8_t> rgba;
+		if (alpha)
+		{
+			rgba = std::move(image->m_pixels);
+		}
+		else
+		{
+			const size_t pixelCount = size_t(width) * size_t(height);
+			rgba.resize(pixelCount * 4);
+			for (size_t i = 0; i < pixelCount; i++)
+			{
+				rgba[i * 4 + 0] = image->m_pixels[i * 3 + 0];
+				rgba[i * 4 + 1] = image->m_pixels[i * 3 + 1];
+				rgba[i * 4 + 2] = image->m_pixels[i * 3 + 2];
+				rgba[i * 4 + 3] = 255;
+			}
+		}
+
+		std::vector<uint8_t> compressed;
+		std::vector<GLTextureImage::CompressedMip> mips;
+		std::vector<uint8_t> nextRGBA;
+		while (true)
+		{
+			GLTextureImage::CompressedMip mip;
+			mip.m_width = uint32_t(width);
+			mip.m_height = uint32_t(height);
+			mip.m_offset = uint32_t(compressed.size());
+			CompressRGBABlocks(&compressed, rgba, width, height, alpha);
+			mip.m_size = uint32_t(compressed.size() - mip.m_offset);
+			mips.push_back(mip);
+
+			if (width == 1 && height == 1)
+			{
+				break;
+			}
+			const int nextWidth = std::max(width / 2, 1);
+			const int nextHeight = std::max(height / 2, 1);
+			DownsampleRGBA(&nextRGBA, rgba, width, height, nextWidth, nextHeight);
+			rgba.swap(nextRGBA);
+			width = nextWidth;
+			height = nextHeight;
+		}
+
+		image->m_internalFormat = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		image->m_format = image->m_internalFormat;
+		image->m_unpackAlignment = 1;
+		image->m_pixels = std::move(compressed);
+		image->m_compressedMips = std::move(mips);
+
+		return true;
+	}
+
+	bool SaveCompressedTextureImage(const GLTextureImage& image, const std::string& filepath, uint64_t sourceSize, uint64_t sourceHash)
+	{
+		if (image.m_compressedMips.empty())
+		{
+			return false;
+		}
+
+		TextureCacheInfo info;
+		info.m_internalFormat = image.m_internalFormat;
+		info.m_width = image.m_width;
+		info.m_height = image.m_height;
+
+		MMDModelCacheWriter writer;
+		writer.AddValue(TextureCacheSection::Info, info);
+		writer.AddSection(TextureCacheSection::Mips, image.m_compressedMips);
+		writer.AddSection(TextureCacheSection::Pixels, image.m_pixels);
+		if (!writer.Save(filepath, TextureCacheFormat, sourceSize, sourceHash))
+		{
+			SABA_WARN("Texture Cache Save Fail. [{}]", filepath);
+			return false;
+		}
+		return true;
+	}
+
+	bool LoadCompressedTextureImage(GLTextureImage* image, const std::string& filepath, uint64_t sourceSize, uint64_t sourceHash)
+	{
+		MMDModelCacheReader reader;
+		if (!reader.Open(filepath, TextureCacheFormat, sourceSize, sourceHash))
+		{
+			return false;
+		}
+
+		TextureCacheInfo info;
+		std::vector<GLTextureImage::CompressedMip> mips;
+		std::vector<uint8_t> pixels;
+		if (!reader.ReadValue(TextureCacheSection::Info, &info) ||
+			!reader.ReadSection(TextureCacheSection::Mips, &mips) ||
+			!reader.ReadSection(TextureCacheSection::Pixels, &pixels) ||
+			mips.empty())
+		{
+			SABA_WARN("Texture Cache Read Fail. [{}]", filepath);
+			return false;
+		}
+		if (info.m_internalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT &&
+			info.m_internalFormat != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+		{
+			SABA_WARN("Texture Cache Unknown Format. [{}]", filepath);
+			return false;
+		}
+		for (const auto& mip : mips)
+		{
+			if (size_t(mip.m_offset) + size_t(mip.m_size) > pixels.size())
+			{
+				SABA_WARN("Texture Cache is broken. [{}]", filepath);
+				return false;
+			}
+		}
+
+		image->m_width = info.m_width;
+		image->m_height = info.m_height;
+		image->m_internalFormat = info.m_internalFormat;
+		image->m_format = info.m_internalFormat;
+		image->m_type = GL_UNSIGNED_BYTE;
+		image->m_unpackAlignment = 1;
+		image->m_pixels = std::move(pixels);
+		image->m_compressedMips = std::move(mips);
+
+		return true;
+	}
+
+	GLTextureObject CreateTextureFromImage(const GLTextureImage& image, bool genMipMap)
+	{
+		GLTextureObject tex;
+		if (!tex.Create())
+		{
+			SABA_ERROR("Texture Create fail.");
+			return GLTextureObject();
+		}
+
+		bool ret = UploadTexture(tex, image, genMipMap);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		if (!ret)
+		{
+			return GLTextureObject();
+		}
+
+		return tex;
 	}
 
 	GLTextureObject CreateTextureFromFile(const char * filename, bool genMipMap, bool rgba)
@@ -536,7 +916,7 @@ namespace saba
 			return GLTextureObject();
 		}
 
-		bool ret = LoadTextureFromFile(tex, filename, genMipMap);
+		bool ret = LoadTextureFromFile(tex, filename, genMipMap, rgba);
 		glBindTexture(GL_TEXTURE_2D, 0);
 
 		if (!ret)
@@ -555,31 +935,22 @@ namespace saba
 	bool LoadTextureFromFile(const GLTextureObject& tex, const char* filename, bool genMipMap, bool rgba)
 	{
 		SABA_INFO("LoadTexture: [{}]", filename);
-		std::string ext = PathUtil::GetExt(filename);
 		bool successed = false;
-		if (ext == "dds")
-		{
 #if ENABLE_GLI
+		if (PathUtil::GetExt(filename) == "dds")
+		{
 			successed = LoadTextureFromGLI(tex, filename);
 			if (!successed)
 			{
 				SABA_WARN("LoadTextureFromGLI fail.");
 			}
-#else // ENABLE_GLI
-			successed = LoadTextureFromDDS(tex, filename);
-			if (!successed)
-			{
-				SABA_WARN("LoadTextureFromDDS fail.");
-			}
-#endif // ENABLE_GLI
 		}
 		else
+#endif // ENABLE_GLI
 		{
-			successed = LoadTextureFromStb(tex, filename, genMipMap, rgba);
-			if (!successed)
-			{
-				SABA_WARN("LoadTextureFromStb fail.");
-			}
+			GLTextureImage image;
+			successed = DecodeTextureFromFile(&image, filename, rgba)
+				&& UploadTexture(tex, image, genMipMap);
 		}
 
 		if (successed)
@@ -608,5 +979,20 @@ namespace saba
 		return alpha != 0;
 	}
 
+	bool IsS3TCSupported()
+	{
+		GLint extCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extCount);
+		for (GLint i = 0; i < extCount; i++)
+		{
+			auto ext = (const char*)glGetStringi(GL_EXTENSIONS, GLuint(i));
+			if (ext != nullptr && strcmp(ext, "GL_EXT_texture_compression_s3tc") == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 }
 
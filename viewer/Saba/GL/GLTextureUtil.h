@@ -9,9 +9,69 @@
 #include "GLObject.h"
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace tinyddsloader
+{
+	class DDSFile;
+}
 
 namespace saba
 {
+	/*
+	GL に転送する前のデコード済みの画像。
+	DecodeTextureFromFile は GL を使わないので、ワーカースレッドで呼び出せる。
+	*/
+	struct GLTextureImage
+	{
+		GLTextureImage();
+
+		// stb_image でデコードした画像
+		int						m_width;
+		int						m_height;
+		GLenum					m_internalFormat;
+		GLenum					m_format;
+		GLenum					m_type;
+		GLint					m_unpackAlignment;
+		std::vector<uint8_t>	m_pixels;
+
+		// DDS (上下反転済み)
+		std::shared_ptr<tinyddsloader::DDSFile>	m_dds;
+
+		// BC1 / BC3 に圧縮した画像 (m_pixels にすべてのミップマップを並べる)
+		struct CompressedMip
+		{
+			uint32_t	m_width;
+			uint32_t	m_height;
+			uint32_t	m_offset;
+			uint32_t	m_size;
+		};
+		std::vector<CompressedMip>	m_compressedMips;
+	};
+
+	bool DecodeTextureFromFile(GLTextureImage* image, const char* filename, bool rgba = false);
+	bool DecodeTextureFromFile(GLTextureImage* image, const std::string& filename, bool rgba = false);
+
+	/*
+	stb_image でデコードした 8 bit の画像を、ミップマップを作ってから圧縮する。
+	RGB は BC1、RGBA は BC3 にする。それ以外の画像は変更せずに false を返す。
+	GL を使わないので、ワーカースレッドで呼び出せる。
+	*/
+	bool CompressTextureImage(GLTextureImage* image);
+
+	/*
+	圧縮した画像のキャッシュファイル (.sabatex)。
+	元の画像ファイルのサイズとハッシュが一致しない場合は読み込まない。
+	*/
+	bool SaveCompressedTextureImage(const GLTextureImage& image, const std::string& filepath, uint64_t sourceSize, uint64_t sourceHash);
+	bool LoadCompressedTextureImage(GLTextureImage* image, const std::string& filepath, uint64_t sourceSize, uint64_t sourceHash);
+
+	// GL のスレッドで呼び出す
+	// stb_image の画像はピクセルバッファオブジェクトを経由して転送する
+	GLTextureObject CreateTextureFromImage(const GLTextureImage& image, bool genMipMap = true);
+
 	GLTextureObject CreateTextureFromFile(const char* filename, bool genMipMap = true, bool rgba = false);
 	GLTextureObject CreateTextureFromFile(const std::string& filename, bool genMipMap = true, bool rgba = false);
 
@@ -19,6 +79,8 @@ namespace saba
 	bool LoadTextureFromFile(const GLTextureObject& tex, const std::string& filename, bool genMipMap = true, bool rgba = false);
 
 	bool IsAlphaTexture(GLuint tex);
+	// GL のスレッドで呼び出す
+	bool IsS3TCSupported();
 }
 
 #endif // !SABA_GL_TEXTUREUTIL_H_
@@ -0,0 +1,234 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "GLVertexRingBuffer.h"
+
+#include <Saba/Base/Log.h>
+
+#include <cstring>
+
+namespace saba
+{
+	namespace
+	{
+		bool IsBufferStorageSupported()
+		{
+			if (glBufferStorage == nullptr)
+			{
+				return false;
+			}
+			if (gl3wIsSupported(4, 4))
+			{
+				return true;
+			}
+			GLint extCount = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &extCount);
+			for (GLint i = 0; i < extCount; i++)
+			{
+				auto ext = (const char*)glGetStringi(GL_EXTENSIONS, GLuint(i));
+				if (ext != nullptr && strcmp(ext, "GL_ARB_buffer_storage") == 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+
+	GLVertexRingBuffer::GLVertexRingBuffer()
+		: m_regionSize(0)
+		, m_regionIndex(0)
+		, m_persistentPtr(nullptr)
+		, m_mapped(false)
+	{
+	}
+
+	GLVertexRingBuffer::~GLVertexRingBuffer()
+	{
+		Destroy();
+	}
+
+	bool GLVertexRingBuffer::Create(size_t regionSize, size_t ringCount, const void * initData)
+	{
+		Destroy();
+
+		if (regionSize == 0 || ringCount == 0)
+		{
+			return false;
+		}
+
+		if (!m_buffer.Create())
+		{
+			return false;
+		}
+		m_regionSize = regionSize;
+		m_regionIndex = 0;
+		m_fences.resize(ringCount, nullptr);
+
+		const GLsizeiptr bufferSize = GLsizeiptr(regionSize * ringCount);
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+		if (IsBufferStorageSupported())
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, flags);
+			m_persistentPtr = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags);
+			if (m_persistentPtr == nullptr)
+			{
+				// glBufferStorage で作ったバッファは作り直す
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				m_buffer.Create();
+				glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			}
+		}
+		if (m_persistentPtr == nullptr)
+		{
+			glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (initData != nullptr)
+		{
+			for (size_t i = 0; i < ringCount; i++)
+			{
+				m_regionIndex = i;
+				Write(initData, regionSize);
+			}
+			m_regionIndex = 0;
+		}
+
+		SABA_INFO("GLVertexRingBuffer : size {} x {}, persistent mapped {}", regionSize, ringCount, IsPersistentMapped());
+
+		return true;
+	}
+
+	void GLVertexRingBuffer::Destroy()
+	{
+		for (auto& fence : m_fences)
+		{
+			if (fence != nullptr)
+			{
+				glDeleteSync(fence);
+			}
+		}
+		m_fences.clear();
+
+		if (m_buffer != 0 && (m_persistentPtr != nullptr || m_mapped))
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		m_persistentPtr = nullptr;
+		m_mapped = false;
+
+		m_buffer.Destroy();
+		m_regionSize = 0;
+		m_regionIndex = 0;
+	}
+
+	void GLVertexRingBuffer::NextRegion()
+	{
+		if (m_fences.empty())
+		{
+			return;
+		}
+
+		if (m_fences[m_regionIndex] != nullptr)
+		{
+			glDeleteSync(m_fences[m_regionIndex]);
+		}
+		m_fences[m_regionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		// 1 つ前の NextRegion で置いたフェンスを待つ
+		m_regionIndex = (m_regionIndex + 1) % m_fences.size();
+		WaitFence((m_regionIndex + 1) % m_fences.size());
+	}
+
+	void * GLVertexRingBuffer::Map()
+	{
+		if (m_persistentPtr != nullptr)
+		{
+			return m_persistentPtr + GetRegionOffset();
+		}
+		if (m_buffer == 0 || m_mapped)
+		{
+			return nullptr;
+		}
+
+		// フェンスで待っているので、同期せずにマップする
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+		void* ptr = glMapBufferRange(
+			GL_ARRAY_BUFFER,
+			GLintptr(GetRegionOffset()),
+			GLsizeiptr(m_regionSize),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+		);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_mapped = ptr != nullptr;
+		return ptr;
+	}
+
+	void GLVertexRingBuffer::Unmap()
+	{
+		if (!m_mapped)
+		{
+			return;
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+		if (glUnmapBuffer(GL_ARRAY_BUFFER) != GL_TRUE)
+		{
+			SABA_WARN("GLVertexRingBuffer : Unmap fail.");
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_mapped = false;
+	}
+
+	void GLVertexRingBuffer::Write(const void * data, size_t size)
+	{
+		if (size > m_regionSize)
+		{
+			size = m_regionSize;
+		}
+		if (m_persistentPtr != nullptr)
+		{
+			memcpy(m_persistentPtr + GetRegionOffset(), data, size);
+		}
+		else
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			glBufferSubData(GL_ARRAY_BUFFER, GLintptr(GetRegionOffset()), GLsizeiptr(size), data);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+
+	void GLVertexRingBuffer::WaitFence(size_t regionIndex)
+	{
+		GLsync fence = m_fences[regionIndex];
+		if (fence == nullptr)
+		{
+			return;
+		}
+
+		const GLuint64 Timeout = 1000 * 1000 * 1000;	// 1 秒
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (true)
+		{
+			GLenum ret = glClientWaitSync(fence, flags, Timeout);
+			if (ret == GL_ALREADY_SIGNALED || ret == GL_CONDITION_SATISFIED)
+			{
+				break;
+			}
+			if (ret == GL_WAIT_FAILED)
+			{
+				SABA_WARN("GLVertexRingBuffer : glClientWaitSync fail.");
+				break;
+			}
+			flags = 0;
+		}
+		glDeleteSync(fence);
+		m_fences[regionIndex] = nullptr;
+	}
+}
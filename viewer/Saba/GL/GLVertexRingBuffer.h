@@ -0,0 +1,72 @@
+﻿//
+// Copyright(c) 2016-2019 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_GL_GLVERTEXRINGBUFFER_H_
+#define SABA_GL_GLVERTEXRINGBUFFER_H_
+
+#include "GLObject.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace saba
+{
+	/*
+	毎フレーム書き換える頂点バッファ。
+	1 つのバッファを ringCount 個の領域に分け、フレーム毎に次の領域へ書き込む。
+	GPU が描画に使用中の領域には、フェンスで完了を待ってから書き込む。
+	GL 4.4 か GL_ARB_buffer_storage が使える場合は、永続的にマップしたままにする。
+	*/
+	class GLVertexRingBuffer
+	{
+	public:
+		static const size_t DefaultRingCount = 3;
+
+		GLVertexRingBuffer();
+		~GLVertexRingBuffer();
+
+		GLVertexRingBuffer(const GLVertexRingBuffer&) = delete;
+		GLVertexRingBuffer& operator = (const GLVertexRingBuffer&) = delete;
+
+		// regionSize : 1 フレーム分のバイト数
+		// initData がある場合は、すべての領域を初期化する
+		bool Create(size_t regionSize, size_t ringCount = DefaultRingCount, const void* initData = nullptr);
+		void Destroy();
+
+		/*
+		次の領域に切り替える。
+		呼ぶたびにフェンスを置き、1 つ前に呼んだときのフェンスを待つ。
+		書き込む領域が描画する領域より 1 フレーム先行していても (更新と描画のパイプライン化)、
+		GPU が使用中の領域には書き込まない。
+		*/
+		void NextRegion();
+
+		// 今の領域の書き込み先 (失敗した場合は nullptr)
+		void* Map();
+		void Unmap();
+		// マップせずに、今の領域に転送する
+		void Write(const void* data, size_t size);
+
+		GLuint GetBuffer() const { return m_buffer; }
+		size_t GetRegionIndex() const { return m_regionIndex; }
+		size_t GetRegionOffset() const { return m_regionIndex * m_regionSize; }
+		size_t GetRegionSize() const { return m_regionSize; }
+		bool IsPersistentMapped() const { return m_persistentPtr != nullptr; }
+
+	private:
+		void WaitFence(size_t regionIndex);
+
+	private:
+		GLBufferObject		m_buffer;
+		size_t				m_regionSize;
+		size_t				m_regionIndex;
+		std::vector<GLsync>	m_fences;
+		uint8_t*			m_persistentPtr;
+		bool				m_mapped;
+	};
+}
+
+#endif // !SABA_GL_GLVERTEXRINGBUFFER_H_
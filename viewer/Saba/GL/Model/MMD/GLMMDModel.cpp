@@ -2,24 +2,41 @@
 // Copyright(c) 2016-2017 benikabocha.
 // Distributed under the MIT License (http://opensource.org/licenses/MIT)
 //
+#define GLM_ENABLE_EXPERIMENTAL
 
 #include "GLMMDModel.h"
+#include "GLMMDModelDrawContext.h"
 #include <Saba/GL/GLVertexUtil.h>
 #include <Saba/GL/GLTextureUtil.h>
+#include <Saba/GL/GLTextureCache.h>
+#include <Saba/GL/GLShaderUtil.h>
 #include <Saba/Base/Log.h>
+#include <Saba/Base/Singleton.h>
 #include <Saba/Base/Time.h>
+#include <Saba/Model/MMD/MMDGPUSkinning.h>
+
+#include <glm/gtx/dual_quaternion.hpp>
 
 #include <string>
 #include <map>
 #include <memory>
+#include <algorithm>
+#include <cstddef>
 
 namespace saba
 {
 	GLMMDModel::GLMMDModel()
 		: m_animTime(0)
+		, m_vertexCount(0)
+		, m_drawBaseVertex(0)
+		, m_drawRegionIndex(0)
+		, m_mappedPositions(nullptr)
+		, m_mappedNormals(nullptr)
+		, m_mappedUVs(nullptr)
 		, m_indexType(0)
 		, m_indexTypeSize(0)
 		, m_enablePhysics(true)
+		, m_waitSharedPhysics(false)
 		, m_enableEdge(true)
 		, m_enableGroundShadow(true)
 	{
@@ -32,78 +49,147 @@ namespace saba
 
 	namespace
 	{
-		using TextureManager = std::map<std::string, GLTextureRef>;
+		// テクスチャはプロセス全体のキャッシュから取得し、他のモデルと共有する
 		GLTextureRef CreateMMDTexture(
-			TextureManager& texMan,
+			const GLMMDTextureImageMap& textureImages,
 			const std::string& filename,
-			bool genMipmap = true,
-			bool rgba = false
+			bool genMipmap = true
 		)
 		{
-			std::string key = filename + ":" +
-				std::to_string(genMipmap) + ":" +
-				std::to_string(rgba);
-			auto findIt = texMan.find(key);
-			if (findIt != texMan.end())
+			const GLTextureImage* image = nullptr;
+			auto imageIt = textureImages.find(filename);
+			if (imageIt != textureImages.end())
 			{
-				return (*findIt).second;
-			}
-			else
-			{
-				auto tex = CreateTextureFromFile(filename.c_str());
-				GLTextureRef texRef = std::move(tex);
-				texMan.emplace(std::make_pair(key, texRef));
-				return texRef;
+				// デコードに失敗したテクスチャ (画像が nullptr) は読み直さない
+				if ((*imageIt).second == nullptr)
+				{
+					return GLTextureRef();
+				}
+				image = (*imageIt).second.get();
 			}
+			return Singleton<GLTextureCache>::Get()->GetTexture(filename, genMipmap, image);
 		}
 	}
 
-	bool GLMMDModel::Create(std::shared_ptr<MMDModel> mmdModel)
+	std::shared_ptr<GLMMDModel::StaticBuffers> GLMMDModel::AcquireStaticBuffers(const MMDModel& mmdModel)
 	{
-		Destroy();
+		// GL のスレッドからだけ呼ばれるので、ロックはしない
+		static std::map<const void*, std::weak_ptr<StaticBuffers>> sharedBuffersMap;
 
-		size_t vtxCount = mmdModel->GetVertexCount();
-		auto positions = mmdModel->GetPositions();
-		auto normals = mmdModel->GetNormals();
-		auto uvs = mmdModel->GetUVs();
-		m_posVBO = CreateVBO(positions, vtxCount, GL_DYNAMIC_DRAW);
-		m_norVBO = CreateVBO(normals, vtxCount, GL_DYNAMIC_DRAW);
-		m_uvVBO = CreateVBO(uvs, vtxCount, GL_DYNAMIC_DRAW);
-
-		m_posBinder = MakeVertexBinder<glm::vec3>();
-		m_norBinder = MakeVertexBinder<glm::vec3>();
-		m_uvBinder = MakeVertexBinder<glm::vec2>();
+		auto source = mmdModel.GetSharedMeshData();
+		if (source != nullptr)
+		{
+			auto findIt = sharedBuffersMap.find(source.get());
+			if (findIt != sharedBuffersMap.end())
+			{
+				if (auto sharedBuffers = (*findIt).second.lock())
+				{
+					return sharedBuffers;
+				}
+			}
+		}
 
-		const void* iboBuf = mmdModel->GetIndices();
-		size_t indexCount = mmdModel->GetIndexCount();
-		size_t indexElemSize = mmdModel->GetIndexElementSize();
+		auto buffers = std::make_shared<StaticBuffers>();
+		const void* iboBuf = mmdModel.GetIndices();
+		size_t indexCount = mmdModel.GetIndexCount();
+		size_t indexElemSize = mmdModel.GetIndexElementSize();
 		switch (indexElemSize)
 		{
 		case 1:
-			m_ibo = CreateIBO((uint8_t*)iboBuf, indexCount, GL_STATIC_DRAW);
-			m_indexType = GL_UNSIGNED_BYTE;
-			m_indexTypeSize = 1;
+			buffers->m_ibo = CreateIBO((uint8_t*)iboBuf, indexCount, GL_STATIC_DRAW);
+			buffers->m_indexType = GL_UNSIGNED_BYTE;
+			buffers->m_indexTypeSize = 1;
 			break;
 		case 2:
-			m_ibo = CreateIBO((uint16_t*)iboBuf, indexCount, GL_STATIC_DRAW);
-			m_indexType = GL_UNSIGNED_SHORT;
-			m_indexTypeSize = 2;
+			buffers->m_ibo = CreateIBO((uint16_t*)iboBuf, indexCount, GL_STATIC_DRAW);
+			buffers->m_indexType = GL_UNSIGNED_SHORT;
+			buffers->m_indexTypeSize = 2;
 			break;
 		case 4:
-			m_ibo = CreateIBO((uint32_t*)iboBuf, indexCount, GL_STATIC_DRAW);
-			m_indexType = GL_UNSIGNED_INT;
-			m_indexTypeSize = 4;
+			buffers->m_ibo = CreateIBO((uint32_t*)iboBuf, indexCount, GL_STATIC_DRAW);
+			buffers->m_indexType = GL_UNSIGNED_INT;
+			buffers->m_indexTypeSize = 4;
 			break;
 		default:
 			SABA_ERROR("Unknown Index Size. [{}]", indexElemSize);
+			return nullptr;
+		}
+
+		if (!mmdModel.HasUVMorph())
+		{
+			// 位置と法線のリングバッファと同じ GetBaseVertex() で描画できるように並べる
+			const size_t vtxCount = mmdModel.GetVertexCount();
+			const auto* uvs = mmdModel.GetUVs();
+			std::vector<glm::vec2> ringUVs;
+			ringUVs.reserve(vtxCount * GLVertexRingBuffer::DefaultRingCount);
+			for (size_t i = 0; i < GLVertexRingBuffer::DefaultRingCount; i++)
+			{
+				ringUVs.insert(ringUVs.end(), uvs, uvs + vtxCount);
+			}
+			buffers->m_uvVBO = CreateVBO(ringUVs.data(), ringUVs.size());
+		}
+
+		if (source != nullptr)
+		{
+			for (auto it = sharedBuffersMap.begin(); it != sharedBuffersMap.end();)
+			{
+				if ((*it).second.expired())
+				{
+					it = sharedBuffersMap.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+			buffers->m_source = source;
+			sharedBuffersMap[source.get()] = buffers;
+		}
+		return buffers;
+	}
+
+	bool GLMMDModel::Create(std::shared_ptr<MMDModel> mmdModel)
+	{
+		return Create(mmdModel, GLMMDTextureImageMap());
+	}
+
+	bool GLMMDModel::Create(std::shared_ptr<MMDModel> mmdModel, const GLMMDTextureImageMap& textureImages)
+	{
+		Destroy();
+
+		m_staticBuffers = AcquireStaticBuffers(*mmdModel);
+		if (m_staticBuffers == nullptr)
+		{
+			return false;
+		}
+		m_indexType = m_staticBuffers->m_indexType;
+		m_indexTypeSize = m_staticBuffers->m_indexTypeSize;
+
+		size_t vtxCount = mmdModel->GetVertexCount();
+		auto positions = mmdModel->GetPositions();
+		auto normals = mmdModel->GetNormals();
+		auto uvs = mmdModel->GetUVs();
+		if (!m_posVBO.Create(sizeof(glm::vec3) * vtxCount, GLVertexRingBuffer::DefaultRingCount, positions) ||
+			!m_norVBO.Create(sizeof(glm::vec3) * vtxCount, GLVertexRingBuffer::DefaultRingCount, normals) ||
+			(m_staticBuffers->m_uvVBO == 0 &&
+			!m_uvVBO.Create(sizeof(glm::vec2) * vtxCount, GLVertexRingBuffer::DefaultRingCount, uvs)))
+		{
+			SABA_ERROR("Vertex Buffer Create fail.");
+			Destroy();
 			return false;
 		}
+		m_vertexCount = vtxCount;
+		m_drawBaseVertex = 0;
+		m_drawRegionIndex = 0;
+
+		m_posBinder = MakeVertexBinder<glm::vec3>();
+		m_norBinder = MakeVertexBinder<glm::vec3>();
+		m_uvBinder = MakeVertexBinder<glm::vec2>();
 
 		// Material
 		size_t matCount = mmdModel->GetMaterialCount();
 		auto materials = mmdModel->GetMaterials();
 		m_materials.resize(matCount);
-		TextureManager texMan;
 		for (size_t matIdx = 0; matIdx < matCount; matIdx++)
 		{
 			auto& dest = m_materials[matIdx];
@@ -119,7 +205,7 @@ namespace saba
 			dest.m_edgeColor = src.m_edgeColor;
 			if (!src.m_texture.empty())
 			{
-				dest.m_texture = CreateMMDTexture(texMan, src.m_texture, true, true);
+				dest.m_texture = CreateMMDTexture(textureImages, src.m_texture, true);
 				dest.m_textureHaveAlpha = IsAlphaTexture(dest.m_texture);
 			}
 			dest.m_textureMulFactor = src.m_textureMulFactor;
@@ -127,7 +213,7 @@ namespace saba
 
 			if (!src.m_spTexture.empty())
 			{
-				dest.m_spTexture = CreateMMDTexture(texMan, src.m_spTexture, false, true);
+				dest.m_spTexture = CreateMMDTexture(textureImages, src.m_spTexture, false);
 			}
 			dest.m_spTextureMode = src.m_spTextureMode;
 			dest.m_spTextureMulFactor = src.m_spTextureMulFactor;
@@ -135,7 +221,7 @@ namespace saba
 
 			if (!src.m_toonTexture.empty())
 			{
-				dest.m_toonTexture = CreateMMDTexture(texMan, src.m_toonTexture);
+				dest.m_toonTexture = CreateMMDTexture(textureImages, src.m_toonTexture);
 			}
 			dest.m_toonTextureMulFactor = src.m_toonTextureMulFactor;
 			dest.m_toonTextureAddFactor = src.m_toonTextureAddFactor;
@@ -167,12 +253,40 @@ namespace saba
 
 	void GLMMDModel::Destroy()
 	{
+		DisableGPUSkinning();
+
 		m_mmdModel.reset();
 
 		m_posVBO.Destroy();
 		m_norVBO.Destroy();
 		m_uvVBO.Destroy();
-		m_ibo.Destroy();
+		m_vertexCount = 0;
+		m_drawBaseVertex = 0;
+		m_drawRegionIndex = 0;
+		m_mappedPositions = nullptr;
+		m_mappedNormals = nullptr;
+		m_mappedUVs = nullptr;
+		m_indexType = 0;
+		m_indexTypeSize = 0;
+		m_staticBuffers.reset();
+	}
+
+	GLuint GLMMDModel::GetUVVBO() const
+	{
+		if (m_uvVBO.GetBuffer() != 0 || m_staticBuffers == nullptr)
+		{
+			return m_uvVBO.GetBuffer();
+		}
+		return m_staticBuffers->m_uvVBO;
+	}
+
+	GLuint GLMMDModel::GetIBO() const
+	{
+		if (m_staticBuffers == nullptr)
+		{
+			return 0;
+		}
+		return m_staticBuffers->m_ibo;
 	}
 
 	bool GLMMDModel::LoadAnimation(const VMDFile& vmd)
@@ -279,7 +393,6 @@ namespace saba
 		Perf setupAnimPerf;
 		Perf updateMorphAnimPerf;
 		Perf updateNodeAnimPerf;
-		Perf updatePhysicsAnimPerf;
 
 		// Begin animation
 		setupAnimPerf.Start();
@@ -299,30 +412,14 @@ namespace saba
 		// Update node animation (before physics animation)
 		updateNodeAnimPerf.Start();
 		m_mmdModel->UpdateNodeAnimation(false);
-		updateNodeAnimPerf.Stop();;
-
-		if (m_enablePhysics)
-		{
-			// Update physics animation
-			updatePhysicsAnimPerf.Start();
-			m_mmdModel->UpdatePhysicsAnimation((float)elapsed);
-			updatePhysicsAnimPerf.Stop();
-		}
-
-		// Update node animation (after physics animation)
-		updateNodeAnimPerf.Start();
-		m_mmdModel->UpdateNodeAnimation(true);
 		updateNodeAnimPerf.Stop();
 
-		// End animation
-		setupAnimPerf.Start();
-		m_mmdModel->EndAnimation();
-		setupAnimPerf.Stop();
-
 		m_perfInfo.m_setupAnimTime = setupAnimPerf.GetPerfTime();
 		m_perfInfo.m_updateMorphAnimTime = updateMorphAnimPerf.GetPerfTime();
 		m_perfInfo.m_updateNodeAnimTime = updateNodeAnimPerf.GetPerfTime();
-		m_perfInfo.m_updatePhysicsAnimTime = updatePhysicsAnimPerf.GetPerfTime();
+		m_perfInfo.m_updatePhysicsAnimTime = 0;
+
+		UpdatePhysicsAndEndAnimation(elapsed);
 	}
 
 	void GLMMDModel::UpdateAnimationIgnoreVMD(double elapsed)
@@ -330,7 +427,6 @@ namespace saba
 		Perf setupAnimPerf;
 		Perf updateMorphAnimPerf;
 		Perf updateNodeAnimPerf;
-		Perf updatePhysicsAnimPerf;
 
 		// Save animation (save node TRS)
 		setupAnimPerf.Start();
@@ -357,14 +453,63 @@ namespace saba
 		m_mmdModel->UpdateNodeAnimation(false);
 		updateNodeAnimPerf.Stop();
 
+		m_perfInfo.m_setupAnimTime = setupAnimPerf.GetPerfTime();
+		m_perfInfo.m_updateMorphAnimTime = updateMorphAnimPerf.GetPerfTime();
+		m_perfInfo.m_updateNodeAnimTime = updateNodeAnimPerf.GetPerfTime();
+		m_perfInfo.m_updatePhysicsAnimTime = 0;
+
+		UpdatePhysicsAndEndAnimation(elapsed);
+	}
+
+	void GLMMDModel::UpdatePhysicsAndEndAnimation(double elapsed)
+	{
+		Perf updatePhysicsAnimPerf;
+
+		if (m_enablePhysics && m_mmdModel->GetPhysicsManager()->IsSharedPhysics())
+		{
+			// ワールドは共有している側で進めるので、続きは EndSharedPhysicsAnimation で行う
+			updatePhysicsAnimPerf.Start();
+			m_mmdModel->BeginPhysicsAnimation((float)elapsed);
+			updatePhysicsAnimPerf.Stop();
+			m_perfInfo.m_updatePhysicsAnimTime += updatePhysicsAnimPerf.GetPerfTime();
+			m_waitSharedPhysics = true;
+			return;
+		}
+
 		if (m_enablePhysics)
 		{
 			// Update physics animation
 			updatePhysicsAnimPerf.Start();
 			m_mmdModel->UpdatePhysicsAnimation((float)elapsed);
 			updatePhysicsAnimPerf.Stop();
+			m_perfInfo.m_updatePhysicsAnimTime += updatePhysicsAnimPerf.GetPerfTime();
 		}
 
+		EndAnimationAfterPhysics();
+	}
+
+	void GLMMDModel::EndSharedPhysicsAnimation()
+	{
+		if (!m_waitSharedPhysics)
+		{
+			return;
+		}
+		m_waitSharedPhysics = false;
+
+		Perf updatePhysicsAnimPerf;
+		updatePhysicsAnimPerf.Start();
+		m_mmdModel->EndPhysicsAnimation();
+		updatePhysicsAnimPerf.Stop();
+		m_perfInfo.m_updatePhysicsAnimTime += updatePhysicsAnimPerf.GetPerfTime();
+
+		EndAnimationAfterPhysics();
+	}
+
+	void GLMMDModel::EndAnimationAfterPhysics()
+	{
+		Perf setupAnimPerf;
+		Perf updateNodeAnimPerf;
+
 		// Update node animation (after physics animation)
 		updateNodeAnimPerf.Start();
 		m_mmdModel->UpdateNodeAnimation(true);
@@ -375,10 +520,8 @@ namespace saba
 		m_mmdModel->EndAnimation();
 		setupAnimPerf.Stop();
 
-		m_perfInfo.m_setupAnimTime = setupAnimPerf.GetPerfTime();
-		m_perfInfo.m_updateMorphAnimTime = updateMorphAnimPerf.GetPerfTime();
-		m_perfInfo.m_updateNodeAnimTime = updateNodeAnimPerf.GetPerfTime();
-		m_perfInfo.m_updatePhysicsAnimTime = updatePhysicsAnimPerf.GetPerfTime();
+		m_perfInfo.m_setupAnimTime += setupAnimPerf.GetPerfTime();
+		m_perfInfo.m_updateNodeAnimTime += updateNodeAnimPerf.GetPerfTime();
 	}
 
 	void GLMMDModel::UpdateMorph()
@@ -398,18 +541,114 @@ namespace saba
 	}
 
 	void GLMMDModel::Update()
+	{
+		BeginUpdate();
+		UpdateModel();
+		EndUpdate();
+	}
+
+	void GLMMDModel::BeginUpdate()
 	{
 		if (m_mmdModel == nullptr)
 		{
 			return;
 		}
 
-		Perf updateModelPerf;
 		Perf updateGLBufferPerf;
 
+		updateGLBufferPerf.Start();
+		// 描画に使っている領域とは別の領域に書き込む
+		m_posVBO.NextRegion();
+		m_norVBO.NextRegion();
+		m_uvVBO.NextRegion();
+		// UV を共有している場合は書き込まない
+		const bool writeUV = m_uvVBO.GetBuffer() != 0;
+		// 永続的にマップできない場合、マップしたままのバッファでは描画できない (GL_INVALID_OPERATION)。
+		// EndUpdate までの間に描画することがあるので、MMDModel の配列から EndUpdate で転送する
+		const bool persistentMapped = m_posVBO.IsPersistentMapped() && m_norVBO.IsPersistentMapped() &&
+			(!writeUV || m_uvVBO.IsPersistentMapped());
+		if (!IsEnabledGPUSkinning() && persistentMapped)
+		{
+			// スキニングの結果をマップしたバッファに直接書き込む
+			auto positions = (glm::vec3*)m_posVBO.Map();
+			auto normals = (glm::vec3*)m_norVBO.Map();
+			auto uvs = writeUV ? (glm::vec2*)m_uvVBO.Map() : nullptr;
+			if (positions != nullptr && normals != nullptr && (uvs != nullptr || !writeUV))
+			{
+				m_mappedPositions = positions;
+				m_mappedNormals = normals;
+				m_mappedUVs = uvs;
+			}
+			else
+			{
+				m_posVBO.Unmap();
+				m_norVBO.Unmap();
+				m_uvVBO.Unmap();
+			}
+		}
+		updateGLBufferPerf.Stop();
+
+		m_perfInfo.m_updateGLBufferTime = updateGLBufferPerf.GetPerfTime();
+	}
+
+	void GLMMDModel::UpdateModel()
+	{
+		if (m_mmdModel == nullptr)
+		{
+			return;
+		}
+
+		Perf updateModelPerf;
+
 		updateModelPerf.Start();
-		m_mmdModel->Update();
+		if (m_mappedPositions != nullptr)
+		{
+			m_mmdModel->Update(m_mappedPositions, m_mappedNormals, m_mappedUVs);
+		}
+		else
+		{
+			m_mmdModel->Update();
+		}
+		updateModelPerf.Stop();
 
+		m_perfInfo.m_updateModelTime = updateModelPerf.GetPerfTime();
+	}
+
+	void GLMMDModel::EndUpdate()
+	{
+		if (m_mmdModel == nullptr)
+		{
+			return;
+		}
+
+		Perf updateGLBufferPerf;
+
+		updateGLBufferPerf.Start();
+		if (IsEnabledGPUSkinning())
+		{
+			UpdateGPUSkinning();
+		}
+		else if (m_mappedPositions != nullptr)
+		{
+			m_posVBO.Unmap();
+			m_norVBO.Unmap();
+			m_uvVBO.Unmap();
+			m_mappedPositions = nullptr;
+			m_mappedNormals = nullptr;
+			m_mappedUVs = nullptr;
+		}
+		else
+		{
+			m_posVBO.Write(m_mmdModel->GetUpdatePositions(), sizeof(glm::vec3) * m_vertexCount);
+			m_norVBO.Write(m_mmdModel->GetUpdateNormals(), sizeof(glm::vec3) * m_vertexCount);
+			if (m_uvVBO.GetBuffer() != 0)
+			{
+				m_uvVBO.Write(m_mmdModel->GetUpdateUVs(), sizeof(glm::vec2) * m_vertexCount);
+			}
+		}
+		updateGLBufferPerf.Stop();
+
+		// 描画に使うマテリアルと頂点はここで切り替える
 		size_t matCount = m_mmdModel->GetMaterialCount();
 		for (size_t mi = 0; mi < matCount; mi++)
 		{
@@ -426,17 +665,273 @@ namespace saba
 			m_materials[mi].m_toonTextureMulFactor = mmdMat.m_toonTextureMulFactor;
 			m_materials[mi].m_toonTextureAddFactor = mmdMat.m_toonTextureAddFactor;
 		}
-		updateModelPerf.Stop();
+		m_drawRegionIndex = m_posVBO.GetRegionIndex();
+		m_drawBaseVertex = GLint(m_drawRegionIndex * m_vertexCount);
+
+		m_perfInfo.m_updateGLBufferTime += updateGLBufferPerf.GetPerfTime();
+	}
+
+	namespace
+	{
+		// ボーン毎の texel 数 (mmd_skinning.vert の BONE_TEXEL_COUNT)
+		// 0-3: スキニング行列, 4: SDEF の回転, 5-6: デュアルクォータニオン
+		const size_t GPUSkinningBoneTexelCount = 7;
+
+		enum GPUSkinningTextureUnit : GLint
+		{
+			BoneTextureUnit,
+			PositionMorphTextureUnit,
+			UVMorphTextureUnit,
+			MorphWeightTextureUnit,
+		};
+
+		template <typename T>
+		void CreateTextureBuffer(
+			GLBufferObject*	buffer,
+			GLTextureObject* tex,
+			GLenum			format,
+			const T*		data,
+			size_t			count,
+			GLenum			usage
+		)
+		{
+			// 空のバッファは作れないので、最低 1 要素確保する
+			buffer->Create();
+			glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+			glBufferData(GL_TEXTURE_BUFFER, sizeof(T) * std::max(count, size_t(1)), nullptr, usage);
+			if (count != 0)
+			{
+				glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(T) * count, data);
+			}
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+			tex->Create();
+			glBindTexture(GL_TEXTURE_BUFFER, *tex);
+			glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+		}
+
+		void BindSkinningAttribute(GLint attr, GLuint vbo, GLint num, GLenum type, size_t stride, size_t offset)
+		{
+			if (attr == -1)
+			{
+				return;
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			if (type == GL_INT)
+			{
+				glVertexAttribIPointer(attr, num, type, GLsizei(stride), (const void*)offset);
+			}
+			else
+			{
+				glVertexAttribPointer(attr, num, type, GL_FALSE, GLsizei(stride), (const void*)offset);
+			}
+			glEnableVertexAttribArray(attr);
+		}
+	}
+
+	bool GLMMDModel::EnableGPUSkinning(const GLMMDSkinningShader* shader)
+	{
+		if (m_mmdModel == nullptr || shader == nullptr)
+		{
+			return false;
+		}
+		if (m_gpuSkinning.m_shader == shader)
+		{
+			return true;
+		}
+		DisableGPUSkinning();
+
+		// スキニング前の頂点とモーフは、同じモデルのインスタンスで共有する
+		auto* buffers = m_staticBuffers.get();
+		if (!buffers->m_gpuSkinningCreated && !CreateGPUSkinningInputs(buffers))
+		{
+			SABA_INFO("GPU Skinning is not supported.");
+			return false;
+		}
+
+		// 回転の texel は使わない場合も単位クォータニオンにしておく
+		auto& gpu = m_gpuSkinning;
+		gpu.m_boneCount = m_mmdModel->GetNodeManager()->GetNodeCount();
+		gpu.m_boneTexels.assign(std::max(gpu.m_boneCount, size_t(1)) * GPUSkinningBoneTexelCount, glm::vec4(0, 0, 0, 1));
+		CreateTextureBuffer(&gpu.m_boneBuffer, &gpu.m_boneTex, GL_RGBA32F, gpu.m_boneTexels.data(), gpu.m_boneTexels.size(), GL_STREAM_DRAW);
+		std::vector<float> morphWeights(buffers->m_morphWeightCount, 0.0f);
+		CreateTextureBuffer(&gpu.m_morphWeightBuffer, &gpu.m_morphWeightTex, GL_R32F, morphWeights.data(), morphWeights.size(), GL_STREAM_DRAW);
+
+		if (!gpu.m_vao.Create())
+		{
+			SABA_ERROR("Vertex Array Object Create fail.");
+			DisableGPUSkinning();
+			return false;
+		}
+		glBindVertexArray(gpu.m_vao);
+		BindSkinningAttribute(shader->m_inPos, buffers->m_skinningPosVBO, 3, GL_FLOAT, sizeof(glm::vec3), 0);
+		BindSkinningAttribute(shader->m_inNor, buffers->m_skinningNorVBO, 3, GL_FLOAT, sizeof(glm::vec3), 0);
+		BindSkinningAttribute(shader->m_inUV, buffers->m_skinningUVVBO, 2, GL_FLOAT, sizeof(glm::vec2), 0);
+		const GLuint vertexVBO = buffers->m_skinningVertexVBO;
+		const size_t stride = sizeof(MMDGPUSkinningVertex);
+		BindSkinningAttribute(shader->m_inBoneIndex, vertexVBO, 4, GL_INT, stride, offsetof(MMDGPUSkinningVertex, m_boneIndex));
+		BindSkinningAttribute(shader->m_inBoneWeight, vertexVBO, 4, GL_FLOAT, stride, offsetof(MMDGPUSkinningVertex, m_boneWeight));
+		BindSkinningAttribute(shader->m_inSdefC, vertexVBO, 3, GL_FLOAT, stride, offsetof(MMDGPUSkinningVertex, m_sdefC));
+		BindSkinningAttribute(shader->m_inSdefR0, vertexVBO, 3, GL_FLOAT, stride, offsetof(MMDGPUSkinningVertex, m_sdefR0));
+		BindSkinningAttribute(shader->m_inSdefR1, vertexVBO, 3, GL_FLOAT, stride, offsetof(MMDGPUSkinningVertex, m_sdefR1));
+		BindSkinningAttribute(shader->m_inSkinningType, vertexVBO, 1, GL_INT, stride, offsetof(MMDGPUSkinningVertex, m_skinningType));
+		BindSkinningAttribute(shader->m_inPositionMorph, vertexVBO, 2, GL_INT, stride, offsetof(MMDGPUSkinningVertex, m_positionMorph));
+		BindSkinningAttribute(shader->m_inUVMorph, vertexVBO, 2, GL_INT, stride, offsetof(MMDGPUSkinningVertex, m_uvMorph));
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		gpu.m_shader = shader;
+		m_mmdModel->EnableGPUSkinning(true);
+
+		return true;
+	}
+
+	void GLMMDModel::DisableGPUSkinning()
+	{
+		if (m_mmdModel != nullptr)
+		{
+			m_mmdModel->EnableGPUSkinning(false);
+		}
+
+		// GLObject のムーブ代入は破棄しないので、個別に破棄する
+		auto& gpu = m_gpuSkinning;
+		gpu.m_shader = nullptr;
+		gpu.m_vao.Destroy();
+		gpu.m_boneBuffer.Destroy();
+		gpu.m_boneTex.Destroy();
+		gpu.m_morphWeightBuffer.Destroy();
+		gpu.m_morphWeightTex.Destroy();
+		gpu.m_boneTexels.clear();
+		gpu.m_boneCount = 0;
+	}
+
+	bool GLMMDModel::CreateGPUSkinningInputs(StaticBuffers* buffers)
+	{
+		MMDGPUSkinningData data;
+		if (!m_mmdModel->GetGPUSkinningData(&data))
+		{
+			return false;
+		}
 
-		updateGLBufferPerf.Start();
 		size_t vtxCount = m_mmdModel->GetVertexCount();
-		UpdateVBO(m_posVBO, m_mmdModel->GetUpdatePositions(), vtxCount);
-		UpdateVBO(m_norVBO, m_mmdModel->GetUpdateNormals(), vtxCount);
-		UpdateVBO(m_uvVBO, m_mmdModel->GetUpdateUVs(), vtxCount);
-		updateGLBufferPerf.Stop();
+		buffers->m_skinningPosVBO = CreateVBO(m_mmdModel->GetPositions(), vtxCount);
+		buffers->m_skinningNorVBO = CreateVBO(m_mmdModel->GetNormals(), vtxCount);
+		buffers->m_skinningUVVBO = CreateVBO(m_mmdModel->GetUVs(), vtxCount);
+		buffers->m_skinningVertexVBO = CreateVBO(data.m_vertices);
+		if (buffers->m_uvVBO != 0)
+		{
+			buffers->m_skinningUVDiscard = CreateVBO((const glm::vec2*)nullptr, vtxCount, GL_STREAM_COPY);
+		}
 
-		m_perfInfo.m_updateModelTime = updateModelPerf.GetPerfTime();
-		m_perfInfo.m_updateGLBufferTime = updateGLBufferPerf.GetPerfTime();
+		buffers->m_useDualQuaternion = std::any_of(
+			data.m_vertices.begin(),
+			data.m_vertices.end(),
+			[](const MMDGPUSkinningVertex& vtx) { return vtx.m_skinningType == int32_t(MMDGPUSkinningType::DualQuaternion); }
+		);
+
+		CreateTextureBuffer(&buffers->m_positionMorphBuffer, &buffers->m_positionMorphTex, GL_RGBA32F, data.m_positionMorphs.data(), data.m_positionMorphs.size(), GL_STATIC_DRAW);
+		CreateTextureBuffer(&buffers->m_uvMorphBuffer, &buffers->m_uvMorphTex, GL_RGBA32F, data.m_uvMorphs.data(), data.m_uvMorphs.size(), GL_STATIC_DRAW);
+		buffers->m_morphWeightCount = data.m_morphWeightCount;
+		buffers->m_gpuSkinningCreated = true;
+
+		return true;
+	}
+
+	void GLMMDModel::UpdateGPUSkinning()
+	{
+		auto& gpu = m_gpuSkinning;
+		const auto* buffers = m_staticBuffers.get();
+
+		// スキニング行列
+		const auto* transforms = m_mmdModel->GetSkinningTransforms();
+		const auto* sdefRotations = m_mmdModel->GetSDEFRotations();
+		for (size_t i = 0; i < gpu.m_boneCount; i++)
+		{
+			auto* texel = &gpu.m_boneTexels[i * GPUSkinningBoneTexelCount];
+			const auto& m = transforms[i];
+			texel[0] = m[0];
+			texel[1] = m[1];
+			texel[2] = m[2];
+			texel[3] = m[3];
+			if (sdefRotations != nullptr)
+			{
+				const auto& q = sdefRotations[i];
+				texel[4] = glm::vec4(q.x, q.y, q.z, q.w);
+			}
+			if (buffers->m_useDualQuaternion)
+			{
+				auto dq = glm::dualquat_cast(glm::mat3x4(glm::transpose(m)));
+				dq = glm::normalize(dq);
+				texel[5] = glm::vec4(dq.real.x, dq.real.y, dq.real.z, dq.real.w);
+				texel[6] = glm::vec4(dq.dual.x, dq.dual.y, dq.dual.z, dq.dual.w);
+			}
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, gpu.m_boneBuffer);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(glm::vec4) * gpu.m_boneCount * GPUSkinningBoneTexelCount, gpu.m_boneTexels.data());
+
+		// モーフのウェイト
+		if (buffers->m_morphWeightCount != 0)
+		{
+			glBindBuffer(GL_TEXTURE_BUFFER, gpu.m_morphWeightBuffer);
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(float) * buffers->m_morphWeightCount, m_mmdModel->GetMorphWeights());
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		const auto* shader = gpu.m_shader;
+		glUseProgram(shader->m_prog);
+
+		auto bindTexture = [](GLint uniform, GLint unit, GLuint tex)
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_BUFFER, tex);
+			SetUniform(uniform, unit);
+		};
+		bindTexture(shader->m_uBones, BoneTextureUnit, gpu.m_boneTex);
+		bindTexture(shader->m_uPositionMorphs, PositionMorphTextureUnit, buffers->m_positionMorphTex);
+		bindTexture(shader->m_uUVMorphs, UVMorphTextureUnit, buffers->m_uvMorphTex);
+		bindTexture(shader->m_uMorphWeights, MorphWeightTextureUnit, gpu.m_morphWeightTex);
+
+		// 描画用の頂点バッファに直接書き出す
+		glBindVertexArray(gpu.m_vao);
+		glEnable(GL_RASTERIZER_DISCARD);
+		auto bindOutput = [](GLuint index, const GLVertexRingBuffer& vbo)
+		{
+			glBindBufferRange(
+				GL_TRANSFORM_FEEDBACK_BUFFER,
+				index,
+				vbo.GetBuffer(),
+				GLintptr(vbo.GetRegionOffset()),
+				GLsizeiptr(vbo.GetRegionSize())
+			);
+		};
+		bindOutput(0, m_posVBO);
+		bindOutput(1, m_norVBO);
+		if (m_uvVBO.GetBuffer() != 0)
+		{
+			bindOutput(2, m_uvVBO);
+		}
+		else
+		{
+			// UV は共有しているバッファを使うので、書き出した UV は捨てる
+			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 2, buffers->m_skinningUVDiscard);
+		}
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, GLsizei(m_mmdModel->GetVertexCount()));
+		glEndTransformFeedback();
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, 0);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 2, 0);
+		glDisable(GL_RASTERIZER_DISCARD);
+		glBindVertexArray(0);
+
+		for (GLint unit = BoneTextureUnit; unit <= MorphWeightTextureUnit; unit++)
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+		}
+		glActiveTexture(GL_TEXTURE0);
+		glUseProgram(0);
 	}
 
 	void GLMMDModel::PerfInfo::Clear()
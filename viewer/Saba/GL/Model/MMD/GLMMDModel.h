@@ -8,15 +8,24 @@
 
 #include <Saba/GL/GLObject.h>
 #include <Saba/GL/GLVertexUtil.h>
+#include <Saba/GL/GLTextureUtil.h>
+#include <Saba/GL/GLVertexRingBuffer.h>
 #include <Saba/Model/MMD/MMDModel.h>
 #include <Saba/Model/MMD/MMDMaterial.h>
 
 #include <Saba/Model/MMD/VMDAnimation.h>
 
 #include <memory>
+#include <map>
+#include <string>
 
 namespace saba
 {
+	struct GLMMDSkinningShader;
+
+	// デコード済みのテクスチャ (キーはテクスチャのファイルパス)
+	using GLMMDTextureImageMap = std::map<std::string, std::shared_ptr<GLTextureImage>>;
+
 	struct GLMMDMaterial
 	{
 		using SphereTextureMode = MMDMaterial::SphereTextureMode;
@@ -52,6 +61,8 @@ namespace saba
 		~GLMMDModel();
 
 		bool Create(std::shared_ptr<MMDModel> mmdModel);
+		// textureImages にあるテクスチャはファイルから読まずに、デコード済みの画像を転送する
+		bool Create(std::shared_ptr<MMDModel> mmdModel, const GLMMDTextureImageMap& textureImages);
 		void Destroy();
 
 		bool LoadAnimation(const VMDFile& vmd);
@@ -71,20 +82,52 @@ namespace saba
 		void EvaluateAnimation(double animTime);
 		void UpdateAnimation(double animTime, double elapsed);
 		void UpdateAnimationIgnoreVMD(double elapsed);
+		/*
+		物理演算のワールドを他のモデルと共有している場合、UpdateAnimation は物理演算の前までを行う。
+		ワールドを進めた後に EndSharedPhysicsAnimation を呼ぶ。
+		*/
+		bool IsWaitingSharedPhysics() const { return m_waitSharedPhysics; }
+		void EndSharedPhysicsAnimation();
 		void UpdateMorph();
 		void Update();
 
-		const GLBufferObject& GetPositionVBO() const { return m_posVBO; }
-		const GLBufferObject& GetNormalVBO() const { return m_norVBO; }
-		const GLBufferObject& GetUVVBO() const { return m_uvVBO; }
+		/*
+		Update を分割したもの。
+		BeginUpdate と EndUpdate は GL のスレッドで呼び、UpdateModel はワーカースレッドで呼んでもよい。
+		EndUpdate を呼ぶまでは、前の Update の結果が描画に使われる。
+		BeginUpdate から EndUpdate の間は、MMDModel に触らないこと。
+		*/
+		void BeginUpdate();
+		void UpdateModel();
+		void EndUpdate();
+
+		/*
+		スキニングとモーフを GPU (Transform Feedback) で行う。
+		毎フレームの転送はスキニング行列とモーフのウェイトだけになる。
+		モデルが対応していない場合は false を返し、CPU で行う。
+		*/
+		bool EnableGPUSkinning(const GLMMDSkinningShader* shader);
+		void DisableGPUSkinning();
+		bool IsEnabledGPUSkinning() const { return m_gpuSkinning.m_shader != nullptr; }
+
+		// 頂点バッファはフレーム毎に領域を切り替えるので、描画時は GetBaseVertex() を使う
+		// UV モーフがないモデルの UV は、同じモデルのインスタンスで共有するバッファを返す
+		GLuint GetPositionVBO() const { return m_posVBO.GetBuffer(); }
+		GLuint GetNormalVBO() const { return m_norVBO.GetBuffer(); }
+		GLuint GetUVVBO() const;
+		GLint GetBaseVertex() const { return m_drawBaseVertex; }
+		// GetBaseVertex() の領域の番号 (0 から GetVertexRegionCount() - 1 まで)
+		size_t GetVertexRegionIndex() const { return m_drawRegionIndex; }
+		size_t GetVertexRegionCount() const { return GLVertexRingBuffer::DefaultRingCount; }
 
 		const VertexBinder& GetPositionBinder() const { return m_posBinder; }
 		const VertexBinder& GetNormalBinder() const { return m_norBinder; }
 		const VertexBinder& GetUVBinder() const { return m_uvBinder; }
 
+		// インデックスバッファは同じモデルのインスタンスで共有する
 		size_t GetIndexTypeSize() const { return m_indexTypeSize; }
 		GLenum GetIndexType() const { return m_indexType; }
-		const GLBufferObject& GetIBO() const { return m_ibo; }
+		GLuint GetIBO() const;
 
 		MMDModel* GetMMDModel() const { return m_mmdModel.get(); }
 		const std::vector<GLMMDMaterial>& GetMaterials() const { return m_materials; }
@@ -120,15 +163,80 @@ namespace saba
 		void EnableGroundShadow(bool enable) { m_enableGroundShadow = enable; }
 		bool IsEnableGroundShadow() const { return m_enableGroundShadow; }
 
+	private:
+		struct StaticBuffers;
+		static std::shared_ptr<StaticBuffers> AcquireStaticBuffers(const MMDModel& mmdModel);
+		bool CreateGPUSkinningInputs(StaticBuffers* buffers);
+		void UpdatePhysicsAndEndAnimation(double elapsed);
+		void EndAnimationAfterPhysics();
+		void UpdateGPUSkinning();
+
+	private:
+		/*
+		モデルデータ (MMDModel::GetSharedMeshData) が同じインスタンスで共有する、変化しないバッファ。
+		共有していないモデルは、インスタンス毎に作る。
+		*/
+		struct StaticBuffers
+		{
+			// 共有している間、キーにしているモデルデータを破棄しない
+			std::shared_ptr<const void>	m_source;
+
+			GLenum			m_indexType = 0;
+			size_t			m_indexTypeSize = 0;
+			GLBufferObject	m_ibo;
+
+			// UV モーフがない場合の描画用の UV (GLVertexRingBuffer の領域数だけ並べる)
+			GLBufferObject	m_uvVBO;
+
+			// GPU スキニングの入力 (最初に有効にしたときに作る)
+			bool			m_gpuSkinningCreated = false;
+			GLBufferObject	m_skinningPosVBO;
+			GLBufferObject	m_skinningNorVBO;
+			GLBufferObject	m_skinningUVVBO;
+			GLBufferObject	m_skinningVertexVBO;	// MMDGPUSkinningVertex
+			GLBufferObject	m_positionMorphBuffer;
+			GLTextureObject	m_positionMorphTex;
+			GLBufferObject	m_uvMorphBuffer;
+			GLTextureObject	m_uvMorphTex;
+			// UV を共有している場合の、Transform Feedback の UV の書き出し先 (描画には使わない)
+			GLBufferObject	m_skinningUVDiscard;
+			size_t			m_morphWeightCount = 0;
+			bool			m_useDualQuaternion = false;
+		};
+
+		struct GPUSkinning
+		{
+			const GLMMDSkinningShader*	m_shader = nullptr;
+			GLVertexArrayObject			m_vao;
+
+			// Texture Buffer
+			GLBufferObject	m_boneBuffer;
+			GLTextureObject	m_boneTex;
+			GLBufferObject	m_morphWeightBuffer;
+			GLTextureObject	m_morphWeightTex;
+
+			std::vector<glm::vec4>	m_boneTexels;
+			size_t					m_boneCount = 0;
+		};
+
 	private:
 		std::shared_ptr<MMDModel>		m_mmdModel;
 
 		std::unique_ptr<VMDAnimation>	m_vmdAnim;
 		double							m_animTime;
 
-		GLBufferObject	m_posVBO;
-		GLBufferObject	m_norVBO;
-		GLBufferObject	m_uvVBO;
+		size_t				m_vertexCount;
+		GLVertexRingBuffer	m_posVBO;
+		GLVertexRingBuffer	m_norVBO;
+		// UV モーフがあるモデルだけ作る
+		GLVertexRingBuffer	m_uvVBO;
+		GLint				m_drawBaseVertex;
+		size_t				m_drawRegionIndex;
+
+		// BeginUpdate でマップした書き込み先 (永続的にマップできなかった場合は nullptr)
+		glm::vec3*	m_mappedPositions;
+		glm::vec3*	m_mappedNormals;
+		glm::vec2*	m_mappedUVs;
 
 		VertexBinder	m_posBinder;
 		VertexBinder	m_norBinder;
@@ -136,14 +244,17 @@ namespace saba
 
 		GLenum			m_indexType;
 		size_t			m_indexTypeSize;
-		GLBufferObject	m_ibo;
+		std::shared_ptr<StaticBuffers>	m_staticBuffers;
 
 		std::vector<GLMMDMaterial>	m_materials;
 		std::vector<MMDSubMesh>		m_subMeshes;
 
 		PerfInfo					m_perfInfo;
 
+		GPUSkinning					m_gpuSkinning;
+
 		bool	m_enablePhysics;
+		bool	m_waitSharedPhysics;
 		bool	m_enableEdge;
 		bool	m_enableGroundShadow;
 	};
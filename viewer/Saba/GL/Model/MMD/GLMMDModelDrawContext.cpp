@@ -6,54 +6,74 @@
 #include "GLMMDModelDrawContext.h"
 
 #include <Saba/Base/Log.h>
+#include <Saba/GL/GLShaderUtil.h>
 #include <Saba/Viewer/ViewerContext.h>
 
 #include <algorithm>
+#include <cstring>
 
 namespace saba
 {
+	namespace
+	{
+		// シェーダーで使われていない uniform block は無視する
+		void BindUniformBlock(GLuint prog, const char* blockName, GLuint binding)
+		{
+			GLuint blockIndex = glGetUniformBlockIndex(prog, blockName);
+			if (blockIndex != GL_INVALID_INDEX)
+			{
+				glUniformBlockBinding(prog, blockIndex, binding);
+			}
+		}
+
+		void BindMMDUniformBlocks(GLuint prog)
+		{
+			BindUniformBlock(prog, "MMDFrame", GLMMDFrameBlockBinding);
+			BindUniformBlock(prog, "MMDModel", GLMMDModelBlockBinding);
+			BindUniformBlock(prog, "MMDMaterial", GLMMDMaterialBlockBinding);
+
+			// MMD_MULTI_DRAW
+			glUseProgram(prog);
+			SetUniform(glGetUniformLocation(prog, "u_Materials"), GLMMDMaterialTextureUnit);
+			glUseProgram(0);
+		}
+
+		bool IsGLExtensionSupported(const char* name)
+		{
+			GLint extCount = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &extCount);
+			for (GLint i = 0; i < extCount; i++)
+			{
+				auto ext = (const char*)glGetStringi(GL_EXTENSIONS, GLuint(i));
+				if (ext != nullptr && strcmp(ext, name) == 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+
 	void GLMMDShader::Initialize()
 	{
 		// attribute
 		m_inPos = glGetAttribLocation(m_prog, "in_Pos");
 		m_inNor = glGetAttribLocation(m_prog, "in_Nor");
 		m_inUV = glGetAttribLocation(m_prog, "in_UV");
+		m_inDrawID = glGetAttribLocation(m_prog, "in_DrawID");
 
 		// uniform
-		m_uWV = glGetUniformLocation(m_prog, "u_WV");
-		m_uWVP = glGetUniformLocation(m_prog, "u_WVP");
-
-		m_uAmbinet = glGetUniformLocation(m_prog, "u_Ambient");
-		m_uDiffuse = glGetUniformLocation(m_prog, "u_Diffuse");
-		m_uSpecular = glGetUniformLocation(m_prog, "u_Specular");
-		m_uSpecularPower = glGetUniformLocation(m_prog, "u_SpecularPower");
-		m_uAlpha = glGetUniformLocation(m_prog, "u_Alpha");
-
-		m_uTexMode = glGetUniformLocation(m_prog, "u_TexMode");
-		m_uTex = glGetUniformLocation(m_prog, "u_Tex");
-		m_uTexMulFactor = glGetUniformLocation(m_prog, "u_TexMulFactor");
-		m_uTexAddFactor = glGetUniformLocation(m_prog, "u_TexAddFactor");
-
-		m_uSphereTexMode = glGetUniformLocation(m_prog, "u_SphereTexMode");
-		m_uSphereTex = glGetUniformLocation(m_prog, "u_SphereTex");
-		m_uSphereTexMulFactor = glGetUniformLocation(m_prog, "u_SphereTexMulFactor");
-		m_uSphereTexAddFactor = glGetUniformLocation(m_prog, "u_SphereTexAddFactor");
-
-		m_uToonTexMode = glGetUniformLocation(m_prog, "u_ToonTexMode");
-		m_uToonTex = glGetUniformLocation(m_prog, "u_ToonTex");
-		m_uToonTexMulFactor = glGetUniformLocation(m_prog, "u_ToonTexMulFactor");
-		m_uToonTexAddFactor = glGetUniformLocation(m_prog, "u_ToonTexAddFactor");
-
-		m_uLightColor = glGetUniformLocation(m_prog, "u_LightColor");
-		m_uLightDir = glGetUniformLocation(m_prog, "u_LightDir");
-
-		m_uLightVP = glGetUniformLocation(m_prog, "u_LightWVP");
-		m_uShadowMapSplitPositions = glGetUniformLocation(m_prog, "u_ShadowMapSplitPositions");
-		m_uShadowMap0 = glGetUniformLocation(m_prog, "u_ShadowMap0");
-		m_uShadowMap1 = glGetUniformLocation(m_prog, "u_ShadowMap1");
-		m_uShadowMap2 = glGetUniformLocation(m_prog, "u_ShadowMap2");
-		m_uShadowMap3 = glGetUniformLocation(m_prog, "u_ShadowMap3");
-		m_uShadowMapEnabled = glGetUniformLocation(m_prog, "u_ShadowMapEnabled");
+		BindMMDUniformBlocks(m_prog);
+
+		glUseProgram(m_prog);
+		SetUniform(glGetUniformLocation(m_prog, "u_Tex"), GLMMDTextureUnit);
+		SetUniform(glGetUniformLocation(m_prog, "u_SphereTex"), GLMMDSphereTextureUnit);
+		SetUniform(glGetUniformLocation(m_prog, "u_ToonTex"), GLMMDToonTextureUnit);
+		SetUniform(glGetUniformLocation(m_prog, "u_ShadowMap0"), GLMMDShadowMapTextureUnit + 0);
+		SetUniform(glGetUniformLocation(m_prog, "u_ShadowMap1"), GLMMDShadowMapTextureUnit + 1);
+		SetUniform(glGetUniformLocation(m_prog, "u_ShadowMap2"), GLMMDShadowMapTextureUnit + 2);
+		SetUniform(glGetUniformLocation(m_prog, "u_ShadowMap3"), GLMMDShadowMapTextureUnit + 3);
+		glUseProgram(0);
 	}
 
 	void GLMMDEdgeShader::Initialize()
@@ -61,13 +81,10 @@ namespace saba
 		// attribute
 		m_inPos = glGetAttribLocation(m_prog, "in_Pos");
 		m_inNor = glGetAttribLocation(m_prog, "in_Nor");
+		m_inDrawID = glGetAttribLocation(m_prog, "in_DrawID");
 
 		// uniform
-		m_uWV = glGetUniformLocation(m_prog, "u_WV");
-		m_uWVP = glGetUniformLocation(m_prog, "u_WVP");
-		m_uScreenSize = glGetUniformLocation(m_prog, "u_ScreenSize");
-		m_uEdgeSize = glGetUniformLocation(m_prog, "u_EdgeSize");
-		m_uEdgeColor = glGetUniformLocation(m_prog, "u_EdgeColor");
+		BindMMDUniformBlocks(m_prog);
 	}
 
 	void GLMMDGroundShadowShader::Initialize()
@@ -76,12 +93,36 @@ namespace saba
 		m_inPos = glGetAttribLocation(m_prog, "in_Pos");
 
 		// uniform
-		m_uWVP = glGetUniformLocation(m_prog, "u_WVP");
-		m_uShadowColor = glGetUniformLocation(m_prog, "u_ShadowColor");
+		BindMMDUniformBlocks(m_prog);
+	}
+
+	void GLMMDSkinningShader::Initialize()
+	{
+		// attribute
+		m_inPos = glGetAttribLocation(m_prog, "in_Pos");
+		m_inNor = glGetAttribLocation(m_prog, "in_Nor");
+		m_inUV = glGetAttribLocation(m_prog, "in_UV");
+		m_inBoneIndex = glGetAttribLocation(m_prog, "in_BoneIndex");
+		m_inBoneWeight = glGetAttribLocation(m_prog, "in_BoneWeight");
+		m_inSdefC = glGetAttribLocation(m_prog, "in_SdefC");
+		m_inSdefR0 = glGetAttribLocation(m_prog, "in_SdefR0");
+		m_inSdefR1 = glGetAttribLocation(m_prog, "in_SdefR1");
+		m_inSkinningType = glGetAttribLocation(m_prog, "in_SkinningType");
+		m_inPositionMorph = glGetAttribLocation(m_prog, "in_PositionMorph");
+		m_inUVMorph = glGetAttribLocation(m_prog, "in_UVMorph");
+
+		// uniform
+		m_uBones = glGetUniformLocation(m_prog, "u_Bones");
+		m_uPositionMorphs = glGetUniformLocation(m_prog, "u_PositionMorphs");
+		m_uUVMorphs = glGetUniformLocation(m_prog, "u_UVMorphs");
+		m_uMorphWeights = glGetUniformLocation(m_prog, "u_MorphWeights");
 	}
 
 	GLMMDModelDrawContext::GLMMDModelDrawContext(ViewerContext * ctxt)
 		: m_viewerContext(ctxt)
+		, m_skinningShaderFailed(false)
+		, m_materialBlockStride(0)
+		, m_multiDrawIndirectSupport(-1)
 	{
 		SABA_ASSERT(ctxt != nullptr);
 	}
@@ -231,10 +272,116 @@ namespace saba
 		return m_groundShadowShaders[groundShadowShaderIndex].get();
 	}
 
+	GLMMDSkinningShader * GLMMDModelDrawContext::GetSkinningShader()
+	{
+		if (m_skinningShader != nullptr)
+		{
+			return m_skinningShader.get();
+		}
+		// 失敗した場合は作り直さない
+		if (m_viewerContext == nullptr || m_skinningShaderFailed)
+		{
+			return nullptr;
+		}
+
+		auto shader = std::make_unique<GLMMDSkinningShader>();
+		GLSLShaderUtil glslShaderUtil;
+		glslShaderUtil.SetShaderDir(m_viewerContext->GetShaderDir());
+		const char* varyings[] = { "xfb_Pos", "xfb_Nor", "xfb_UV" };
+		shader->m_prog = glslShaderUtil.CreateTransformFeedbackProgram("mmd_skinning", varyings, 3);
+		if (shader->m_prog == 0)
+		{
+			SABA_ERROR("Shader Create fail.");
+			m_skinningShaderFailed = true;
+			return nullptr;
+		}
+
+		shader->Initialize();
+		m_skinningShader = std::move(shader);
+		return m_skinningShader.get();
+	}
+
 	ViewerContext * GLMMDModelDrawContext::GetViewerContext() const
 	{
 		return m_viewerContext;
 	}
 
+	void GLMMDModelDrawContext::UpdateFrameBlock()
+	{
+		if (m_viewerContext == nullptr)
+		{
+			return;
+		}
+		if (m_frameUBO == 0)
+		{
+			if (!m_frameUBO.Create())
+			{
+				SABA_ERROR("Uniform Buffer Create fail.");
+				return;
+			}
+			glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(GLMMDFrameBlock), nullptr, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+
+		const auto ctxt = m_viewerContext;
+		GLMMDFrameBlock frame = {};
+		glm::mat3 viewMat = glm::mat3(ctxt->GetCamera()->GetViewMatrix());
+		frame.m_lightColor = ctxt->GetLight()->GetLightColor();
+		frame.m_lightDir = viewMat * ctxt->GetLight()->GetLightDirection();
+		frame.m_groundShadowColor = ctxt->GetMMDGroundShadowColor();
+		frame.m_screenSize = glm::vec2(ctxt->GetFrameBufferWidth(), ctxt->GetFrameBufferHeight());
+		frame.m_shadowMapEnabled = ctxt->IsShadowEnabled() ? 1 : 0;
+		frame.m_materialTexelStride = GLint(GetMaterialBlockStride() / sizeof(glm::vec4));
+
+		auto shadowMap = ctxt->GetShadowMap();
+		const float* splitPositions = shadowMap->GetSplitPositions();
+		size_t splitPositionCount = std::min(GLMMDShadowMapCount + 1, shadowMap->GetSplitPositionCount());
+		for (size_t i = 0; i < splitPositionCount; i++)
+		{
+			frame.m_shadowMapSplitPositions[i].x = splitPositions[i];
+		}
+
+		glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GLMMDFrameBlock), &frame);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	GLsizeiptr GLMMDModelDrawContext::GetMaterialBlockStride()
+	{
+		if (m_materialBlockStride == 0)
+		{
+			GLint alignment = 0;
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			// テクスチャバッファの texel (vec4) 単位でも読めるようにする
+			const GLsizeiptr step = std::max(GLsizeiptr(alignment), GLsizeiptr(1));
+			GLsizeiptr align = step;
+			while (align % GLsizeiptr(sizeof(glm::vec4)) != 0)
+			{
+				align += step;
+			}
+			const GLsizeiptr size = GLsizeiptr(sizeof(GLMMDMaterialBlock));
+			m_materialBlockStride = (size + align - 1) / align * align;
+		}
+		return m_materialBlockStride;
+	}
+
+	bool GLMMDModelDrawContext::IsMultiDrawIndirectSupported()
+	{
+		if (m_multiDrawIndirectSupport == -1)
+		{
+			bool supported = false;
+			if (glMultiDrawElementsIndirect != nullptr && glVertexAttribDivisor != nullptr)
+			{
+				supported = gl3wIsSupported(4, 3) ||
+					(gl3wIsSupported(4, 0) &&
+						IsGLExtensionSupported("GL_ARB_multi_draw_indirect") &&
+						IsGLExtensionSupported("GL_ARB_base_instance"));
+			}
+			m_multiDrawIndirectSupport = supported ? 1 : 0;
+		}
+		return m_multiDrawIndirectSupport == 1;
+	}
+
 }
 
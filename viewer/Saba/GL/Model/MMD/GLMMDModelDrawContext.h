@@ -12,10 +12,83 @@
 #include <memory>
 #include <vector>
 
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
 namespace saba
 {
 	class ViewerContext;
 
+	// mmd_uniform_block.glsl の NUM_SHADOWMAP
+	const size_t GLMMDShadowMapCount = 4;
+
+	// uniform block のバインディングポイント
+	const GLuint GLMMDFrameBlockBinding = 0;
+	const GLuint GLMMDModelBlockBinding = 1;
+	const GLuint GLMMDMaterialBlockBinding = 2;
+
+	// テクスチャユニット
+	const GLint GLMMDTextureUnit = 0;
+	const GLint GLMMDSphereTextureUnit = 1;
+	const GLint GLMMDToonTextureUnit = 2;
+	const GLint GLMMDShadowMapTextureUnit = 3;	// 3 - 6
+	const GLint GLMMDMaterialTextureUnit = 7;	// MMD_MULTI_DRAW のマテリアル (GLMMDMaterialBlock の配列)
+
+	/*
+	mmd_uniform_block.glsl の uniform block (std140) と同じ並び。
+	vec3 の後ろの 4 byte には次のメンバが入り、配列の要素は 16 byte 毎に並ぶ。
+	GLMMDMaterialBlock は MMD_MULTI_DRAW の場合にテクスチャバッファ (RGBA32F) として読むので、float のみにする。
+	*/
+
+	// すべてのモデルで共通 (GLMMDModelDrawContext::UpdateFrameBlock で 1 フレームに 1 回転送する)
+	struct GLMMDFrameBlock
+	{
+		glm::vec3	m_lightColor;
+		float		m_padding0;
+		glm::vec3	m_lightDir;			// ビュー空間
+		float		m_padding1;
+		glm::vec4	m_groundShadowColor;
+		glm::vec2	m_screenSize;
+		GLint		m_shadowMapEnabled;
+		GLint		m_materialTexelStride;	// GLMMDMaterialBlock の間隔 (texel)
+		glm::vec4	m_shadowMapSplitPositions[GLMMDShadowMapCount + 1];	// x のみ使う
+	};
+	static_assert(sizeof(GLMMDFrameBlock) == 144, "GLMMDFrameBlock must match std140 layout.");
+
+	struct GLMMDModelBlock
+	{
+		glm::mat4	m_wv;
+		glm::mat4	m_wvp;
+		glm::mat4	m_groundShadowWVP;
+		glm::mat4	m_lightWVP[GLMMDShadowMapCount];
+	};
+	static_assert(sizeof(GLMMDModelBlock) == 448, "GLMMDModelBlock must match std140 layout.");
+
+	struct GLMMDMaterialBlock
+	{
+		glm::vec3	m_diffuse;
+		float		m_alpha;
+		glm::vec3	m_ambient;
+		float		m_specularPower;
+		glm::vec3	m_specular;
+		float		m_texMode;
+		glm::vec4	m_texMulFactor;
+		glm::vec4	m_texAddFactor;
+		glm::vec4	m_sphereTexMulFactor;
+		glm::vec4	m_sphereTexAddFactor;
+		glm::vec4	m_toonTexMulFactor;
+		glm::vec4	m_toonTexAddFactor;
+		glm::vec4	m_edgeColor;
+		float		m_sphereTexMode;
+		float		m_toonTexMode;
+		float		m_shadowReceiver;
+		float		m_edgeSize;
+	};
+	static_assert(sizeof(GLMMDMaterialBlock) == 176, "GLMMDMaterialBlock must match std140 layout.");
+
+	// uniform は uniform block とサンプラーのみ (サンプラーのユニットは Initialize で設定する)
 	struct GLMMDShader
 	{
 		GLSLDefine			m_define;
@@ -25,42 +98,7 @@ namespace saba
 		GLint	m_inPos;
 		GLint	m_inNor;
 		GLint	m_inUV;
-
-		// uniform
-		GLint	m_uWV;
-		GLint	m_uWVP;
-
-		GLint	m_uAmbinet;
-		GLint	m_uDiffuse;
-		GLint	m_uSpecular;
-		GLint	m_uSpecularPower;
-		GLint	m_uAlpha;
-
-		GLint	m_uTexMode;
-		GLint	m_uTex;
-		GLint	m_uTexMulFactor;
-		GLint	m_uTexAddFactor;
-
-		GLint	m_uSphereTexMode;
-		GLint	m_uSphereTex;
-		GLint	m_uSphereTexMulFactor;
-		GLint	m_uSphereTexAddFactor;
-
-		GLint	m_uToonTexMode;
-		GLint	m_uToonTex;
-		GLint	m_uToonTexMulFactor;
-		GLint	m_uToonTexAddFactor;
-
-		GLint	m_uLightColor;
-		GLint	m_uLightDir;
-
-		GLint	m_uLightVP;
-		GLint	m_uShadowMapSplitPositions;
-		GLint	m_uShadowMap0;
-		GLint	m_uShadowMap1;
-		GLint	m_uShadowMap2;
-		GLint	m_uShadowMap3;
-		GLint	m_uShadowMapEnabled;
+		GLint	m_inDrawID;		// MMD_MULTI_DRAW のみ
 
 		void Initialize();
 	};
@@ -73,14 +111,7 @@ namespace saba
 		// attribute
 		GLint	m_inPos;
 		GLint	m_inNor;
-
-		// uniform
-		GLint	m_uWV;
-		GLint	m_uWVP;
-		GLint	m_uScreenSize;
-		GLint	m_uEdgeSize;
-
-		GLint	m_uEdgeColor;
+		GLint	m_inDrawID;		// MMD_MULTI_DRAW のみ
 
 		void Initialize();
 	};
@@ -93,9 +124,32 @@ namespace saba
 		// attribute
 		GLint	m_inPos;
 
+		void Initialize();
+	};
+
+	// GPU スキニング (Transform Feedback で位置、法線、UV を書き出す)
+	struct GLMMDSkinningShader
+	{
+		GLProgramObject	m_prog;
+
+		// attribute
+		GLint	m_inPos;
+		GLint	m_inNor;
+		GLint	m_inUV;
+		GLint	m_inBoneIndex;
+		GLint	m_inBoneWeight;
+		GLint	m_inSdefC;
+		GLint	m_inSdefR0;
+		GLint	m_inSdefR1;
+		GLint	m_inSkinningType;
+		GLint	m_inPositionMorph;
+		GLint	m_inUVMorph;
+
 		// uniform
-		GLint	m_uWVP;
-		GLint	m_uShadowColor;
+		GLint	m_uBones;
+		GLint	m_uPositionMorphs;
+		GLint	m_uUVMorphs;
+		GLint	m_uMorphWeights;
 
 		void Initialize();
 	};
@@ -117,8 +171,21 @@ namespace saba
 		int GetGroundShadowShaderIndex(const GLSLDefine& define);
 		GLMMDGroundShadowShader* GetGroundShadowShader(int groundShadowShaderIndex) const;
 
+		// 作成に失敗した場合は nullptr
+		GLMMDSkinningShader* GetSkinningShader();
+
 		ViewerContext* GetViewerContext() const;
 
+		// モデルを描画する前に、1 フレームに 1 回呼ぶ
+		void UpdateFrameBlock();
+		GLuint GetFrameBlockBuffer() const { return m_frameUBO; }
+
+		// マテリアルの配列での GLMMDMaterialBlock の間隔 (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT の倍数)
+		GLsizeiptr GetMaterialBlockStride();
+
+		// glMultiDrawElementsIndirect と描画毎の baseInstance が使えるか (GL 4.3 もしくは拡張)
+		bool IsMultiDrawIndirectSupported();
+
 	private:
 		using MMDShaderPtr = std::unique_ptr<GLMMDShader>;
 		using MMDEdgeShaderPtr = std::unique_ptr<GLMMDEdgeShader>;
@@ -127,6 +194,11 @@ namespace saba
 		std::vector<MMDShaderPtr>	m_shaders;
 		std::vector<MMDEdgeShaderPtr>	m_edgeShaders;
 		std::vector<MMDGroundShadowShaderPtr>	m_groundShadowShaders;
+		std::unique_ptr<GLMMDSkinningShader>	m_skinningShader;
+		bool									m_skinningShaderFailed;
+		GLBufferObject							m_frameUBO;
+		GLsizeiptr								m_materialBlockStride;
+		int										m_multiDrawIndirectSupport;	// -1: 未確認
 	};
 }
 
@@ -14,11 +14,82 @@
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace saba
 {
+	namespace
+	{
+		// 直前の描画と同じ状態は設定し直さない
+		class GLMMDDrawState
+		{
+		public:
+			void UseProgram(GLuint prog)
+			{
+				if (m_prog != prog)
+				{
+					glUseProgram(prog);
+					m_prog = prog;
+				}
+			}
+
+			void BindVertexArray(GLuint vao)
+			{
+				if (m_vao != vao)
+				{
+					glBindVertexArray(vao);
+					m_vao = vao;
+				}
+			}
+
+			void BindTexture(GLint unit, GLuint tex)
+			{
+				if (m_textures[unit] != tex)
+				{
+					glActiveTexture(GL_TEXTURE0 + unit);
+					glBindTexture(GL_TEXTURE_2D, tex);
+					m_textures[unit] = tex;
+				}
+			}
+
+			// GL_NONE の場合はカリングしない
+			void SetCullFace(GLenum cullFace)
+			{
+				if (m_cullFace == cullFace)
+				{
+					return;
+				}
+				if (cullFace == GL_NONE)
+				{
+					glDisable(GL_CULL_FACE);
+				}
+				else
+				{
+					glEnable(GL_CULL_FACE);
+					glCullFace(cullFace);
+				}
+				m_cullFace = cullFace;
+			}
+
+		private:
+			GLuint	m_prog = 0;
+			GLuint	m_vao = 0;
+			GLuint	m_textures[3] = { GLuint(-1), GLuint(-1), GLuint(-1) };
+			GLenum	m_cullFace = GLenum(-1);
+		};
+	}
+
 	GLMMDModelDrawer::GLMMDModelDrawer(GLMMDModelDrawContext * ctxt, std::shared_ptr<GLMMDModel> mmdModel)
 		: m_drawContext(ctxt)
 		, m_mmdModel(mmdModel)
+		, m_materialBlockStride(0)
+		, m_multiDraw(false)
+		, m_multiDrawShaderIndex(-1)
+		, m_multiDrawEdgeShaderIndex(-1)
+		, m_updateAnimTime(0)
+		, m_updateElapsed(0)
+		, m_updatePlayAnimation(false)
 		, m_clipElapsed(true)
 		, m_viewLocal(true)
 		, m_selectedNode(nullptr)
@@ -49,32 +120,12 @@ namespace saba
 				SABA_ERROR("MMD Material Shader not found.");
 				return false;
 			}
-			if (!matShader.m_mmdVao.Create())
+			matShader.m_mmdVao = CreateMMDVAO(matShader.m_mmdShaderIndex);
+			if (matShader.m_mmdVao == 0)
 			{
-				SABA_ERROR("Vertex Array Object Create fail.");
 				return false;
 			}
 
-			auto shader = m_drawContext->GetShader(matShader.m_mmdShaderIndex);
-
-			glBindVertexArray(matShader.m_mmdVao);
-
-			m_mmdModel->GetPositionBinder().Bind(shader->m_inPos, m_mmdModel->GetPositionVBO());
-			glEnableVertexAttribArray(shader->m_inPos);
-
-			m_mmdModel->GetNormalBinder().Bind(shader->m_inNor, m_mmdModel->GetNormalVBO());
-			glEnableVertexAttribArray(shader->m_inNor);
-
-			if (shader->m_inUV != -1)
-			{
-				m_mmdModel->GetUVBinder().Bind(shader->m_inUV, m_mmdModel->GetUVVBO());
-				glEnableVertexAttribArray(shader->m_inUV);
-			}
-
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
-
-			glBindVertexArray(0);
-
 			// MMD Edge Shaer
 			matShader.m_mmdEdgeShaderIndex = m_drawContext->GetEdgeShaderIndex(define);
 			if (matShader.m_mmdEdgeShaderIndex == -1)
@@ -82,80 +133,506 @@ namespace saba
 				SABA_ERROR("MMD Edge Material Shader not found.");
 				return false;
 			}
-			if (!matShader.m_mmdEdgeVao.Create())
+			matShader.m_mmdEdgeVao = CreateMMDEdgeVAO(matShader.m_mmdEdgeShaderIndex);
+			if (matShader.m_mmdEdgeVao == 0)
+			{
+				return false;
+			}
+
+			// Ground Shadow
+			matShader.m_mmdGroundShadowShaderIndex = m_drawContext->GetGroundShadowShaderIndex(define);
+			if (matShader.m_mmdGroundShadowShaderIndex == -1)
+			{
+				SABA_ERROR("MMD Ground Shadow Material Shader not found.");
+				return false;
+			}
+			matShader.m_mmdGroundShadowVao = CreateMMDGroundShadowVAO(matShader.m_mmdGroundShadowShaderIndex);
+			if (matShader.m_mmdGroundShadowVao == 0)
 			{
-				SABA_ERROR("Vertex Array Object Create fail.");
 				return false;
 			}
 
-			auto edgeShader = m_drawContext->GetEdgeShader(matShader.m_mmdEdgeShaderIndex);
+			// トゥーンテクスチャは端を繰り返さない
+			if (mat.m_toonTexture != 0)
+			{
+				glBindTexture(GL_TEXTURE_2D, mat.m_toonTexture);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glBindTexture(GL_TEXTURE_2D, 0);
+			}
+
+			// Add
+			m_materialShaders.emplace_back(std::move(matShader));
+
+			matIdx++;
+		}
 
-			glBindVertexArray(matShader.m_mmdEdgeVao);
+		// Shadow
+		if (!m_shadowVao.Create())
+		{
+			SABA_ERROR("Vertex Array Object Create fail.");
+			return false;
+		}
 
-			m_mmdModel->GetPositionBinder().Bind(edgeShader->m_inPos, m_mmdModel->GetPositionVBO());
-			glEnableVertexAttribArray(edgeShader->m_inPos);
+		glBindVertexArray(m_shadowVao);
+		auto shadowShader = m_drawContext->GetViewerContext()->GetShadowMap()->GetShader();
 
-			m_mmdModel->GetNormalBinder().Bind(edgeShader->m_inNor, m_mmdModel->GetNormalVBO());
-			glEnableVertexAttribArray(edgeShader->m_inNor);
+		m_mmdModel->GetPositionBinder().Bind(shadowShader->m_inPos, m_mmdModel->GetPositionVBO());
+		glEnableVertexAttribArray(shadowShader->m_inPos);
 
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
 
-			glBindVertexArray(0);
+		glBindVertexArray(0);
 
-			// Shadow
-			if (!matShader.m_shadowVao.Create())
+		// 深度のみなので、描画順は変えてもよい
+		const auto& subMeshes = m_mmdModel->GetSubMeshes();
+		const auto& materials = m_mmdModel->GetMaterials();
+		for (size_t subMeshIdx = 0; subMeshIdx < subMeshes.size(); subMeshIdx++)
+		{
+			if (materials[subMeshes[subMeshIdx].m_materialID].m_shadowCaster)
 			{
-				SABA_ERROR("Vertex Array Object Create fail.");
-				return false;
+				m_shadowSubMeshes.push_back(subMeshIdx);
 			}
+		}
+		std::stable_sort(
+			m_shadowSubMeshes.begin(),
+			m_shadowSubMeshes.end(),
+			[&subMeshes, &materials](size_t a, size_t b)
+			{
+				return !materials[subMeshes[a].m_materialID].m_bothFace
+					&& materials[subMeshes[b].m_materialID].m_bothFace;
+			}
+		);
 
-			glBindVertexArray(matShader.m_shadowVao);
-			auto shadowShader = m_drawContext->GetViewerContext()->GetShadowMap()->GetShader();
+		// Uniform Block
+		m_materialBlockStride = m_drawContext->GetMaterialBlockStride();
+		m_materialBlocks.resize(size_t(m_materialBlockStride) * std::max(materials.size(), size_t(1)));
 
-			m_mmdModel->GetPositionBinder().Bind(shadowShader->m_inPos, m_mmdModel->GetPositionVBO());
-			glEnableVertexAttribArray(shadowShader->m_inPos);
+		if (!m_modelUBO.Create() || !m_materialUBO.Create())
+		{
+			SABA_ERROR("Uniform Buffer Create fail.");
+			return false;
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, m_modelUBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(GLMMDModelBlock), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_materialUBO);
+		glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(m_materialBlocks.size()), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
+		return true;
+	}
 
-			glBindVertexArray(0);
+	GLuint GLMMDModelDrawer::CreateMMDVAO(int shaderIndex)
+	{
+		for (const auto& shaderVao : m_mmdVaos)
+		{
+			if (shaderVao.m_shaderIndex == shaderIndex)
+			{
+				return shaderVao.m_vao;
+			}
+		}
 
-			// Ground Shadow
-			matShader.m_mmdGroundShadowShaderIndex = m_drawContext->GetGroundShadowShaderIndex(define);
-			if (matShader.m_mmdGroundShadowShaderIndex == -1)
+		ShaderVAO shaderVao;
+		shaderVao.m_shaderIndex = shaderIndex;
+		if (!shaderVao.m_vao.Create())
+		{
+			SABA_ERROR("Vertex Array Object Create fail.");
+			return 0;
+		}
+
+		auto shader = m_drawContext->GetShader(shaderIndex);
+
+		glBindVertexArray(shaderVao.m_vao);
+
+		m_mmdModel->GetPositionBinder().Bind(shader->m_inPos, m_mmdModel->GetPositionVBO());
+		glEnableVertexAttribArray(shader->m_inPos);
+
+		m_mmdModel->GetNormalBinder().Bind(shader->m_inNor, m_mmdModel->GetNormalVBO());
+		glEnableVertexAttribArray(shader->m_inNor);
+
+		if (shader->m_inUV != -1)
+		{
+			m_mmdModel->GetUVBinder().Bind(shader->m_inUV, m_mmdModel->GetUVVBO());
+			glEnableVertexAttribArray(shader->m_inUV);
+		}
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
+
+		glBindVertexArray(0);
+
+		GLuint vao = shaderVao.m_vao;
+		m_mmdVaos.emplace_back(std::move(shaderVao));
+		return vao;
+	}
+
+	GLuint GLMMDModelDrawer::CreateMMDEdgeVAO(int shaderIndex)
+	{
+		for (const auto& shaderVao : m_mmdEdgeVaos)
+		{
+			if (shaderVao.m_shaderIndex == shaderIndex)
 			{
-				SABA_ERROR("MMD Ground Shadow Material Shader not found.");
-				return false;
+				return shaderVao.m_vao;
 			}
-			if (!matShader.m_mmdGroundShadowVao.Create())
+		}
+
+		ShaderVAO shaderVao;
+		shaderVao.m_shaderIndex = shaderIndex;
+		if (!shaderVao.m_vao.Create())
+		{
+			SABA_ERROR("Vertex Array Object Create fail.");
+			return 0;
+		}
+
+		auto edgeShader = m_drawContext->GetEdgeShader(shaderIndex);
+
+		glBindVertexArray(shaderVao.m_vao);
+
+		m_mmdModel->GetPositionBinder().Bind(edgeShader->m_inPos, m_mmdModel->GetPositionVBO());
+		glEnableVertexAttribArray(edgeShader->m_inPos);
+
+		m_mmdModel->GetNormalBinder().Bind(edgeShader->m_inNor, m_mmdModel->GetNormalVBO());
+		glEnableVertexAttribArray(edgeShader->m_inNor);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
+
+		glBindVertexArray(0);
+
+		GLuint vao = shaderVao.m_vao;
+		m_mmdEdgeVaos.emplace_back(std::move(shaderVao));
+		return vao;
+	}
+
+	GLuint GLMMDModelDrawer::CreateMMDGroundShadowVAO(int shaderIndex)
+	{
+		for (const auto& shaderVao : m_mmdGroundShadowVaos)
+		{
+			if (shaderVao.m_shaderIndex == shaderIndex)
 			{
-				SABA_ERROR("Vertex Array Object Create fail.");
-				return false;
+				return shaderVao.m_vao;
 			}
+		}
 
-			auto groundShadowShader = m_drawContext->GetGroundShadowShader(
-				matShader.m_mmdGroundShadowShaderIndex
-			);
+		ShaderVAO shaderVao;
+		shaderVao.m_shaderIndex = shaderIndex;
+		if (!shaderVao.m_vao.Create())
+		{
+			SABA_ERROR("Vertex Array Object Create fail.");
+			return 0;
+		}
 
-			glBindVertexArray(matShader.m_mmdGroundShadowVao);
+		auto groundShadowShader = m_drawContext->GetGroundShadowShader(shaderIndex);
 
-			m_mmdModel->GetPositionBinder().Bind(edgeShader->m_inPos, m_mmdModel->GetPositionVBO());
-			glEnableVertexAttribArray(groundShadowShader->m_inPos);
+		glBindVertexArray(shaderVao.m_vao);
 
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
+		m_mmdModel->GetPositionBinder().Bind(groundShadowShader->m_inPos, m_mmdModel->GetPositionVBO());
+		glEnableVertexAttribArray(groundShadowShader->m_inPos);
 
-			glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
 
-			// Add
-			m_materialShaders.emplace_back(std::move(matShader));
+		glBindVertexArray(0);
 
-			matIdx++;
+		GLuint vao = shaderVao.m_vao;
+		m_mmdGroundShadowVaos.emplace_back(std::move(shaderVao));
+		return vao;
+	}
+
+	bool GLMMDModelDrawer::CreateMultiDrawResources()
+	{
+		GLSLDefine define;
+		define.Define("MMD_MULTI_DRAW");
+
+		m_multiDrawShaderIndex = m_drawContext->GetShaderIndex(define);
+		m_multiDrawEdgeShaderIndex = m_drawContext->GetEdgeShaderIndex(define);
+		if (m_multiDrawShaderIndex == -1 || m_multiDrawEdgeShaderIndex == -1)
+		{
+			SABA_ERROR("MMD Multi Draw Shader not found.");
+			return false;
+		}
+		auto shader = m_drawContext->GetShader(m_multiDrawShaderIndex);
+		auto edgeShader = m_drawContext->GetEdgeShader(m_multiDrawEdgeShaderIndex);
+
+		// 描画 ID はインスタンス毎の頂点属性にして、コマンドの baseInstance で選ぶ
+		const size_t matCount = m_mmdModel->GetMaterials().size();
+		std::vector<GLint> drawIDs(std::max(matCount, size_t(1)));
+		for (size_t i = 0; i < drawIDs.size(); i++)
+		{
+			drawIDs[i] = GLint(i);
 		}
+		if (!m_drawIDVBO.Create())
+		{
+			SABA_ERROR("Vertex Buffer Create fail.");
+			return false;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_drawIDVBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * drawIDs.size(), drawIDs.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		auto BindDrawID = [this](GLint inDrawID)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_drawIDVBO);
+			glVertexAttribIPointer(inDrawID, 1, GL_INT, sizeof(GLint), nullptr);
+			glVertexAttribDivisor(inDrawID, 1);
+			glEnableVertexAttribArray(inDrawID);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		};
+
+		// MMD Shader
+		if (!m_multiDrawVao.Create())
+		{
+			SABA_ERROR("Vertex Array Object Create fail.");
+			return false;
+		}
+
+		glBindVertexArray(m_multiDrawVao);
+
+		m_mmdModel->GetPositionBinder().Bind(shader->m_inPos, m_mmdModel->GetPositionVBO());
+		glEnableVertexAttribArray(shader->m_inPos);
+
+		m_mmdModel->GetNormalBinder().Bind(shader->m_inNor, m_mmdModel->GetNormalVBO());
+		glEnableVertexAttribArray(shader->m_inNor);
+
+		if (shader->m_inUV != -1)
+		{
+			m_mmdModel->GetUVBinder().Bind(shader->m_inUV, m_mmdModel->GetUVVBO());
+			glEnableVertexAttribArray(shader->m_inUV);
+		}
+
+		BindDrawID(shader->m_inDrawID);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
+
+		glBindVertexArray(0);
+
+		// MMD Edge Shader
+		if (!m_multiDrawEdgeVao.Create())
+		{
+			SABA_ERROR("Vertex Array Object Create fail.");
+			return false;
+		}
+
+		glBindVertexArray(m_multiDrawEdgeVao);
+
+		m_mmdModel->GetPositionBinder().Bind(edgeShader->m_inPos, m_mmdModel->GetPositionVBO());
+		glEnableVertexAttribArray(edgeShader->m_inPos);
+
+		m_mmdModel->GetNormalBinder().Bind(edgeShader->m_inNor, m_mmdModel->GetNormalVBO());
+		glEnableVertexAttribArray(edgeShader->m_inNor);
+
+		BindDrawID(edgeShader->m_inDrawID);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
+
+		glBindVertexArray(0);
+
+		// マテリアル (uniform block と同じバッファをテクスチャバッファとして読む)
+		if (!m_materialTex.Create())
+		{
+			SABA_ERROR("Texture Create fail.");
+			return false;
+		}
+		glBindTexture(GL_TEXTURE_BUFFER, m_materialTex);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_materialUBO);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+		// シャドウマップ、通常、エッジ、地面影の順
+		// 頂点バッファの領域毎に並べ、同じ領域のコマンドは変わった場合だけ転送する
+		// (baseVertex は領域毎に決まるので、表示するマテリアルが変わらなければ転送しない)
+		const size_t subMeshCount = m_mmdModel->GetSubMeshes().size();
+		m_drawCommands.resize(m_shadowSubMeshes.size() + subMeshCount * 3);
+		m_uploadedDrawCommands.clear();
+		m_uploadedDrawCommands.resize(
+			std::max(m_drawCommands.size() * m_mmdModel->GetVertexRegionCount(), size_t(1)),
+			DrawCommand{ 0, 0, 0, 0, 0 }
+		);
+		if (!m_drawCommandBuffer.Create())
+		{
+			SABA_ERROR("Draw Indirect Buffer Create fail.");
+			return false;
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommandBuffer);
+		glBufferData(
+			GL_DRAW_INDIRECT_BUFFER,
+			sizeof(DrawCommand) * m_uploadedDrawCommands.size(),
+			m_uploadedDrawCommands.data(),
+			GL_DYNAMIC_DRAW
+		);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
 		return true;
 	}
 
+	bool GLMMDModelDrawer::EnableMultiDrawIndirect(bool enable)
+	{
+		if (!enable)
+		{
+			m_multiDraw = false;
+			return true;
+		}
+		if (m_multiDraw)
+		{
+			return true;
+		}
+		if (!m_drawContext->IsMultiDrawIndirectSupported())
+		{
+			return false;
+		}
+		if (m_drawCommandBuffer == 0 && !CreateMultiDrawResources())
+		{
+			return false;
+		}
+		m_multiDraw = true;
+		return true;
+	}
+
+	void GLMMDModelDrawer::AddDrawCommand(
+		std::vector<DrawBatch>* batches,
+		size_t firstCommand,
+		const MMDSubMesh& subMesh,
+		bool sameBatch
+	)
+	{
+		size_t commandIdx = firstCommand;
+		if (!batches->empty())
+		{
+			commandIdx = batches->back().m_firstCommand + batches->back().m_commandCount;
+		}
+
+		auto& command = m_drawCommands[commandIdx];
+		command.m_count = GLuint(subMesh.m_vertexCount);
+		command.m_instanceCount = 1;
+		command.m_firstIndex = GLuint(subMesh.m_beginIndex);
+		command.m_baseVertex = m_mmdModel->GetBaseVertex();
+		command.m_baseInstance = GLuint(subMesh.m_materialID);
+
+		if (batches->empty() || !sameBatch)
+		{
+			DrawBatch batch;
+			batch.m_firstCommand = commandIdx;
+			batch.m_commandCount = 0;
+			batch.m_materialID = subMesh.m_materialID;
+			batches->push_back(batch);
+		}
+		batches->back().m_commandCount++;
+	}
+
+	void GLMMDModelDrawer::UploadDrawCommands(size_t firstCommand, size_t commandCount)
+	{
+		if (commandCount == 0)
+		{
+			return;
+		}
+		// 前のフレームの描画が読んでいる間に書き換えると同期が発生するので、変わった場合だけ転送する
+		const size_t uploadFirst = GetDrawCommandRegionOffset() + firstCommand;
+		const size_t size = sizeof(DrawCommand) * commandCount;
+		if (memcmp(&m_uploadedDrawCommands[uploadFirst], &m_drawCommands[firstCommand], size) == 0)
+		{
+			return;
+		}
+		memcpy(&m_uploadedDrawCommands[uploadFirst], &m_drawCommands[firstCommand], size);
+		glBufferSubData(
+			GL_DRAW_INDIRECT_BUFFER,
+			GLintptr(sizeof(DrawCommand) * uploadFirst),
+			GLsizeiptr(size),
+			&m_drawCommands[firstCommand]
+		);
+	}
+
+	void GLMMDModelDrawer::UpdateShadowDrawCommands()
+	{
+		const auto& subMeshes = m_mmdModel->GetSubMeshes();
+		const auto& materials = m_mmdModel->GetMaterials();
+
+		m_shadowBatches.clear();
+		for (size_t subMeshIdx : m_shadowSubMeshes)
+		{
+			const auto& subMesh = subMeshes[subMeshIdx];
+			bool sameBatch = !m_shadowBatches.empty() &&
+				materials[m_shadowBatches.back().m_materialID].m_bothFace == materials[subMesh.m_materialID].m_bothFace;
+			AddDrawCommand(&m_shadowBatches, 0, subMesh, sameBatch);
+		}
+		UploadDrawCommands(0, m_shadowSubMeshes.size());
+	}
+
+	void GLMMDModelDrawer::UpdateDrawCommands()
+	{
+		const auto& subMeshes = m_mmdModel->GetSubMeshes();
+		const auto& materials = m_mmdModel->GetMaterials();
+		const size_t mainFirst = m_shadowSubMeshes.size();
+		const size_t edgeFirst = mainFirst + subMeshes.size();
+		const size_t groundShadowFirst = edgeFirst + subMeshes.size();
+
+		m_mainBatches.clear();
+		m_edgeBatches.clear();
+		m_groundShadowBatches.clear();
+		for (const auto& subMesh : subMeshes)
+		{
+			const auto& mmdMat = materials[subMesh.m_materialID];
+			if (mmdMat.m_alpha == 0.0f)
+			{
+				continue;
+			}
+
+			// テクスチャとカリングが同じ間は続けて描画する
+			bool sameBatch = false;
+			if (!m_mainBatches.empty())
+			{
+				const auto& prevMat = materials[m_mainBatches.back().m_materialID];
+				sameBatch =
+					GLuint(prevMat.m_texture) == GLuint(mmdMat.m_texture) &&
+					GLuint(prevMat.m_spTexture) == GLuint(mmdMat.m_spTexture) &&
+					GLuint(prevMat.m_toonTexture) == GLuint(mmdMat.m_toonTexture) &&
+					prevMat.m_bothFace == mmdMat.m_bothFace;
+			}
+			AddDrawCommand(&m_mainBatches, mainFirst, subMesh, sameBatch);
+
+			if (m_mmdModel->IsEnabledEdge() && mmdMat.m_edgeFlag)
+			{
+				AddDrawCommand(&m_edgeBatches, edgeFirst, subMesh, true);
+			}
+			if (m_mmdModel->IsEnableGroundShadow() && mmdMat.m_groundShadow)
+			{
+				AddDrawCommand(&m_groundShadowBatches, groundShadowFirst, subMesh, true);
+			}
+		}
+		UploadDrawCommands(mainFirst, subMeshes.size() * 3);
+	}
+
+	void GLMMDModelDrawer::MultiDraw(const DrawBatch& batch)
+	{
+		glMultiDrawElementsIndirect(
+			GL_TRIANGLES,
+			m_mmdModel->GetIndexType(),
+			(const GLvoid*)(sizeof(DrawCommand) * (GetDrawCommandRegionOffset() + batch.m_firstCommand)),
+			GLsizei(batch.m_commandCount),
+			0
+		);
+	}
+
 	void GLMMDModelDrawer::Destroy()
 	{
 		m_materialShaders.clear();
+		m_mmdVaos.clear();
+		m_mmdEdgeVaos.clear();
+		m_mmdGroundShadowVaos.clear();
+		m_shadowVao.Destroy();
+		m_shadowSubMeshes.clear();
+		m_modelUBO.Destroy();
+		m_materialUBO.Destroy();
+		m_materialBlocks.clear();
+		m_multiDraw = false;
+		m_multiDrawShaderIndex = -1;
+		m_multiDrawEdgeShaderIndex = -1;
+		m_multiDrawVao.Destroy();
+		m_multiDrawEdgeVao.Destroy();
+		m_drawIDVBO.Destroy();
+		m_materialTex.Destroy();
+		m_drawCommandBuffer.Destroy();
+		m_drawCommands.clear();
+		m_uploadedDrawCommands.clear();
+		m_shadowBatches.clear();
+		m_mainBatches.clear();
+		m_edgeBatches.clear();
+		m_groundShadowBatches.clear();
 		m_selectedNode = nullptr;
 	}
 
@@ -269,6 +746,25 @@ namespace saba
 			}
 			ImGui::TreePop();
 		}
+		if (ImGui::TreeNode("Skinning"))
+		{
+			bool gpuSkinning = m_mmdModel->IsEnabledGPUSkinning();
+			if (ImGui::Checkbox("GPU", &gpuSkinning))
+			{
+				if (gpuSkinning)
+				{
+					if (!m_mmdModel->EnableGPUSkinning(m_drawContext->GetSkinningShader()))
+					{
+						SABA_WARN("GPU Skinning Enable fail.");
+					}
+				}
+				else
+				{
+					m_mmdModel->DisableGPUSkinning();
+				}
+			}
+			ImGui::TreePop();
+		}
 		if (ImGui::TreeNode("Morph"))
 		{
 			auto model = m_mmdModel->GetMMDModel();
@@ -320,40 +816,49 @@ namespace saba
 
 		glUseProgram(shader->m_prog);
 		SetUniform(shader->m_uWVP, wvp);
+		glBindVertexArray(m_shadowVao);
 
-		for (const auto& subMesh : m_mmdModel->GetSubMeshes())
+		GLMMDDrawState drawState;
+		if (m_multiDraw)
 		{
-			int matID = subMesh.m_materialID;
-			const auto& matShader = m_materialShaders[matID];
-			const auto& mmdMat = m_mmdModel->GetMaterials()[matID];
-			if (!mmdMat.m_shadowCaster)
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommandBuffer);
+			// 分割したシャドウマップは 0 番から順に描画される
+			if (csmIdx == 0)
 			{
-				continue;
+				UpdateShadowDrawCommands();
 			}
-
-			glBindVertexArray(matShader.m_shadowVao);
-
-			if (mmdMat.m_bothFace)
+			for (const auto& batch : m_shadowBatches)
 			{
-				glDisable(GL_CULL_FACE);
-			}
-			else
-			{
-				glEnable(GL_CULL_FACE);
-				glCullFace(GL_BACK);
+				const auto& mmdMat = m_mmdModel->GetMaterials()[batch.m_materialID];
+				drawState.SetCullFace(mmdMat.m_bothFace ? GL_NONE : GL_BACK);
+				MultiDraw(batch);
 			}
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+			glBindVertexArray(0);
+			glUseProgram(0);
+			return;
+		}
+
+		const auto& subMeshes = m_mmdModel->GetSubMeshes();
+		for (size_t subMeshIdx : m_shadowSubMeshes)
+		{
+			const auto& subMesh = subMeshes[subMeshIdx];
+			const auto& mmdMat = m_mmdModel->GetMaterials()[subMesh.m_materialID];
+
+			drawState.SetCullFace(mmdMat.m_bothFace ? GL_NONE : GL_BACK);
 
 			size_t offset = subMesh.m_beginIndex * m_mmdModel->GetIndexTypeSize();
-			glDrawElements(
+			glDrawElementsBaseVertex(
 				GL_TRIANGLES,
 				subMesh.m_vertexCount,
 				m_mmdModel->GetIndexType(),
-				(GLvoid*)offset
+				(GLvoid*)offset,
+				m_mmdModel->GetBaseVertex()
 			);
-
-			glBindVertexArray(0);
 		}
 
+		glBindVertexArray(0);
 		glUseProgram(0);
 	}
 
@@ -371,51 +876,84 @@ namespace saba
 	}
 
 	void GLMMDModelDrawer::Update(ViewerContext * ctxt)
+	{
+		BeginAsyncUpdate(ctxt);
+		UpdateAsync();
+		// 単独で更新する場合、共有しているワールドは進めない
+		UpdateAsyncAfterPhysics();
+		EndAsyncUpdate(ctxt);
+	}
+
+	bool GLMMDModelDrawer::BeginAsyncUpdate(ViewerContext * ctxt)
 	{
 		m_mmdModel->ClearPerfInfo();
 
-		double animTime = ctxt->GetAnimationTime();
-		double elapsed = ctxt->GetElapsed();
-		if (ctxt->GetPlayMode() != ViewerContext::PlayMode::Stop)
+		// ワーカースレッドでは ViewerContext を参照しない
+		m_updateAnimTime = ctxt->GetAnimationTime();
+		m_updateElapsed = ctxt->GetElapsed();
+		m_updatePlayAnimation = ctxt->GetPlayMode() != ViewerContext::PlayMode::Stop;
+
+		m_mmdModel->BeginUpdate();
+		return true;
+	}
+
+	void GLMMDModelDrawer::UpdateAsync()
+	{
+		if (m_updatePlayAnimation)
 		{
-			m_mmdModel->UpdateAnimation(animTime, elapsed);
+			m_mmdModel->UpdateAnimation(m_updateAnimTime, m_updateElapsed);
 		}
 		else
 		{
-			m_mmdModel->UpdateAnimationIgnoreVMD(elapsed);
+			m_mmdModel->UpdateAnimationIgnoreVMD(m_updateElapsed);
 		}
 
-		m_mmdModel->Update();
+		if (m_mmdModel->IsWaitingSharedPhysics())
+		{
+			// 共有しているワールドを進めた後、UpdateAsyncAfterPhysics で続きを行う
+			return;
+		}
+		m_mmdModel->UpdateModel();
 	}
 
+	bool GLMMDModelDrawer::IsWaitingSharedPhysics() const
+	{
+		return m_mmdModel->IsWaitingSharedPhysics();
+	}
 
-	void GLMMDModelDrawer::Draw(ViewerContext * ctxt)
+	void GLMMDModelDrawer::UpdateAsyncAfterPhysics()
+	{
+		if (!m_mmdModel->IsWaitingSharedPhysics())
+		{
+			return;
+		}
+		m_mmdModel->EndSharedPhysicsAnimation();
+		m_mmdModel->UpdateModel();
+	}
+
+	void GLMMDModelDrawer::EndAsyncUpdate(ViewerContext * ctxt)
+	{
+		m_mmdModel->EndUpdate();
+	}
+
+
+	void GLMMDModelDrawer::UpdateUniformBlocks(ViewerContext * ctxt)
 	{
 		const auto& view = ctxt->GetCamera()->GetViewMatrix();
 		const auto& proj = ctxt->GetCamera()->GetProjectionMatrix();
-
 		const auto& world = GetTransform();
-		auto wv = view * world;
-		auto wvp = proj * view * world;
-		auto wvit = glm::mat3(view * world);
-		wvit = glm::inverse(wvit);
-		wvit = glm::transpose(wvit);
 
-		const static size_t MaxShadowMap = 4;
-		GLint shadowMapTexs[MaxShadowMap] = { 0 };
-		glm::mat4 shadowMapVPs[MaxShadowMap];
+		GLMMDModelBlock modelBlock;
+		modelBlock.m_wv = view * world;
+		modelBlock.m_wvp = proj * view * world;
+
 		auto shadowMap = ctxt->GetShadowMap();
-		size_t numShadowMap = glm::min(MaxShadowMap, shadowMap->GetShadowMapCount());
-		const float* shadowMapSplitPositions = shadowMap->GetSplitPositions();
-		size_t numShadowMapSplitPosition = glm::max(MaxShadowMap + 1, shadowMap->GetSplitPositionCount());
 		if (ctxt->IsShadowEnabled())
 		{
+			size_t numShadowMap = glm::min(GLMMDShadowMapCount, shadowMap->GetShadowMapCount());
 			for (size_t i = 0; i < numShadowMap; i++)
 			{
 				const auto& clipSpace = shadowMap->GetClipSpace(i);
-				GLint texIdx = GLint(i + 3);
-				glActiveTexture(GL_TEXTURE0 + texIdx);
-				glBindTexture(GL_TEXTURE_2D, clipSpace.m_shadomap);
 
 				glm::mat4 offset;
 				offset[0] = glm::vec4(0.5f, 0.0f, 0.0f, 0.0f);
@@ -424,268 +962,244 @@ namespace saba
 				offset[3] = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
 				glm::mat4 bias;
 				bias[3][2] = -shadowMap->GetBias();
-				shadowMapTexs[i] = texIdx;
-				shadowMapVPs[i] = bias * offset * clipSpace.m_projection * shadowMap->GetShadowViewMatrix() * world;
-			}
-		}
-		else
-		{
-			for (size_t i = 0; i < numShadowMap; i++)
-			{
-				const auto& clipSpace = shadowMap->GetClipSpace(i);
-				GLint texIdx = GLint(i + 3);
-				glActiveTexture(GL_TEXTURE0 + texIdx);
-				glBindTexture(GL_TEXTURE_2D, ctxt->GetDummyShadowDepthTexture());
-				shadowMapTexs[i] = texIdx;
+				modelBlock.m_lightWVP[i] = bias * offset * clipSpace.m_projection * shadowMap->GetShadowViewMatrix() * world;
 			}
 		}
 
-		for (const auto& subMesh : m_mmdModel->GetSubMeshes())
 		{
-			int matID = subMesh.m_materialID;
-			const auto& matShader = m_materialShaders[matID];
-			const auto& mmdMat = m_mmdModel->GetMaterials()[matID];
-			auto shader = m_drawContext->GetShader(matShader.m_mmdShaderIndex);
+			auto plane = glm::vec4(0, 1, 0, 0);
+			auto light = -ctxt->GetLight()->GetLightDirection();
+			auto shadow = glm::mat4(1);
 
-			if (mmdMat.m_alpha == 0.0f)
-			{
-				continue;
-			}
+			shadow[0][0] = plane.y * light.y + plane.z * light.z;
+			shadow[0][1] = -plane.x * light.y;
+			shadow[0][2] = -plane.x * light.z;
+			shadow[0][3] = 0;
 
-			glUseProgram(shader->m_prog);
-			glBindVertexArray(matShader.m_mmdVao);
+			shadow[1][0] = -plane.y * light.x;
+			shadow[1][1] = plane.x * light.x + plane.z * light.z;
+			shadow[1][2] = -plane.y * light.z;
+			shadow[1][3] = 0;
 
-			SetUniform(shader->m_uWV, wv);
-			SetUniform(shader->m_uWVP, wvp);
+			shadow[2][0] = -plane.z * light.x;
+			shadow[2][1] = -plane.z * light.y;
+			shadow[2][2] = plane.x * light.x + plane.y * light.y;
+			shadow[2][3] = 0;
+
+			shadow[3][0] = -plane.w * light.x;
+			shadow[3][1] = -plane.w * light.y;
+			shadow[3][2] = -plane.w * light.z;
+			shadow[3][3] = plane.x * light.x + plane.y * light.y + plane.z * light.z;
 
-			bool alphaBlend = true;
+			modelBlock.m_groundShadowWVP = proj * view * shadow * world;
+		}
 
-			SetUniform(shader->m_uAmbinet, mmdMat.m_ambient);
-			SetUniform(shader->m_uDiffuse, mmdMat.m_diffuse);
-			SetUniform(shader->m_uSpecular, mmdMat.m_specular);
-			SetUniform(shader->m_uSpecularPower, mmdMat.m_specularPower);
-			SetUniform(shader->m_uAlpha, mmdMat.m_alpha);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_modelUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GLMMDModelBlock), &modelBlock);
 
-			glActiveTexture(GL_TEXTURE0 + 0);
-			SetUniform(shader->m_uTex, (GLint)0);
+		// マテリアルモーフで毎フレーム変わるので、すべてのマテリアルをまとめて転送する
+		const auto& materials = m_mmdModel->GetMaterials();
+		for (size_t matIdx = 0; matIdx < materials.size(); matIdx++)
+		{
+			const auto& mmdMat = materials[matIdx];
+			GLMMDMaterialBlock matBlock = {};
+			matBlock.m_diffuse = mmdMat.m_diffuse;
+			matBlock.m_alpha = mmdMat.m_alpha;
+			matBlock.m_ambient = mmdMat.m_ambient;
+			matBlock.m_specularPower = mmdMat.m_specularPower;
+			matBlock.m_specular = mmdMat.m_specular;
 			if (mmdMat.m_texture != 0)
 			{
-				if (!mmdMat.m_textureHaveAlpha)
-				{
-					// Use Material Alpha
-					SetUniform(shader->m_uTexMode, (GLint)1);
-				}
-				else
-				{
-					// Use Material Alpha * Texture Alpha
-					SetUniform(shader->m_uTexMode, (GLint)2);
-				}
-				SetUniform(shader->m_uTexMulFactor, mmdMat.m_textureMulFactor);
-				SetUniform(shader->m_uTexAddFactor, mmdMat.m_textureAddFactor);
-				glBindTexture(GL_TEXTURE_2D, mmdMat.m_texture);
-			}
-			else
-			{
-				SetUniform(shader->m_uTexMode, (GLint)0);
-				glBindTexture(GL_TEXTURE_2D, ctxt->GetDummyColorTexture());
+				// 1: Use Material Alpha, 2: Use Material Alpha * Texture Alpha
+				matBlock.m_texMode = mmdMat.m_textureHaveAlpha ? 2.0f : 1.0f;
 			}
-
-			glActiveTexture(GL_TEXTURE0 + 1);
-			SetUniform(shader->m_uSphereTex, (GLint)1);
+			matBlock.m_texMulFactor = mmdMat.m_textureMulFactor;
+			matBlock.m_texAddFactor = mmdMat.m_textureAddFactor;
 			if (mmdMat.m_spTexture != 0)
 			{
 				if (mmdMat.m_spTextureMode == MMDMaterial::SphereTextureMode::Mul)
 				{
-					SetUniform(shader->m_uSphereTexMode, (GLint)1);
+					matBlock.m_sphereTexMode = 1.0f;
 				}
 				else if (mmdMat.m_spTextureMode == MMDMaterial::SphereTextureMode::Add)
 				{
-					SetUniform(shader->m_uSphereTexMode, (GLint)2);
+					matBlock.m_sphereTexMode = 2.0f;
 				}
-				SetUniform(shader->m_uSphereTexMulFactor, mmdMat.m_spTextureMulFactor);
-				SetUniform(shader->m_uSphereTexAddFactor, mmdMat.m_spTextureAddFactor);
-				glBindTexture(GL_TEXTURE_2D, mmdMat.m_spTexture);
-			}
-			else
-			{
-				SetUniform(shader->m_uSphereTexMode, (GLint)0);
-				glBindTexture(GL_TEXTURE_2D, ctxt->GetDummyColorTexture());
-			}
-
-			glActiveTexture(GL_TEXTURE0 + 2);
-			SetUniform(shader->m_uToonTex, 2);
-			if (mmdMat.m_toonTexture != 0)
-			{
-				SetUniform(shader->m_uToonTexMulFactor, mmdMat.m_toonTextureMulFactor);
-				SetUniform(shader->m_uToonTexAddFactor, mmdMat.m_toonTextureAddFactor);
-				SetUniform(shader->m_uToonTexMode, (GLint)1);
-				glBindTexture(GL_TEXTURE_2D, mmdMat.m_toonTexture);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			}
-			else
-			{
-				SetUniform(shader->m_uToonTexMode, (GLint)0);
-				glBindTexture(GL_TEXTURE_2D, ctxt->GetDummyColorTexture());
 			}
+			matBlock.m_sphereTexMulFactor = mmdMat.m_spTextureMulFactor;
+			matBlock.m_sphereTexAddFactor = mmdMat.m_spTextureAddFactor;
+			matBlock.m_toonTexMode = mmdMat.m_toonTexture != 0 ? 1.0f : 0.0f;
+			matBlock.m_toonTexMulFactor = mmdMat.m_toonTextureMulFactor;
+			matBlock.m_toonTexAddFactor = mmdMat.m_toonTextureAddFactor;
+			matBlock.m_edgeColor = mmdMat.m_edgeColor;
+			matBlock.m_edgeSize = mmdMat.m_edgeSize;
+			matBlock.m_shadowReceiver = mmdMat.m_shadowReceiver ? 1.0f : 0.0f;
+			memcpy(&m_materialBlocks[matIdx * size_t(m_materialBlockStride)], &matBlock, sizeof(matBlock));
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, m_materialUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, GLsizeiptr(m_materialBlocks.size()), m_materialBlocks.data());
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
 
-			glm::vec3 lightColor = ctxt->GetLight()->GetLightColor();
-			glm::vec3 lightDir = ctxt->GetLight()->GetLightDirection();
-			glm::mat3 viewMat = glm::mat3(ctxt->GetCamera()->GetViewMatrix());
-			lightDir = viewMat * lightDir;
-			SetUniform(shader->m_uLightDir, lightDir);
-			SetUniform(shader->m_uLightColor, lightColor);
+	void GLMMDModelDrawer::Draw(ViewerContext * ctxt)
+	{
+		UpdateUniformBlocks(ctxt);
 
-			if (mmdMat.m_bothFace)
-			{
-				glDisable(GL_CULL_FACE);
-			}
-			else
-			{
-				glEnable(GL_CULL_FACE);
-				glCullFace(GL_BACK);
-			}
+		glBindBufferBase(GL_UNIFORM_BUFFER, GLMMDFrameBlockBinding, m_drawContext->GetFrameBlockBuffer());
+		glBindBufferBase(GL_UNIFORM_BUFFER, GLMMDModelBlockBinding, m_modelUBO);
 
-			if (alphaBlend)
-			{
-				glEnable(GL_BLEND);
-				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-			}
-			else
-			{
-				glDisable(GL_BLEND);
-			}
-
-			if (ctxt->IsShadowEnabled() && mmdMat.m_shadowReceiver)
+		auto shadowMap = ctxt->GetShadowMap();
+		size_t numShadowMap = glm::min(GLMMDShadowMapCount, shadowMap->GetShadowMapCount());
+		for (size_t i = 0; i < numShadowMap; i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + GLMMDShadowMapTextureUnit + GLint(i));
+			if (ctxt->IsShadowEnabled())
 			{
-				SetUniform(shader->m_uShadowMapEnabled, 1);
-				SetUniform(shader->m_uShadowMap0, shadowMapTexs[0]);
-				SetUniform(shader->m_uShadowMap1, shadowMapTexs[1]);
-				SetUniform(shader->m_uShadowMap2, shadowMapTexs[2]);
-				SetUniform(shader->m_uShadowMap3, shadowMapTexs[3]);
-				SetUniform(shader->m_uShadowMapSplitPositions, shadowMapSplitPositions, static_cast<GLsizei>(numShadowMapSplitPosition));
-				SetUniform(shader->m_uLightVP, shadowMapVPs, static_cast<GLsizei>(numShadowMap));
+				glBindTexture(GL_TEXTURE_2D, shadowMap->GetClipSpace(i).m_shadomap);
 			}
 			else
 			{
-				SetUniform(shader->m_uShadowMapEnabled, 0);
-				SetUniform(shader->m_uShadowMap0, shadowMapTexs[0]);
-				SetUniform(shader->m_uShadowMap1, shadowMapTexs[1]);
-				SetUniform(shader->m_uShadowMap2, shadowMapTexs[2]);
-				SetUniform(shader->m_uShadowMap3, shadowMapTexs[3]);
+				glBindTexture(GL_TEXTURE_2D, ctxt->GetDummyShadowDepthTexture());
 			}
+		}
 
-			size_t offset = subMesh.m_beginIndex * m_mmdModel->GetIndexTypeSize();
-			glDrawElements(
-				GL_TRIANGLES,
-				subMesh.m_vertexCount,
-				m_mmdModel->GetIndexType(),
-				(GLvoid*)offset
+		const auto& materials = m_mmdModel->GetMaterials();
+		auto BindMaterialBlock = [this](int matID)
+		{
+			glBindBufferRange(
+				GL_UNIFORM_BUFFER,
+				GLMMDMaterialBlockBinding,
+				m_materialUBO,
+				GLintptr(matID) * m_materialBlockStride,
+				sizeof(GLMMDMaterialBlock)
 			);
+		};
 
-			glActiveTexture(GL_TEXTURE0 + 2);
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glActiveTexture(GL_TEXTURE0 + 1);
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glActiveTexture(GL_TEXTURE0 + 0);
-			glBindTexture(GL_TEXTURE_2D, 0);
-
-			glBindVertexArray(0);
-			glUseProgram(0);
+		if (m_multiDraw)
+		{
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommandBuffer);
+			UpdateDrawCommands();
+			glActiveTexture(GL_TEXTURE0 + GLMMDMaterialTextureUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, m_materialTex);
 		}
 
-		for (size_t i = 0; i < MaxShadowMap; i++)
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		// 半透明の重なりがあるので、描画はマテリアルの順番のまま行う
+		GLMMDDrawState drawState;
+		GLuint dummyTex = ctxt->GetDummyColorTexture();
+		if (m_multiDraw)
 		{
-			GLint texIdx = GLint(i + 3);
-			glActiveTexture(GL_TEXTURE0 + texIdx);
-			glBindTexture(GL_TEXTURE_2D, 0);
-		}
+			auto shader = m_drawContext->GetShader(m_multiDrawShaderIndex);
+			drawState.UseProgram(shader->m_prog);
+			drawState.BindVertexArray(m_multiDrawVao);
+			for (const auto& batch : m_mainBatches)
+			{
+				const auto& mmdMat = materials[batch.m_materialID];
 
-		if (m_mmdModel->IsEnabledEdge())
+				drawState.BindTexture(GLMMDTextureUnit, mmdMat.m_texture != 0 ? GLuint(mmdMat.m_texture) : dummyTex);
+				drawState.BindTexture(GLMMDSphereTextureUnit, mmdMat.m_spTexture != 0 ? GLuint(mmdMat.m_spTexture) : dummyTex);
+				drawState.BindTexture(GLMMDToonTextureUnit, mmdMat.m_toonTexture != 0 ? GLuint(mmdMat.m_toonTexture) : dummyTex);
+
+				drawState.SetCullFace(mmdMat.m_bothFace ? GL_NONE : GL_BACK);
+
+				MultiDraw(batch);
+			}
+		}
+		else
 		{
-			glm::vec2 screenSize(ctxt->GetFrameBufferWidth(), ctxt->GetFrameBufferHeight());
 			for (const auto& subMesh : m_mmdModel->GetSubMeshes())
 			{
 				int matID = subMesh.m_materialID;
 				const auto& matShader = m_materialShaders[matID];
-				const auto& mmdMat = m_mmdModel->GetMaterials()[matID];
-				auto shader = m_drawContext->GetEdgeShader(matShader.m_mmdEdgeShaderIndex);
+				const auto& mmdMat = materials[matID];
+				auto shader = m_drawContext->GetShader(matShader.m_mmdShaderIndex);
 
-				if (!mmdMat.m_edgeFlag)
-				{
-					continue;
-				}
 				if (mmdMat.m_alpha == 0.0f)
 				{
 					continue;
 				}
 
-				glUseProgram(shader->m_prog);
-				glBindVertexArray(matShader.m_mmdEdgeVao);
-
-				SetUniform(shader->m_uWV, wv);
-				SetUniform(shader->m_uWVP, wvp);
-				SetUniform(shader->m_uScreenSize, screenSize);
-				SetUniform(shader->m_uEdgeSize, mmdMat.m_edgeSize);
-				SetUniform(shader->m_uEdgeColor, mmdMat.m_edgeColor);
+				drawState.UseProgram(shader->m_prog);
+				drawState.BindVertexArray(matShader.m_mmdVao);
+				BindMaterialBlock(matID);
 
-				bool alphaBlend = true;
+				drawState.BindTexture(GLMMDTextureUnit, mmdMat.m_texture != 0 ? GLuint(mmdMat.m_texture) : dummyTex);
+				drawState.BindTexture(GLMMDSphereTextureUnit, mmdMat.m_spTexture != 0 ? GLuint(mmdMat.m_spTexture) : dummyTex);
+				drawState.BindTexture(GLMMDToonTextureUnit, mmdMat.m_toonTexture != 0 ? GLuint(mmdMat.m_toonTexture) : dummyTex);
 
-				glEnable(GL_CULL_FACE);
-				glCullFace(GL_FRONT);
-
-				if (alphaBlend)
-				{
-					glEnable(GL_BLEND);
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-				}
-				else
-				{
-					glDisable(GL_BLEND);
-				}
+				drawState.SetCullFace(mmdMat.m_bothFace ? GL_NONE : GL_BACK);
 
 				size_t offset = subMesh.m_beginIndex * m_mmdModel->GetIndexTypeSize();
-				glDrawElements(
+				glDrawElementsBaseVertex(
 					GL_TRIANGLES,
 					subMesh.m_vertexCount,
 					m_mmdModel->GetIndexType(),
-					(GLvoid*)offset
+					(GLvoid*)offset,
+					m_mmdModel->GetBaseVertex()
 				);
-
-				glBindVertexArray(0);
-				glUseProgram(0);
 			}
 		}
 
-		if (m_mmdModel->IsEnableGroundShadow())
+		for (GLint unit = 0; unit < GLMMDShadowMapTextureUnit + GLint(GLMMDShadowMapCount); unit++)
 		{
-			glEnable(GL_POLYGON_OFFSET_FILL);
-			glPolygonOffset(-1, -1);
-			auto plane = glm::vec4(0, 1, 0, 0);
-			auto light = -ctxt->GetLight()->GetLightDirection();
-			auto shadow = glm::mat4(1);
-
-			shadow[0][0] = plane.y * light.y + plane.z * light.z;
-			shadow[0][1] = -plane.x * light.y;
-			shadow[0][2] = -plane.x * light.z;
-			shadow[0][3] = 0;
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		glActiveTexture(GL_TEXTURE0);
 
-			shadow[1][0] = -plane.y * light.x;
-			shadow[1][1] = plane.x * light.x + plane.z * light.z;
-			shadow[1][2] = -plane.y * light.z;
-			shadow[1][3] = 0;
+		if (m_mmdModel->IsEnabledEdge())
+		{
+			drawState.SetCullFace(GL_FRONT);
+			if (m_multiDraw)
+			{
+				auto shader = m_drawContext->GetEdgeShader(m_multiDrawEdgeShaderIndex);
+				drawState.UseProgram(shader->m_prog);
+				drawState.BindVertexArray(m_multiDrawEdgeVao);
+				for (const auto& batch : m_edgeBatches)
+				{
+					MultiDraw(batch);
+				}
+			}
+			else
+			{
+				for (const auto& subMesh : m_mmdModel->GetSubMeshes())
+				{
+					int matID = subMesh.m_materialID;
+					const auto& matShader = m_materialShaders[matID];
+					const auto& mmdMat = materials[matID];
+					auto shader = m_drawContext->GetEdgeShader(matShader.m_mmdEdgeShaderIndex);
 
-			shadow[2][0] = -plane.z * light.x;
-			shadow[2][1] = -plane.z * light.y;
-			shadow[2][2] = plane.x * light.x + plane.y * light.y;
-			shadow[2][3] = 0;
+					if (!mmdMat.m_edgeFlag)
+					{
+						continue;
+					}
+					if (mmdMat.m_alpha == 0.0f)
+					{
+						continue;
+					}
 
-			shadow[3][0] = -plane.w * light.x;
-			shadow[3][1] = -plane.w * light.y;
-			shadow[3][2] = -plane.w * light.z;
-			shadow[3][3] = plane.x * light.x + plane.y * light.y + plane.z * light.z;
+					drawState.UseProgram(shader->m_prog);
+					drawState.BindVertexArray(matShader.m_mmdEdgeVao);
+					BindMaterialBlock(matID);
+
+					size_t offset = subMesh.m_beginIndex * m_mmdModel->GetIndexTypeSize();
+					glDrawElementsBaseVertex(
+						GL_TRIANGLES,
+						subMesh.m_vertexCount,
+						m_mmdModel->GetIndexType(),
+						(GLvoid*)offset,
+						m_mmdModel->GetBaseVertex()
+					);
+				}
+			}
+		}
 
-			auto wsvp = proj * view * shadow * world;
+		if (m_mmdModel->IsEnableGroundShadow())
+		{
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(-1, -1);
 
 			auto shadowColor = ctxt->GetMMDGroundShadowColor();
 			if (shadowColor.a < 1.0f)
@@ -701,40 +1215,50 @@ namespace saba
 			{
 				glDisable(GL_BLEND);
 			}
-			glDisable(GL_CULL_FACE);
+			drawState.SetCullFace(GL_NONE);
 
-			for (const auto& subMesh : m_mmdModel->GetSubMeshes())
+			if (m_multiDraw)
 			{
-				int matID = subMesh.m_materialID;
-				const auto& matShader = m_materialShaders[matID];
-				const auto& mmdMat = m_mmdModel->GetMaterials()[matID];
-				if (!mmdMat.m_groundShadow)
+				for (const auto& batch : m_groundShadowBatches)
 				{
-					continue;
+					// 地面影はマテリアル毎の値を使わないので、シェーダーは共通
+					const auto& matShader = m_materialShaders[batch.m_materialID];
+					auto shader = m_drawContext->GetGroundShadowShader(matShader.m_mmdGroundShadowShaderIndex);
+					drawState.UseProgram(shader->m_prog);
+					drawState.BindVertexArray(matShader.m_mmdGroundShadowVao);
+					MultiDraw(batch);
 				}
-				if (mmdMat.m_alpha == 0.0f)
+			}
+			else
+			{
+				for (const auto& subMesh : m_mmdModel->GetSubMeshes())
 				{
-					continue;
-				}
-
-				auto shader = m_drawContext->GetGroundShadowShader(matShader.m_mmdGroundShadowShaderIndex);
-
-				glUseProgram(shader->m_prog);
-				glBindVertexArray(matShader.m_mmdGroundShadowVao);
+					int matID = subMesh.m_materialID;
+					const auto& matShader = m_materialShaders[matID];
+					const auto& mmdMat = materials[matID];
+					if (!mmdMat.m_groundShadow)
+					{
+						continue;
+					}
+					if (mmdMat.m_alpha == 0.0f)
+					{
+						continue;
+					}
 
-				SetUniform(shader->m_uWVP, wsvp);
-				SetUniform(shader->m_uShadowColor, shadowColor);
+					auto shader = m_drawContext->GetGroundShadowShader(matShader.m_mmdGroundShadowShaderIndex);
 
-				size_t offset = subMesh.m_beginIndex * m_mmdModel->GetIndexTypeSize();
-				glDrawElements(
-					GL_TRIANGLES,
-					subMesh.m_vertexCount,
-					m_mmdModel->GetIndexType(),
-					(GLvoid*)offset
-				);
+					drawState.UseProgram(shader->m_prog);
+					drawState.BindVertexArray(matShader.m_mmdGroundShadowVao);
 
-				glBindVertexArray(0);
-				glUseProgram(0);
+					size_t offset = subMesh.m_beginIndex * m_mmdModel->GetIndexTypeSize();
+					glDrawElementsBaseVertex(
+						GL_TRIANGLES,
+						subMesh.m_vertexCount,
+						m_mmdModel->GetIndexType(),
+						(GLvoid*)offset,
+						m_mmdModel->GetBaseVertex()
+					);
+				}
 			}
 
 			glDisable(GL_POLYGON_OFFSET_FILL);
@@ -742,6 +1266,14 @@ namespace saba
 			glDisable(GL_BLEND);
 		}
 
+		if (m_multiDraw)
+		{
+			glActiveTexture(GL_TEXTURE0 + GLMMDMaterialTextureUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			glActiveTexture(GL_TEXTURE0);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+
 		glBindVertexArray(0);
 		glUseProgram(0);
 
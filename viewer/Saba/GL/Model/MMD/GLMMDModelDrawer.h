@@ -36,33 +36,124 @@ namespace saba
 
 		void ResetAnimation(ViewerContext* ctxt) override;
 		void Update(ViewerContext* ctxt) override;
+		bool BeginAsyncUpdate(ViewerContext* ctxt) override;
+		void UpdateAsync() override;
+		bool IsWaitingSharedPhysics() const override;
+		void UpdateAsyncAfterPhysics() override;
+		void EndAsyncUpdate(ViewerContext* ctxt) override;
 		void DrawUI(ViewerContext* ctxt) override;
 		void DrawShadowMap(ViewerContext* ctxt, size_t csmIdx) override;
 		void Draw(ViewerContext* ctxt) override;
 
 		GLMMDModel* GetModel() { return m_mmdModel.get(); }
 
+		// サブメッシュを glMultiDrawElementsIndirect でまとめて描画する
+		// GLMMDModelDrawContext::IsMultiDrawIndirectSupported() が false の場合は失敗する
+		bool EnableMultiDrawIndirect(bool enable);
+		bool IsEnabledMultiDrawIndirect() const { return m_multiDraw; }
+
 	private:
+		// VAO は同じシェーダーを使うマテリアルで共有する
+		struct ShaderVAO
+		{
+			int					m_shaderIndex = -1;
+			GLVertexArrayObject	m_vao;
+		};
+
 		struct MaterialShader
 		{
-			int					m_mmdMaterialIndex = -1;
-			int					m_mmdShaderIndex = -1;
-			GLVertexArrayObject	m_mmdVao;
+			int		m_mmdMaterialIndex = -1;
+			int		m_mmdShaderIndex = -1;
+			GLuint	m_mmdVao = 0;
+
+			int		m_mmdEdgeShaderIndex = -1;
+			GLuint	m_mmdEdgeVao = 0;
 
-			int					m_mmdEdgeShaderIndex = -1;
-			GLVertexArrayObject	m_mmdEdgeVao;
+			int		m_mmdGroundShadowShaderIndex = -1;
+			GLuint	m_mmdGroundShadowVao = 0;
+		};
 
-			GLVertexArrayObject	m_shadowVao;
+		// glMultiDrawElementsIndirect のコマンド (DrawElementsIndirectCommand)
+		struct DrawCommand
+		{
+			GLuint	m_count;
+			GLuint	m_instanceCount;
+			GLuint	m_firstIndex;
+			GLint	m_baseVertex;
+			GLuint	m_baseInstance;	// 描画 ID (マテリアルのインデックス)
+		};
 
-			int					m_mmdGroundShadowShaderIndex = -1;
-			GLVertexArrayObject	m_mmdGroundShadowVao;
+		// 同じ状態で続けて描画できるコマンドの範囲 (状態は先頭のマテリアルのもの)
+		struct DrawBatch
+		{
+			size_t	m_firstCommand;
+			size_t	m_commandCount;
+			int		m_materialID;
 		};
 
+		GLuint CreateMMDVAO(int shaderIndex);
+		GLuint CreateMMDEdgeVAO(int shaderIndex);
+		GLuint CreateMMDGroundShadowVAO(int shaderIndex);
+		bool CreateMultiDrawResources();
+		// モデル毎、マテリアル毎の uniform block を転送する
+		void UpdateUniformBlocks(ViewerContext* ctxt);
+
+		// m_drawCommands の firstCommand から始まる範囲に追加する
+		// sameBatch が false の場合は新しいバッチにする
+		void AddDrawCommand(
+			std::vector<DrawBatch>* batches,
+			size_t firstCommand,
+			const MMDSubMesh& subMesh,
+			bool sameBatch
+		);
+		// GL_DRAW_INDIRECT_BUFFER に m_drawCommandBuffer をバインドして呼ぶ
+		void UploadDrawCommands(size_t firstCommand, size_t commandCount);
+		// m_drawCommandBuffer の中で、今の頂点バッファの領域のコマンドが始まる位置
+		size_t GetDrawCommandRegionOffset() const { return m_mmdModel->GetVertexRegionIndex() * m_drawCommands.size(); }
+		void UpdateShadowDrawCommands();
+		void UpdateDrawCommands();
+		void MultiDraw(const DrawBatch& batch);
+
 	private:
 		GLMMDModelDrawContext*		m_drawContext;
 		std::shared_ptr<GLMMDModel>	m_mmdModel;
 
 		std::vector<MaterialShader>	m_materialShaders;
+		std::vector<ShaderVAO>		m_mmdVaos;
+		std::vector<ShaderVAO>		m_mmdEdgeVaos;
+		std::vector<ShaderVAO>		m_mmdGroundShadowVaos;
+		GLVertexArrayObject			m_shadowVao;
+
+		// シャドウマップに描画するサブメッシュ (カリングの切り替えが少なくなるように並べる)
+		std::vector<size_t>			m_shadowSubMeshes;
+
+		GLBufferObject				m_modelUBO;
+		GLBufferObject				m_materialUBO;
+		GLsizeiptr					m_materialBlockStride;	// GLMMDModelDrawContext::GetMaterialBlockStride
+		std::vector<uint8_t>		m_materialBlocks;
+
+		// Multi Draw Indirect
+		bool						m_multiDraw;
+		int							m_multiDrawShaderIndex;
+		int							m_multiDrawEdgeShaderIndex;
+		GLVertexArrayObject			m_multiDrawVao;
+		GLVertexArrayObject			m_multiDrawEdgeVao;
+		GLBufferObject				m_drawIDVBO;			// 0, 1, 2 ... (baseInstance で選ぶ)
+		GLTextureObject				m_materialTex;			// m_materialUBO をテクスチャバッファとして読む
+		GLBufferObject				m_drawCommandBuffer;
+		// シャドウマップ、通常、エッジ、地面影の順に並べる
+		std::vector<DrawCommand>	m_drawCommands;
+		// m_drawCommandBuffer に転送した内容 (頂点バッファの領域の数だけ m_drawCommands を並べる)
+		std::vector<DrawCommand>	m_uploadedDrawCommands;
+		std::vector<DrawBatch>		m_shadowBatches;
+		std::vector<DrawBatch>		m_mainBatches;
+		std::vector<DrawBatch>		m_edgeBatches;
+		std::vector<DrawBatch>		m_groundShadowBatches;
+
+		// BeginAsyncUpdate で ViewerContext から取り出した値
+		double		m_updateAnimTime;
+		double		m_updateElapsed;
+		bool		m_updatePlayAnimation;
 
 		// IMGui
 		bool		m_clipElapsed;
@@ -5,7 +5,9 @@
 
 #include "GLOBJModel.h"
 
-#include "../../GLTextureUtil.h"
+#include "../../GLTextureCache.h"
+
+#include <Saba/Base/Singleton.h>
 
 namespace saba
 {
@@ -25,6 +27,7 @@ namespace saba
 
 		m_materials.clear();
 		m_materials.reserve(materials.size());
+		auto texCache = Singleton<GLTextureCache>::Get();
 		for (const auto& objMat : materials)
 		{
 			Material mat;
@@ -38,23 +41,19 @@ namespace saba
 
 			if (!objMat.m_ambientTex.empty())
 			{
-				auto tex = CreateTextureFromFile(objMat.m_ambientTex);
-				mat.m_ambientTex = std::move(tex);
+				mat.m_ambientTex = texCache->GetTexture(objMat.m_ambientTex);
 			}
 			if (!objMat.m_diffuseTex.empty())
 			{
-				auto tex = CreateTextureFromFile(objMat.m_diffuseTex);
-				mat.m_diffuseTex = std::move(tex);
+				mat.m_diffuseTex = texCache->GetTexture(objMat.m_diffuseTex);
 			}
 			if (!objMat.m_specularTex.empty())
 			{
-				auto tex = CreateTextureFromFile(objMat.m_specularTex);
-				mat.m_specularTex = std::move(tex);
+				mat.m_specularTex = texCache->GetTexture(objMat.m_specularTex);
 			}
 			if (!objMat.m_transparencyTex.empty())
 			{
-				auto tex = CreateTextureFromFile(objMat.m_transparencyTex);
-				mat.m_transparencyTex = std::move(tex);
+				mat.m_transparencyTex = texCache->GetTexture(objMat.m_transparencyTex);
 			}
 
 			m_materials.push_back(mat);
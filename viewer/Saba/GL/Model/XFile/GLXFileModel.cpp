@@ -6,9 +6,10 @@
 #include "GLXFileModel.h"
 
 #include <Saba/Base/Path.h>
+#include <Saba/Base/Singleton.h>
 
 #include "../../../Viewer/ViewerContext.h"
-#include "../../GLTextureUtil.h"
+#include "../../GLTextureCache.h"
 
 namespace saba
 {
@@ -58,15 +59,13 @@ namespace saba
 					}
 					else
 					{
-						auto tex = CreateTextureFromFile(xmat.m_texture);
-						mat.m_texture = std::move(tex);
+						mat.m_texture = Singleton<GLTextureCache>::Get()->GetTexture(xmat.m_texture);
 					}
 				}
 				mat.m_spTextureMode = xmat.m_spTextureMode;
 				if (!xmat.m_spTexture.empty())
 				{
-					auto tex = CreateTextureFromFile(xmat.m_spTexture);
-					mat.m_spTexture = std::move(tex);
+					mat.m_spTexture = Singleton<GLTextureCache>::Get()->GetTexture(xmat.m_spTexture);
 				}
 				mesh->m_materials.emplace_back(std::move(mat));
 			}
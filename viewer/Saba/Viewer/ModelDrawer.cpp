@@ -15,6 +15,7 @@ namespace saba
 		, m_translate(0)
 		, m_rotate(0)
 		, m_scale(1)
+		, m_updateTime(0)
 	{
 		UpdateTransform();
 	}
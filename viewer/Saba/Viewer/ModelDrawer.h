@@ -34,6 +34,24 @@ namespace saba
 		virtual void ResetAnimation(ViewerContext* ctxt) = 0;
 		virtual void DrawUI(ViewerContext* ctxt) = 0;
 		virtual void Update(ViewerContext* ctxt) = 0;
+
+		/*
+		描画と並行して更新する場合の Update。
+		BeginAsyncUpdate が true を返したら、UpdateAsync をワーカースレッドで呼び、
+		その後 EndAsyncUpdate を呼ぶまでは前の更新結果で描画する。
+		UpdateAsync は他の Drawer の UpdateAsync と並列に呼ばれる。
+		false を返す Drawer は、描画スレッドで Update を呼ぶ。
+		*/
+		virtual bool BeginAsyncUpdate(ViewerContext* ctxt) { return false; }
+		virtual void UpdateAsync() {}
+		virtual void EndAsyncUpdate(ViewerContext* ctxt) {}
+		/*
+		物理演算のワールドを他の Drawer と共有している場合、UpdateAsync は物理演算の前で止まり、
+		IsWaitingSharedPhysics が true を返す。
+		ワールドを 1 回だけ進めた後、UpdateAsyncAfterPhysics で続きを行う。
+		*/
+		virtual bool IsWaitingSharedPhysics() const { return false; }
+		virtual void UpdateAsyncAfterPhysics() {}
 		virtual void DrawShadowMap(ViewerContext* ctxt, size_t csmIdx) = 0;
 		virtual void Draw(ViewerContext* ctxt) = 0;
 
@@ -58,6 +76,10 @@ namespace saba
 
 		const glm::mat4& GetTransform() const { return m_transform; }
 
+		// 最後の Update (UpdateAsync) にかかった時間 (秒)
+		void SetUpdateTime(double time) { m_updateTime = time; }
+		double GetUpdateTime() const { return m_updateTime; }
+
 	protected:
 		void UpdateTransform();
 
@@ -71,6 +93,8 @@ namespace saba
 		glm::vec3	m_scale;
 
 		glm::mat4	m_transform;
+
+		double		m_updateTime;
 	};
 }
 
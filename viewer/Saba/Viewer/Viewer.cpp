@@ -8,11 +8,13 @@
 #include "ShadowMap.h"
 
 #include <Saba/Base/Singleton.h>
+#include <Saba/Base/JobSystem.h>
 #include <Saba/Base/Log.h>
 #include <Saba/Base/Path.h>
 #include <Saba/Base/Time.h>
 #include <Saba/GL/GLSLUtil.h>
 #include <Saba/GL/GLShaderUtil.h>
+#include <Saba/GL/GLTextureCache.h>
 
 #include <Saba/Model/OBJ/OBJModel.h>
 #include <Saba/GL/Model/OBJ/GLOBJModel.h>
@@ -22,6 +24,7 @@
 #include <Saba/Model/MMD/VMDFile.h>
 #include <Saba/Model/MMD/VPDFile.h>
 #include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/MMDPhysics.h>
 #include <Saba/GL/Model/MMD/GLMMDModel.h>
 #include <Saba/GL/Model/MMD/GLMMDModelDrawer.h>
 #include <Saba/Model/MMD/SjisToUnicode.h>
@@ -44,6 +47,7 @@
 #include <iomanip>
 #include <string>
 #include <thread>
+#include <mutex>
 
 namespace saba
 {
@@ -56,8 +60,10 @@ namespace saba
 		{
 		}
 
+		// モデルの読み込み中はワーカースレッドからも呼ばれる
 		void log(const spdlog::details::log_msg& msg) override
 		{
+			std::lock_guard<std::mutex> lock(m_mutex);
 			while (m_buffer.size() >= m_maxBufferSize)
 			{
 				if (m_buffer.empty())
@@ -81,6 +87,7 @@ namespace saba
 			std::string					m_message;
 		};
 		const std::deque<LogMessage>& GetBuffer() const { return m_buffer; }
+		std::mutex& GetMutex() { return m_mutex; }
 
 		bool IsAdded() const { return m_added; }
 		void ClearAddedFlag() { m_added = false; }
@@ -89,6 +96,7 @@ namespace saba
 		size_t					m_maxBufferSize;
 		std::deque<LogMessage>	m_buffer;
 		bool					m_added;
+		std::mutex				m_mutex;
 	};
 
 	Viewer::InitializeParameter::InitializeParameter()
@@ -107,6 +115,23 @@ namespace saba
 
 	Viewer::MMDModelConfig::MMDModelConfig()
 		: m_parallelUpdateCount(0)
+		, m_useModelCache(false)
+		, m_useCompressedTexture(false)
+		, m_useGPUSkinning(false)
+		, m_useMultiDrawIndirect(false)
+		, m_useSharedPhysics(false)
+		, m_enablePhysicsLOD(false)
+		, m_physicsLODBudget(8)
+		, m_physicsMaxUpdateTime(0)
+	{
+	}
+
+	Viewer::MMDModelLoadTask::MMDModelLoadTask()
+		: m_state(State::LoadModel)
+		, m_loadSucceeded(false)
+		, m_bboxMin(0)
+		, m_bboxMax(0)
+		, m_decodedTextureCount(0)
 	{
 	}
 
@@ -124,6 +149,13 @@ namespace saba
 		, m_sceneUnitScale(1)
 		, m_prevTime(0)
 		, m_modelNameID(1)
+		, m_enablePipelinedUpdate(true)
+		, m_asyncUpdating(false)
+		, m_asyncUpdateAnimTime(0)
+		, m_asyncUpdateElapsed(0)
+		, m_drawAnimTime(0)
+		, m_perfUpdateTime(0)
+		, m_perfDrawTime(0)
 		, m_enableInfoUI(true)
 		, m_enableMoreInfoUI(false)
 		, m_enableLogUI(true)
@@ -272,6 +304,14 @@ namespace saba
 		m_mmdModelDrawContext = std::make_unique<GLMMDModelDrawContext>(&m_context);
 		m_xfileModelDrawContext = std::make_unique<GLXFileModelDrawContext>(&m_context);
 
+		// 描画を止めないように、読み込みは更新用とは別のスレッドで行う
+		size_t loadWorkerCount = std::max(size_t(std::thread::hardware_concurrency() / 2), size_t(1));
+		m_loadJobSystem = std::make_unique<JobSystem>(loadWorkerCount);
+
+		// モデルの更新を描画と並行して行うスレッド
+		// (頂点の更新は、このスレッドから Singleton<JobSystem> で並列に行う)
+		m_updateJobSystem = std::make_unique<JobSystem>(1);
+
 		RegisterCommand();
 		RefreshCustomCommand();
 
@@ -282,6 +322,12 @@ namespace saba
 
 	void Viewer::Uninitislize()
 	{
+		WaitAsyncUpdate();
+		m_updateJobSystem.reset();
+
+		WaitMMDModelLoadTasks();
+		m_loadJobSystem.reset();
+
 		auto logger = Singleton<saba::Logger>::Get();
 		logger->RemoveSink(m_imguiLogSink.get());
 		m_imguiLogSink.reset();
@@ -290,6 +336,8 @@ namespace saba
 		ImGui_ImplGlfw_Shutdown();
 		ImGui::DestroyContext();
 
+		Singleton<GLTextureCache>::Get()->Clear();
+
 		m_context.Uninitialize();
 	}
 
@@ -297,6 +345,9 @@ namespace saba
 	{
 		while (!glfwWindowShouldClose(m_window))
 		{
+			// 前のフレームで開始したモデルの更新を待ち、描画に反映する
+			WaitAsyncUpdate();
+
 			ImGui_ImplOpenGL3_NewFrame();
 			ImGui_ImplGlfw_NewFrame();
 			ImGui::NewFrame();
@@ -357,11 +408,13 @@ namespace saba
 
 			Update();
 
+			double drawStartTime = GetTime();
 			if (m_context.IsShadowEnabled())
 			{
 				DrawShadowMap();
 			}
 			Draw();
+			m_perfDrawTime = GetTime() - drawStartTime;
 
 			if (m_context.IsUIEnabled())
 			{
@@ -448,6 +501,8 @@ namespace saba
 
 	void Viewer::Update()
 	{
+		UpdateMMDModelLoadTasks();
+
 		if (m_context.IsUIEnabled())
 		{
 			DrawUI();
@@ -490,23 +545,23 @@ namespace saba
 			UpdateAnimation();
 		}
 
+		if (update)
+		{
+			UpdateModels();
+		}
+
 		if (m_cameraOverride && m_cameraOverrider)
 		{
+			// 描画するモデルと同じ時間のカメラを使う
+			double animTime = m_context.GetAnimationTime();
+			m_context.SetAnimationTime(m_drawAnimTime);
 			Camera overrideCam = *m_context.GetCamera();
 			m_cameraOverrider->Override(&m_context, &overrideCam);
 			m_context.SetCamera(overrideCam);
+			m_context.SetAnimationTime(animTime);
 		}
 		m_context.m_camera.UpdateMatrix();
 
-		if (update)
-		{
-			for (auto& modelDrawer : m_modelDrawers)
-			{
-				// Update
-				modelDrawer->Update(&m_context);
-			}
-		}
-
 		if (m_context.IsShadowEnabled())
 		{
 			m_context.m_shadowmap.CalcShadowMap(m_context.GetCamera(), m_context.GetLight());
@@ -569,6 +624,7 @@ namespace saba
 			m_grid.Draw();
 		}
 
+		m_mmdModelDrawContext->UpdateFrameBlock();
 		for (auto& modelDrawer : m_modelDrawers)
 		{
 			// Draw
@@ -906,6 +962,7 @@ namespace saba
 			DrawManip();
 		}
 		DrawCtrlUI();
+		DrawLoadProgressUI();
 
 		DrawLightGuide();
 	}
@@ -985,6 +1042,46 @@ namespace saba
 			ImGui::Text("FPS ave:%.2f min:%.2f max time:%.2f[ms]", aveFps, minFps, 1000.0f / minFps);
 		}
 
+		// Pipelined Update では、Update と Draw の時間は重なる
+		PushPerfLap(m_perfUpdateTimeLap, m_perfUpdateTime);
+		PushPerfLap(m_perfDrawTimeLap, m_perfDrawTime);
+		ImGui::Checkbox("Pipelined Update", &m_enablePipelinedUpdate);
+		ImGui::Text("Update ave:%.2f max:%.2f [ms]",
+			float(GetPerfLapAve(m_perfUpdateTimeLap) * 1000.0),
+			float(GetPerfLapMax(m_perfUpdateTimeLap) * 1000.0)
+		);
+		ImGui::Text("Draw   ave:%.2f max:%.2f [ms]",
+			float(GetPerfLapAve(m_perfDrawTimeLap) * 1000.0),
+			float(GetPerfLapMax(m_perfDrawTimeLap) * 1000.0)
+		);
+
+		if (m_enableMoreInfoUI && ImGui::TreeNode("Model Update"))
+		{
+			// モデル毎の更新時間 (並列に更新するので、合計は Update の時間より大きくなる)
+			for (const auto& modelDrawer : m_modelDrawers)
+			{
+				ImGui::Text("%s %.2f [ms]", modelDrawer->GetName().c_str(), float(modelDrawer->GetUpdateTime() * 1000.0));
+				if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+				{
+					auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+					const auto& perfInfo = mmdModelDrawer->GetModel()->GetPerfInfo();
+					auto physicsMan = mmdModelDrawer->GetModel()->GetMMDModel()->GetPhysicsManager();
+					const char* lodNames[] = { "Full", "Reduced", "Kinematic" };
+					ImGui::Text("  Setup:%.2f Morph:%.2f Node:%.2f Physics:%.2f (%s%s) Model:%.2f Buffer:%.2f",
+						float(perfInfo.m_setupAnimTime * 1000.0),
+						float(perfInfo.m_updateMorphAnimTime * 1000.0),
+						float(perfInfo.m_updateNodeAnimTime * 1000.0),
+						float(perfInfo.m_updatePhysicsAnimTime * 1000.0),
+						lodNames[int(physicsMan->GetLOD())],
+						physicsMan->IsSleeping() ? " Sleep" : "",
+						float(perfInfo.m_updateModelTime * 1000.0),
+						float(perfInfo.m_updateGLBufferTime * 1000.0)
+					);
+				}
+			}
+			ImGui::TreePop();
+		}
+
 		if (m_selectedModelDrawer != nullptr && m_selectedModelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
 		{
 			auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(m_selectedModelDrawer.get());
@@ -1068,6 +1165,7 @@ namespace saba
 		ImGui::Begin("Log", &m_enableLogUI);
 		ImGui::BeginChild("scrolling", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
 
+		std::lock_guard<std::mutex> lock(m_imguiLogSink->GetMutex());
 		for (const auto& log : m_imguiLogSink->GetBuffer())
 		{
 			ImVec4 col = ImColor(255, 255, 255, 255);
@@ -1674,6 +1772,210 @@ namespace saba
 		}
 	}
 
+	void Viewer::UpdateModels()
+	{
+		if (m_mmdModelConfig.m_enablePhysicsLOD)
+		{
+			UpdatePhysicsLOD();
+		}
+
+		// GL を使う準備はこのスレッドで行う
+		m_asyncUpdateDrawers.clear();
+		for (auto& modelDrawer : m_modelDrawers)
+		{
+			if (modelDrawer->BeginAsyncUpdate(&m_context))
+			{
+				m_asyncUpdateDrawers.push_back(modelDrawer);
+			}
+			else
+			{
+				double updateStartTime = GetTime();
+				modelDrawer->Update(&m_context);
+				modelDrawer->SetUpdateTime(GetTime() - updateStartTime);
+			}
+		}
+		// 前のフレームで時間がかかったモデルから順に処理して、スレッド毎の偏りを減らす
+		std::stable_sort(
+			m_asyncUpdateDrawers.begin(),
+			m_asyncUpdateDrawers.end(),
+			[](const ModelDrawerPtr& a, const ModelDrawerPtr& b) { return a->GetUpdateTime() > b->GetUpdateTime(); }
+		);
+		m_asyncUpdateAnimTime = m_context.GetAnimationTime();
+		m_asyncUpdateElapsed = m_context.GetElapsed();
+		m_asyncUpdating = true;
+
+		if (m_enablePipelinedUpdate)
+		{
+			m_updateJobSystem->Run(&m_updateJobGroup, [this]() { UpdateAsyncModels(); });
+		}
+		else
+		{
+			UpdateAsyncModels();
+			WaitAsyncUpdate();
+		}
+	}
+
+	void Viewer::UpdatePhysicsLOD()
+	{
+		// 画面上で大きいモデルから順に、m_physicsLODBudget 個ずつ Full と Reduced にする
+		const float FullScreenSize = 0.2f;
+		const float ReducedScreenSize = 0.05f;
+
+		struct ModelLOD
+		{
+			MMDModel*	m_mmdModel;
+			float		m_screenSize;
+		};
+		std::vector<ModelLOD> modelLODs;
+
+		const auto& view = m_context.GetCamera()->GetViewMatrix();
+		const auto& proj = m_context.GetCamera()->GetProjectionMatrix();
+		for (const auto& modelDrawer : m_modelDrawers)
+		{
+			if (modelDrawer->GetType() != ModelDrawerType::MMDModelDrawer)
+			{
+				continue;
+			}
+			auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+			auto mmdModel = mmdModelDrawer->GetModel()->GetMMDModel();
+
+			// バウンディングスフィアの半径の、画面の高さに対する割合
+			const auto& scale = modelDrawer->GetScale();
+			glm::vec3 bboxCenter = (modelDrawer->GetBBoxMin() + modelDrawer->GetBBoxMax()) * 0.5f;
+			float radius = glm::length(modelDrawer->GetBBoxMax() - modelDrawer->GetBBoxMin()) * 0.5f;
+			radius *= std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+			glm::vec4 viewCenter = view * modelDrawer->GetTransform() * glm::vec4(bboxCenter, 1.0f);
+			float dist = std::max(-viewCenter.z, 0.01f);
+			float screenSize = radius * proj[1][1] / dist * 0.5f;
+
+			modelLODs.push_back(ModelLOD{ mmdModel, screenSize });
+		}
+		std::stable_sort(
+			modelLODs.begin(),
+			modelLODs.end(),
+			[](const ModelLOD& a, const ModelLOD& b) { return a.m_screenSize > b.m_screenSize; }
+		);
+
+		const size_t budget = size_t(m_mmdModelConfig.m_physicsLODBudget);
+		for (size_t i = 0; i < modelLODs.size(); i++)
+		{
+			const auto& modelLOD = modelLODs[i];
+			MMDPhysicsLOD lod = MMDPhysicsLOD::Kinematic;
+			if (i < budget && modelLOD.m_screenSize >= FullScreenSize)
+			{
+				lod = MMDPhysicsLOD::Full;
+			}
+			else if (i < budget * 2 && modelLOD.m_screenSize >= ReducedScreenSize)
+			{
+				lod = MMDPhysicsLOD::Reduced;
+			}
+			modelLOD.m_mmdModel->GetPhysicsManager()->SetLOD(lod);
+		}
+	}
+
+	void Viewer::SetupPhysics(MMDModel* mmdModel)
+	{
+		auto physicsMan = mmdModel->GetPhysicsManager();
+		if (!physicsMan->IsSharedPhysics() && physicsMan->GetMMDPhysics() != nullptr)
+		{
+			physicsMan->GetMMDPhysics()->SetMaxUpdateTime(m_mmdModelConfig.m_physicsMaxUpdateTime / 1000.0);
+		}
+		physicsMan->EnableSleep(m_mmdModelConfig.m_enablePhysicsLOD);
+		if (!m_mmdModelConfig.m_enablePhysicsLOD)
+		{
+			physicsMan->SetLOD(MMDPhysicsLOD::Full);
+		}
+	}
+
+	void Viewer::UpdateAsyncModels()
+	{
+		double updateStartTime = GetTime();
+
+		if (m_sharedPhysics == nullptr)
+		{
+			ParallelUpdateDrawers(m_asyncUpdateDrawers, &ModelDrawer::UpdateAsync);
+			m_perfUpdateTime = GetTime() - updateStartTime;
+			return;
+		}
+
+		// 更新している間、読み込み中のモデルがワールドに触らないようにする
+		std::unique_lock<std::recursive_mutex> physicsLock(m_sharedPhysics->GetMutex());
+
+		// 物理演算の前まで
+		ParallelUpdateDrawers(m_asyncUpdateDrawers, &ModelDrawer::UpdateAsync);
+
+		std::vector<ModelDrawerPtr> waitingDrawers;
+		for (const auto& modelDrawer : m_asyncUpdateDrawers)
+		{
+			if (modelDrawer->IsWaitingSharedPhysics())
+			{
+				waitingDrawers.push_back(modelDrawer);
+			}
+		}
+
+		if (!waitingDrawers.empty())
+		{
+			// 共有しているワールドを 1 回だけ進める
+			m_sharedPhysics->Update(float(m_asyncUpdateElapsed));
+
+			// 物理演算の後から
+			ParallelUpdateDrawers(waitingDrawers, &ModelDrawer::UpdateAsyncAfterPhysics);
+		}
+
+		m_perfUpdateTime = GetTime() - updateStartTime;
+	}
+
+	void Viewer::ParallelUpdateDrawers(const std::vector<ModelDrawerPtr>& drawers, void (ModelDrawer::*updateFunc)())
+	{
+		// 空いたジョブが次に大きいモデルを取る
+		auto& jobSystem = *Singleton<JobSystem>::Get();
+		const size_t drawerCount = drawers.size();
+		const size_t jobCount = std::min(drawerCount, jobSystem.GetConcurrency());
+		std::atomic<size_t> nextDrawerIndex(0);
+		auto jobFunc = [&drawers, updateFunc, &nextDrawerIndex, drawerCount]()
+		{
+			size_t drawerIdx;
+			while ((drawerIdx = nextDrawerIndex++) < drawerCount)
+			{
+				auto& modelDrawer = drawers[drawerIdx];
+				double startTime = GetTime();
+				((*modelDrawer).*updateFunc)();
+				// UpdateAsyncAfterPhysics の時間は UpdateAsync に足す
+				double updateTime = GetTime() - startTime;
+				if (updateFunc != &ModelDrawer::UpdateAsync)
+				{
+					updateTime += modelDrawer->GetUpdateTime();
+				}
+				modelDrawer->SetUpdateTime(updateTime);
+			}
+		};
+
+		JobGroup group;
+		for (size_t jobIdx = 1; jobIdx < jobCount; jobIdx++)
+		{
+			jobSystem.Run(&group, jobFunc);
+		}
+		jobFunc();
+		jobSystem.Wait(&group);
+	}
+
+	void Viewer::WaitAsyncUpdate()
+	{
+		if (!m_asyncUpdating)
+		{
+			return;
+		}
+
+		m_updateJobSystem->Wait(&m_updateJobGroup);
+		for (auto& modelDrawer : m_asyncUpdateDrawers)
+		{
+			modelDrawer->EndAsyncUpdate(&m_context);
+		}
+		m_asyncUpdateDrawers.clear();
+		m_drawAnimTime = m_asyncUpdateAnimTime;
+		m_asyncUpdating = false;
+	}
+
 	void Viewer::InitializeAnimation()
 	{
 		m_context.SetAnimationTime(0);
@@ -1850,6 +2152,9 @@ namespace saba
 
 	bool Viewer::ExecuteCommand(const ViewerCommand & cmd)
 	{
+		// コマンドはモデルを変更するので、更新中のモデルを待つ
+		WaitAsyncUpdate();
+
 		// Register Command
 		{
 			auto findIt = std::find_if(
@@ -1913,7 +2218,21 @@ namespace saba
 			return false;
 		}
 
-		std::string filepath = args[0];
+		// -async : MMD モデルの読み込みを待たずに戻る
+		bool async = false;
+		auto argIt = args.begin();
+		if ((*argIt) == "-async")
+		{
+			async = true;
+			++argIt;
+			if (argIt == args.end())
+			{
+				SABA_INFO("Cmd Open Args Empty.");
+				return false;
+			}
+		}
+
+		std::string filepath = *argIt;
 		std::string ext = PathUtil::GetExt(filepath);
 		SABA_INFO("Open File. [{}]", filepath);
 		if (ext == "obj")
@@ -1926,7 +2245,7 @@ namespace saba
 		else if (ext == "pmd")
 		{
 			InitializeAnimation();
-			if (!LoadPMDFile(filepath))
+			if (!LoadPMDFile(filepath, async))
 			{
 				return false;
 			}
@@ -1942,7 +2261,7 @@ namespace saba
 		else if (ext == "pmx")
 		{
 			InitializeAnimation();
-			if (!LoadPMXFile(filepath))
+			if (!LoadPMXFile(filepath, async))
 			{
 				return false;
 			}
@@ -2273,6 +2592,14 @@ namespace saba
 		if (args.empty())
 		{
 			SABA_INFO("Parallel : {}", m_mmdModelConfig.m_parallelUpdateCount);
+			SABA_INFO("Model Cache : {}", m_mmdModelConfig.m_useModelCache);
+			SABA_INFO("Texture Compression : {}", m_mmdModelConfig.m_useCompressedTexture);
+			SABA_INFO("GPU Skinning : {}", m_mmdModelConfig.m_useGPUSkinning);
+			SABA_INFO("Multi Draw Indirect : {}", m_mmdModelConfig.m_useMultiDrawIndirect);
+			SABA_INFO("Shared Physics : {}", m_mmdModelConfig.m_useSharedPhysics);
+			SABA_INFO("Physics LOD : {} (budget {})", m_mmdModelConfig.m_enablePhysicsLOD, m_mmdModelConfig.m_physicsLODBudget);
+			SABA_INFO("Physics Time : {} ms", m_mmdModelConfig.m_physicsMaxUpdateTime);
+			SABA_INFO("Job Workers : {}", Singleton<JobSystem>::Get()->GetWorkerCount());
 		}
 		auto argIt = args.begin();
 		for (; argIt != args.end(); ++argIt)
@@ -2286,7 +2613,7 @@ namespace saba
 				}
 				try
 				{
-					const size_t MaxParallelCount = std::max(size_t(std::thread::hardware_concurrency()), size_t(16));
+					const size_t MaxParallelCount = std::max(Singleton<JobSystem>::Get()->GetConcurrency(), size_t(16));
 					auto parallelCount = std::stoul(*argIt);
 					if (parallelCount > MaxParallelCount)
 					{
@@ -2310,6 +2637,182 @@ namespace saba
 					return false;
 				}
 			}
+			else if ((*argIt) == "-cache" || (*argIt) == "-c")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool useModelCache = false;
+				if (!ToBool(args, size_t(argIt - args.begin()), &useModelCache))
+				{
+					SABA_WARN("cache : true or false");
+					return false;
+				}
+				m_mmdModelConfig.m_useModelCache = useModelCache;
+			}
+			else if ((*argIt) == "-texcompress" || (*argIt) == "-x")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool useCompressedTexture = false;
+				if (!ToBool(args, size_t(argIt - args.begin()), &useCompressedTexture))
+				{
+					SABA_WARN("texcompress : true or false");
+					return false;
+				}
+				if (useCompressedTexture && !IsS3TCSupported())
+				{
+					SABA_WARN("GL_EXT_texture_compression_s3tc is not supported.");
+					return false;
+				}
+				// 読み込み済みのテクスチャはそのまま
+				m_mmdModelConfig.m_useCompressedTexture = useCompressedTexture;
+				Singleton<GLTextureCache>::Get()->EnableCompression(useCompressedTexture);
+			}
+			else if ((*argIt) == "-gpuskinning" || (*argIt) == "-g")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool useGPUSkinning = false;
+				if (!ToBool(args, size_t(argIt - args.begin()), &useGPUSkinning))
+				{
+					SABA_WARN("gpuskinning : true or false");
+					return false;
+				}
+				m_mmdModelConfig.m_useGPUSkinning = useGPUSkinning;
+				for (auto& modelDrawer : m_modelDrawers)
+				{
+					if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+					{
+						auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+						SetupGPUSkinning(mmdModelDrawer->GetModel());
+					}
+				}
+			}
+			else if ((*argIt) == "-multidraw" || (*argIt) == "-m")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool useMultiDrawIndirect = false;
+				if (!ToBool(args, size_t(argIt - args.begin()), &useMultiDrawIndirect))
+				{
+					SABA_WARN("multidraw : true or false");
+					return false;
+				}
+				if (useMultiDrawIndirect && !m_mmdModelDrawContext->IsMultiDrawIndirectSupported())
+				{
+					SABA_WARN("glMultiDrawElementsIndirect is not supported.");
+					return false;
+				}
+				m_mmdModelConfig.m_useMultiDrawIndirect = useMultiDrawIndirect;
+				for (auto& modelDrawer : m_modelDrawers)
+				{
+					if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+					{
+						auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+						if (!mmdModelDrawer->EnableMultiDrawIndirect(useMultiDrawIndirect))
+						{
+							SABA_WARN("Multi Draw Indirect Enable Fail. [{}]", mmdModelDrawer->GetName());
+						}
+					}
+				}
+			}
+			else if ((*argIt) == "-sharedphysics" || (*argIt) == "-s")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool useSharedPhysics = false;
+				if (!ToBool(args, size_t(argIt - args.begin()), &useSharedPhysics))
+				{
+					SABA_WARN("sharedphysics : true or false");
+					return false;
+				}
+				// 読み込み済みのモデルはそのまま
+				m_mmdModelConfig.m_useSharedPhysics = useSharedPhysics;
+			}
+			else if ((*argIt) == "-physicslod" || (*argIt) == "-l")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool enablePhysicsLOD = false;
+				if (!ToBool(args, size_t(argIt - args.begin()), &enablePhysicsLOD))
+				{
+					SABA_WARN("physicslod : true or false");
+					return false;
+				}
+				m_mmdModelConfig.m_enablePhysicsLOD = enablePhysicsLOD;
+				for (auto& modelDrawer : m_modelDrawers)
+				{
+					if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+					{
+						auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+						SetupPhysics(mmdModelDrawer->GetModel()->GetMMDModel());
+					}
+				}
+			}
+			else if ((*argIt) == "-physicsbudget" || (*argIt) == "-b")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				try
+				{
+					m_mmdModelConfig.m_physicsLODBudget = uint32_t(std::stoul(*argIt));
+				}
+				catch (std::exception e)
+				{
+					SABA_WARN("exception : {}", e.what());
+					return false;
+				}
+			}
+			else if ((*argIt) == "-physicstime" || (*argIt) == "-t")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				try
+				{
+					m_mmdModelConfig.m_physicsMaxUpdateTime = std::max(std::stof(*argIt), 0.0f);
+				}
+				catch (std::exception e)
+				{
+					SABA_WARN("exception : {}", e.what());
+					return false;
+				}
+				if (m_sharedPhysics != nullptr)
+				{
+					m_sharedPhysics->SetMaxUpdateTime(m_mmdModelConfig.m_physicsMaxUpdateTime / 1000.0);
+				}
+				for (auto& modelDrawer : m_modelDrawers)
+				{
+					if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+					{
+						auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+						SetupPhysics(mmdModelDrawer->GetModel()->GetMMDModel());
+					}
+				}
+			}
 			else
 			{
 				SABA_WARN("unknown arg : {}", *argIt);
@@ -2381,7 +2884,7 @@ namespace saba
 		return true;
 	}
 
-	bool Viewer::LoadPMDFile(const std::string & filename)
+	bool Viewer::LoadPMDFile(const std::string & filename, bool async)
 	{
 		std::shared_ptr<PMDModel> pmdModel = std::make_shared<PMDModel>();
 		std::string mmdDataDir = PathUtil::Combine(
@@ -2389,41 +2892,35 @@ namespace saba
 			"mmd"
 		);
 		pmdModel->SetParallelUpdateHint(m_mmdModelConfig.m_parallelUpdateCount);
-		if (!pmdModel->Load(filename, mmdDataDir))
-		{
-			SABA_WARN("PMD Load Fail.");
-			return false;
-		}
-
-		std::shared_ptr<GLMMDModel> glMMDModel = std::make_shared<GLMMDModel>();
-		if (!glMMDModel->Create(pmdModel))
+		if (m_mmdModelConfig.m_useSharedPhysics)
 		{
-			SABA_WARN("GLMMDModel Create Fail.");
-			return false;
+			if (!SetupSharedPhysics())
+			{
+				return false;
+			}
+			pmdModel->GetPhysicsManager()->SetSharedPhysics(m_sharedPhysics);
 		}
 
-		auto mmdDrawer = std::make_unique<GLMMDModelDrawer>(
-			m_mmdModelDrawContext.get(),
-			glMMDModel
-			);
-		if (!mmdDrawer->Create())
+		auto task = std::make_unique<MMDModelLoadTask>();
+		auto taskPtr = task.get();
+		task->m_filename = filename;
+		task->m_mmdModel = pmdModel;
+		task->m_loadFunc = [taskPtr, pmdModel, filename, mmdDataDir]()
 		{
-			SABA_WARN("GLMMDModelDrawer Create Fail.");
-			return false;
-		}
-		m_modelDrawers.emplace_back(std::move(mmdDrawer));
-		m_selectedModelDrawer = m_modelDrawers[m_modelDrawers.size() - 1];
-		m_selectedModelDrawer->SetName(GetNewModelName());
-		m_selectedModelDrawer->SetBBox(pmdModel->GetBBoxMin(), pmdModel->GetBBoxMax());
-
-		InitializeScene();
-
-		m_prevTime = GetTime();
+			if (!pmdModel->Load(filename, mmdDataDir))
+			{
+				SABA_WARN("PMD Load Fail.");
+				return false;
+			}
+			taskPtr->m_bboxMin = pmdModel->GetBBoxMin();
+			taskPtr->m_bboxMax = pmdModel->GetBBoxMax();
+			return true;
+		};
 
-		return true;
+		return StartMMDModelLoadTask(std::move(task), async);
 	}
 
-	bool Viewer::LoadPMXFile(const std::string & filename)
+	bool Viewer::LoadPMXFile(const std::string & filename, bool async)
 	{
 		std::shared_ptr<PMXModel> pmxModel = std::make_shared<PMXModel>();
 		std::string mmdDataDir = PathUtil::Combine(
@@ -2431,18 +2928,125 @@ namespace saba
 			"mmd"
 		);
 		pmxModel->SetParallelUpdateHint(m_mmdModelConfig.m_parallelUpdateCount);
-		if (!pmxModel->Load(filename, mmdDataDir))
+		if (m_mmdModelConfig.m_useSharedPhysics)
+		{
+			if (!SetupSharedPhysics())
+			{
+				return false;
+			}
+			pmxModel->GetPhysicsManager()->SetSharedPhysics(m_sharedPhysics);
+		}
+		// キャッシュはモデルファイルと同じ場所に作る
+		std::string cachePath;
+		if (m_mmdModelConfig.m_useModelCache)
+		{
+			cachePath = filename + ".sabacache";
+		}
+
+		auto task = std::make_unique<MMDModelLoadTask>();
+		auto taskPtr = task.get();
+		task->m_filename = filename;
+		task->m_mmdModel = pmxModel;
+		task->m_loadFunc = [taskPtr, pmxModel, filename, mmdDataDir, cachePath]()
+		{
+			if (!pmxModel->Load(filename, mmdDataDir, cachePath))
+			{
+				SABA_WARN("PMX Load Fail.");
+				return false;
+			}
+			taskPtr->m_bboxMin = pmxModel->GetBBoxMin();
+			taskPtr->m_bboxMax = pmxModel->GetBBoxMax();
+			return true;
+		};
+
+		return StartMMDModelLoadTask(std::move(task), async);
+	}
+
+	bool Viewer::SetupSharedPhysics()
+	{
+		if (m_sharedPhysics != nullptr)
+		{
+			return true;
+		}
+		auto physics = std::make_shared<MMDPhysics>();
+		if (!physics->Create())
 		{
-			SABA_WARN("PMD Load Fail.");
+			SABA_WARN("Failed to create shared physics.");
 			return false;
 		}
+		m_sharedPhysics = std::move(physics);
+		m_sharedPhysics->SetMaxUpdateTime(m_mmdModelConfig.m_physicsMaxUpdateTime / 1000.0);
+		return true;
+	}
+
+	bool Viewer::StartMMDModelLoadTask(MMDModelLoadTaskPtr task, bool async)
+	{
+		if (async)
+		{
+			auto taskPtr = task.get();
+			m_loadJobSystem->Run(&task->m_jobGroup, [taskPtr]()
+			{
+				taskPtr->m_loadSucceeded = taskPtr->m_loadFunc();
+			});
+			m_mmdModelLoadTasks.emplace_back(std::move(task));
+			return true;
+		}
+
+		// 同期読み込みでも、テクスチャのデコードは並列に行う
+		if (!task->m_loadFunc())
+		{
+			return false;
+		}
+		StartTextureDecode(task.get());
+		m_loadJobSystem->Wait(&task->m_jobGroup);
+
+		return FinishMMDModelLoadTask(task.get());
+	}
 
+	void Viewer::StartTextureDecode(MMDModelLoadTask* task)
+	{
+		// 同じテクスチャは一度だけデコードする
+		auto mmdModel = task->m_mmdModel;
+		size_t matCount = mmdModel->GetMaterialCount();
+		auto materials = mmdModel->GetMaterials();
+		for (size_t matIdx = 0; matIdx < matCount; matIdx++)
+		{
+			const auto& mat = materials[matIdx];
+			for (const auto* texPath : { &mat.m_texture, &mat.m_spTexture, &mat.m_toonTexture })
+			{
+				if (!texPath->empty())
+				{
+					task->m_textureImages.emplace(*texPath, nullptr);
+				}
+			}
+		}
+
+		// 各ジョブは自分の要素にだけ書き込む (map の構造は変えない)
+		// 他のモデルと同じ画像は、キャッシュにあるデコード済みのものを使う
+		task->m_state = MMDModelLoadTask::State::DecodeTexture;
+		for (auto& textureImage : task->m_textureImages)
+		{
+			auto imagePtr = &textureImage;
+			m_loadJobSystem->Run(&task->m_jobGroup, [task, imagePtr]()
+			{
+				imagePtr->second = Singleton<GLTextureCache>::Get()->GetImage(imagePtr->first);
+				task->m_decodedTextureCount++;
+			});
+		}
+	}
+
+	bool Viewer::FinishMMDModelLoadTask(MMDModelLoadTask* task)
+	{
 		std::shared_ptr<GLMMDModel> glMMDModel = std::make_shared<GLMMDModel>();
-		if (!glMMDModel->Create(pmxModel))
+		if (!glMMDModel->Create(task->m_mmdModel, task->m_textureImages))
 		{
 			SABA_WARN("GLMMDModel Create Fail.");
 			return false;
 		}
+		// GL に転送したので、デコードした画像は不要
+		task->m_textureImages.clear();
+		SetupGPUSkinning(glMMDModel.get());
+		SetupPhysics(task->m_mmdModel.get());
 
 		auto mmdDrawer = std::make_unique<GLMMDModelDrawer>(
 			m_mmdModelDrawContext.get(),
@@ -2453,10 +3057,14 @@ namespace saba
 			SABA_WARN("GLMMDModelDrawer Create Fail.");
 			return false;
 		}
+		if (!mmdDrawer->EnableMultiDrawIndirect(m_mmdModelConfig.m_useMultiDrawIndirect))
+		{
+			SABA_WARN("Multi Draw Indirect Enable Fail.");
+		}
 		m_modelDrawers.emplace_back(std::move(mmdDrawer));
 		m_selectedModelDrawer = m_modelDrawers[m_modelDrawers.size() - 1];
 		m_selectedModelDrawer->SetName(GetNewModelName());
-		m_selectedModelDrawer->SetBBox(pmxModel->GetBBoxMin(), pmxModel->GetBBoxMax());
+		m_selectedModelDrawer->SetBBox(task->m_bboxMin, task->m_bboxMax);
 
 		InitializeScene();
 
@@ -2465,6 +3073,111 @@ namespace saba
 		return true;
 	}
 
+	void Viewer::SetupGPUSkinning(GLMMDModel* glMMDModel)
+	{
+		if (!m_mmdModelConfig.m_useGPUSkinning)
+		{
+			glMMDModel->DisableGPUSkinning();
+			return;
+		}
+		// 失敗した場合は CPU でスキニングする
+		if (!glMMDModel->EnableGPUSkinning(m_mmdModelDrawContext->GetSkinningShader()))
+		{
+			SABA_WARN("GPU Skinning Enable fail.");
+		}
+	}
+
+	void Viewer::UpdateMMDModelLoadTasks()
+	{
+		for (auto& task : m_mmdModelLoadTasks)
+		{
+			if (!task->m_jobGroup.IsDone())
+			{
+				continue;
+			}
+
+			if (task->m_state == MMDModelLoadTask::State::LoadModel)
+			{
+				if (task->m_loadSucceeded)
+				{
+					StartTextureDecode(task.get());
+					continue;
+				}
+				SABA_WARN("MMD Model Load Fail. [{}]", task->m_filename);
+			}
+			else
+			{
+				if (!FinishMMDModelLoadTask(task.get()))
+				{
+					SABA_WARN("MMD Model Load Fail. [{}]", task->m_filename);
+				}
+			}
+			task.reset();
+		}
+		m_mmdModelLoadTasks.erase(
+			std::remove(m_mmdModelLoadTasks.begin(), m_mmdModelLoadTasks.end(), nullptr),
+			m_mmdModelLoadTasks.end()
+		);
+
+		// ドロップされたファイルは、前のモデルの読み込みが終わってから順に開く
+		// (モーションはモデルが選択されている必要があるため)
+		while (m_mmdModelLoadTasks.empty() && !m_dropFiles.empty())
+		{
+			std::string filepath = m_dropFiles.front();
+			m_dropFiles.pop_front();
+			CmdOpen({ "-async", filepath });
+		}
+	}
+
+	void Viewer::WaitMMDModelLoadTasks()
+	{
+		if (m_loadJobSystem == nullptr)
+		{
+			return;
+		}
+
+		for (auto& task : m_mmdModelLoadTasks)
+		{
+			m_loadJobSystem->Wait(&task->m_jobGroup);
+		}
+		m_mmdModelLoadTasks.clear();
+		m_dropFiles.clear();
+	}
+
+	void Viewer::DrawLoadProgressUI()
+	{
+		if (m_mmdModelLoadTasks.empty())
+		{
+			return;
+		}
+
+		float width = 400;
+		ImGui::SetNextWindowPos(
+			ImVec2(((float)m_context.GetWindowWidth() - width) * 0.5f, (float)m_context.GetWindowHeight() * 0.5f),
+			ImGuiCond_Always
+		);
+		ImGui::SetNextWindowSize(ImVec2(width, 0), ImGuiCond_Always);
+		ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings);
+		for (const auto& task : m_mmdModelLoadTasks)
+		{
+			ImGui::TextUnformatted(PathUtil::GetFilename(task->m_filename).c_str());
+			if (task->m_state == MMDModelLoadTask::State::LoadModel)
+			{
+				ImGui::ProgressBar(0.0f, ImVec2(-1, 0), "Load Model");
+			}
+			else
+			{
+				size_t textureCount = task->m_textureImages.size();
+				size_t decodedCount = task->m_decodedTextureCount;
+				char overlay[64];
+				snprintf(overlay, sizeof(overlay), "Decode Texture %zu/%zu", decodedCount, textureCount);
+				float progress = textureCount == 0 ? 1.0f : float(decodedCount) / float(textureCount);
+				ImGui::ProgressBar(progress, ImVec2(-1, 0), overlay);
+			}
+		}
+		ImGui::End();
+	}
+
 	bool Viewer::LoadVMDFile(const std::string & filename)
 	{
 		GLMMDModel* mmdModel = nullptr;
@@ -2839,15 +3552,11 @@ namespace saba
 
 	void Viewer::OnDrop(int count, const char ** paths)
 	{
-		if (count > 0)
+		// 読み込みは UpdateMMDModelLoadTasks で行う
+		for (int i = 0; i < count; i++)
 		{
-			std::vector<std::string> args;
-			for (int i = 0; i < count; i++)
-			{
-				SABA_INFO("Drop File. {}", paths[i]);
-				args.emplace_back(paths[i]);
-			}
-			CmdOpen(args);
+			SABA_INFO("Drop File. {}", paths[i]);
+			m_dropFiles.emplace_back(paths[i]);
 		}
 	}
 
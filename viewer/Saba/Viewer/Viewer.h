@@ -24,16 +24,21 @@
 #include <imgui.h>
 #include <ImGuizmo.h>
 
+#include <Saba/Base/JobSystem.h>
+
 #include <sol.hpp>
 
 #include <map>
 #include <string>
 #include <memory>
 #include <deque>
+#include <atomic>
+#include <functional>
 
 namespace saba
 {
 	class ImGUILogSink;
+	class MMDPhysics;
 
 	class Viewer
 	{
@@ -137,9 +142,46 @@ namespace saba
 		struct MMDModelConfig
 		{
 			MMDModelConfig();
-			uint32_t	m_parallelUpdateCount;	//!< 0 - 16 (0:auto)
+			uint32_t	m_parallelUpdateCount;	//!< 0 - 16 (0:auto) 頂点更新のジョブ数
+			bool		m_useModelCache;		//!< PMX の頂点データをキャッシュ (.sabacache) から読み込む
+			bool		m_useCompressedTexture;	//!< テクスチャを BC1/BC3 に圧縮し、キャッシュ (.sabatex) から読み込む
+			bool		m_useGPUSkinning;		//!< スキニングとモーフを GPU で行う
+			bool		m_useMultiDrawIndirect;	//!< サブメッシュを glMultiDrawElementsIndirect でまとめて描画する
+			bool		m_useSharedPhysics;		//!< 物理演算のワールドをモデル間で共有する (モデル同士は衝突しない)
+			bool		m_enablePhysicsLOD;		//!< 画面上の大きさで物理演算の LOD を切り替え、静止したモデルの物理演算を止める
+			uint32_t	m_physicsLODBudget;		//!< すべての剛体を物理演算するモデルの数
+			float		m_physicsMaxUpdateTime;	//!< ワールド毎の 1 フレームの物理演算の時間 (ms, 0:制限しない)
 		};
 
+		/*
+		MMD モデルの読み込み。
+		モデルの読み込みとテクスチャのデコードをワーカースレッドで行い、
+		終わったら GL のスレッドでバッファとテクスチャを作る。
+		*/
+		struct MMDModelLoadTask
+		{
+			MMDModelLoadTask();
+
+			enum class State
+			{
+				LoadModel,
+				DecodeTexture,
+			};
+
+			std::string					m_filename;
+			std::shared_ptr<MMDModel>	m_mmdModel;
+			std::function<bool()>		m_loadFunc;
+			State						m_state;
+			bool						m_loadSucceeded;
+			glm::vec3					m_bboxMin;
+			glm::vec3					m_bboxMax;
+			GLMMDTextureImageMap		m_textureImages;
+			std::atomic<size_t>			m_decodedTextureCount;
+			JobGroup					m_jobGroup;
+		};
+
+		using MMDModelLoadTaskPtr = std::unique_ptr<MMDModelLoadTask>;
+
 	private:
 		using ModelDrawerPtr = std::shared_ptr<ModelDrawer>;
 
@@ -167,6 +209,12 @@ namespace saba
 		void DrawModelCtrl();
 		void DrawBGCtrl();
 		void UpdateAnimation();
+		void UpdateModels();
+		void UpdatePhysicsLOD();
+		void SetupPhysics(MMDModel* mmdModel);
+		void UpdateAsyncModels();
+		void ParallelUpdateDrawers(const std::vector<ModelDrawerPtr>& drawers, void (ModelDrawer::*updateFunc)());
+		void WaitAsyncUpdate();
 		void InitializeAnimation();
 		void ResetAnimation();
 		void RegisterCommand();
@@ -188,12 +236,21 @@ namespace saba
 		bool CmdSetMSAA(const std::vector<std::string>& args);
 
 		bool LoadOBJFile(const std::string& filename);
-		bool LoadPMDFile(const std::string& filename);
-		bool LoadPMXFile(const std::string& filename);
+		bool LoadPMDFile(const std::string& filename, bool async);
+		bool LoadPMXFile(const std::string& filename, bool async);
+		bool SetupSharedPhysics();
 		bool LoadVMDFile(const std::string& filename);
 		bool LoadVPDFile(const std::string& filename);
 		bool LoadXFile(const std::string& filename);
 
+		bool StartMMDModelLoadTask(MMDModelLoadTaskPtr task, bool async);
+		void StartTextureDecode(MMDModelLoadTask* task);
+		bool FinishMMDModelLoadTask(MMDModelLoadTask* task);
+		void SetupGPUSkinning(GLMMDModel* glMMDModel);
+		void UpdateMMDModelLoadTasks();
+		void WaitMMDModelLoadTasks();
+		void DrawLoadProgressUI();
+
 		bool ClearAnimation(ModelDrawer* modelDrawer);
 		bool ClearSceneAnimation();
 
@@ -264,7 +321,37 @@ namespace saba
 		// MMDModelConfig
 		MMDModelConfig	m_mmdModelConfig;
 
+		/*
+		共有する物理演算のワールド。
+		ワールドを共有するモデルは、UpdateAsyncModels でまとめて 1 回だけワールドを進める。
+		*/
+		std::shared_ptr<MMDPhysics>	m_sharedPhysics;
+
+		// Async Load
+		std::unique_ptr<JobSystem>			m_loadJobSystem;
+		std::vector<MMDModelLoadTaskPtr>	m_mmdModelLoadTasks;
+		std::deque<std::string>				m_dropFiles;
+
+		/*
+		Pipelined Update
+		フレーム N を描画している間に、フレーム N + 1 のアニメーション、物理、スキニングをワーカースレッドで行う。
+		更新の結果は次のフレームの始めに待って、GL のバッファに反映する。
+		モデル同士は独立しているので、モデル毎のジョブとして Singleton<JobSystem> で並列に更新する。
+		*/
+		bool							m_enablePipelinedUpdate;
+		std::unique_ptr<JobSystem>		m_updateJobSystem;
+		JobGroup						m_updateJobGroup;
+		std::vector<ModelDrawerPtr>		m_asyncUpdateDrawers;
+		bool							m_asyncUpdating;
+		double							m_asyncUpdateAnimTime;
+		double							m_asyncUpdateElapsed;
+		double							m_drawAnimTime;	//!< 描画するモデルのアニメーションの時間
+
 		// Performance
+		double				m_perfUpdateTime;
+		double				m_perfDrawTime;
+		std::deque<double>	m_perfUpdateTimeLap;
+		std::deque<double>	m_perfDrawTimeLap;
 		std::deque<float>	m_perfFramerateLap;
 		std::deque<double>	m_perfMMDSetupAnimTimeLap;
 		std::deque<double>	m_perfMMDUpdateMorphAnimTimeLap;
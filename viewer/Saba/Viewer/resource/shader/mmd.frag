@@ -1,45 +1,27 @@
 #version 140
 
-#define NUM_SHADOWMAP 4
+#include "mmd_uniform_block.glsl"
 
 in vec3 vs_Pos;
 in vec3 vs_Nor;
 in vec2 vs_UV;
 
 in vec4 vs_shadowMapCoord[NUM_SHADOWMAP];
+#ifdef MMD_MULTI_DRAW
+flat in int vs_MaterialID;
+#endif
 
 out vec4 out_Color;
 
-uniform float u_Alpha;
-uniform vec3 u_Diffuse;
-uniform vec3 u_Ambient;
-uniform vec3 u_Specular;
-uniform float u_SpecularPower;
-uniform vec3 u_LightColor;
-uniform vec3 u_LightDir;
-
-uniform int u_TexMode;
 uniform sampler2D u_Tex;
-uniform vec4 u_TexMulFactor;
-uniform vec4 u_TexAddFactor;
-
-uniform int u_ToonTexMode;
 uniform sampler2D u_ToonTex;
-uniform vec4 u_ToonTexMulFactor;
-uniform vec4 u_ToonTexAddFactor;
-
-uniform int u_SphereTexMode;
 uniform sampler2D u_SphereTex;
-uniform vec4 u_SphereTexMulFactor;
-uniform vec4 u_SphereTexAddFactor;
 
 // ShadowMap
-uniform float u_ShadowMapSplitPositions[NUM_SHADOWMAP + 1];
 uniform sampler2DShadow u_ShadowMap0;
 uniform sampler2DShadow u_ShadowMap1;
 uniform sampler2DShadow u_ShadowMap2;
 uniform sampler2DShadow u_ShadowMap3;
-uniform int u_ShadowMapEnabled;
 
 vec3 ComputeTexMulFactor(vec3 texColor, vec4 factor)
 {
@@ -56,6 +38,9 @@ vec3 ComputeTexAddFactor(vec3 texColor, vec4 factor)
 
 void main()
 {
+#ifdef MMD_MULTI_DRAW
+	LoadMaterial(vs_MaterialID);
+#endif
 	vec3 eyeDir = normalize(vs_Pos);
 	vec3 lightDir = normalize(-u_LightDir);
 	vec3 nor = normalize(vs_Nor);
@@ -68,7 +53,7 @@ void main()
 	color += u_Ambient;
 	color = clamp(color, 0.0, 1.0);
 
-	if (u_ShadowMapEnabled != 0)
+	if (u_ShadowMapEnabled != 0 && u_ShadowReceiver != 0.0)
 	{
 		float z = -vs_Pos.z;
 		float visibility = 1.0;
@@ -91,13 +76,13 @@ void main()
 		ln *= (1.0 - visibility);
 	}
 
-    if (u_TexMode != 0)
+    if (u_TexMode != 0.0)
     {
 		vec4 texColor = texture(u_Tex, vs_UV);
 		texColor.rgb = ComputeTexMulFactor(texColor.rgb, u_TexMulFactor);
 		texColor.rgb = ComputeTexAddFactor(texColor.rgb, u_TexAddFactor);
         color *= texColor.rgb;
-		if (u_TexMode == 2)
+		if (u_TexMode == 2.0)
 		{
 			alpha *= texColor.a;
 		}
@@ -107,7 +92,7 @@ void main()
 		discard;
 	}
 
-	if (u_SphereTexMode != 0)
+	if (u_SphereTexMode != 0.0)
 	{
 		vec2 spUV = vec2(0.0);
 		spUV.x = nor.x * 0.5 + 0.5;
@@ -115,17 +100,17 @@ void main()
 		vec3 spColor = texture(u_SphereTex, spUV).rgb;
 		spColor = ComputeTexMulFactor(spColor, u_SphereTexMulFactor);
 		spColor = ComputeTexAddFactor(spColor, u_SphereTexAddFactor);
-		if (u_SphereTexMode == 1)
+		if (u_SphereTexMode == 1.0)
 		{
 			color *= spColor;
 		}
-		else if (u_SphereTexMode == 2)
+		else if (u_SphereTexMode == 2.0)
 		{
 			color += spColor;
 		}
 	}
 
-	if (u_ToonTexMode != 0)
+	if (u_ToonTexMode != 0.0)
 	{
 		vec3 toonColor = texture(u_ToonTex, vec2(0.0, ln)).rgb;
 		toonColor = ComputeTexMulFactor(toonColor, u_ToonTexMulFactor);
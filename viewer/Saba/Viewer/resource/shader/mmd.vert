@@ -1,20 +1,22 @@
 #version 140
 
-#define NUM_SHADOWMAP 4
+#include "mmd_uniform_block.glsl"
 
 in vec3 in_Pos;
 in vec3 in_Nor;
 in vec2 in_UV;
+#ifdef MMD_MULTI_DRAW
+in int in_DrawID;
+#endif
 
 out vec3 vs_Pos;
 out vec3 vs_Nor;
 out vec2 vs_UV;
 
 out vec4 vs_shadowMapCoord[NUM_SHADOWMAP];
-
-uniform mat4 u_WV;
-uniform mat4 u_WVP;
-uniform mat4 u_LightWVP[NUM_SHADOWMAP];
+#ifdef MMD_MULTI_DRAW
+flat out int vs_MaterialID;
+#endif
 
 void main()
 {
@@ -22,6 +24,9 @@ void main()
     vs_Pos = (u_WV * vec4(in_Pos, 1.0)).xyz;
     vs_Nor = mat3(u_WV) * in_Nor;
     vs_UV = in_UV;
+#ifdef MMD_MULTI_DRAW
+    vs_MaterialID = in_DrawID;
+#endif
 
     for (int i = 0; i < NUM_SHADOWMAP; i++)
     {
@@ -1,10 +1,17 @@
 #version 140
 
-out vec4 out_Color;
+#include "mmd_uniform_block.glsl"
+
+#ifdef MMD_MULTI_DRAW
+flat in int vs_MaterialID;
+#endif
 
-uniform vec4 u_EdgeColor;
+out vec4 out_Color;
 
 void main()
 {
+#ifdef MMD_MULTI_DRAW
+	LoadMaterial(vs_MaterialID);
+#endif
 	out_Color = u_EdgeColor;
 }
@@ -1,15 +1,21 @@
 #version 140
 
+#include "mmd_uniform_block.glsl"
+
 in vec3 in_Pos;
 in vec3 in_Nor;
+#ifdef MMD_MULTI_DRAW
+in int in_DrawID;
 
-uniform mat4 u_WV;
-uniform mat4 u_WVP;
-uniform vec2 u_ScreenSize;
-uniform float u_EdgeSize;
+flat out int vs_MaterialID;
+#endif
 
 void main()
 {
+#ifdef MMD_MULTI_DRAW
+    LoadMaterial(in_DrawID);
+    vs_MaterialID = in_DrawID;
+#endif
     vec3 nor = mat3(u_WV) * in_Nor;
     vec4 pos = u_WVP * vec4(in_Pos, 1.0);
     vec2 screenNor = normalize(vec2(nor));
@@ -1,11 +1,11 @@
 #version 140
 
-uniform vec4	u_ShadowColor;
+#include "mmd_uniform_block.glsl"
 
 // Output
 out vec4 fs_Color;
 
 void main()
 {
-	fs_Color = u_ShadowColor;
+	fs_Color = u_GroundShadowColor;
 }
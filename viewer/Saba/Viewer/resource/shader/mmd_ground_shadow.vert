@@ -1,12 +1,11 @@
 #version 140
 
+#include "mmd_uniform_block.glsl"
+
 // Input
 in vec3	in_Pos;
 
-// Uniform
-uniform	mat4	u_WVP;
-
 void main()
 {
-	gl_Position = u_WVP * vec4(in_Pos, 1.0);
+	gl_Position = u_GroundShadowWVP * vec4(in_Pos, 1.0);
 }
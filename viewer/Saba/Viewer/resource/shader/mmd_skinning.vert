@@ -0,0 +1,156 @@
+#version 140
+
+// MMDGPUSkinningType
+#define SKINNING_LINEAR 0
+#define SKINNING_SDEF 1
+#define SKINNING_DUAL_QUATERNION 2
+
+// ボーン毎の texel 数 (スキニング行列 4, SDEF の回転 1, デュアルクォータニオン 2)
+#define BONE_TEXEL_COUNT 7
+
+in vec3 in_Pos;
+in vec3 in_Nor;
+in vec2 in_UV;
+in ivec4 in_BoneIndex;
+in vec4 in_BoneWeight;
+in vec3 in_SdefC;
+in vec3 in_SdefR0;
+in vec3 in_SdefR1;
+in int in_SkinningType;
+in ivec2 in_PositionMorph;
+in ivec2 in_UVMorph;
+
+// Transform Feedback で描画用の頂点バッファに書き出す
+out vec3 xfb_Pos;
+out vec3 xfb_Nor;
+out vec2 xfb_UV;
+
+uniform samplerBuffer u_Bones;
+uniform samplerBuffer u_PositionMorphs;
+uniform samplerBuffer u_UVMorphs;
+uniform samplerBuffer u_MorphWeights;
+
+mat4 GetBoneTransform(int bone)
+{
+    int texel = bone * BONE_TEXEL_COUNT;
+    return mat4(
+        texelFetch(u_Bones, texel),
+        texelFetch(u_Bones, texel + 1),
+        texelFetch(u_Bones, texel + 2),
+        texelFetch(u_Bones, texel + 3)
+    );
+}
+
+vec4 GetSDEFRotation(int bone)
+{
+    return texelFetch(u_Bones, bone * BONE_TEXEL_COUNT + 4);
+}
+
+vec3 RotateVector(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+// glm::slerp と同じ
+vec4 Slerp(vec4 q0, vec4 q1, float t)
+{
+    float cosTheta = dot(q0, q1);
+    if (cosTheta < 0.0)
+    {
+        q1 = -q1;
+        cosTheta = -cosTheta;
+    }
+    if (cosTheta > 1.0 - 1.192092896e-07)
+    {
+        return mix(q0, q1, t);
+    }
+    float angle = acos(cosTheta);
+    return (sin((1.0 - t) * angle) * q0 + sin(t * angle) * q1) / sin(angle);
+}
+
+void SkinLinear(vec3 pos, out vec3 outPos, out vec3 outNor)
+{
+    mat4 m = GetBoneTransform(in_BoneIndex.x) * in_BoneWeight.x
+        + GetBoneTransform(in_BoneIndex.y) * in_BoneWeight.y
+        + GetBoneTransform(in_BoneIndex.z) * in_BoneWeight.z
+        + GetBoneTransform(in_BoneIndex.w) * in_BoneWeight.w;
+    outPos = (m * vec4(pos, 1.0)).xyz;
+    outNor = normalize(mat3(m) * in_Nor);
+}
+
+// https://github.com/powroupi/blender_mmd_tools/blob/dev_test/mmd_tools/core/sdef.py
+void SkinSDEF(vec3 pos, out vec3 outPos, out vec3 outNor)
+{
+    int i0 = in_BoneIndex.x;
+    int i1 = in_BoneIndex.y;
+    float w0 = in_BoneWeight.x;
+    float w1 = in_BoneWeight.y;
+    mat4 m0 = GetBoneTransform(i0);
+    mat4 m1 = GetBoneTransform(i1);
+    vec4 rot = Slerp(GetSDEFRotation(i0), GetSDEFRotation(i1), w1);
+
+    outPos = RotateVector(rot, pos - in_SdefC)
+        + (m0 * vec4(in_SdefR0, 1.0)).xyz * w0
+        + (m1 * vec4(in_SdefR1, 1.0)).xyz * w1;
+    outNor = RotateVector(rot, in_Nor);
+}
+
+// Skinning with Dual Quaternions
+// https://www.cs.utah.edu/~ladislav/dq/index.html
+void SkinDualQuaternion(vec3 pos, out vec3 outPos, out vec3 outNor)
+{
+    vec4 real = vec4(0.0);
+    vec4 dual = vec4(0.0);
+    vec4 real0 = texelFetch(u_Bones, in_BoneIndex.x * BONE_TEXEL_COUNT + 5);
+    for (int i = 0; i < 4; i++)
+    {
+        int texel = in_BoneIndex[i] * BONE_TEXEL_COUNT + 5;
+        vec4 r = texelFetch(u_Bones, texel);
+        vec4 d = texelFetch(u_Bones, texel + 1);
+        float w = in_BoneWeight[i];
+        if (i != 0 && dot(real0, r) < 0.0)
+        {
+            w = -w;
+        }
+        real += r * w;
+        dual += d * w;
+    }
+    float len = length(real);
+    real /= len;
+    dual /= len;
+
+    vec3 t = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+    outPos = RotateVector(real, pos) + t;
+    outNor = normalize(RotateVector(real, in_Nor));
+}
+
+void main()
+{
+    vec3 pos = in_Pos;
+    for (int i = 0; i < in_PositionMorph.y; i++)
+    {
+        vec4 morph = texelFetch(u_PositionMorphs, in_PositionMorph.x + i);
+        pos += morph.xyz * texelFetch(u_MorphWeights, int(morph.w)).x;
+    }
+
+    vec2 uv = in_UV;
+    for (int i = 0; i < in_UVMorph.y; i++)
+    {
+        vec4 morph = texelFetch(u_UVMorphs, in_UVMorph.x + i);
+        uv += morph.xy * texelFetch(u_MorphWeights, int(morph.z)).x;
+    }
+
+    if (in_SkinningType == SKINNING_SDEF)
+    {
+        SkinSDEF(pos, xfb_Pos, xfb_Nor);
+    }
+    else if (in_SkinningType == SKINNING_DUAL_QUATERNION)
+    {
+        SkinDualQuaternion(pos, xfb_Pos, xfb_Nor);
+    }
+    else
+    {
+        SkinLinear(pos, xfb_Pos, xfb_Nor);
+    }
+    xfb_UV = uv;
+}
@@ -0,0 +1,100 @@
+// GLMMDModelDrawContext.h の GLMMDFrameBlock, GLMMDModelBlock, GLMMDMaterialBlock と同じ並び
+
+#define NUM_SHADOWMAP 4
+
+// フレーム毎
+layout(std140) uniform MMDFrame
+{
+	vec3 u_LightColor;
+	vec3 u_LightDir;
+	vec4 u_GroundShadowColor;
+	vec2 u_ScreenSize;
+	int u_ShadowMapEnabled;
+	int u_MaterialTexelStride;
+	float u_ShadowMapSplitPositions[NUM_SHADOWMAP + 1];
+};
+
+// モデル毎
+layout(std140) uniform MMDModel
+{
+	mat4 u_WV;
+	mat4 u_WVP;
+	mat4 u_GroundShadowWVP;
+	mat4 u_LightWVP[NUM_SHADOWMAP];
+};
+
+#ifdef MMD_MULTI_DRAW
+
+// glMultiDrawElementsIndirect でまとめて描画するので、マテリアルは
+// 描画 ID (マテリアルのインデックス) を使ってテクスチャバッファから読み込む
+uniform samplerBuffer u_Materials;
+
+vec3 u_Diffuse;
+float u_Alpha;
+vec3 u_Ambient;
+float u_SpecularPower;
+vec3 u_Specular;
+float u_TexMode;
+vec4 u_TexMulFactor;
+vec4 u_TexAddFactor;
+vec4 u_SphereTexMulFactor;
+vec4 u_SphereTexAddFactor;
+vec4 u_ToonTexMulFactor;
+vec4 u_ToonTexAddFactor;
+vec4 u_EdgeColor;
+float u_SphereTexMode;
+float u_ToonTexMode;
+float u_ShadowReceiver;
+float u_EdgeSize;
+
+void LoadMaterial(int materialID)
+{
+	int texel = materialID * u_MaterialTexelStride;
+	vec4 t0 = texelFetch(u_Materials, texel + 0);
+	vec4 t1 = texelFetch(u_Materials, texel + 1);
+	vec4 t2 = texelFetch(u_Materials, texel + 2);
+	vec4 t10 = texelFetch(u_Materials, texel + 10);
+	u_Diffuse = t0.xyz;
+	u_Alpha = t0.w;
+	u_Ambient = t1.xyz;
+	u_SpecularPower = t1.w;
+	u_Specular = t2.xyz;
+	u_TexMode = t2.w;
+	u_TexMulFactor = texelFetch(u_Materials, texel + 3);
+	u_TexAddFactor = texelFetch(u_Materials, texel + 4);
+	u_SphereTexMulFactor = texelFetch(u_Materials, texel + 5);
+	u_SphereTexAddFactor = texelFetch(u_Materials, texel + 6);
+	u_ToonTexMulFactor = texelFetch(u_Materials, texel + 7);
+	u_ToonTexAddFactor = texelFetch(u_Materials, texel + 8);
+	u_EdgeColor = texelFetch(u_Materials, texel + 9);
+	u_SphereTexMode = t10.x;
+	u_ToonTexMode = t10.y;
+	u_ShadowReceiver = t10.z;
+	u_EdgeSize = t10.w;
+}
+
+#else
+
+// マテリアル毎
+layout(std140) uniform MMDMaterial
+{
+	vec3 u_Diffuse;
+	float u_Alpha;
+	vec3 u_Ambient;
+	float u_SpecularPower;
+	vec3 u_Specular;
+	float u_TexMode;
+	vec4 u_TexMulFactor;
+	vec4 u_TexAddFactor;
+	vec4 u_SphereTexMulFactor;
+	vec4 u_SphereTexAddFactor;
+	vec4 u_ToonTexMulFactor;
+	vec4 u_ToonTexAddFactor;
+	vec4 u_EdgeColor;
+	float u_SphereTexMode;
+	float u_ToonTexMode;
+	float u_ShadowReceiver;
+	float u_EdgeSize;
+};
+
+#endif